@@ -15,6 +15,9 @@ fi
 
 cd shaders
 
+# A pack left over from an earlier build would be loaded instead of these
+rm -f shaders.pack
+
 # Compile custom vertex shader
 echo "Compiling example.vert.dsl -> shader.vert.spv"
 if ../build/myshaderc example.vert.dsl -o shader.vert.spv -t vertex --stats; then
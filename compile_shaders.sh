@@ -18,6 +18,9 @@ fi
 
 cd shaders
 
+# A pack left over from an earlier build would be loaded instead of these
+rm -f shaders.pack
+
 # Compile vertex shader
 echo "Compiling shader.vert -> shader.vert.spv"
 if glslangValidator -V shader.vert -o shader.vert.spv; then
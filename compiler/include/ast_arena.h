@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <string_view>
+#include <type_traits>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+struct ASTNode;
+
+/**
+ * Bump allocator that owns every AST node and string of one compilation
+ * Nodes are trivially destructible, so the whole tree is released by a
+ * single reset(); the fixed-size blocks are kept and reused by the next
+ * compile, so a steady-state compile does no heap allocation for its AST
+ */
+class AstArena {
+public:
+    explicit AstArena(size_t blockSize = 64 * 1024);
+
+    AstArena(const AstArena&) = delete;
+    AstArena& operator=(const AstArena&) = delete;
+
+    /**
+     * Construct a node in the arena
+     * The returned pointer stays valid until the next reset()
+     */
+    template <typename T, typename... Args>
+    T* create(Args&&... args) {
+        static_assert(std::is_trivially_destructible<T>::value,
+                      "Arena objects are never destroyed individually");
+        return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+
+    /**
+     * Uninitialized storage for count objects of type T
+     */
+    template <typename T>
+    T* allocateArray(size_t count) {
+        static_assert(std::is_trivially_destructible<T>::value,
+                      "Arena objects are never destroyed individually");
+        return static_cast<T*>(allocate(sizeof(T) * count, alignof(T)));
+    }
+
+    /**
+     * Intern a string: equal strings share one copy in the arena, so the
+     * returned view is stable until reset() and cheap to compare and hash
+     */
+    std::string_view intern(std::string_view str);
+
+    /**
+     * Release every node and string at once
+     */
+    void reset();
+
+    /**
+     * Bytes handed out since the last reset (for statistics)
+     */
+    size_t bytesUsed() const { return used; }
+
+private:
+    void* allocate(size_t size, size_t alignment);
+
+    size_t blockSize;
+    std::vector<std::unique_ptr<char[]>> blocks;      // Fixed-size, reused after reset
+    std::vector<std::unique_ptr<char[]>> largeBlocks; // Oversized requests, freed on reset
+    size_t currentBlock = 0;
+    size_t offset = 0;
+    size_t used = 0;
+
+    std::unordered_set<std::string_view> strings;
+};
+
+/**
+ * Growable list of node handles stored in an AstArena
+ * Used instead of std::vector so nodes stay trivially destructible;
+ * growing copies into a larger arena array and abandons the old one
+ */
+class NodeList {
+public:
+    using iterator = ASTNode**;
+    using const_iterator = ASTNode* const*;
+
+    void push_back(AstArena& arena, ASTNode* node);
+    void insert(AstArena& arena, size_t index, ASTNode* node);
+    iterator erase(iterator position);
+    void truncate(size_t newSize) { if (newSize < count) count = static_cast<uint32_t>(newSize); }
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    ASTNode*& operator[](size_t index) { return items[index]; }
+    ASTNode* operator[](size_t index) const { return items[index]; }
+
+    iterator begin() { return items; }
+    iterator end() { return items + count; }
+    const_iterator begin() const { return items; }
+    const_iterator end() const { return items + count; }
+
+private:
+    void reserve(AstArena& arena, uint32_t minimum);
+
+    ASTNode** items = nullptr;
+    uint32_t count = 0;
+    uint32_t capacity = 0;
+};
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "shader_compiler.h"
+#include "codegen.h"
+#include <string>
+#include <vector>
+
+/**
+ * One shader to compile in a batch
+ */
+struct BatchJob {
+    std::string inputFile;
+    std::string outputFile;
+    std::string shaderType;
+};
+
+/**
+ * Outcome of one batch job
+ */
+struct BatchJobResult {
+    bool success = false;
+    std::string error;                       // First line of the failure message
+    CompileDiagnostic diagnostic;            // Stage and position of the failure
+    ShaderCompiler::CompilationStats stats;  // Valid when success is true
+    std::vector<uint32_t> spirv;             // Only with Options::keepSpirv
+};
+
+/**
+ * Compiles many shaders on a pool of worker threads
+ * Every worker owns its own ShaderCompiler, so no compiler state is shared;
+ * jobs are handed out through an atomic index and results are written to
+ * per-job slots, so the only synchronization is joining the workers
+ */
+class BatchCompiler {
+public:
+    struct Options {
+        bool optimizationEnabled = true;
+        SpirvBackend backend = CodeGenerator::defaultBackend();
+        bool spirvOptimizationEnabled = false;
+        std::string cacheDirectory;  // Empty disables the SPIR-V cache
+        unsigned threadCount = 0;    // 0 = one worker per hardware thread
+        bool keepSpirv = false;      // Return each module in its result instead of writing the output file
+        CompileTrace* trace = nullptr;  // Not owned; records every job and its stages when set
+    };
+
+    /**
+     * Totals over a finished batch
+     */
+    struct Summary {
+        size_t succeeded = 0;
+        size_t failed = 0;
+        unsigned threadCount = 0;
+        double wallTimeMs = 0.0;
+        ShaderCompiler::CompilationStats totals;  // Sum over successful jobs
+    };
+
+    explicit BatchCompiler(const Options& options);
+
+    /**
+     * Compile every job and write its SPIR-V to the job's output file (or
+     * keep it in the result)
+     * Failures are recorded per job; the batch always runs to completion
+     * @return One result per job, in job order
+     */
+    std::vector<BatchJobResult> run(const std::vector<BatchJob>& jobs);
+
+    /**
+     * Totals for the last run()
+     */
+    const Summary& getSummary() const { return summary; }
+
+    /**
+     * Read a manifest: one "<input> <vertex|fragment> [output]" job per line,
+     * blank lines and lines starting with '#' are ignored
+     * Relative paths are resolved against the manifest's directory
+     * @throws std::runtime_error if the file cannot be read or a line is malformed
+     */
+    static std::vector<BatchJob> parseManifest(const std::string& manifestFile);
+
+    /**
+     * Build a job from a file name alone: unless given, the type comes from a
+     * ".vert" or ".frag" component ("water.frag.dsl"); the output replaces
+     * ".dsl" with ".spv", optionally inside outputDirectory
+     * @throws std::runtime_error if the shader type cannot be inferred
+     */
+    static BatchJob jobForFile(const std::string& inputFile, const std::string& outputDirectory = "",
+                               const std::string& shaderType = "");
+
+    /**
+     * Number of workers used for a requested count (0 = hardware threads)
+     */
+    static unsigned resolveThreadCount(unsigned requested, size_t jobCount);
+
+private:
+    Options options;
+    Summary summary;
+
+    void compileJob(ShaderCompiler& compiler, const BatchJob& job, BatchJobResult& result) const;
+    static void accumulate(ShaderCompiler::CompilationStats& totals,
+                           const ShaderCompiler::CompilationStats& stats);
+};
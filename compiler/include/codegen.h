@@ -1,19 +1,102 @@
 #pragma once
 
 #include "parser.h"
+#include "type_resolver.h"
+#include <atomic>
 #include <vector>
 #include <string>
 #include <map>
 #include <sstream>
+#include <unordered_map>
+
+class CompileTrace;
+
+/**
+ * Backend used to turn generated GLSL into SPIR-V
+ * Every backend targets Vulkan 1.0 / SPIR-V 1.0, so they are interchangeable
+ * and their modules load on any Vulkan device
+ */
+enum class SpirvBackend {
+    EXTERNAL_VALIDATOR, // Spawn glslangValidator through popen (temp files on disk)
+    GLSLANG_LIBRARY,    // Compile in-process through the linked glslang library
+    NATIVE              // Emit SPIR-V directly from the AST, no GLSL text at all
+};
+
+/**
+ * Generated code kept between generate() calls, for incremental compiles
+ * Statement GLSL is keyed by the statement's structural hash and the local
+ * declaration it starts with; entries the latest generate() did not use are
+ * dropped. A module whose GLSL (or, for the native backend, whose shader)
+ * is unchanged returns the previous SPIR-V without compiling it again
+ */
+struct CodegenMemo {
+    struct StatementKey {
+        AstHash hash;
+        std::string declaration;
+        
+        bool operator==(const StatementKey& other) const {
+            return hash == other.hash && declaration == other.declaration;
+        }
+    };
+    
+    struct StatementKeyHash {
+        size_t operator()(const StatementKey& key) const {
+            return static_cast<size_t>(key.hash.primary) ^ std::hash<std::string>()(key.declaration);
+        }
+    };
+    
+    using StatementMap = std::unordered_map<StatementKey, std::string, StatementKeyHash>;
+    StatementMap statements;  // Used by the current generate()
+    StatementMap previous;    // Used by the one before, consumed as it is reused
+    
+    // Last module generated
+    bool hasModule = false;
+    SpirvBackend moduleBackend = SpirvBackend::NATIVE;
+    std::string moduleShaderType;
+    std::string moduleGLSL;
+    AstHash moduleHash;  // Native backend: hash of the shader declaration
+    std::vector<uint32_t> moduleSPIRV;
+    
+    // Reuse during the last generate()
+    size_t statementsReused = 0;
+    size_t statementsGenerated = 0;
+    bool moduleReused = false;
+};
 
 /**
  * Code generator
- * Converts AST to GLSL and then to SPIR-V
+ * Converts AST to GLSL and then to SPIR-V, or straight to SPIR-V with the
+ * native backend
  */
 class CodeGenerator {
 public:
     CodeGenerator();
+    explicit CodeGenerator(SpirvBackend backend);
     
+    /**
+     * Select the SPIR-V backend
+     * @throws std::runtime_error if the backend is not available in this build
+     */
+    void setBackend(SpirvBackend backend);
+    SpirvBackend getBackend() const { return backend; }
+    
+    /**
+     * Check whether a backend was compiled into this build
+     */
+    static bool isBackendAvailable(SpirvBackend backend);
+    
+    /**
+     * Preferred backend: in-process glslang when linked, glslangValidator otherwise
+     */
+    static SpirvBackend defaultBackend();
+    
+    /**
+     * Backend name as used on the command line ("validator", "glslang", "native")
+     */
+    static const char* backendName(SpirvBackend backend);
+    static bool parseBackendName(const std::string& name, SpirvBackend& backend);
+    
+
     /**
      * Generate SPIR-V from AST
      * @param ast The optimized AST
@@ -24,21 +107,50 @@ public:
     
     /**
      * Get the generated GLSL code (for debugging/inspection)
+     * Empty when the native backend was used
      */
     const std::string& getGeneratedGLSL() const { return lastGeneratedGLSL; }
     
+    /**
+     * Time split of the last generate() call
+     */
+    struct Timings {
+        double glslGenerationMs = 0.0;  // AST -> GLSL text (0 for the native backend)
+        double spirvGenerationMs = 0.0; // GLSL -> SPIR-V, or AST -> SPIR-V for native
+    };
+    
+    const Timings& getTimings() const { return timings; }
+    
+    /**
+     * Reuse code from earlier generate() calls through memo
+     * @param memo Not owned; nullptr generates everything from scratch
+     */
+    void setMemo(CodegenMemo* memo) { this->memo = memo; }
+    
+    /**
+     * Record spans for GLSL emission and SPIR-V generation
+     * @param trace Not owned; nullptr disables tracing
+     */
+    void setTrace(CompileTrace* trace) { this->trace = trace; }
+    
 private:
+    const ShaderDeclNode* findShader(const ProgramNode* ast, const std::string& shaderType);
+    
     // GLSL generation methods
     std::string generateGLSL(const ProgramNode* ast, const std::string& shaderType);
     std::string generateShaderDeclaration(const ShaderDeclNode* shader);
-    std::string generateInputDeclarations(const std::vector<std::unique_ptr<ASTNode>>& inputs);
-    std::string generateOutputDeclarations(const std::vector<std::unique_ptr<ASTNode>>& outputs);
-    std::string generateMainFunction(const std::vector<std::unique_ptr<ASTNode>>& statements);
+    std::string generateInputDeclarations(const NodeList& inputs);
+    std::string generateOutputDeclarations(const NodeList& outputs);
+    std::string generateUniformDeclarations(const NodeList& uniforms, std::string_view shaderType);
+    std::string generateSpecConstantDeclarations(const NodeList& constants);
+    std::string generateMainFunction(const NodeList& statements);
     std::string generateStatement(const ASTNode* node);
     std::string generateExpression(const ASTNode* node);
     
     // SPIR-V compilation methods
     std::vector<uint32_t> compileGLSLToSPIRV(const std::string& glslCode, const std::string& shaderType);
+    std::vector<uint32_t> compileGLSLWithValidator(const std::string& glslCode, const std::string& shaderType);
+    std::vector<uint32_t> compileGLSLInProcess(const std::string& glslCode, const std::string& shaderType);
     std::vector<uint32_t> readSPIRVFile(const std::string& filename);
     
     // Helper methods
@@ -48,7 +160,10 @@ private:
     bool fileExists(const std::string& filename);
     
     // Type mapping
-    std::string mapType(const std::string& type);
+    std::string mapType(std::string_view type);
+    
+    // Types of interface variables and locals declared so far
+    TypeResolver typeResolver;
     
     // Variable location tracking
     std::map<std::string, int> inputLocations;
@@ -56,9 +171,14 @@ private:
     int nextInputLocation = 0;
     int nextOutputLocation = 0;
     
+    SpirvBackend backend;
+    Timings timings;
+    CodegenMemo* memo = nullptr;
+    CompileTrace* trace = nullptr;
+    
     // Store last generated GLSL for debugging
     std::string lastGeneratedGLSL;
     
     // Temp file counter for unique names
-    static int tempFileCounter;
+    static std::atomic<int> tempFileCounter;  // Shared by every compiler instance and thread
 };
\ No newline at end of file
@@ -0,0 +1,167 @@
+#pragma once
+
+#include "shader_compiler.h"
+#include "shader_cache.h"
+#include "codegen.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * One shader in a request to the compile server
+ */
+struct CompileRequest {
+    std::string name;         // For diagnostics only (usually the file name)
+    std::string shaderType;   // "vertex" or "fragment"
+    std::string source;
+    bool optimizationEnabled = true;
+    SpirvBackend backend = CodeGenerator::defaultBackend();
+    bool spirvOptimizationEnabled = false;
+};
+
+/**
+ * Answer to one CompileRequest
+ */
+struct CompileResponse {
+    enum class CacheResult : uint8_t {
+        MISS,
+        MEMORY,
+        DISK
+    };
+
+    bool success = false;
+    CacheResult cache = CacheResult::MISS;
+    double compileTimeMs = 0.0;     // On the server, excluding queueing
+    std::vector<uint32_t> spirv;    // Valid when success is true
+    std::string error;              // Full message otherwise
+    CompileDiagnostic diagnostic;   // Stage and position of the failure
+};
+
+/**
+ * Long-running compile server on a Unix stream socket
+ * A connection carries any number of batches; each batch is a single
+ * request frame holding many shaders and is answered by one response frame
+ * with one result per shader, in order. The shaders are spread over a pool
+ * of workers, each owning a ShaderCompiler, that share an in-memory LRU of
+ * SPIR-V in front of the optional on-disk cache. Frames are native-endian,
+ * as both ends run on the same machine
+ */
+class CompileServer {
+public:
+    struct Options {
+        std::string socketPath;
+        unsigned threadCount = 0;                      // 0 = one worker per hardware thread
+        std::string cacheDirectory;                    // Empty disables the on-disk cache
+        size_t memoryCacheBytes = 64 * 1024 * 1024;
+    };
+
+    struct Stats {
+        size_t connections = 0;
+        size_t batches = 0;
+        size_t shaders = 0;
+        size_t failures = 0;
+        ShaderMemoryCache::Stats memoryCache;
+    };
+
+    explicit CompileServer(const Options& options);
+    ~CompileServer();
+
+    CompileServer(const CompileServer&) = delete;
+    CompileServer& operator=(const CompileServer&) = delete;
+
+    /**
+     * Bind the socket and start accepting connections in the background
+     * A stale socket file is replaced; a socket with a live server is not
+     * @throws std::runtime_error if the socket cannot be bound
+     */
+    void start();
+
+    /**
+     * Close every connection, finish the queued shaders and join all threads
+     * Removes the socket file
+     */
+    void stop();
+
+    unsigned getThreadCount() const { return static_cast<unsigned>(workers.size()); }
+    Stats getStats() const;
+
+private:
+    // Shaders of one request frame; answered once every one is compiled
+    struct Batch {
+        std::vector<CompileRequest> requests;
+        std::vector<CompileResponse> responses;
+        size_t remaining = 0;
+    };
+
+    struct Task {
+        Batch* batch;
+        size_t index;
+    };
+
+    struct Connection {
+        int fd = -1;
+        std::thread thread;
+        std::atomic<bool> done{false};
+    };
+
+    void acceptLoop();
+    void serveConnection(Connection* connection);
+    void workerLoop();
+    void compileTask(ShaderCompiler& compiler, const Task& task);
+    void reapConnections(bool all);
+
+    Options options;
+    std::unique_ptr<ShaderMemoryCache> memoryCache;
+
+    int listenFd = -1;
+    std::atomic<bool> stopping{false};
+    std::thread acceptThread;
+
+    std::mutex connectionMutex;
+    std::list<std::unique_ptr<Connection>> connections;
+
+    // Worker pool; a batch waits on batchDone until its remaining count is zero
+    std::mutex queueMutex;
+    std::condition_variable queueReady;
+    std::condition_variable batchDone;
+    std::deque<Task> queue;
+    bool workersExit = false;
+    std::vector<std::thread> workers;
+
+    mutable std::mutex statsMutex;
+    Stats stats;
+};
+
+/**
+ * Client side of the compile server protocol
+ * One connection, reused for every batch; not thread-safe
+ */
+class CompileClient {
+public:
+    /**
+     * @throws std::runtime_error if no server is listening on socketPath
+     */
+    explicit CompileClient(const std::string& socketPath);
+    ~CompileClient();
+
+    CompileClient(const CompileClient&) = delete;
+    CompileClient& operator=(const CompileClient&) = delete;
+
+    /**
+     * Compile a batch on the server
+     * Per-shader failures are reported in the responses
+     * @return One response per request, in order
+     * @throws std::runtime_error if the connection fails
+     */
+    std::vector<CompileResponse> compile(const std::vector<CompileRequest>& requests);
+
+private:
+    int fd = -1;
+};
@@ -0,0 +1,147 @@
+#pragma once
+
+#include "ast_arena.h"
+#include "codegen.h"
+#include "lexer.h"
+#include "parser.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Incremental compilation of one shader that is edited and recompiled
+ * repeatedly, e.g. by an editor's live preview
+ * Each update() re-lexes only the edited range and splices the new tokens
+ * into the previous stream. Main-block statements whose tokens did not
+ * change keep their parsed AST, statements that also read variables of the
+ * same types keep their simplified form, and unchanged statements keep
+ * their GLSL. Dead code elimination and CSE still see the whole shader, and
+ * a module whose final code changed is compiled to SPIR-V as a whole. The
+ * result is the same as ShaderCompiler::compile() with the same options
+ */
+class CompileSession {
+public:
+    /**
+     * Work done and skipped by the last update()
+     */
+    struct UpdateStats {
+        size_t tokenCount = 0;
+        size_t tokensRelexed = 0;
+        size_t statementsParsed = 0;
+        size_t statementsReused = 0;        // Parsed AST taken from the previous update
+        size_t statementsSimplified = 0;
+        size_t simplificationsReused = 0;
+        size_t glslStatementsGenerated = 0;
+        size_t glslStatementsReused = 0;
+        bool spirvReused = false;           // Final code unchanged; previous module returned
+        bool fullRebuild = false;           // Memoized ASTs were dropped to compact the arena
+        double lexingTimeMs = 0.0;
+        double parsingTimeMs = 0.0;
+        double optimizationTimeMs = 0.0;
+        double codegenTimeMs = 0.0;
+        double spirvOptimizationTimeMs = 0.0;
+        double totalTimeMs = 0.0;
+    };
+
+    /**
+     * @param shaderType "vertex" or "fragment"
+     * @throws std::runtime_error for any other shader type
+     */
+    explicit CompileSession(const std::string& shaderType);
+
+    CompileSession(const CompileSession&) = delete;
+    CompileSession& operator=(const CompileSession&) = delete;
+
+    void setOptimizationEnabled(bool enabled);
+    bool isOptimizationEnabled() const { return optimizationEnabled; }
+
+    /**
+     * @throws std::runtime_error if the backend is not available in this build
+     */
+    void setBackend(SpirvBackend backend);
+    SpirvBackend getBackend() const { return backend; }
+
+    void setSpirvOptimizationEnabled(bool enabled);
+    bool isSpirvOptimizationEnabled() const { return spirvOptimizationEnabled; }
+
+    /**
+     * Compile the current text of the shader
+     * The source is copied; on failure the session keeps what it can reuse
+     * and the next update() starts from there
+     * @return SPIR-V bytecode
+     * @throws ShaderCompilationError on compilation failure
+     */
+    std::vector<uint32_t> update(std::string_view source);
+
+    const UpdateStats& getLastUpdate() const { return lastUpdate; }
+
+    /**
+     * GLSL of the last update that reached code generation, including one
+     * the GLSL compiler rejected (empty for the native backend)
+     */
+    const std::string& getGeneratedGLSL() const { return generatedGLSL; }
+
+    /**
+     * Forget everything; the next update() compiles from scratch
+     */
+    void reset();
+
+private:
+    // Parsed main-block statement, keyed by the text of its tokens
+    struct ParsedStatement {
+        ASTNode* node = nullptr;
+        AstHash hash;
+    };
+
+    // Simplified statement, keyed by the parsed statement and the types of
+    // what it reads
+    struct SimplifyKey {
+        AstHash hash;
+        std::string context;
+
+        bool operator==(const SimplifyKey& other) const {
+            return hash == other.hash && context == other.context;
+        }
+    };
+
+    struct SimplifyKeyHash {
+        size_t operator()(const SimplifyKey& key) const {
+            return static_cast<size_t>(key.hash.primary) ^ std::hash<std::string>()(key.context);
+        }
+    };
+
+    // Re-lex source against the previous token stream
+    std::vector<Token> relex(const std::string& next);
+    size_t offsetOf(const Token& token) const { return static_cast<size_t>(token.value.data() - source.data()); }
+
+    // Text of the statement starting at tokens[first], up to its ';'
+    bool statementKey(size_t first, std::string& key, size_t& end) const;
+
+    ProgramNode* parse(std::vector<AstHash>& hashes);
+    ProgramNode* optimize(ProgramNode* ast, const std::vector<AstHash>& hashes);
+
+    std::string shaderType;
+    bool optimizationEnabled = true;
+    bool spirvOptimizationEnabled = false;
+    SpirvBackend backend;
+
+    std::string source;
+    std::vector<Token> tokens;      // Views into source, terminated by END_OF_FILE
+    bool hasResult = false;
+    std::vector<uint32_t> spirv;    // Result of the last successful update, after SPIR-V optimization
+    std::string generatedGLSL;
+
+    // Every memoized node lives in the arena; it is only reset, together
+    // with the memos, once garbage from earlier updates outgrows the
+    // live AST
+    AstArena arena;
+    size_t compactThreshold = 0;
+
+    std::unordered_map<std::string, ParsedStatement> parsedStatements;
+    std::unordered_map<SimplifyKey, ASTNode*, SimplifyKeyHash> simplifiedStatements;
+    CodegenMemo codegenMemo;
+
+    UpdateStats lastUpdate;
+};
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+/**
+ * Timed spans of the compiler pipeline, written as a Chrome trace
+ * (chrome://tracing, Perfetto)
+ * Each stage takes a CompileTrace pointer that is null unless tracing was
+ * asked for, so an untraced compile only pays a null check per span.
+ * Recording is thread-safe; every thread gets its own track
+ */
+class CompileTrace {
+public:
+    struct Span {
+        std::string name;
+        const char* category;
+        std::string detail;     // Shown under args; empty for none
+        double startUs;         // Since the trace was created
+        double durationUs;
+        uint32_t thread;        // Order in which threads first recorded a span
+    };
+
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * Span from construction to destruction; does nothing for a null trace
+     */
+    class Scope {
+    public:
+        // detail is only copied when tracing
+        Scope(CompileTrace* trace, const char* name, const char* category, std::string_view detail = {})
+            : trace(trace) {
+            if (trace) {
+                this->name = name;
+                this->category = category;
+                this->detail = detail;
+                start = Clock::now();
+            }
+        }
+
+        ~Scope() {
+            if (trace) {
+                trace->record(name, category, std::move(detail), start, Clock::now());
+            }
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        CompileTrace* trace;
+        const char* name = nullptr;
+        const char* category = nullptr;
+        std::string detail;
+        Clock::time_point start;
+    };
+
+    CompileTrace() : origin(Clock::now()) {}
+
+    void record(const char* name, const char* category, std::string detail, Clock::time_point start,
+                Clock::time_point end);
+
+    std::vector<Span> getSpans() const;
+    void clear();
+
+    // Complete ("X") events in microseconds, one track per thread
+    bool writeChromeTrace(const std::string& path) const;
+
+private:
+    Clock::time_point origin;
+    mutable std::mutex mutex;
+    std::vector<Span> spans;
+    std::vector<std::thread::id> threads;
+};
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <exception>
+#include <stdexcept>
+#include <string>
+
+/**
+ * Compilation error raised where the problem was found
+ * The lexer and parser throw it with the line and column of the offending
+ * token; later stages throw plain std::runtime_error, which ShaderCompiler
+ * tags with the stage it was running. Callers read the stage and position
+ * from the fields, never from what()
+ */
+class ShaderCompilationError : public std::runtime_error {
+public:
+    enum class Stage {
+        LEXING,
+        PARSING,
+        OPTIMIZATION,
+        CODE_GENERATION
+    };
+
+    /**
+     * @param line 1-based; 0 when the error has no source position
+     */
+    ShaderCompilationError(Stage stage, const std::string& message, int line = 0, int column = 0)
+        : std::runtime_error(formatMessage(stage, message, line, column))
+        , stage_(stage)
+        , message_(message)
+        , line_(line)
+        , column_(column) {}
+
+    Stage getStage() const { return stage_; }
+    const std::string& getMessage() const { return message_; }  // Without the stage and position
+    int getLine() const { return line_; }
+    int getColumn() const { return column_; }
+    bool hasLocation() const { return line_ > 0; }
+
+    static const char* stageName(Stage stage);
+
+    /**
+     * Rethrow error as a ShaderCompilationError; one that already is keeps
+     * its own stage and position, anything else is tagged with stage
+     */
+    [[noreturn]] static void rethrow(Stage stage, const std::runtime_error& error);
+
+private:
+    Stage stage_;
+    std::string message_;
+    int line_;
+    int column_;
+
+    static std::string formatMessage(Stage stage, const std::string& message, int line, int column);
+};
+
+/**
+ * A failed compile as plain data, for results that outlive the exception
+ * (batch results, compile server responses)
+ */
+struct CompileDiagnostic {
+    bool hasStage = false;  // false for errors outside the pipeline (I/O, options)
+    ShaderCompilationError::Stage stage = ShaderCompilationError::Stage::CODE_GENERATION;
+    int line = 0;
+    int column = 0;
+    std::string message;    // Without the stage and position
+
+    static CompileDiagnostic fromException(const std::exception& error);
+
+    /**
+     * The text what() had: "[Parsing Error] 3:14: message"
+     */
+    std::string format() const;
+};
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <vector>
 
 /**
@@ -14,6 +15,7 @@ enum class TokenType {
     INPUT,
     OUTPUT,
     UNIFORM,
+    CONST,
     MAIN,
     
     // Types
@@ -51,41 +53,71 @@ enum class TokenType {
 
 /**
  * Token structure
+ * value is a view into the lexer's source buffer, not a copy
  */
 struct Token {
-    TokenType type;
-    std::string value;
-    int line;
-    int column;
+    TokenType type = TokenType::END_OF_FILE;
+    std::string_view value;
+    int line = 0;
+    int column = 0;
 };
 
 /**
  * Lexer (Tokenizer) for the shader language
  * Converts source code into a stream of tokens
+ * Tokens are produced on demand and point into the source, which must
+ * outlive the lexer and every token it returns
  */
 class Lexer {
 public:
-    Lexer(const std::string& source);
+    Lexer(std::string_view source);
+    
+    /**
+     * Resume lexing mid-source, e.g. to re-lex an edited range
+     * @param position Offset of a token start (or of whitespace before one)
+     * @param line Line of that offset
+     * @param column Column of that offset
+     */
+    Lexer(std::string_view source, size_t position, int line, int column);
+    
+    /**
+     * Produce the next token
+     * Returns END_OF_FILE once the source is exhausted (repeatedly)
+     * @throws ShaderCompilationError (LEXING) on an unexpected character
+     */
+    Token next();
     
     /**
      * Tokenize the entire source
-     * @return Vector of tokens
+     * @return Vector of tokens, terminated by END_OF_FILE
      */
     std::vector<Token> tokenize();
     
+    /**
+     * Number of tokens returned so far, including END_OF_FILE
+     */
+    size_t getTokenCount() const { return tokenCount; }
+    
+    /**
+     * Classify an identifier: the keyword's token type, or IDENTIFIER
+     */
+    static TokenType keywordType(std::string_view word);
+    
 private:
-    std::string source;
+    std::string_view source;
     size_t position = 0;
     int line = 1;
     int column = 1;
+    size_t tokenCount = 0;
+    bool reachedEnd = false;
     
-    char currentChar();
-    char peek(int offset = 1);
+    char currentChar() const;
+    char peek(int offset = 1) const;
     void advance();
     void skipWhitespace();
     void skipComment();
     
     Token readNumber();
     Token readIdentifier();
-    Token makeToken(TokenType type, const std::string& value);
+    Token makeToken(TokenType type, size_t length);
 };
\ No newline at end of file
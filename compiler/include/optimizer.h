@@ -1,10 +1,11 @@
 #pragma once
 
 #include "parser.h"
-#include <memory>
-#include <set>
-#include <map>
+#include "type_resolver.h"
 #include <string>
+#include <vector>
+
+class CompileTrace;
 
 /**
  * Shader optimizer
@@ -12,7 +13,10 @@
  */
 class Optimizer {
 public:
-    Optimizer();
+    /**
+     * @param arena Arena of the AST being optimized; folded literals are allocated in it
+     */
+    explicit Optimizer(AstArena& arena);
     
     /**
      * Optimize the AST
@@ -20,6 +24,29 @@ public:
      */
     void optimize(ProgramNode* ast);
     
+    /**
+     * Record a span per pass and shader
+     * @param trace Not owned; nullptr disables tracing
+     */
+    void setTrace(CompileTrace* trace) { this->trace = trace; }
+    
+    /**
+     * The steps of optimize() for one shader, for callers that reuse
+     * simplified statements between compiles: beginShader, then for every
+     * statement in order simplifyStatement (or a copy of an earlier result
+     * with the same typeContext) and declareAssignment, then finishShader
+     */
+    void beginShader(const ShaderDeclNode* shader);
+    void simplifyStatement(AssignmentNode* assign);
+    void declareAssignment(const AssignmentNode* assign);
+    void finishShader(ShaderDeclNode* shader);  // Dead code and CSE over the whole shader
+    
+    /**
+     * Types of the variables an assignment reads, as currently in scope
+     * Simplifying the same statement in the same context gives the same result
+     */
+    std::string typeContext(const AssignmentNode* assign) const;
+    
     /**
      * Get optimization statistics
      */
@@ -27,36 +54,81 @@ public:
         int constantsFolded = 0;
         int deadCodeRemoved = 0;
         int algebraicSimplifications = 0;
-        int totalPasses = 0;
+        int commonSubexpressionsEliminated = 0;  // Duplicate evaluations replaced by a temporary
+        int totalPasses = 0;  // Sweeps over the program; one sweep reaches the fixed point
+        
+        // Time spent in each pass, summed over shaders
+        double simplifyTimeMs = 0.0;  // Constant folding and algebraic simplification
+        double deadCodeTimeMs = 0.0;
+        double cseTimeMs = 0.0;
     };
     
     const OptimizationStats& getStats() const { return stats; }
-    
+
 private:
+    AstArena& arena;
     OptimizationStats stats;
+    CompileTrace* trace = nullptr;
+    TypeResolver types;  // Variables of the shader being simplified
+    
+    // Simplify an expression bottom-up, replacing it in its parent's slot
+    bool simplifyExpression(ASTNode*& node);
+    struct SimplifyFrame {
+        ASTNode** slot;
+        bool expanded;  // Operands pushed
+    };
+    std::vector<SimplifyFrame> simplifyStack;
+    
+    // Fold or rewrite a chain whose operands are already simplified, all
+    // levels of it in one pass; returns the replacement or nullptr
+    ASTNode* rewriteBinaryOp(BinaryOpNode* node);
+    
+    // Remove assignments whose value is never read (worklist over use counts)
+    bool eliminateDeadCode(ShaderDeclNode* shader);
     
-    // Optimization pass methods
-    bool constantFoldingPass(ASTNode* node);
-    bool deadCodeEliminationPass(ProgramNode* ast);
-    bool algebraicSimplificationPass(ASTNode* node);
+    // Hoist expressions computed more than once into _cseN temporaries
+    bool eliminateCommonSubexpressions(ShaderDeclNode* shader);
+    
+    // Value of a compile-time constant: a literal, a vecN constructor of
+    // constants, or a swizzle of one
+    struct Constant {
+        int components = 0;      // 1 = scalar, 2-4 = vector
+        bool isInteger = false;  // Scalar int literal, or arithmetic on only those
+        float values[4] = {};
+    };
+    
+    // Fold a constructor or swizzle with a known value into a literal or a
+    // vecN of literals; returns nullptr if it already is one
+    ASTNode* foldConstantExpression(ASTNode* node);
     
     // Helper methods for constant folding
     bool isLiteral(ASTNode* node);
-    bool isLiteralValue(ASTNode* node, float value);
-    float getLiteralValue(ASTNode* node);
-    std::unique_ptr<ASTNode> foldBinaryOp(const std::string& op, float left, float right);
-    
-    // Helper methods for dead code elimination
-    void collectDeclaredVariables(ShaderDeclNode* shader, std::set<std::string>& declared);
-    void collectUsedVariables(ASTNode* node, std::set<std::string>& used);
-    void collectUsedVariablesInStatements(const std::vector<std::unique_ptr<ASTNode>>& statements, 
-                                         std::set<std::string>& used);
-    bool isOutputVariable(const std::string& varName, ShaderDeclNode* shader);
+    bool evaluateConstant(const ASTNode* node, Constant& result) const;
+    static bool combineConstants(std::string_view op, const Constant& left, const Constant& right,
+                                 Constant& result);
+    ASTNode* makeConstant(const Constant& value);
+    ASTNode* makeZero(ValueType type);
+    LiteralNode* makeLiteral(float value, bool isInteger);
     
     // Helper methods for algebraic simplification
-    std::unique_ptr<ASTNode> simplifyBinaryOp(BinaryOpNode* node, bool& changed);
-    std::unique_ptr<ASTNode> cloneNode(ASTNode* node);
+    // Component count of a constant whose every component is value, or 0
+    int constantSplatSize(ASTNode* node, float value) const;
     
-    // Traversal helpers
-    bool optimizeNodeRecursive(ASTNode* node, bool (Optimizer::*optimizeFunc)(ASTNode*));
+    // Working copy of a chain; ops[i] is the operator in front of operands[i]
+    struct Chain {
+        std::vector<ASTNode*> operands;
+        std::string ops;
+    };
+    Chain workingChain;  // Reused by every rewriteBinaryOp()
+    // Type of the first count operands of the chain
+    ValueType chainType(const Chain& chain, size_t count) const;
+    // Rewrites of a chain; each returns whether it changed anything
+    // Merge the constants of the chain, and of nested chains of its level, into one
+    bool gatherConstants(Chain& chain);
+    // Nested chain without its merged constants; may negate op in front of it
+    ASTNode* removeConstants(BinaryOpNode* nested, char& op);
+    // A product with a zero factor in its leading run of * becomes zero
+    bool foldZeroProduct(Chain& chain);
+    // Drop 0 and 1 operands that do not affect the result or its type
+    bool dropIdentities(Chain& chain);
 };
\ No newline at end of file
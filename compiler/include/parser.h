@@ -1,9 +1,13 @@
 #pragma once
 
 #include "lexer.h"
-#include <memory>
+#include "ast_arena.h"
+#include "diagnostics.h"
+#include <cstdint>
+#include <functional>
 #include <vector>
 #include <string>
+#include <string_view>
 
 /**
  * AST Node types
@@ -12,6 +16,7 @@ enum class ASTNodeType {
     PROGRAM,
     SHADER_DECL,
     VARIABLE_DECL,
+    SPEC_CONSTANT_DECL,
     FUNCTION_DECL,
     ASSIGNMENT,
     BINARY_OP,
@@ -23,17 +28,19 @@ enum class ASTNodeType {
 
 /**
  * Base AST Node
+ * Nodes live in an AstArena: children are plain pointers into the same
+ * arena and strings are interned views, so nodes have no destructor and
+ * the tree is dispatched on `type` rather than through a vtable
  */
 struct ASTNode {
     ASTNodeType type;
-    virtual ~ASTNode() = default;
 };
 
 /**
  * Program node (root of AST)
  */
 struct ProgramNode : public ASTNode {
-    std::vector<std::unique_ptr<ASTNode>> declarations;
+    NodeList declarations;
     ProgramNode() { type = ASTNodeType::PROGRAM; }
 };
 
@@ -41,10 +48,12 @@ struct ProgramNode : public ASTNode {
  * Shader declaration node
  */
 struct ShaderDeclNode : public ASTNode {
-    std::string shaderType; // "vertex" or "fragment"
-    std::vector<std::unique_ptr<ASTNode>> inputs;
-    std::vector<std::unique_ptr<ASTNode>> outputs;
-    std::vector<std::unique_ptr<ASTNode>> statements;
+    std::string_view shaderType; // "vertex" or "fragment"
+    NodeList inputs;
+    NodeList outputs;
+    NodeList uniforms; // Members of the stage's uniform block, in declaration order
+    NodeList constants; // Specialization constants, in constant_id order
+    NodeList statements;
     ShaderDeclNode() { type = ASTNodeType::SHADER_DECL; }
 };
 
@@ -52,35 +61,53 @@ struct ShaderDeclNode : public ASTNode {
  * Variable declaration node
  */
 struct VariableDeclNode : public ASTNode {
-    std::string varType; // vec3, float, etc.
-    std::string name;
+    std::string_view varType; // vec3, float, etc.
+    std::string_view name;
     VariableDeclNode() { type = ASTNodeType::VARIABLE_DECL; }
 };
 
+/**
+ * Specialization constant declaration (const float name = 1.0;)
+ * Ids are assigned in declaration order within the shader, starting at 0;
+ * the value is a numeric literal used when the pipeline does not override it
+ */
+struct SpecConstantNode : public ASTNode {
+    std::string_view varType; // float or int
+    std::string_view name;
+    std::string_view defaultValue;
+    uint32_t constantId = 0;
+    SpecConstantNode() { type = ASTNodeType::SPEC_CONSTANT_DECL; }
+};
+
 /**
  * Assignment node
  */
 struct AssignmentNode : public ASTNode {
-    std::unique_ptr<ASTNode> target;
-    std::unique_ptr<ASTNode> value;
+    ASTNode* target = nullptr;
+    ASTNode* value = nullptr;
     AssignmentNode() { type = ASTNodeType::ASSIGNMENT; }
 };
 
 /**
- * Binary operation node
+ * Binary operators of one precedence level, flattened into a single node
+ * a - b + c has operands {a, b, c} and ops "+-+": evaluated left to right,
+ * ops[i] combines operand i with the value of the operands before it.
+ * ops[0] names the level: '+' for + and -, '*' for * and /
  */
 struct BinaryOpNode : public ASTNode {
-    std::string op; // +, -, *, /
-    std::unique_ptr<ASTNode> left;
-    std::unique_ptr<ASTNode> right;
+    NodeList operands;    // At least two
+    std::string_view ops; // One operator per operand
     BinaryOpNode() { type = ASTNodeType::BINARY_OP; }
+    
+    std::string_view op(size_t i) const { return ops.substr(i, 1); }
+    bool isAdditive() const { return ops[0] == '+'; }
 };
 
 /**
  * Identifier node
  */
 struct IdentifierNode : public ASTNode {
-    std::string name;
+    std::string_view name;
     IdentifierNode() { type = ASTNodeType::IDENTIFIER; }
 };
 
@@ -88,7 +115,7 @@ struct IdentifierNode : public ASTNode {
  * Literal node
  */
 struct LiteralNode : public ASTNode {
-    std::string value;
+    std::string_view value;
     LiteralNode() { type = ASTNodeType::LITERAL; }
 };
 
@@ -96,8 +123,8 @@ struct LiteralNode : public ASTNode {
  * Member access node (e.g., position.xyz)
  */
 struct MemberAccessNode : public ASTNode {
-    std::unique_ptr<ASTNode> object;
-    std::string member;
+    ASTNode* object = nullptr;
+    std::string_view member;
     MemberAccessNode() { type = ASTNodeType::MEMBER_ACCESS; }
 };
 
@@ -105,8 +132,8 @@ struct MemberAccessNode : public ASTNode {
  * Function call node (e.g., vec4(position, 1.0))
  */
 struct FunctionCallNode : public ASTNode {
-    std::string functionName;
-    std::vector<std::unique_ptr<ASTNode>> arguments;
+    std::string_view functionName;
+    NodeList arguments;
     FunctionCallNode() { type = ASTNodeType::FUNCTION_CALL; }
 };
 
@@ -116,37 +143,114 @@ struct FunctionCallNode : public ASTNode {
  */
 class Parser {
 public:
-    Parser(const std::vector<Token>& tokens);
+    /**
+     * @param lexer Token source; tokens are pulled one at a time
+     * @param arena Arena that will own every node of the AST
+     */
+    Parser(Lexer& lexer, AstArena& arena);
+    
+    /**
+     * @param tokens Already lexed tokens, terminated by END_OF_FILE; must
+     *               outlive the parser
+     * @param arena Arena that will own every node of the AST
+     */
+    Parser(const std::vector<Token>& tokens, AstArena& arena);
+    
+    /**
+     * Called before each statement of a main block with the index of its
+     * first token. Returning a node uses it in place of parsing the
+     * statement, and end must then be set to the index of the token after
+     * it; returning nullptr parses the statement as usual
+     * Only consulted when parsing a token vector
+     */
+    using StatementLookup = std::function<ASTNode*(size_t first, size_t& end)>;
+    void setStatementLookup(StatementLookup lookup) { statementLookup = std::move(lookup); }
     
     /**
      * Parse tokens into AST
-     * @return Root program node
+     * @return Root program node, owned by the arena
      */
-    std::unique_ptr<ProgramNode> parse();
+    ProgramNode* parse();
     
 private:
-    std::vector<Token> tokens;
-    size_t position = 0;
+    Lexer* lexer = nullptr;                     // Streaming source, or
+    const std::vector<Token>* tokens = nullptr; // a token vector
+    size_t tokenIndex = 0;                      // Index of currentToken in tokens
+    StatementLookup statementLookup;
+    AstArena& arena;
+    Token currentToken;
     
     // Token navigation helpers
-    Token& current();
-    Token& peek(int offset = 1);
+    const Token& current() const { return currentToken; }
     void advance();
     bool match(TokenType type);
-    void expect(TokenType type, const std::string& message);
+    void expect(TokenType type, const char* message);
     bool check(TokenType type);
     
+    // Throw a parsing error at the current token
+    [[noreturn]] void error(const std::string& message) const;
+    
     // Parsing methods for different constructs
-    std::unique_ptr<ShaderDeclNode> parseShaderDecl();
-    std::unique_ptr<VariableDeclNode> parseVariableDecl(bool isInput);
-    std::unique_ptr<ASTNode> parseStatement();
-    std::unique_ptr<ASTNode> parseExpression();
-    std::unique_ptr<ASTNode> parseTerm();
-    std::unique_ptr<ASTNode> parseFactor();
-    std::unique_ptr<ASTNode> parsePrimary();
-    std::unique_ptr<FunctionCallNode> parseFunctionCall(const std::string& funcName);
+    ShaderDeclNode* parseShaderDecl();
+    VariableDeclNode* parseVariableDecl(bool isInput);
+    SpecConstantNode* parseSpecConstantDecl(uint32_t constantId);
+    ASTNode* parseStatement();
+    ASTNode* parseExpression();
+    ASTNode* parsePrimary();
+    
+    // Precedence climbing state of parseExpression(), kept across calls so
+    // a steady-state parse does not allocate for it. Each operand is stored
+    // with the operator in front of it; a nested call (function arguments)
+    // works above the entries of its caller
+    struct ExpressionFrame {
+        size_t sumStart;      // First term of this parenthesized level
+        size_t productStart;  // First factor of the term being read
+        char op;              // Operator in front of the group in its parent
+    };
+    std::vector<ASTNode*> operandStack;
+    std::vector<uint32_t> depthStack;     // Tree depth of each operand
+    std::string operatorStack;
+    std::vector<ExpressionFrame> frameStack;
+    uint32_t expressionDepth = 0;         // Of the last primary or expression parsed
+    uint32_t nestedExpressions = 0;       // parseExpression() calls in progress
+    
+    // Later stages walk an expression recursively, so its tree depth is
+    // bounded. Chains and left-nested groups are flat and never reach it
+    static constexpr uint32_t maxExpressionDepth = 512;
+    
+    void pushOperand(ASTNode* node, char op, uint32_t depth);
+    void checkDepth(uint32_t depth);
+    void closeProduct(ExpressionFrame& frame);
+    ASTNode* closeGroup(ExpressionFrame& frame);
+    void closeParenthesized();
+    ASTNode* makeChain(size_t start, char level);
+    FunctionCallNode* parseFunctionCall(std::string_view funcName);
     
     // Helper to parse type tokens
-    std::string parseType();
+    std::string_view parseType();
     bool isTypeToken(TokenType type);
-};
\ No newline at end of file
+};
+
+/**
+ * Deep-copy an AST subtree into arena
+ * Strings are interned views and are shared with the original, so the copy
+ * must not outlive the arena the original was parsed into
+ */
+ASTNode* cloneAST(AstArena& arena, const ASTNode* node);
+
+/**
+ * Structural hash of an AST subtree: equal for trees that print the same,
+ * independent of which arena they live in. Two independent 64-bit halves,
+ * so a key built from both is safe to use without comparing the trees
+ */
+struct AstHash {
+    uint64_t primary = 0;
+    uint64_t secondary = 0;
+    
+    bool operator==(const AstHash& other) const {
+        return primary == other.primary && secondary == other.secondary;
+    }
+    bool operator!=(const AstHash& other) const { return !(*this == other); }
+};
+
+AstHash hashAST(const ASTNode* node);
\ No newline at end of file
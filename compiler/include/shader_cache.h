@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Content-addressed on-disk SPIR-V cache
+ * Entries are named after a hash of everything that influences the output
+ * (source bytes, shader type, compiler options, compiler version) and also
+ * store a second, independent hash that is verified on load so a collision
+ * of the file name can never return the wrong module
+ */
+class ShaderCache {
+public:
+    /**
+     * @param directory Cache directory (created on first store)
+     */
+    explicit ShaderCache(const std::string& directory);
+
+    /**
+     * Cache key for one compilation
+     */
+    struct Key {
+        uint64_t primary = 0;   // Names the entry file
+        uint64_t secondary = 0; // Verified against the entry header
+    };
+
+    /**
+     * Build a key from the compilation inputs
+     * @param source Shader source bytes
+     * @param shaderType "vertex" or "fragment"
+     * @param optionsSignature Serialized compiler options and version
+     */
+    static Key makeKey(std::string_view source, std::string_view shaderType,
+                       std::string_view optionsSignature);
+
+    /**
+     * Look up an entry
+     * @return true and fills spirv on a hit
+     */
+    bool load(const Key& key, std::vector<uint32_t>& spirv) const;
+
+    /**
+     * Store an entry; written to a temporary file and renamed into place so
+     * concurrent readers and writers never observe a partial entry
+     * @return false if the entry could not be written (the cache is best effort)
+     */
+    bool store(const Key& key, const std::vector<uint32_t>& spirv) const;
+
+    const std::string& getDirectory() const { return directory; }
+
+private:
+    std::string entryPath(const Key& key) const;
+
+    std::string directory;
+};
+
+/**
+ * In-memory LRU of compiled SPIR-V, shared by many compilers
+ * Uses the same keys as ShaderCache and sits in front of it; lookups and
+ * stores are thread-safe, and the least recently used modules are evicted
+ * once the stored SPIR-V exceeds the capacity
+ */
+class ShaderMemoryCache {
+public:
+    /**
+     * @param capacityBytes Upper bound on the SPIR-V bytes held
+     */
+    explicit ShaderMemoryCache(size_t capacityBytes = 64 * 1024 * 1024);
+
+    /**
+     * Look up an entry and mark it as most recently used
+     * @return true and fills spirv on a hit
+     */
+    bool load(const ShaderCache::Key& key, std::vector<uint32_t>& spirv);
+
+    /**
+     * Insert or replace an entry; modules larger than the capacity are not kept
+     */
+    void store(const ShaderCache::Key& key, const std::vector<uint32_t>& spirv);
+
+    struct Stats {
+        size_t entries = 0;
+        size_t bytes = 0;
+        size_t hits = 0;
+        size_t misses = 0;
+        size_t evictions = 0;
+    };
+
+    Stats getStats() const;
+
+private:
+    struct Entry {
+        ShaderCache::Key key;
+        std::vector<uint32_t> spirv;
+    };
+
+    void evict();
+
+    size_t capacityBytes;
+    mutable std::mutex mutex;
+    std::list<Entry> entries;  // Most recently used first
+    std::unordered_map<uint64_t, std::list<Entry>::iterator> index;  // By primary hash
+    Stats stats;
+};
@@ -1,17 +1,37 @@
 #pragma once
 
+#include "diagnostics.h"
 #include <string>
+#include <string_view>
 #include <vector>
 #include <memory>
 #include <stdexcept>
+#include <utility>
 
 // Forward declarations
 struct Token;
+struct ASTNode;
 struct ProgramNode;
 class Lexer;
 class Parser;
 class Optimizer;
 class CodeGenerator;
+class ShaderCache;
+class ShaderMemoryCache;
+class AstArena;
+class CompileTrace;
+enum class SpirvBackend;
+
+/**
+ * One variant of a shader family
+ * Every constant listed is baked into the code, so the optimizer can fold
+ * it; constants not listed stay specialization constants with their
+ * declared defaults
+ */
+struct ShaderPermutation {
+    std::string name;                                            // Names the output; not part of the code
+    std::vector<std::pair<std::string, std::string>> constants;  // Constant name, numeric literal
+};
 
 /**
  * Main shader compiler class
@@ -24,15 +44,16 @@ public:
     
     /**
      * Compile a shader from source code to SPIR-V
-     * @param source The shader source in custom DSL format
+     * @param source The shader source in custom DSL format (not copied)
      * @param shaderType "vertex" or "fragment"
      * @return SPIR-V bytecode as uint32_t vector
      * @throws std::runtime_error on compilation failure
      */
-    std::vector<uint32_t> compile(const std::string& source, const std::string& shaderType);
+    std::vector<uint32_t> compile(std::string_view source, const std::string& shaderType);
     
     /**
      * Compile from file
+     * The file is memory-mapped and lexed in place
      * @param filename Path to shader source file
      * @param shaderType "vertex" or "fragment"
      * @return SPIR-V bytecode
@@ -40,6 +61,34 @@ public:
      */
     std::vector<uint32_t> compileFromFile(const std::string& filename, const std::string& shaderType);
     
+    /**
+     * Compile every permutation of one shader in a single pass
+     * The source is lexed and parsed once; each permutation optimizes and
+     * generates code from its own copy of the AST. Statistics are summed
+     * over permutations, and each permutation is cached separately
+     * @param source The shader source in custom DSL format (not copied)
+     * @param shaderType "vertex" or "fragment"
+     * @return One SPIR-V module per permutation, in order
+     * @throws std::runtime_error on compilation failure, or if a permutation
+     *         sets a constant the shader does not declare
+     */
+    std::vector<std::vector<uint32_t>> compilePermutations(std::string_view source, const std::string& shaderType,
+                                                           const std::vector<ShaderPermutation>& permutations);
+    
+    /**
+     * compilePermutations() on a memory-mapped file
+     */
+    std::vector<std::vector<uint32_t>> compilePermutationsFromFile(const std::string& filename,
+                                                                   const std::string& shaderType,
+                                                                   const std::vector<ShaderPermutation>& permutations);
+    
+    /**
+     * Read permutations: one "<name> [CONSTANT=value ...]" per line, blank
+     * lines and lines starting with '#' are ignored
+     * @throws std::runtime_error if the file cannot be read or a line is malformed
+     */
+    static std::vector<ShaderPermutation> parsePermutationFile(const std::string& filename);
+    
     /**
      * Enable/disable optimization passes
      * @param enabled If true, optimization passes will be run
@@ -51,6 +100,66 @@ public:
      */
     bool isOptimizationEnabled() const { return optimizationEnabled; }
     
+    /**
+     * Select how generated GLSL is turned into SPIR-V
+     * Defaults to the in-process glslang library when it is linked
+     * @throws std::runtime_error if the backend is not available in this build
+     */
+    void setBackend(SpirvBackend backend);
+    
+    /**
+     * Get the selected SPIR-V backend
+     */
+    SpirvBackend getBackend() const { return backend; }
+    
+    /**
+     * Enable/disable the SPIR-V size reduction passes run on the finished
+     * module (see SpirvOptimizer); off by default, since they strip the
+     * debug names that tools like RenderDoc show
+     */
+    void setSpirvOptimizationEnabled(bool enabled) { spirvOptimizationEnabled = enabled; }
+    
+    /**
+     * Check if SPIR-V optimization is enabled
+     */
+    bool isSpirvOptimizationEnabled() const { return spirvOptimizationEnabled; }
+    
+    /**
+     * Enable the persistent SPIR-V cache
+     * A hit returns the stored module without lexing, parsing or codegen
+     * @param directory Cache directory; empty disables caching
+     */
+    void setCacheDirectory(const std::string& directory);
+    
+    /**
+     * Get the cache directory (empty when caching is disabled)
+     */
+    const std::string& getCacheDirectory() const { return cacheDirectory; }
+    
+    /**
+     * Share an in-memory SPIR-V cache, checked before the on-disk cache and
+     * filled from it
+     * @param cache Not owned; must outlive the compiler (nullptr disables it)
+     */
+    void setMemoryCache(ShaderMemoryCache* cache) { memoryCache = cache; }
+    
+    /**
+     * Record a span for every stage and pass of each compile
+     * @param trace Not owned; must outlive the compiler (nullptr disables tracing)
+     */
+    void setTrace(CompileTrace* trace) { this->trace = trace; }
+    
+    /**
+     * Compiler version; part of every cache key
+     */
+    static const char* version();
+    
+    /**
+     * Hash of the compiler's sources, so a rebuilt compiler with the same
+     * version never reuses cached SPIR-V; also part of every cache key
+     */
+    static const char* buildSignature();
+    
     /**
      * Enable/disable verbose output for debugging
      */
@@ -67,18 +176,27 @@ public:
     struct CompilationStats {
         size_t tokenCount = 0;
         size_t astNodeCount = 0;
+        size_t astArenaBytes = 0;
         size_t originalStatementCount = 0;
         size_t optimizedStatementCount = 0;
         size_t constantsFolded = 0;
         size_t deadCodeEliminated = 0;
         size_t algebraicSimplifications = 0;
+        size_t commonSubexpressionsEliminated = 0;
         size_t optimizationPasses = 0;
+        size_t originalSpirvSizeBytes = 0;        // Before SPIR-V optimization; equal when it is off or on a cache hit
+        size_t originalSpirvInstructionCount = 0;
         size_t spirvSizeBytes = 0;
         size_t spirvInstructionCount = 0;
-        double lexingTimeMs = 0.0;
-        double parsingTimeMs = 0.0;
+        size_t cacheHits = 0;
+        size_t cacheMisses = 0;
+        size_t memoryCacheHits = 0;         // Subset of cacheHits served from the memory cache
+        double parsingTimeMs = 0.0;         // Includes lexing: tokens are streamed into the parser
         double optimizationTimeMs = 0.0;
         double codegenTimeMs = 0.0;
+        double glslGenerationTimeMs = 0.0;  // Part of codegen: AST -> GLSL (0 for native)
+        double spirvGenerationTimeMs = 0.0; // Part of codegen: GLSL/AST -> SPIR-V
+        double spirvOptimizationTimeMs = 0.0;
         double totalTimeMs = 0.0;
     };
     
@@ -86,7 +204,8 @@ public:
     
     /**
      * Get the generated GLSL code (after optimization, before SPIR-V)
-     * Only available after a successful compilation
+     * Kept when the GLSL compiler rejects it, so it can be shown next to the
+     * error without being copied into the message
      */
     const std::string& getGeneratedGLSL() const { return generatedGLSL; }
     
@@ -102,47 +221,29 @@ public:
     
 private:
     bool optimizationEnabled = true;
+    bool spirvOptimizationEnabled = false;
     bool verbose = false;
+    SpirvBackend backend;
     CompilationStats stats;
     std::string generatedGLSL;
+    std::string cacheDirectory;
+    std::unique_ptr<ShaderCache> cache;
+    ShaderMemoryCache* memoryCache = nullptr;
+    CompileTrace* trace = nullptr;
+    std::unique_ptr<AstArena> arena;  // Owns the AST of the current compile
+    
+    // Pipeline stages shared by compile() and compilePermutations(); stage
+    // statistics accumulate
+    ProgramNode* parseSource(std::string_view source);
+    std::vector<uint32_t> optimizeAndGenerate(ProgramNode* ast, const std::string& shaderType);
+    ShaderCompilationError::Stage currentStage = ShaderCompilationError::Stage::PARSING;  // Tags untyped errors
     
     // Helper methods
+    std::string optionsSignature() const;
     void logVerbose(const std::string& message);
     void validateShaderType(const std::string& shaderType);
     size_t countASTNodes(const ProgramNode* ast);
+    static size_t countNodes(const ASTNode* node);
     size_t countStatements(const ProgramNode* ast);
     double getCurrentTimeMs();
-};
-
-/**
- * Custom exception for shader compilation errors
- */
-class ShaderCompilationError : public std::runtime_error {
-public:
-    enum class Stage {
-        LEXING,
-        PARSING,
-        OPTIMIZATION,
-        CODE_GENERATION
-    };
-    
-    ShaderCompilationError(Stage stage, const std::string& message)
-        : std::runtime_error(formatMessage(stage, message))
-        , stage_(stage) {}
-    
-    Stage getStage() const { return stage_; }
-    
-private:
-    Stage stage_;
-    
-    static std::string formatMessage(Stage stage, const std::string& message) {
-        std::string stageStr;
-        switch (stage) {
-            case Stage::LEXING: stageStr = "Lexing"; break;
-            case Stage::PARSING: stageStr = "Parsing"; break;
-            case Stage::OPTIMIZATION: stageStr = "Optimization"; break;
-            case Stage::CODE_GENERATION: stageStr = "Code Generation"; break;
-        }
-        return "[" + stageStr + " Error] " + message;
-    }
 };
\ No newline at end of file
@@ -0,0 +1,148 @@
+#pragma once
+
+#include "spirv_reflect.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * Shader pack: many SPIR-V modules and their reflection in one file
+ * Written by `myshaderc --pack` and memory-mapped by the renderer, which
+ * hands the mapped words straight to vkCreateShaderModule. Native-endian, as
+ * packs are built for the machine that loads them:
+ *   Header       counts and section offsets
+ *   Entries      one record per module, sorted by name
+ *   Interface    reflection records; each entry owns a contiguous run
+ *   Strings      names, nul-terminated
+ *   Code         the modules, each starting on a 4-byte boundary
+ */
+struct ShaderPackFormat {
+    static constexpr uint32_t MAGIC = 0x4B415053;   // "SPAK"
+    static constexpr uint32_t VERSION = 1;
+
+    struct Header {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t entryCount;
+        uint32_t interfaceCount;
+        uint32_t stringsOffset;
+        uint32_t stringsSize;
+        uint32_t codeOffset;
+        uint32_t fileSize;
+    };
+
+    struct Entry {
+        uint32_t nameOffset;        // Into the string section
+        uint32_t entryPointOffset;
+        uint32_t stage;             // ShaderReflection::Stage
+        uint32_t codeOffset;        // Bytes from the start of the file
+        uint32_t codeWords;
+        uint32_t firstInterface;
+        uint32_t interfaceCount;
+        uint32_t reserved;
+    };
+
+    enum InterfaceKind : uint32_t {
+        INPUT,
+        OUTPUT,
+        UNIFORM_BLOCK,
+        SPEC_CONSTANT
+    };
+
+    // One reflected variable; fields are used as the kind requires
+    struct Interface {
+        uint32_t kind;              // InterfaceKind
+        uint32_t nameOffset;
+        uint32_t index;             // Location, binding or SpecId
+        uint32_t set;               // Uniform blocks
+        uint32_t type;              // ShaderReflection::ScalarType
+        uint32_t components;
+        uint32_t columns;
+        uint32_t value;             // Block size in bytes, spec constant default bits
+    };
+};
+
+/**
+ * Builds a shader pack in memory and writes it in one go
+ */
+class ShaderPackWriter {
+public:
+    /**
+     * Add a module; its reflection is read from the SPIR-V
+     * @throws std::runtime_error if the name is taken or the SPIR-V cannot be reflected
+     */
+    void add(const std::string& name, std::vector<uint32_t> spirv);
+
+    size_t size() const { return modules.size(); }
+
+    /**
+     * Write the pack; a temporary file is renamed into place, so a running
+     * renderer that maps the old pack keeps a consistent view of it
+     * @throws std::runtime_error if the file cannot be written
+     */
+    void write(const std::string& path) const;
+
+private:
+    struct Module {
+        std::string name;
+        std::vector<uint32_t> spirv;
+        ShaderReflection reflection;
+    };
+
+    std::vector<Module> modules;
+};
+
+/**
+ * Read-only view of a memory-mapped shader pack
+ * Every pointer it returns points into the mapping and stays valid until
+ * the pack is closed or destroyed
+ */
+class ShaderPack {
+public:
+    struct Module {
+        std::string_view name;
+        ShaderReflection::Stage stage;
+        const uint32_t* code;
+        size_t wordCount;
+    };
+
+    ShaderPack() = default;
+    ~ShaderPack();
+
+    ShaderPack(const ShaderPack&) = delete;
+    ShaderPack& operator=(const ShaderPack&) = delete;
+
+    /**
+     * Map a pack and check its layout; any previously opened pack is closed
+     * @throws std::runtime_error if the file cannot be mapped or is not a valid pack
+     */
+    void open(const std::string& path);
+    void close();
+
+    bool isOpen() const { return data != nullptr; }
+    size_t size() const { return modules.size(); }
+    const Module& module(size_t index) const { return modules[index]; }
+
+    /**
+     * Index of the module with this name
+     * @return size() if there is none
+     */
+    size_t find(std::string_view name) const;
+
+    /**
+     * Decode the reflection of one module
+     */
+    ShaderReflection reflection(size_t index) const;
+
+private:
+    const char* string(uint32_t offset) const;
+
+    const char* data = nullptr;
+    size_t mappedSize = 0;
+    const ShaderPackFormat::Header* header = nullptr;
+    const ShaderPackFormat::Entry* entries = nullptr;
+    const ShaderPackFormat::Interface* interfaces = nullptr;
+    std::vector<Module> modules;
+};
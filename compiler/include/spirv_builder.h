@@ -0,0 +1,193 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+/**
+ * SPIR-V module builder
+ * Allocates result ids, deduplicates types and constants, and keeps each
+ * logical section of the module separate so instructions can be emitted in
+ * any order and serialized in the layout the specification requires
+ */
+class SpirvModuleBuilder {
+public:
+    /**
+     * Opcodes used by the native backend
+     */
+    enum Op : uint16_t {
+        OpName = 5,
+        OpMemberName = 6,
+        OpMemoryModel = 14,
+        OpEntryPoint = 15,
+        OpExecutionMode = 16,
+        OpCapability = 17,
+        OpTypeVoid = 19,
+        OpTypeInt = 21,
+        OpTypeFloat = 22,
+        OpTypeVector = 23,
+        OpTypeMatrix = 24,
+        OpTypeStruct = 30,
+        OpTypePointer = 32,
+        OpTypeFunction = 33,
+        OpConstant = 43,
+        OpSpecConstant = 50,
+        OpFunction = 54,
+        OpFunctionEnd = 56,
+        OpVariable = 59,
+        OpLoad = 61,
+        OpStore = 62,
+        OpAccessChain = 65,
+        OpDecorate = 71,
+        OpMemberDecorate = 72,
+        OpVectorShuffle = 79,
+        OpCompositeConstruct = 80,
+        OpCompositeExtract = 81,
+        OpConvertFToS = 110,
+        OpConvertSToF = 111,
+        OpIAdd = 128,
+        OpFAdd = 129,
+        OpISub = 130,
+        OpFSub = 131,
+        OpIMul = 132,
+        OpFMul = 133,
+        OpSDiv = 135,
+        OpFDiv = 136,
+        OpVectorTimesScalar = 142,
+        OpMatrixTimesScalar = 143,
+        OpVectorTimesMatrix = 144,
+        OpMatrixTimesVector = 145,
+        OpMatrixTimesMatrix = 146,
+        OpLabel = 248,
+        OpReturn = 253
+    };
+
+    // Enumerants used as instruction operands
+    static constexpr uint32_t MagicNumber = 0x07230203;
+    static constexpr uint32_t Version_1_0 = 0x00010000;
+    static constexpr uint32_t CapabilityShader = 1;
+    static constexpr uint32_t AddressingLogical = 0;
+    static constexpr uint32_t MemoryModelGLSL450 = 1;
+    static constexpr uint32_t ExecutionModelVertex = 0;
+    static constexpr uint32_t ExecutionModelFragment = 4;
+    static constexpr uint32_t ExecutionModeOriginUpperLeft = 7;
+    static constexpr uint32_t StorageClassInput = 1;
+    static constexpr uint32_t StorageClassUniform = 2;
+    static constexpr uint32_t StorageClassOutput = 3;
+    static constexpr uint32_t StorageClassFunction = 7;
+    static constexpr uint32_t DecorationSpecId = 1;
+    static constexpr uint32_t DecorationBlock = 2;
+    static constexpr uint32_t DecorationColMajor = 5;
+    static constexpr uint32_t DecorationMatrixStride = 7;
+    static constexpr uint32_t DecorationBuiltIn = 11;
+    static constexpr uint32_t DecorationLocation = 30;
+    static constexpr uint32_t DecorationBinding = 33;
+    static constexpr uint32_t DecorationDescriptorSet = 34;
+    static constexpr uint32_t DecorationOffset = 35;
+    static constexpr uint32_t BuiltInPosition = 0;
+    static constexpr uint32_t FunctionControlNone = 0;
+
+    SpirvModuleBuilder();
+
+    uint32_t newId() { return nextId++; }
+
+    // Module-level declarations
+    void addCapability(uint32_t capability);
+    void setMemoryModel(uint32_t addressing, uint32_t memory);
+    void addEntryPoint(uint32_t executionModel, uint32_t function, const std::string& name,
+                       const std::vector<uint32_t>& interface);
+    void addExecutionMode(uint32_t function, uint32_t mode);
+    void addName(uint32_t target, const std::string& name);
+    void addDecoration(uint32_t target, uint32_t decoration, const std::vector<uint32_t>& operands = {});
+    void addMemberName(uint32_t structType, uint32_t member, const std::string& name);
+    void addMemberDecoration(uint32_t structType, uint32_t member, uint32_t decoration,
+                             const std::vector<uint32_t>& operands = {});
+
+    // Types (deduplicated)
+    uint32_t typeVoid();
+    uint32_t typeFloat();
+    uint32_t typeInt();
+    uint32_t typeVector(uint32_t componentType, uint32_t count);
+    uint32_t typeMatrix(uint32_t columnType, uint32_t columns);
+    uint32_t typePointer(uint32_t storageClass, uint32_t pointee);
+    uint32_t typeFunction(uint32_t returnType, const std::vector<uint32_t>& params = {});
+
+    /**
+     * Declare a struct type; never deduplicated, since each struct carries
+     * its own member decorations
+     */
+    uint32_t typeStruct(const std::vector<uint32_t>& members);
+
+    // Constants (deduplicated)
+    uint32_t constantFloat(float value);
+    uint32_t constantInt(int32_t value);
+
+    /**
+     * Declare a specialization constant with the given default bits; never
+     * deduplicated, since each one carries its own SpecId
+     */
+    uint32_t specConstant(uint32_t type, uint32_t defaultBits);
+
+    /**
+     * Declare a module-scope variable
+     */
+    uint32_t globalVariable(uint32_t pointerType, uint32_t storageClass);
+
+    /**
+     * Begin the (single) function; emits OpFunction and its entry OpLabel
+     */
+    void beginFunction(uint32_t function, uint32_t returnType, uint32_t functionType);
+
+    /**
+     * Declare a Function-storage variable in the entry block
+     */
+    uint32_t localVariable(uint32_t pointerType);
+
+    /**
+     * Emit an instruction with a result into the current function
+     * @return The new result id
+     */
+    uint32_t emit(Op op, uint32_t resultType, const std::vector<uint32_t>& operands);
+
+    /**
+     * Emit an instruction without a result into the current function
+     */
+    void emitVoid(Op op, const std::vector<uint32_t>& operands);
+
+    /**
+     * End the current function with OpReturn / OpFunctionEnd
+     */
+    void endFunction();
+
+    /**
+     * Serialize the module
+     */
+    std::vector<uint32_t> finish() const;
+
+    /**
+     * Encode a literal string as SPIR-V words (nul-terminated, padded)
+     */
+    static void appendString(std::vector<uint32_t>& words, const std::string& str);
+
+private:
+    static void appendInstruction(std::vector<uint32_t>& section, Op op, const std::vector<uint32_t>& operands);
+    uint32_t internGlobal(Op op, const std::vector<uint32_t>& operands);
+
+    uint32_t nextId = 1;
+
+    // Sections in the order required by the specification
+    std::vector<uint32_t> capabilities;
+    std::vector<uint32_t> memoryModel;
+    std::vector<uint32_t> entryPoints;
+    std::vector<uint32_t> executionModes;
+    std::vector<uint32_t> debugNames;
+    std::vector<uint32_t> annotations;
+    std::vector<uint32_t> globals;
+    std::vector<uint32_t> functionHeader;
+    std::vector<uint32_t> functionVariables;
+    std::vector<uint32_t> functionBody;
+
+    // Key: opcode followed by operands (without result id)
+    std::map<std::vector<uint32_t>, uint32_t> internedGlobals;
+};
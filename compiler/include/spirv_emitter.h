@@ -0,0 +1,77 @@
+#pragma once
+
+#include "parser.h"
+#include "spirv_builder.h"
+#include "type_resolver.h"
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Native SPIR-V emitter
+ * Translates a shader declaration straight into a SPIR-V module without
+ * going through GLSL text or an external front-end
+ */
+class SpirvEmitter {
+public:
+    SpirvEmitter();
+
+    /**
+     * Emit a SPIR-V module for one shader declaration
+     * @param shader The (optimized) shader declaration
+     * @return SPIR-V bytecode
+     * @throws std::runtime_error on type errors or unsupported constructs
+     */
+    std::vector<uint32_t> emit(const ShaderDeclNode* shader);
+
+private:
+    struct Value {
+        uint32_t id;
+        ValueType type;
+    };
+
+    struct Variable {
+        uint32_t id;
+        ValueType type;
+        uint32_t storageClass;
+        int32_t member = -1;  // Index in the uniform block, -1 for plain variables
+    };
+
+    // Declarations
+    void declareInterface(const ShaderDeclNode* shader);
+    void declareLocals(const NodeList& statements);
+    uint32_t declareGlobal(std::string_view name, ValueType type, uint32_t storageClass);
+    void declareUniformBlock(const NodeList& uniforms);
+    void declareSpecConstants(const NodeList& constants);
+
+    // Statements
+    void emitStatement(const ASTNode* node);
+    void emitAssignment(const AssignmentNode* assign);
+
+    // Expressions
+    Value emitExpression(const ASTNode* node);
+    Value emitLiteral(const LiteralNode* lit);
+    Value emitLoad(std::string_view name);
+    Value emitBinaryOp(const BinaryOpNode* binOp);
+    Value emitOperator(std::string_view op, Value left, Value right);
+    Value emitSwizzle(const MemberAccessNode* member);
+    Value emitConstructor(const FunctionCallNode* funcCall);
+
+    // Helpers
+    Value convert(Value value, ValueType::Base base);
+    Value splat(Value scalar, ValueType target);
+    Value extractComponent(Value vector, uint32_t index);
+    Value componentWise(std::string_view op, Value left, Value right, ValueType result);
+    const Variable& lookupVariable(std::string_view name);
+    uint32_t typeId(ValueType type);
+    std::vector<uint32_t> swizzleIndices(std::string_view member, ValueType objectType);
+    void checkAssignable(const Variable& var, std::string_view name);
+
+    SpirvModuleBuilder builder;
+    TypeResolver resolver;
+    std::unordered_map<std::string_view, Variable> variables;  // Keys are interned AST names
+    std::unordered_map<std::string_view, Value> constants;     // Specialization constants, read directly
+    std::vector<uint32_t> interfaceVariables;
+    std::string shaderType;
+};
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * SPIR-V to SPIR-V size reduction, run on a finished module from either
+ * backend
+ * Strips debug instructions, merges duplicate types and constants, removes
+ * definitions and side-effect-free instructions whose result is never used,
+ * and renumbers the remaining ids densely from 1. The module is only ever
+ * shortened by whole instructions, so it is rewritten in place. A module
+ * containing an instruction the optimizer does not know is left untouched,
+ * since it cannot tell which of that instruction's operands are ids
+ */
+class SpirvOptimizer {
+public:
+    struct Options {
+        bool stripDebugInfo = true;         // OpName, OpMemberName, OpSource*, OpString, OpLine, OpModuleProcessed
+        bool deduplicateConstants = true;   // Also merges identical non-struct types
+        bool removeDeadIds = true;
+        bool compactIds = true;
+    };
+
+    struct Stats {
+        size_t wordsBefore = 0;
+        size_t wordsAfter = 0;
+        uint32_t idBoundBefore = 0;
+        uint32_t idBoundAfter = 0;
+        size_t debugInstructionsStripped = 0;
+        size_t duplicatesMerged = 0;
+        size_t deadInstructionsRemoved = 0;
+        bool skipped = false;               // Unknown instruction; module left as it was
+    };
+
+    SpirvOptimizer() = default;
+    explicit SpirvOptimizer(const Options& options) : options(options) {}
+
+    /**
+     * Optimize a module in place
+     * @throws std::runtime_error if the words are not a well-formed SPIR-V module
+     */
+    void optimize(std::vector<uint32_t>& spirv);
+
+    const Stats& getStats() const { return stats; }
+
+private:
+    static constexpr uint32_t NoInstruction = UINT32_MAX;
+
+    // One instruction of the module being optimized
+    struct Instruction {
+        uint32_t offset;            // Of the first word (word count and opcode)
+        uint16_t opcode;
+        uint16_t wordCount;
+        uint32_t resultWord;        // Offset of the result id, 0 if there is none
+        bool removed;
+    };
+
+    /**
+     * Split the module into instructions and find their id operands
+     * @return false if the module contains an unknown instruction
+     * @throws std::runtime_error if an instruction is malformed
+     */
+    bool index(const std::vector<uint32_t>& spirv);
+
+    void stripDebugInfo(const std::vector<uint32_t>& spirv);
+    void deduplicate(std::vector<uint32_t>& spirv);
+    void removeDeadIds(const std::vector<uint32_t>& spirv);
+    void removeOrphanAnnotations(const std::vector<uint32_t>& spirv);
+    void compactIds(std::vector<uint32_t>& spirv);
+    void rebuild(std::vector<uint32_t>& spirv) const;
+
+    // Names and decorations, whose first operand is their target
+    static bool isAnnotation(uint16_t opcode);
+
+    Options options;
+    Stats stats;
+
+    std::vector<Instruction> instructions;
+
+    // Word offsets of the id operands of every instruction other than its
+    // result id, in instruction order; instruction i owns
+    // idOperands[idOperandStart[i] .. idOperandStart[i + 1])
+    std::vector<uint32_t> idOperands;
+    std::vector<uint32_t> idOperandStart;
+
+    std::vector<uint32_t> definitions;  // Instruction defining each id
+    uint32_t bound = 0;
+    uint32_t glslSet = 0;               // Id of the GLSL.std.450 import, 0 if none
+};
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Interface of a SPIR-V module, read back from its words
+ * Works on the output of every backend, with or without debug names (names
+ * are then empty); only what the renderer binds is described: located stage
+ * inputs and outputs, uniform blocks and specialization constants
+ */
+struct ShaderReflection {
+    enum class Stage : uint8_t {
+        VERTEX,
+        FRAGMENT,
+        OTHER
+    };
+
+    enum class ScalarType : uint8_t {
+        FLOAT,
+        INT,
+        UINT,
+        BOOL,
+        OTHER
+    };
+
+    // Stage input or output with a Location decoration (built-ins are left out)
+    struct Variable {
+        std::string name;
+        uint32_t location = 0;
+        ScalarType type = ScalarType::OTHER;
+        uint32_t components = 0;    // 1 for scalars, N for vecN and matNxN columns
+        uint32_t columns = 1;       // Matrices take one location per column
+    };
+
+    // Variable in the Uniform storage class
+    struct UniformBlock {
+        std::string name;
+        uint32_t set = 0;
+        uint32_t binding = 0;
+        uint32_t sizeBytes = 0;     // End of the last member, from the Offset decorations
+    };
+
+    struct SpecConstant {
+        std::string name;
+        uint32_t id = 0;
+        ScalarType type = ScalarType::OTHER;
+        uint32_t defaultBits = 0;   // 1/0 for booleans
+    };
+
+    Stage stage = Stage::OTHER;
+    std::string entryPoint;
+    std::vector<Variable> inputs;               // Sorted by location
+    std::vector<Variable> outputs;              // Sorted by location
+    std::vector<UniformBlock> uniformBlocks;    // Sorted by set, then binding
+    std::vector<SpecConstant> specConstants;    // Sorted by id
+
+    /**
+     * Reflect the first entry point of a module
+     * @throws std::runtime_error if the words are not a SPIR-V module with an entry point
+     */
+    static ShaderReflection fromSpirv(const uint32_t* words, size_t wordCount);
+};
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "parser.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+/**
+ * Value type of a DSL expression
+ * Scalars have components == 1, vectors 2-4, matrices have columns > 1
+ */
+struct ValueType {
+    enum class Base {
+        INVALID,
+        FLOAT,
+        INT
+    };
+
+    Base base = Base::INVALID;
+    int components = 1; // Vector size (rows for matrices)
+    int columns = 1;    // Matrix column count (1 = not a matrix)
+
+    static ValueType scalar(Base base) { return {base, 1, 1}; }
+    static ValueType vector(int size) { return {Base::FLOAT, size, 1}; }
+    static ValueType matrix(int size) { return {Base::FLOAT, size, size}; }
+
+    /**
+     * Map a DSL type name (vec3, mat4, float, ...) to a ValueType
+     * @return INVALID type for unknown names
+     */
+    static ValueType fromName(std::string_view name);
+
+    /**
+     * DSL/GLSL spelling of the type
+     */
+    std::string name() const;
+
+    bool isValid() const { return base != Base::INVALID; }
+    bool isScalar() const { return isValid() && components == 1 && columns == 1; }
+    bool isVector() const { return isValid() && components > 1 && columns == 1; }
+    bool isMatrix() const { return isValid() && columns > 1; }
+    int componentCount() const { return components * columns; }
+
+    bool operator==(const ValueType& other) const {
+        return base == other.base && components == other.components && columns == other.columns;
+    }
+    bool operator!=(const ValueType& other) const { return !(*this == other); }
+};
+
+/**
+ * Type resolver
+ * Tracks declared variables for one shader and infers expression types
+ * using GLSL rules (implicit int -> float promotion, scalar broadcast,
+ * matrix/vector products)
+ */
+class TypeResolver {
+public:
+    TypeResolver();
+
+    /**
+     * Declare inputs, outputs, uniforms, specialization constants and the
+     * built-ins of the shader's stage
+     */
+    void declareShaderInterface(const ShaderDeclNode* shader);
+
+    /**
+     * Names are stored as views: they must outlive the resolver, which holds
+     * for interned AST symbols and string literals
+     */
+    void declare(std::string_view name, ValueType type);
+    bool isDeclared(std::string_view name) const;
+    ValueType lookup(std::string_view name) const;
+
+    /**
+     * Infer the type of an expression
+     * @return INVALID type if any part of the expression cannot be typed
+     */
+    ValueType resolve(const ASTNode* expr) const;
+
+    static ValueType literalType(std::string_view literal);
+    static ValueType binaryResultType(std::string_view op, ValueType left, ValueType right);
+    static ValueType swizzleType(ValueType object, std::string_view member);
+
+    /**
+     * Index of a swizzle character (xyzw / rgba / stpq), or -1
+     */
+    static int swizzleIndex(char c);
+
+    /**
+     * Check whether a name is a built-in variable of the given stage
+     */
+    static bool isBuiltinVariable(std::string_view name, std::string_view shaderType);
+
+    /**
+     * Fragment shaders may write gl_FragColor without declaring an output;
+     * it becomes an implicit vec4 output at the first location after the
+     * declared ones. GLSL reserves gl_ names, so the GLSL path spells it
+     * FRAG_COLOR_OUTPUT
+     */
+    static bool writesFragColor(const ShaderDeclNode* shader);
+    static constexpr const char* FRAG_COLOR_OUTPUT = "_fragColor";
+
+    /**
+     * Descriptor binding of a stage's uniform block
+     * Each stage gets one std140 block in set 0: vertex at binding 0,
+     * fragment at binding 1, matching the renderer's descriptor set layout
+     */
+    static constexpr uint32_t UNIFORM_SET = 0;
+    static uint32_t uniformBinding(std::string_view shaderType) { return shaderType == "fragment" ? 1 : 0; }
+
+private:
+    std::unordered_map<std::string_view, ValueType> symbols;
+};
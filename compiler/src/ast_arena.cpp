@@ -0,0 +1,90 @@
+#include "ast_arena.h"
+#include <algorithm>
+#include <cstring>
+
+AstArena::AstArena(size_t blockSize) : blockSize(blockSize) {}
+
+void* AstArena::allocate(size_t size, size_t alignment) {
+    used += size;
+
+    // Requests larger than a quarter block get their own allocation so
+    // they do not waste the tail of a shared block
+    if (size > blockSize / 4) {
+        largeBlocks.push_back(std::make_unique<char[]>(size + alignment));
+        void* ptr = largeBlocks.back().get();
+        size_t space = size + alignment;
+        return std::align(alignment, size, ptr, space);
+    }
+
+    while (true) {
+        if (currentBlock < blocks.size()) {
+            size_t aligned = (offset + alignment - 1) & ~(alignment - 1);
+            if (aligned + size <= blockSize) {
+                offset = aligned + size;
+                return blocks[currentBlock].get() + aligned;
+            }
+            currentBlock++;
+            offset = 0;
+            continue;
+        }
+
+        blocks.push_back(std::make_unique<char[]>(blockSize));
+        currentBlock = blocks.size() - 1;
+        offset = 0;
+    }
+}
+
+std::string_view AstArena::intern(std::string_view str) {
+    auto it = strings.find(str);
+    if (it != strings.end()) {
+        return *it;
+    }
+
+    char* copy = allocateArray<char>(str.size() + 1);
+    std::memcpy(copy, str.data(), str.size());
+    copy[str.size()] = '\0';
+
+    std::string_view stored(copy, str.size());
+    strings.insert(stored);
+    return stored;
+}
+
+void AstArena::reset() {
+    largeBlocks.clear();
+    strings.clear();
+    currentBlock = 0;
+    offset = 0;
+    used = 0;
+}
+
+void NodeList::push_back(AstArena& arena, ASTNode* node) {
+    if (count == capacity) {
+        reserve(arena, count + 1);
+    }
+    items[count++] = node;
+}
+
+void NodeList::insert(AstArena& arena, size_t index, ASTNode* node) {
+    if (count == capacity) {
+        reserve(arena, count + 1);
+    }
+    std::memmove(items + index + 1, items + index, (count - index) * sizeof(ASTNode*));
+    items[index] = node;
+    count++;
+}
+
+NodeList::iterator NodeList::erase(iterator position) {
+    std::memmove(position, position + 1, (end() - position - 1) * sizeof(ASTNode*));
+    count--;
+    return position;
+}
+
+void NodeList::reserve(AstArena& arena, uint32_t minimum) {
+    uint32_t newCapacity = std::max<uint32_t>(minimum, capacity ? capacity * 2 : 4);
+    ASTNode** newItems = arena.allocateArray<ASTNode*>(newCapacity);
+    if (count > 0) {
+        std::memcpy(newItems, items, count * sizeof(ASTNode*));
+    }
+    items = newItems;
+    capacity = newCapacity;
+}
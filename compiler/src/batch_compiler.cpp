@@ -0,0 +1,214 @@
+#include "batch_compiler.h"
+#include "compile_trace.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+BatchCompiler::BatchCompiler(const Options& options) : options(options) {
+    // Checked up front: a throwing setBackend() inside a worker would terminate
+    if (!CodeGenerator::isBackendAvailable(options.backend)) {
+        throw std::runtime_error(std::string("SPIR-V backend '") + CodeGenerator::backendName(options.backend) +
+                                 "' is not available in this build");
+    }
+}
+
+std::vector<BatchJobResult> BatchCompiler::run(const std::vector<BatchJob>& jobs) {
+    auto startTime = std::chrono::steady_clock::now();
+
+    std::vector<BatchJobResult> results(jobs.size());
+    std::atomic<size_t> nextJob{0};
+
+    unsigned threadCount = resolveThreadCount(options.threadCount, jobs.size());
+
+    auto worker = [&]() {
+        ShaderCompiler compiler;
+        compiler.setOptimizationEnabled(options.optimizationEnabled);
+        compiler.setBackend(options.backend);
+        compiler.setSpirvOptimizationEnabled(options.spirvOptimizationEnabled);
+        compiler.setCacheDirectory(options.cacheDirectory);
+        compiler.setTrace(options.trace);
+
+        for (size_t i = nextJob++; i < jobs.size(); i = nextJob++) {
+            compileJob(compiler, jobs[i], results[i]);
+        }
+    };
+
+    std::vector<std::thread> workers;
+    workers.reserve(threadCount);
+    for (unsigned i = 0; i < threadCount; ++i) {
+        workers.emplace_back(worker);
+    }
+    for (auto& thread : workers) {
+        thread.join();
+    }
+
+    summary = Summary();
+    summary.threadCount = threadCount;
+    for (const auto& result : results) {
+        if (result.success) {
+            summary.succeeded++;
+            accumulate(summary.totals, result.stats);
+        } else {
+            summary.failed++;
+        }
+    }
+    summary.wallTimeMs = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - startTime).count();
+
+    return results;
+}
+
+void BatchCompiler::compileJob(ShaderCompiler& compiler, const BatchJob& job, BatchJobResult& result) const {
+    CompileTrace::Scope span(options.trace, "job", "batch", job.inputFile);
+    try {
+        auto spirv = compiler.compileFromFile(job.inputFile, job.shaderType);
+
+        if (options.keepSpirv) {
+            result.success = true;
+            result.stats = compiler.getStats();
+            result.spirv = std::move(spirv);
+            return;
+        }
+
+        fs::path outputPath(job.outputFile);
+        if (outputPath.has_parent_path()) {
+            std::error_code ec;
+            fs::create_directories(outputPath.parent_path(), ec);
+        }
+
+        std::ofstream outFile(job.outputFile, std::ios::binary);
+        if (!outFile.is_open()) {
+            throw std::runtime_error("Failed to open output file: " + job.outputFile);
+        }
+        outFile.write(reinterpret_cast<const char*>(spirv.data()), spirv.size() * sizeof(uint32_t));
+        if (!outFile) {
+            throw std::runtime_error("Failed to write output file: " + job.outputFile);
+        }
+
+        result.success = true;
+        result.stats = compiler.getStats();
+    } catch (const std::exception& e) {
+        std::string message = e.what();
+        result.success = false;
+        result.error = message.substr(0, message.find('\n'));
+        result.diagnostic = CompileDiagnostic::fromException(e);
+    }
+}
+
+void BatchCompiler::accumulate(ShaderCompiler::CompilationStats& totals,
+                               const ShaderCompiler::CompilationStats& stats) {
+    totals.tokenCount += stats.tokenCount;
+    totals.astNodeCount += stats.astNodeCount;
+    totals.astArenaBytes += stats.astArenaBytes;
+    totals.originalStatementCount += stats.originalStatementCount;
+    totals.optimizedStatementCount += stats.optimizedStatementCount;
+    totals.constantsFolded += stats.constantsFolded;
+    totals.deadCodeEliminated += stats.deadCodeEliminated;
+    totals.algebraicSimplifications += stats.algebraicSimplifications;
+    totals.commonSubexpressionsEliminated += stats.commonSubexpressionsEliminated;
+    totals.optimizationPasses += stats.optimizationPasses;
+    totals.originalSpirvSizeBytes += stats.originalSpirvSizeBytes;
+    totals.originalSpirvInstructionCount += stats.originalSpirvInstructionCount;
+    totals.spirvSizeBytes += stats.spirvSizeBytes;
+    totals.spirvInstructionCount += stats.spirvInstructionCount;
+    totals.cacheHits += stats.cacheHits;
+    totals.cacheMisses += stats.cacheMisses;
+    totals.memoryCacheHits += stats.memoryCacheHits;
+    totals.parsingTimeMs += stats.parsingTimeMs;
+    totals.optimizationTimeMs += stats.optimizationTimeMs;
+    totals.codegenTimeMs += stats.codegenTimeMs;
+    totals.glslGenerationTimeMs += stats.glslGenerationTimeMs;
+    totals.spirvGenerationTimeMs += stats.spirvGenerationTimeMs;
+    totals.spirvOptimizationTimeMs += stats.spirvOptimizationTimeMs;
+    totals.totalTimeMs += stats.totalTimeMs;
+}
+
+std::vector<BatchJob> BatchCompiler::parseManifest(const std::string& manifestFile) {
+    std::ifstream file(manifestFile);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open manifest: " + manifestFile);
+    }
+
+    fs::path baseDir = fs::path(manifestFile).parent_path();
+    auto resolve = [&](const std::string& path) {
+        fs::path p(path);
+        return (p.is_absolute() || baseDir.empty()) ? p.string() : (baseDir / p).string();
+    };
+
+    std::vector<BatchJob> jobs;
+    std::string line;
+    int lineNumber = 0;
+
+    while (std::getline(file, line)) {
+        lineNumber++;
+
+        std::istringstream fields(line);
+        std::string input, type, output, extra;
+        if (!(fields >> input) || input[0] == '#') {
+            continue;
+        }
+
+        if (!(fields >> type) || !ShaderCompiler::isValidShaderType(type)) {
+            throw std::runtime_error(manifestFile + ":" + std::to_string(lineNumber) +
+                                     ": expected '<input> <vertex|fragment> [output]'");
+        }
+        if (fields >> output >> extra) {
+            throw std::runtime_error(manifestFile + ":" + std::to_string(lineNumber) +
+                                     ": unexpected text after output file");
+        }
+
+        BatchJob job;
+        job.inputFile = resolve(input);
+        job.shaderType = type;
+        job.outputFile = output.empty()
+            ? fs::path(job.inputFile).replace_extension(".spv").string()
+            : resolve(output);
+        jobs.push_back(std::move(job));
+    }
+
+    return jobs;
+}
+
+BatchJob BatchCompiler::jobForFile(const std::string& inputFile, const std::string& outputDirectory,
+                                   const std::string& shaderType) {
+    fs::path input(inputFile);
+    std::string name = input.filename().string();
+
+    BatchJob job;
+    job.inputFile = inputFile;
+
+    if (!shaderType.empty()) {
+        job.shaderType = shaderType;
+    } else if (name.find(".vert") != std::string::npos) {
+        job.shaderType = "vertex";
+    } else if (name.find(".frag") != std::string::npos) {
+        job.shaderType = "fragment";
+    } else {
+        throw std::runtime_error("Cannot infer shader type of '" + inputFile +
+                                 "' (expected .vert or .frag in the name; use a manifest instead)");
+    }
+
+    fs::path output = input;
+    output.replace_extension(".spv");
+    if (!outputDirectory.empty()) {
+        output = fs::path(outputDirectory) / output.filename();
+    }
+    job.outputFile = output.string();
+
+    return job;
+}
+
+unsigned BatchCompiler::resolveThreadCount(unsigned requested, size_t jobCount) {
+    unsigned count = requested;
+    if (count == 0) {
+        count = std::max(1u, std::thread::hardware_concurrency());
+    }
+    return static_cast<unsigned>(std::max<size_t>(1, std::min<size_t>(count, jobCount)));
+}
@@ -1,4 +1,7 @@
 #include "codegen.h"
+#include "spirv_emitter.h"
+#include "compile_trace.h"
+#include <chrono>
 #include <fstream>
 #include <sstream>
 #include <cstdlib>
@@ -6,21 +9,187 @@
 #include <sys/stat.h>
 #include <unistd.h>
 
-int CodeGenerator::tempFileCounter = 0;
+#ifdef SHADER_COMPILER_HAS_GLSLANG
+#include <glslang/Public/ShaderLang.h>
+#include <glslang/Public/ResourceLimits.h>
+#if __has_include(<glslang/SPIRV/GlslangToSpv.h>)
+#include <glslang/SPIRV/GlslangToSpv.h>
+#else
+#include <SPIRV/GlslangToSpv.h>
+#endif
+#include <mutex>
+#endif
 
-CodeGenerator::CodeGenerator() {}
+std::atomic<int> CodeGenerator::tempFileCounter{0};
+
+CodeGenerator::CodeGenerator() : backend(defaultBackend()) {}
+
+CodeGenerator::CodeGenerator(SpirvBackend backend) : backend(defaultBackend()) {
+    setBackend(backend);
+}
+
+void CodeGenerator::setBackend(SpirvBackend newBackend) {
+    if (!isBackendAvailable(newBackend)) {
+        throw std::runtime_error(std::string("SPIR-V backend '") + backendName(newBackend) +
+                                 "' is not available in this build");
+    }
+    backend = newBackend;
+}
+
+bool CodeGenerator::isBackendAvailable(SpirvBackend backend) {
+    switch (backend) {
+        case SpirvBackend::EXTERNAL_VALIDATOR:
+        case SpirvBackend::NATIVE:
+            return true;
+        case SpirvBackend::GLSLANG_LIBRARY:
+#ifdef SHADER_COMPILER_HAS_GLSLANG
+            return true;
+#else
+            return false;
+#endif
+    }
+    return false;
+}
+
+SpirvBackend CodeGenerator::defaultBackend() {
+    if (isBackendAvailable(SpirvBackend::GLSLANG_LIBRARY)) {
+        return SpirvBackend::GLSLANG_LIBRARY;
+    }
+    return SpirvBackend::EXTERNAL_VALIDATOR;
+}
+
+const char* CodeGenerator::backendName(SpirvBackend backend) {
+    switch (backend) {
+        case SpirvBackend::EXTERNAL_VALIDATOR: return "validator";
+        case SpirvBackend::GLSLANG_LIBRARY: return "glslang";
+        case SpirvBackend::NATIVE: return "native";
+    }
+    return "unknown";
+}
+
+bool CodeGenerator::parseBackendName(const std::string& name, SpirvBackend& backend) {
+    if (name == "validator") {
+        backend = SpirvBackend::EXTERNAL_VALIDATOR;
+    } else if (name == "glslang") {
+        backend = SpirvBackend::GLSLANG_LIBRARY;
+    } else if (name == "native") {
+        backend = SpirvBackend::NATIVE;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static double elapsedMs(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// GLSL compiler output without its trailing newlines
+static std::string trimLog(std::string log) {
+    while (!log.empty() && (log.back() == '\n' || log.back() == '\r')) {
+        log.pop_back();
+    }
+    return log;
+}
 
 std::vector<uint32_t> CodeGenerator::generate(const ProgramNode* ast, const std::string& shaderType) {
+    timings = Timings();
+    lastGeneratedGLSL.clear();
+    
+    if (memo) {
+        memo->previous = std::move(memo->statements);
+        memo->statements.clear();
+        memo->statementsReused = 0;
+        memo->statementsGenerated = 0;
+        memo->moduleReused = false;
+    }
+    auto sameModule = [&]() {
+        return memo && memo->hasModule && memo->moduleBackend == backend && memo->moduleShaderType == shaderType;
+    };
+    
+    // Native backend: AST straight to SPIR-V
+    if (backend == SpirvBackend::NATIVE) {
+        CompileTrace::Scope span(trace, "spirv-emit", "codegen", shaderType);
+        auto start = std::chrono::steady_clock::now();
+        const ShaderDeclNode* shader = findShader(ast, shaderType);
+        
+        AstHash hash;
+        if (memo) {
+            hash = hashAST(shader);
+            if (sameModule() && memo->moduleHash == hash) {
+                memo->moduleReused = true;
+                timings.spirvGenerationMs = elapsedMs(start);
+                return memo->moduleSPIRV;
+            }
+        }
+        
+        SpirvEmitter emitter;
+        std::vector<uint32_t> spirv = emitter.emit(shader);
+        timings.spirvGenerationMs = elapsedMs(start);
+        
+        if (memo) {
+            memo->hasModule = true;
+            memo->moduleBackend = backend;
+            memo->moduleShaderType = shaderType;
+            memo->moduleGLSL.clear();
+            memo->moduleHash = hash;
+            memo->moduleSPIRV = spirv;
+        }
+        return spirv;
+    }
+    
     // Step 1: Generate GLSL code from AST
-    std::string glslCode = generateGLSL(ast, shaderType);
+    auto glslStart = std::chrono::steady_clock::now();
+    std::string glslCode;
+    {
+        CompileTrace::Scope span(trace, "glsl-emit", "codegen", shaderType);
+        glslCode = generateGLSL(ast, shaderType);
+    }
     lastGeneratedGLSL = glslCode;
+    timings.glslGenerationMs = elapsedMs(glslStart);
+    
+    // An edit that did not change the GLSL (whitespace, comments, code the
+    // optimizer removes) does not need the GLSL compiler
+    if (sameModule() && memo->moduleGLSL == glslCode) {
+        memo->moduleReused = true;
+        return memo->moduleSPIRV;
+    }
     
     // Step 2: Compile GLSL to SPIR-V
-    std::vector<uint32_t> spirv = compileGLSLToSPIRV(glslCode, shaderType);
+    auto spirvStart = std::chrono::steady_clock::now();
+    std::vector<uint32_t> spirv;
+    {
+        CompileTrace::Scope span(trace, "spirv-compile", "codegen", backendName(backend));
+        spirv = compileGLSLToSPIRV(glslCode, shaderType);
+    }
+    timings.spirvGenerationMs = elapsedMs(spirvStart);
+    
+    if (memo) {
+        memo->hasModule = true;
+        memo->moduleBackend = backend;
+        memo->moduleShaderType = shaderType;
+        memo->moduleGLSL = glslCode;
+        memo->moduleHash = AstHash();
+        memo->moduleSPIRV = spirv;
+    }
     
     return spirv;
 }
 
+const ShaderDeclNode* CodeGenerator::findShader(const ProgramNode* ast, const std::string& shaderType) {
+    // Find the shader declaration matching the requested type
+    for (const auto* decl : ast->declarations) {
+        if (decl->type == ASTNodeType::SHADER_DECL) {
+            auto* shader = static_cast<const ShaderDeclNode*>(decl);
+            if (shader->shaderType == shaderType) {
+                return shader;
+            }
+        }
+    }
+    
+    throw std::runtime_error("No shader declaration found for type: " + shaderType);
+}
+
 std::string CodeGenerator::generateGLSL(const ProgramNode* ast, const std::string& shaderType) {
     std::stringstream ss;
     
@@ -33,21 +202,7 @@ std::string CodeGenerator::generateGLSL(const ProgramNode* ast, const std::strin
     inputLocations.clear();
     outputLocations.clear();
     
-    // Find the shader declaration matching the requested type
-    const ShaderDeclNode* targetShader = nullptr;
-    for (const auto& decl : ast->declarations) {
-        if (decl->type == ASTNodeType::SHADER_DECL) {
-            auto* shader = static_cast<const ShaderDeclNode*>(decl.get());
-            if (shader->shaderType == shaderType) {
-                targetShader = shader;
-                break;
-            }
-        }
-    }
-    
-    if (!targetShader) {
-        throw std::runtime_error("No shader declaration found for type: " + shaderType);
-    }
+    const ShaderDeclNode* targetShader = findShader(ast, shaderType);
     
     // Generate shader code
     ss << generateShaderDeclaration(targetShader);
@@ -58,11 +213,25 @@ std::string CodeGenerator::generateGLSL(const ProgramNode* ast, const std::strin
 std::string CodeGenerator::generateShaderDeclaration(const ShaderDeclNode* shader) {
     std::stringstream ss;
     
+    // Track variable types so assignments to undeclared names become locals
+    typeResolver = TypeResolver();
+    typeResolver.declareShaderInterface(shader);
+    
     // Generate input declarations
     ss << generateInputDeclarations(shader->inputs);
     
     // Generate output declarations
     ss << generateOutputDeclarations(shader->outputs);
+    if (TypeResolver::writesFragColor(shader)) {
+        ss << "layout(location = " << nextOutputLocation++ << ") out vec4 "
+           << TypeResolver::FRAG_COLOR_OUTPUT << ";\n\n";
+    }
+    
+    // Generate the uniform block
+    ss << generateUniformDeclarations(shader->uniforms, shader->shaderType);
+    
+    // Generate specialization constants
+    ss << generateSpecConstantDeclarations(shader->constants);
     
     // Generate main function
     ss << generateMainFunction(shader->statements);
@@ -70,16 +239,16 @@ std::string CodeGenerator::generateShaderDeclaration(const ShaderDeclNode* shade
     return ss.str();
 }
 
-std::string CodeGenerator::generateInputDeclarations(const std::vector<std::unique_ptr<ASTNode>>& inputs) {
+std::string CodeGenerator::generateInputDeclarations(const NodeList& inputs) {
     std::stringstream ss;
     
-    for (const auto& input : inputs) {
+    for (const auto* input : inputs) {
         if (input->type == ASTNodeType::VARIABLE_DECL) {
-            auto* varDecl = static_cast<const VariableDeclNode*>(input.get());
+            auto* varDecl = static_cast<const VariableDeclNode*>(input);
             
             // Assign and track location
             int location = nextInputLocation++;
-            inputLocations[varDecl->name] = location;
+            inputLocations[std::string(varDecl->name)] = location;
             
             ss << "layout(location = " << location << ") in " 
                << mapType(varDecl->varType) << " " 
@@ -94,16 +263,16 @@ std::string CodeGenerator::generateInputDeclarations(const std::vector<std::uniq
     return ss.str();
 }
 
-std::string CodeGenerator::generateOutputDeclarations(const std::vector<std::unique_ptr<ASTNode>>& outputs) {
+std::string CodeGenerator::generateOutputDeclarations(const NodeList& outputs) {
     std::stringstream ss;
     
-    for (const auto& output : outputs) {
+    for (const auto* output : outputs) {
         if (output->type == ASTNodeType::VARIABLE_DECL) {
-            auto* varDecl = static_cast<const VariableDeclNode*>(output.get());
+            auto* varDecl = static_cast<const VariableDeclNode*>(output);
             
             // Assign and track location
             int location = nextOutputLocation++;
-            outputLocations[varDecl->name] = location;
+            outputLocations[std::string(varDecl->name)] = location;
             
             ss << "layout(location = " << location << ") out " 
                << mapType(varDecl->varType) << " " 
@@ -118,13 +287,56 @@ std::string CodeGenerator::generateOutputDeclarations(const std::vector<std::uni
     return ss.str();
 }
 
-std::string CodeGenerator::generateMainFunction(const std::vector<std::unique_ptr<ASTNode>>& statements) {
+std::string CodeGenerator::generateUniformDeclarations(const NodeList& uniforms, std::string_view shaderType) {
+    std::stringstream ss;
+    
+    if (uniforms.empty()) {
+        return "";
+    }
+    
+    // Members stay unqualified in the body, so the block has no instance name
+    ss << "layout(std140, set = " << TypeResolver::UNIFORM_SET
+       << ", binding = " << TypeResolver::uniformBinding(shaderType) << ") uniform "
+       << (shaderType == "fragment" ? "FragmentUniforms" : "VertexUniforms") << " {\n";
+    
+    for (const auto* uniform : uniforms) {
+        if (uniform->type == ASTNodeType::VARIABLE_DECL) {
+            auto* varDecl = static_cast<const VariableDeclNode*>(uniform);
+            ss << "    " << mapType(varDecl->varType) << " " << varDecl->name << ";\n";
+        }
+    }
+    
+    ss << "};\n\n";
+    
+    return ss.str();
+}
+
+std::string CodeGenerator::generateSpecConstantDeclarations(const NodeList& constants) {
+    std::stringstream ss;
+    
+    for (const auto* constant : constants) {
+        if (constant->type == ASTNodeType::SPEC_CONSTANT_DECL) {
+            auto* specConstant = static_cast<const SpecConstantNode*>(constant);
+            ss << "layout(constant_id = " << specConstant->constantId << ") const " 
+               << mapType(specConstant->varType) << " " 
+               << specConstant->name << " = " << specConstant->defaultValue << ";\n";
+        }
+    }
+    
+    if (!constants.empty()) {
+        ss << "\n";
+    }
+    
+    return ss.str();
+}
+
+std::string CodeGenerator::generateMainFunction(const NodeList& statements) {
     std::stringstream ss;
     
     ss << "void main() {\n";
     
-    for (const auto& stmt : statements) {
-        ss << "    " << generateStatement(stmt.get()) << "\n";
+    for (const auto* stmt : statements) {
+        ss << "    " << generateStatement(stmt) << "\n";
     }
     
     ss << "}\n";
@@ -140,8 +352,42 @@ std::string CodeGenerator::generateStatement(const ASTNode* node) {
     switch (node->type) {
         case ASTNodeType::ASSIGNMENT: {
             auto* assign = static_cast<const AssignmentNode*>(node);
-            return generateExpression(assign->target.get()) + " = " + 
-                   generateExpression(assign->value.get()) + ";";
+            
+            // First assignment to an undeclared name declares a local
+            std::string declaration;
+            if (assign->target->type == ASTNodeType::IDENTIFIER) {
+                std::string_view name = static_cast<const IdentifierNode*>(assign->target)->name;
+                if (!typeResolver.isDeclared(name)) {
+                    ValueType localType = typeResolver.resolve(assign->value);
+                    if (localType.isValid()) {
+                        typeResolver.declare(name, localType);
+                        declaration = localType.name() + " ";
+                    }
+                }
+            }
+            
+            if (!memo) {
+                return declaration + generateExpression(assign->target) + " = " + 
+                       generateExpression(assign->value) + ";";
+            }
+            
+            // Statements unchanged since the last generate() keep their text
+            CodegenMemo::StatementKey key{hashAST(assign), declaration};
+            auto it = memo->statements.find(key);
+            if (it != memo->statements.end()) {
+                memo->statementsReused++;
+                return it->second;
+            }
+            auto previous = memo->previous.find(key);
+            if (previous != memo->previous.end()) {
+                memo->statementsReused++;
+                return memo->statements.insert(memo->previous.extract(previous)).position->second;
+            }
+            
+            memo->statementsGenerated++;
+            std::string text = declaration + generateExpression(assign->target) + " = " + 
+                               generateExpression(assign->value) + ";";
+            return memo->statements.emplace(std::move(key), std::move(text)).first->second;
         }
         
         default:
@@ -156,25 +402,35 @@ std::string CodeGenerator::generateExpression(const ASTNode* node) {
     
     switch (node->type) {
         case ASTNodeType::BINARY_OP: {
+            // GLSL evaluates the chain left to right as well
             auto* binOp = static_cast<const BinaryOpNode*>(node);
-            return "(" + generateExpression(binOp->left.get()) + " " + 
-                   binOp->op + " " + 
-                   generateExpression(binOp->right.get()) + ")";
+            std::string text = "(" + generateExpression(binOp->operands[0]);
+            for (size_t i = 1; i < binOp->operands.size(); ++i) {
+                text += " ";
+                text += binOp->op(i);
+                text += " ";
+                text += generateExpression(binOp->operands[i]);
+            }
+            text += ")";
+            return text;
         }
         
         case ASTNodeType::IDENTIFIER: {
             auto* id = static_cast<const IdentifierNode*>(node);
-            return id->name;
+            if (id->name == "gl_FragColor") {
+                return TypeResolver::FRAG_COLOR_OUTPUT;
+            }
+            return std::string(id->name);
         }
         
         case ASTNodeType::LITERAL: {
             auto* lit = static_cast<const LiteralNode*>(node);
-            return lit->value;
+            return std::string(lit->value);
         }
         
         case ASTNodeType::MEMBER_ACCESS: {
             auto* member = static_cast<const MemberAccessNode*>(node);
-            return generateExpression(member->object.get()) + "." + member->member;
+            return generateExpression(member->object) + "." + std::string(member->member);
         }
         
         case ASTNodeType::FUNCTION_CALL: {
@@ -184,7 +440,7 @@ std::string CodeGenerator::generateExpression(const ASTNode* node) {
             
             for (size_t i = 0; i < funcCall->arguments.size(); ++i) {
                 if (i > 0) ss << ", ";
-                ss << generateExpression(funcCall->arguments[i].get());
+                ss << generateExpression(funcCall->arguments[i]);
             }
             
             ss << ")";
@@ -198,6 +454,67 @@ std::string CodeGenerator::generateExpression(const ASTNode* node) {
 
 std::vector<uint32_t> CodeGenerator::compileGLSLToSPIRV(const std::string& glslCode, 
                                                          const std::string& shaderType) {
+    if (backend == SpirvBackend::GLSLANG_LIBRARY) {
+        return compileGLSLInProcess(glslCode, shaderType);
+    }
+    return compileGLSLWithValidator(glslCode, shaderType);
+}
+
+std::vector<uint32_t> CodeGenerator::compileGLSLInProcess(const std::string& glslCode,
+                                                           const std::string& shaderType) {
+#ifdef SHADER_COMPILER_HAS_GLSLANG
+    // glslang keeps process-wide tables; initialize them exactly once and
+    // leave them alive for the lifetime of the process
+    static std::once_flag glslangInitFlag;
+    std::call_once(glslangInitFlag, [] { glslang::InitializeProcess(); });
+    
+    EShLanguage stage;
+    if (shaderType == "vertex") {
+        stage = EShLangVertex;
+    } else if (shaderType == "fragment") {
+        stage = EShLangFragment;
+    } else {
+        throw std::runtime_error("Unknown shader type: " + shaderType);
+    }
+    
+    // Step 1: Parse GLSL for Vulkan 1.0 / SPIR-V 1.0, the target the validator
+    // backend passes explicitly and the native emitter writes, so every backend
+    // produces modules any Vulkan device accepts
+    glslang::TShader shader(stage);
+    const char* sources[] = { glslCode.c_str() };
+    shader.setStrings(sources, 1);
+    shader.setEnvInput(glslang::EShSourceGlsl, stage, glslang::EShClientVulkan, 100);
+    shader.setEnvClient(glslang::EShClientVulkan, glslang::EShTargetVulkan_1_0);
+    shader.setEnvTarget(glslang::EShTargetSpv, glslang::EShTargetSpv_1_0);
+    
+    EShMessages messages = static_cast<EShMessages>(EShMsgSpvRules | EShMsgVulkanRules);
+    
+    if (!shader.parse(GetDefaultResources(), 450, false, messages)) {
+        throw std::runtime_error("GLSL compilation failed: " + trimLog(shader.getInfoLog()));
+    }
+    
+    // Step 2: Link into a program
+    glslang::TProgram program;
+    program.addShader(&shader);
+    
+    if (!program.link(messages)) {
+        throw std::runtime_error("GLSL link failed: " + trimLog(program.getInfoLog()));
+    }
+    
+    // Step 3: Translate the intermediate tree to SPIR-V
+    std::vector<unsigned int> spirv;
+    glslang::GlslangToSpv(*program.getIntermediate(stage), spirv);
+    
+    return std::vector<uint32_t>(spirv.begin(), spirv.end());
+#else
+    (void)glslCode;
+    (void)shaderType;
+    throw std::runtime_error("In-process glslang backend is not available in this build");
+#endif
+}
+
+std::vector<uint32_t> CodeGenerator::compileGLSLWithValidator(const std::string& glslCode,
+                                                               const std::string& shaderType) {
     // Generate unique temporary file paths
     std::string inputFile = generateTempFilePath(getFileExtension(shaderType));
     std::string outputFile = generateTempFilePath("spv");
@@ -213,7 +530,7 @@ std::vector<uint32_t> CodeGenerator::compileGLSLToSPIRV(const std::string& glslC
         
         // Step 2: Build glslangValidator command
         std::stringstream cmd;
-        cmd << "glslangValidator -V " << inputFile << " -o " << outputFile << " 2>&1";
+        cmd << "glslangValidator -V --target-env vulkan1.0 " << inputFile << " -o " << outputFile << " 2>&1";
         
         // Step 3: Execute glslangValidator
         FILE* pipe = popen(cmd.str().c_str(), "r");
@@ -231,10 +548,8 @@ std::vector<uint32_t> CodeGenerator::compileGLSLToSPIRV(const std::string& glslC
         int result = pclose(pipe);
         
         if (result != 0) {
-            std::string errorMsg = "GLSL compilation failed!\n";
-            errorMsg += "Command: " + cmd.str() + "\n";
-            errorMsg += "Output: " + output.str() + "\n";
-            errorMsg += "Generated GLSL:\n" + glslCode;
+            // The GLSL itself stays out of the message; see getGeneratedGLSL()
+            std::string errorMsg = "GLSL compilation failed: " + trimLog(output.str());
             
             // Clean up before throwing
             cleanupTempFile(inputFile);
@@ -326,13 +641,13 @@ bool CodeGenerator::fileExists(const std::string& filename) {
     return (stat(filename.c_str(), &buffer) == 0);
 }
 
-std::string CodeGenerator::mapType(const std::string& type) {
+std::string CodeGenerator::mapType(std::string_view type) {
     // Direct mapping - GLSL types match our DSL types
     if (type == "vec2" || type == "vec3" || type == "vec4" ||
         type == "mat4" || type == "float" || type == "int") {
-        return type;
+        return std::string(type);
     }
     
     // If no mapping found, return as-is
-    return type;
+    return std::string(type);
 }
\ No newline at end of file
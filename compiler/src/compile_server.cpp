@@ -0,0 +1,490 @@
+#include "compile_server.h"
+#include "batch_compiler.h"
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <poll.h>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+const uint32_t REQUEST_MAGIC = 0x51524353;   // "SCRQ"
+const uint32_t RESPONSE_MAGIC = 0x53524353;  // "SCRS"
+const uint32_t PROTOCOL_VERSION = 3;
+const uint32_t MAX_FRAME_BYTES = 256 * 1024 * 1024;
+const int ACCEPT_POLL_MS = 200;  // How quickly the accept loop notices stop()
+
+// Frame payloads: fixed-size fields are copied as they are, strings and
+// arrays are prefixed with a 32-bit count
+class FrameWriter {
+public:
+    template <typename T>
+    void put(T value) {
+        const char* bytes = reinterpret_cast<const char*>(&value);
+        data.append(bytes, sizeof(T));
+    }
+
+    void putString(const std::string& value) {
+        put(static_cast<uint32_t>(value.size()));
+        data.append(value);
+    }
+
+    void putWords(const std::vector<uint32_t>& words) {
+        put(static_cast<uint32_t>(words.size()));
+        data.append(reinterpret_cast<const char*>(words.data()), words.size() * sizeof(uint32_t));
+    }
+
+    std::string data;
+};
+
+class FrameReader {
+public:
+    explicit FrameReader(const std::string& data) : data(data) {}
+
+    template <typename T>
+    T get() {
+        T value;
+        need(sizeof(T));
+        std::memcpy(&value, data.data() + position, sizeof(T));
+        position += sizeof(T);
+        return value;
+    }
+
+    std::string getString() {
+        uint32_t size = get<uint32_t>();
+        need(size);
+        std::string value = data.substr(position, size);
+        position += size;
+        return value;
+    }
+
+    std::vector<uint32_t> getWords() {
+        uint32_t count = get<uint32_t>();
+        need(static_cast<size_t>(count) * sizeof(uint32_t));
+        std::vector<uint32_t> words(count);
+        std::memcpy(words.data(), data.data() + position, count * sizeof(uint32_t));
+        position += count * sizeof(uint32_t);
+        return words;
+    }
+
+    // Record count that is checked before anything is sized from it: each
+    // record takes at least minRecordBytes of what is left of the frame
+    uint32_t getCount(size_t minRecordBytes) {
+        uint32_t count = get<uint32_t>();
+        if (count > (data.size() - position) / minRecordBytes) {
+            throw std::runtime_error("compile server frame has more records than bytes");
+        }
+        return count;
+    }
+
+private:
+    void need(size_t size) const {
+        if (size > data.size() - position) {
+            throw std::runtime_error("truncated compile server frame");
+        }
+    }
+
+    const std::string& data;
+    size_t position = 0;
+};
+
+bool sendAll(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        // MSG_NOSIGNAL: a client that went away must not kill the server with SIGPIPE
+        ssize_t sent = send(fd, data, size, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR) {
+            continue;
+        }
+        if (sent <= 0) {
+            return false;
+        }
+        data += sent;
+        size -= static_cast<size_t>(sent);
+    }
+    return true;
+}
+
+bool receiveAll(int fd, char* data, size_t size) {
+    while (size > 0) {
+        ssize_t received = recv(fd, data, size, 0);
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+        if (received <= 0) {
+            return false;
+        }
+        data += received;
+        size -= static_cast<size_t>(received);
+    }
+    return true;
+}
+
+bool sendFrame(int fd, uint32_t magic, const std::string& payload) {
+    uint32_t header[2] = {magic, static_cast<uint32_t>(payload.size())};
+    return sendAll(fd, reinterpret_cast<const char*>(header), sizeof(header)) &&
+           sendAll(fd, payload.data(), payload.size());
+}
+
+// False on a closed connection or a frame of the wrong kind
+bool receiveFrame(int fd, uint32_t magic, std::string& payload) {
+    uint32_t header[2];
+    if (!receiveAll(fd, reinterpret_cast<char*>(header), sizeof(header)) ||
+        header[0] != magic || header[1] > MAX_FRAME_BYTES) {
+        return false;
+    }
+    payload.resize(header[1]);
+    return receiveAll(fd, &payload[0], payload.size());
+}
+
+sockaddr_un socketAddress(const std::string& path) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        throw std::runtime_error("Socket path too long: " + path);
+    }
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    return address;
+}
+
+int connectTo(const std::string& path) {
+    sockaddr_un address = socketAddress(path);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+} // namespace
+
+CompileServer::CompileServer(const Options& options)
+    : options(options), memoryCache(std::make_unique<ShaderMemoryCache>(options.memoryCacheBytes)) {}
+
+CompileServer::~CompileServer() {
+    stop();
+}
+
+void CompileServer::start() {
+    if (listenFd >= 0) {
+        return;
+    }
+
+    sockaddr_un address = socketAddress(options.socketPath);
+
+    // A leftover socket file from a server that died is replaced, a live one is not
+    struct stat info;
+    if (stat(options.socketPath.c_str(), &info) == 0) {
+        if (!S_ISSOCK(info.st_mode)) {
+            throw std::runtime_error("Not a socket: " + options.socketPath);
+        }
+        int live = connectTo(options.socketPath);
+        if (live >= 0) {
+            close(live);
+            throw std::runtime_error("A compile server is already listening on " + options.socketPath);
+        }
+        unlink(options.socketPath.c_str());
+    }
+
+    listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenFd < 0 ||
+        bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+        listen(listenFd, SOMAXCONN) != 0) {
+        std::string reason = std::strerror(errno);
+        if (listenFd >= 0) {
+            close(listenFd);
+            listenFd = -1;
+        }
+        throw std::runtime_error("Failed to listen on " + options.socketPath + ": " + reason);
+    }
+
+    stopping = false;
+    workersExit = false;
+    unsigned threadCount = BatchCompiler::resolveThreadCount(options.threadCount, SIZE_MAX);
+    for (unsigned i = 0; i < threadCount; ++i) {
+        workers.emplace_back(&CompileServer::workerLoop, this);
+    }
+    acceptThread = std::thread(&CompileServer::acceptLoop, this);
+}
+
+void CompileServer::stop() {
+    if (listenFd < 0) {
+        return;
+    }
+
+    stopping = true;
+    acceptThread.join();
+    close(listenFd);
+    listenFd = -1;
+    unlink(options.socketPath.c_str());
+
+    // Wakes connections blocked in recv; a batch in progress still completes
+    {
+        std::lock_guard<std::mutex> lock(connectionMutex);
+        for (auto& connection : connections) {
+            shutdown(connection->fd, SHUT_RDWR);
+        }
+    }
+    reapConnections(true);
+
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        workersExit = true;
+    }
+    queueReady.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    workers.clear();
+}
+
+CompileServer::Stats CompileServer::getStats() const {
+    std::lock_guard<std::mutex> lock(statsMutex);
+    Stats result = stats;
+    result.memoryCache = memoryCache->getStats();
+    return result;
+}
+
+void CompileServer::acceptLoop() {
+    while (!stopping) {
+        pollfd pfd{listenFd, POLLIN, 0};
+        if (poll(&pfd, 1, ACCEPT_POLL_MS) <= 0) {
+            reapConnections(false);
+            continue;
+        }
+
+        int fd = accept(listenFd, nullptr, nullptr);
+        if (fd < 0) {
+            continue;
+        }
+
+        std::lock_guard<std::mutex> lock(connectionMutex);
+        connections.push_back(std::make_unique<Connection>());
+        Connection* connection = connections.back().get();
+        connection->fd = fd;
+        connection->thread = std::thread(&CompileServer::serveConnection, this, connection);
+
+        std::lock_guard<std::mutex> statsLock(statsMutex);
+        stats.connections++;
+    }
+}
+
+void CompileServer::serveConnection(Connection* connection) {
+    std::string payload;
+    while (!stopping && receiveFrame(connection->fd, REQUEST_MAGIC, payload)) {
+        Batch batch;
+        try {
+            FrameReader reader(payload);
+            if (reader.get<uint32_t>() != PROTOCOL_VERSION) {
+                break;
+            }
+            // Three flags and three length-prefixed strings
+            uint32_t count = reader.getCount(3 * sizeof(uint8_t) + 3 * sizeof(uint32_t));
+            batch.requests.resize(count);
+            for (auto& request : batch.requests) {
+                request.optimizationEnabled = reader.get<uint8_t>() != 0;
+                request.backend = static_cast<SpirvBackend>(reader.get<uint8_t>());
+                request.spirvOptimizationEnabled = reader.get<uint8_t>() != 0;
+                request.name = reader.getString();
+                request.shaderType = reader.getString();
+                request.source = reader.getString();
+            }
+        } catch (const std::exception&) {
+            break;  // Malformed frame: drop the connection
+        }
+
+        batch.responses.resize(batch.requests.size());
+        batch.remaining = batch.requests.size();
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            for (size_t i = 0; i < batch.requests.size(); ++i) {
+                queue.push_back({&batch, i});
+            }
+            queueReady.notify_all();
+            batchDone.wait(lock, [&] { return batch.remaining == 0; });
+        }
+
+        FrameWriter writer;
+        writer.put(static_cast<uint32_t>(batch.responses.size()));
+        size_t failures = 0;
+        for (const auto& response : batch.responses) {
+            writer.put(static_cast<uint8_t>(response.success));
+            writer.put(static_cast<uint8_t>(response.cache));
+            writer.put(response.compileTimeMs);
+            if (response.success) {
+                writer.putWords(response.spirv);
+            } else {
+                // Sent as fields; the client formats the message
+                const CompileDiagnostic& diagnostic = response.diagnostic;
+                writer.put(static_cast<uint8_t>(diagnostic.hasStage));
+                writer.put(static_cast<uint8_t>(diagnostic.stage));
+                writer.put(static_cast<int32_t>(diagnostic.line));
+                writer.put(static_cast<int32_t>(diagnostic.column));
+                writer.putString(diagnostic.message);
+                failures++;
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(statsMutex);
+            stats.batches++;
+            stats.shaders += batch.responses.size();
+            stats.failures += failures;
+        }
+
+        if (!sendFrame(connection->fd, RESPONSE_MAGIC, writer.data)) {
+            break;
+        }
+    }
+
+    connection->done = true;
+}
+
+void CompileServer::workerLoop() {
+    ShaderCompiler compiler;
+    compiler.setCacheDirectory(options.cacheDirectory);
+    compiler.setMemoryCache(memoryCache.get());
+
+    while (true) {
+        Task task;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            queueReady.wait(lock, [&] { return workersExit || !queue.empty(); });
+            if (queue.empty()) {
+                return;
+            }
+            task = queue.front();
+            queue.pop_front();
+        }
+
+        compileTask(compiler, task);
+
+        std::lock_guard<std::mutex> lock(queueMutex);
+        if (--task.batch->remaining == 0) {
+            batchDone.notify_all();
+        }
+    }
+}
+
+void CompileServer::compileTask(ShaderCompiler& compiler, const Task& task) {
+    const CompileRequest& request = task.batch->requests[task.index];
+    CompileResponse& response = task.batch->responses[task.index];
+
+    auto start = std::chrono::steady_clock::now();
+    try {
+        // Checked here: setBackend() would throw for a backend this build lacks,
+        // and a client may send one
+        if (!CodeGenerator::isBackendAvailable(request.backend)) {
+            throw std::runtime_error(std::string("SPIR-V backend '") + CodeGenerator::backendName(request.backend) +
+                                     "' is not available on this server");
+        }
+        compiler.setBackend(request.backend);
+        compiler.setOptimizationEnabled(request.optimizationEnabled);
+        compiler.setSpirvOptimizationEnabled(request.spirvOptimizationEnabled);
+
+        response.spirv = compiler.compile(request.source, request.shaderType);
+        response.success = true;
+
+        const auto& compileStats = compiler.getStats();
+        if (compileStats.memoryCacheHits) {
+            response.cache = CompileResponse::CacheResult::MEMORY;
+        } else if (compileStats.cacheHits) {
+            response.cache = CompileResponse::CacheResult::DISK;
+        }
+    } catch (const std::exception& e) {
+        response.success = false;
+        response.error = e.what();
+        response.diagnostic = CompileDiagnostic::fromException(e);
+    }
+    response.compileTimeMs = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
+void CompileServer::reapConnections(bool all) {
+    std::list<std::unique_ptr<Connection>> finished;
+    {
+        std::lock_guard<std::mutex> lock(connectionMutex);
+        for (auto it = connections.begin(); it != connections.end();) {
+            if (all || (*it)->done) {
+                finished.push_back(std::move(*it));
+                it = connections.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    // Joined outside the lock; a connection finishing its batch never needs it
+    for (auto& connection : finished) {
+        connection->thread.join();
+        close(connection->fd);
+    }
+}
+
+CompileClient::CompileClient(const std::string& socketPath) {
+    fd = connectTo(socketPath);
+    if (fd < 0) {
+        throw std::runtime_error("No compile server listening on " + socketPath);
+    }
+}
+
+CompileClient::~CompileClient() {
+    if (fd >= 0) {
+        close(fd);
+    }
+}
+
+std::vector<CompileResponse> CompileClient::compile(const std::vector<CompileRequest>& requests) {
+    FrameWriter writer;
+    writer.put(PROTOCOL_VERSION);
+    writer.put(static_cast<uint32_t>(requests.size()));
+    for (const auto& request : requests) {
+        writer.put(static_cast<uint8_t>(request.optimizationEnabled));
+        writer.put(static_cast<uint8_t>(request.backend));
+        writer.put(static_cast<uint8_t>(request.spirvOptimizationEnabled));
+        writer.putString(request.name);
+        writer.putString(request.shaderType);
+        writer.putString(request.source);
+    }
+
+    if (writer.data.size() > MAX_FRAME_BYTES) {
+        throw std::runtime_error("Compile batch too large; split it into several requests");
+    }
+
+    std::string payload;
+    if (!sendFrame(fd, REQUEST_MAGIC, writer.data) || !receiveFrame(fd, RESPONSE_MAGIC, payload)) {
+        throw std::runtime_error("Lost connection to the compile server");
+    }
+
+    FrameReader reader(payload);
+    // Two flags, the compile time and at least a word count or message length
+    std::vector<CompileResponse> responses(reader.getCount(2 * sizeof(uint8_t) + sizeof(double) + sizeof(uint32_t)));
+    if (responses.size() != requests.size()) {
+        throw std::runtime_error("Compile server answered " + std::to_string(responses.size()) +
+                                 " of " + std::to_string(requests.size()) + " shaders");
+    }
+    for (auto& response : responses) {
+        response.success = reader.get<uint8_t>() != 0;
+        response.cache = static_cast<CompileResponse::CacheResult>(reader.get<uint8_t>());
+        response.compileTimeMs = reader.get<double>();
+        if (response.success) {
+            response.spirv = reader.getWords();
+        } else {
+            CompileDiagnostic& diagnostic = response.diagnostic;
+            diagnostic.hasStage = reader.get<uint8_t>() != 0;
+            diagnostic.stage = static_cast<ShaderCompilationError::Stage>(reader.get<uint8_t>());
+            diagnostic.line = reader.get<int32_t>();
+            diagnostic.column = reader.get<int32_t>();
+            diagnostic.message = reader.getString();
+            response.error = diagnostic.format();
+        }
+    }
+    return responses;
+}
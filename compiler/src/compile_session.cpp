@@ -0,0 +1,405 @@
+#include "compile_session.h"
+#include "optimizer.h"
+#include "shader_compiler.h"
+#include "spirv_optimizer.h"
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <stdexcept>
+
+namespace {
+
+// The arena is compacted once it holds this many times the bytes of the
+// last compile from scratch (and at least COMPACT_MIN_BYTES)
+const size_t COMPACT_FACTOR = 4;
+const size_t COMPACT_MIN_BYTES = 1024 * 1024;
+
+double elapsedMs(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Point tokens lexed from one copy of the source at another copy
+void rebaseTokens(std::vector<Token>& tokens, const char* from, const char* to) {
+    if (from == to) {
+        return;
+    }
+    for (auto& token : tokens) {
+        token.value = std::string_view(to + (token.value.data() - from), token.value.size());
+    }
+}
+
+} // namespace
+
+CompileSession::CompileSession(const std::string& type)
+    : shaderType(type), backend(CodeGenerator::defaultBackend()) {
+    if (!ShaderCompiler::isValidShaderType(type)) {
+        throw std::runtime_error("Invalid shader type: '" + type + "'. Must be 'vertex' or 'fragment'.");
+    }
+}
+
+void CompileSession::setOptimizationEnabled(bool enabled) {
+    optimizationEnabled = enabled;
+    hasResult = false;
+}
+
+void CompileSession::setBackend(SpirvBackend newBackend) {
+    if (!CodeGenerator::isBackendAvailable(newBackend)) {
+        throw std::runtime_error(std::string("SPIR-V backend '") + CodeGenerator::backendName(newBackend) +
+                                 "' is not available in this build");
+    }
+    backend = newBackend;
+    hasResult = false;
+}
+
+void CompileSession::setSpirvOptimizationEnabled(bool enabled) {
+    spirvOptimizationEnabled = enabled;
+    hasResult = false;
+    spirv.clear();
+}
+
+void CompileSession::reset() {
+    source.clear();
+    tokens.clear();
+    hasResult = false;
+    spirv.clear();
+    generatedGLSL.clear();
+    parsedStatements.clear();
+    simplifiedStatements.clear();
+    codegenMemo = CodegenMemo();
+    arena.reset();
+    compactThreshold = 0;
+    lastUpdate = UpdateStats();
+}
+
+std::vector<uint32_t> CompileSession::update(std::string_view text) {
+    auto totalStart = std::chrono::steady_clock::now();
+    lastUpdate = UpdateStats();
+
+    if (hasResult && text == source) {
+        lastUpdate.tokenCount = tokens.size();
+        lastUpdate.spirvReused = true;
+        lastUpdate.totalTimeMs = elapsedMs(totalStart);
+        return spirv;
+    }
+
+    // Memoized nodes are never freed one by one; once replaced ones
+    // dominate the arena, start over with an empty one
+    if (compactThreshold != 0 && arena.bytesUsed() > compactThreshold) {
+        parsedStatements.clear();
+        simplifiedStatements.clear();
+        arena.reset();
+        compactThreshold = 0;
+        lastUpdate.fullRebuild = true;
+    }
+
+    // PHASE 1: LEXING
+    // The new text and its tokens replace the old ones only once lexing
+    // succeeded, so a failed update leaves a consistent pair behind
+    auto lexStart = std::chrono::steady_clock::now();
+    try {
+        std::string next(text);
+        std::vector<Token> nextTokens = relex(next);
+
+        const char* lexed = next.data();
+        source.swap(next);
+        rebaseTokens(nextTokens, lexed, source.data());
+        tokens.swap(nextTokens);
+        hasResult = false;
+    } catch (const std::runtime_error& e) {
+        ShaderCompilationError::rethrow(ShaderCompilationError::Stage::LEXING, e);
+    }
+    lastUpdate.tokenCount = tokens.size();
+    lastUpdate.lexingTimeMs = elapsedMs(lexStart);
+
+    // PHASE 2: PARSING
+    auto parseStart = std::chrono::steady_clock::now();
+    std::vector<AstHash> hashes;
+    ProgramNode* ast = nullptr;
+    try {
+        ast = parse(hashes);
+    } catch (const std::runtime_error& e) {
+        ShaderCompilationError::rethrow(ShaderCompilationError::Stage::PARSING, e);
+    }
+    lastUpdate.parsingTimeMs = elapsedMs(parseStart);
+
+    // PHASE 3: OPTIMIZATION
+    if (optimizationEnabled) {
+        auto optimizeStart = std::chrono::steady_clock::now();
+        try {
+            ast = optimize(ast, hashes);
+        } catch (const std::runtime_error& e) {
+            ShaderCompilationError::rethrow(ShaderCompilationError::Stage::OPTIMIZATION, e);
+        }
+        lastUpdate.optimizationTimeMs = elapsedMs(optimizeStart);
+    }
+
+    // PHASE 4: CODE GENERATION
+    auto codegenStart = std::chrono::steady_clock::now();
+    CodeGenerator codegen(backend);
+    codegen.setMemo(&codegenMemo);
+    std::vector<uint32_t> result;
+    try {
+        result = codegen.generate(ast, shaderType);
+    } catch (const std::runtime_error& e) {
+        generatedGLSL = codegen.getGeneratedGLSL();
+        ShaderCompilationError::rethrow(ShaderCompilationError::Stage::CODE_GENERATION, e);
+    }
+    lastUpdate.codegenTimeMs = elapsedMs(codegenStart);
+    lastUpdate.glslStatementsGenerated = codegenMemo.statementsGenerated;
+    lastUpdate.glslStatementsReused = codegenMemo.statementsReused;
+    lastUpdate.spirvReused = codegenMemo.moduleReused;
+
+    // PHASE 5: SPIR-V OPTIMIZATION
+    // An unchanged module was optimized by the update that generated it
+    if (spirvOptimizationEnabled) {
+        if (codegenMemo.moduleReused && !spirv.empty()) {
+            result = spirv;
+        } else {
+            spirv.clear();
+            auto spirvOptimizeStart = std::chrono::steady_clock::now();
+            try {
+                SpirvOptimizer spirvOptimizer;
+                spirvOptimizer.optimize(result);
+            } catch (const std::runtime_error& e) {
+                ShaderCompilationError::rethrow(ShaderCompilationError::Stage::OPTIMIZATION, e);
+            }
+            lastUpdate.spirvOptimizationTimeMs = elapsedMs(spirvOptimizeStart);
+        }
+    }
+
+    spirv = result;
+    generatedGLSL = codegen.getGeneratedGLSL();
+    hasResult = true;
+
+    if (compactThreshold == 0) {
+        compactThreshold = std::max(arena.bytesUsed() * COMPACT_FACTOR, COMPACT_MIN_BYTES);
+    }
+
+    lastUpdate.totalTimeMs = elapsedMs(totalStart);
+    return result;
+}
+
+std::vector<Token> CompileSession::relex(const std::string& next) {
+    std::vector<Token> result;
+    if (tokens.empty()) {
+        Lexer lexer(next);
+        result = lexer.tokenize();
+        lastUpdate.tokensRelexed = result.size();
+        return result;
+    }
+
+    // The edit is whatever lies between the common prefix and suffix
+    size_t limit = std::min(source.size(), next.size());
+    size_t prefix = 0;
+    while (prefix < limit && source[prefix] == next[prefix]) {
+        prefix++;
+    }
+    size_t suffix = 0;
+    while (suffix < limit - prefix && source[source.size() - 1 - suffix] == next[next.size() - 1 - suffix]) {
+        suffix++;
+    }
+    size_t editEnd = next.size() - suffix;
+    std::ptrdiff_t delta = static_cast<std::ptrdiff_t>(next.size()) - static_cast<std::ptrdiff_t>(source.size());
+
+    // Tokens that end before the edit are unchanged, bar the last of them,
+    // which could merge with what follows it (ab -> abc, 1 -> 1.5)
+    auto touched = std::partition_point(tokens.begin(), tokens.end(), [&](const Token& token) {
+        return offsetOf(token) + token.value.size() < prefix;
+    });
+    size_t restart = static_cast<size_t>(touched - tokens.begin());
+    restart = restart > 0 ? restart - 1 : 0;
+
+    for (size_t i = 0; i < restart; i++) {
+        Token token = tokens[i];
+        token.value = std::string_view(next.data() + offsetOf(tokens[i]), token.value.size());
+        result.push_back(token);
+    }
+
+    Lexer lexer = restart == 0
+        ? Lexer(next)
+        : Lexer(next, offsetOf(tokens[restart]), tokens[restart].line, tokens[restart].column);
+
+    // The lexer carries no state between tokens, so once a new token starts
+    // where an old one did in the unchanged suffix, the rest of the old
+    // stream is valid again, only shifted by the edit
+    size_t old = restart;
+    while (true) {
+        Token token = lexer.next();
+        lastUpdate.tokensRelexed++;
+
+        size_t offset = static_cast<size_t>(token.value.data() - next.data());
+        if (offset >= editEnd) {
+            size_t oldOffset = static_cast<size_t>(static_cast<std::ptrdiff_t>(offset) - delta);
+            while (old < tokens.size() && offsetOf(tokens[old]) < oldOffset) {
+                old++;
+            }
+
+            if (old < tokens.size() && offsetOf(tokens[old]) == oldOffset && tokens[old].type == token.type) {
+                int resyncLine = tokens[old].line;
+                int lineDelta = token.line - resyncLine;
+                int columnDelta = token.column - tokens[old].column;
+
+                for (size_t i = old; i < tokens.size(); i++) {
+                    Token shifted = tokens[i];
+                    shifted.value = std::string_view(next.data() + offsetOf(tokens[i]) + delta, shifted.value.size());
+                    if (shifted.line == resyncLine) {
+                        shifted.column += columnDelta;
+                    }
+                    shifted.line += lineDelta;
+                    result.push_back(shifted);
+                }
+                return result;
+            }
+        }
+
+        result.push_back(token);
+        if (token.type == TokenType::END_OF_FILE) {
+            return result;
+        }
+    }
+}
+
+bool CompileSession::statementKey(size_t first, std::string& key, size_t& end) const {
+    // Statements contain no nested ';', so the first one closes it
+    for (size_t i = first; i < tokens.size(); i++) {
+        const Token& token = tokens[i];
+        if (token.type == TokenType::RBRACE || token.type == TokenType::END_OF_FILE) {
+            return false;
+        }
+
+        key.push_back(static_cast<char>(token.type));
+        key.append(token.value);
+        key.push_back('\0');
+
+        if (token.type == TokenType::SEMICOLON) {
+            end = i + 1;
+            return true;
+        }
+    }
+    return false;
+}
+
+ProgramNode* CompileSession::parse(std::vector<AstHash>& hashes) {
+    // Every statement the parser reaches, in order; the memo of this update
+    // only keeps what was seen, so edited-away statements are dropped
+    struct Visit {
+        std::string key;
+        bool reused = false;
+        AstHash hash;
+    };
+    std::vector<Visit> visits;
+    std::unordered_map<std::string, ParsedStatement> next;
+
+    Parser parser(tokens, arena);
+    parser.setStatementLookup([&](size_t first, size_t& end) -> ASTNode* {
+        Visit visit;
+        if (!statementKey(first, visit.key, end)) {
+            // Unterminated: parsing it reports the error
+            visits.push_back(std::move(visit));
+            return nullptr;
+        }
+
+        auto it = next.find(visit.key);
+        if (it == next.end()) {
+            auto previous = parsedStatements.find(visit.key);
+            if (previous == parsedStatements.end()) {
+                visits.push_back(std::move(visit));
+                return nullptr;
+            }
+            it = next.emplace(previous->first, previous->second).first;
+        }
+
+        visit.reused = true;
+        visit.hash = it->second.hash;
+        visits.push_back(std::move(visit));
+        return it->second.node;
+    });
+    ProgramNode* ast = parser.parse();
+
+    // The lookup ran once per statement, in the order of the program
+    size_t index = 0;
+    for (const auto* decl : ast->declarations) {
+        if (decl->type != ASTNodeType::SHADER_DECL) {
+            continue;
+        }
+        for (auto* stmt : static_cast<const ShaderDeclNode*>(decl)->statements) {
+            Visit& visit = visits[index++];
+            if (visit.reused) {
+                lastUpdate.statementsReused++;
+            } else {
+                lastUpdate.statementsParsed++;
+                visit.hash = hashAST(stmt);
+                next.emplace(std::move(visit.key), ParsedStatement{stmt, visit.hash});
+            }
+            hashes.push_back(visit.hash);
+        }
+    }
+
+    parsedStatements.swap(next);
+    return ast;
+}
+
+ProgramNode* CompileSession::optimize(ProgramNode* ast, const std::vector<AstHash>& hashes) {
+    // Only the shader codegen picks is optimized; parsed statements are
+    // memoized, so it is optimized as a copy
+    auto* program = arena.create<ProgramNode>();
+    std::unordered_map<SimplifyKey, ASTNode*, SimplifyKeyHash> next;
+    Optimizer optimizer(arena);
+    bool optimized = false;
+    size_t firstHash = 0;
+
+    for (auto* decl : ast->declarations) {
+        auto* shader = decl->type == ASTNodeType::SHADER_DECL ? static_cast<ShaderDeclNode*>(decl) : nullptr;
+        if (!shader || optimized || shader->shaderType != shaderType) {
+            program->declarations.push_back(arena, decl);
+            firstHash += shader ? shader->statements.size() : 0;
+            continue;
+        }
+        optimized = true;
+
+        auto* copy = arena.create<ShaderDeclNode>(*shader);
+        copy->statements = NodeList();
+        optimizer.beginShader(shader);
+
+        for (size_t i = 0; i < shader->statements.size(); i++) {
+            ASTNode* stmt = shader->statements[i];
+            if (stmt->type != ASTNodeType::ASSIGNMENT) {
+                copy->statements.push_back(arena, cloneAST(arena, stmt));
+                continue;
+            }
+            auto* assign = static_cast<AssignmentNode*>(stmt);
+
+            // Same statement reading the same types: same simplification
+            SimplifyKey key{hashes[firstHash + i], optimizer.typeContext(assign)};
+            auto it = next.find(key);
+            if (it == next.end()) {
+                auto previous = simplifiedStatements.find(key);
+                if (previous != simplifiedStatements.end()) {
+                    it = next.emplace(std::move(key), previous->second).first;
+                    lastUpdate.simplificationsReused++;
+                } else {
+                    auto* simplified = static_cast<AssignmentNode*>(cloneAST(arena, assign));
+                    optimizer.simplifyStatement(simplified);
+                    it = next.emplace(std::move(key), simplified).first;
+                    lastUpdate.statementsSimplified++;
+                }
+            } else {
+                lastUpdate.simplificationsReused++;
+            }
+
+            auto* simplified = static_cast<AssignmentNode*>(it->second);
+            optimizer.declareAssignment(simplified);
+
+            // Dead code elimination and CSE rewrite the shader in place, so
+            // they work on a copy of the memoized form
+            copy->statements.push_back(arena, cloneAST(arena, simplified));
+        }
+
+        optimizer.finishShader(copy);
+        program->declarations.push_back(arena, copy);
+        firstHash += shader->statements.size();
+    }
+
+    simplifiedStatements.swap(next);
+    return program;
+}
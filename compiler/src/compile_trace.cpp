@@ -0,0 +1,84 @@
+#include "compile_trace.h"
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+
+namespace {
+
+// Names and details are file names and pass names; quotes, backslashes and
+// control characters are all they can need escaped
+void writeJsonString(std::ostream& out, const std::string& text) {
+    static const char hex[] = "0123456789abcdef";
+    out << '"';
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            out << '\\' << c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            out << "\\u00" << hex[(c >> 4) & 0xF] << hex[c & 0xF];
+        } else {
+            out << c;
+        }
+    }
+    out << '"';
+}
+
+}
+
+void CompileTrace::record(const char* name, const char* category, std::string detail, Clock::time_point start,
+                          Clock::time_point end) {
+    Span span;
+    span.name = name;
+    span.category = category;
+    span.detail = std::move(detail);
+    span.startUs = std::chrono::duration<double, std::micro>(start - origin).count();
+    span.durationUs = std::chrono::duration<double, std::micro>(end - start).count();
+
+    std::thread::id self = std::this_thread::get_id();
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = std::find(threads.begin(), threads.end(), self);
+    span.thread = static_cast<uint32_t>(it - threads.begin()) + 1;
+    if (it == threads.end()) {
+        threads.push_back(self);
+    }
+    spans.push_back(std::move(span));
+}
+
+std::vector<CompileTrace::Span> CompileTrace::getSpans() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return spans;
+}
+
+void CompileTrace::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    spans.clear();
+    threads.clear();
+    origin = Clock::now();
+}
+
+bool CompileTrace::writeChromeTrace(const std::string& path) const {
+    std::ofstream file(path, std::ios::trunc);
+    if (!file) {
+        return false;
+    }
+
+    // Fixed notation: a trace of a long batch has timestamps past 1e6 us
+    std::lock_guard<std::mutex> lock(mutex);
+    file << std::fixed << std::setprecision(3) << "{\"traceEvents\":[\n";
+    bool first = true;
+    for (const auto& span : spans) {
+        file << (first ? "" : ",\n") << "{\"name\":";
+        writeJsonString(file, span.name);
+        file << ",\"cat\":\"" << span.category << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << span.thread
+             << ",\"ts\":" << span.startUs << ",\"dur\":" << span.durationUs;
+        if (!span.detail.empty()) {
+            file << ",\"args\":{\"detail\":";
+            writeJsonString(file, span.detail);
+            file << "}";
+        }
+        file << "}";
+        first = false;
+    }
+    file << "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+    return static_cast<bool>(file);
+}
@@ -0,0 +1,49 @@
+#include "diagnostics.h"
+
+const char* ShaderCompilationError::stageName(Stage stage) {
+    switch (stage) {
+        case Stage::LEXING: return "Lexing";
+        case Stage::PARSING: return "Parsing";
+        case Stage::OPTIMIZATION: return "Optimization";
+        case Stage::CODE_GENERATION: return "Code Generation";
+    }
+    return "Unknown";
+}
+
+void ShaderCompilationError::rethrow(Stage stage, const std::runtime_error& error) {
+    if (auto* compilationError = dynamic_cast<const ShaderCompilationError*>(&error)) {
+        throw *compilationError;
+    }
+    throw ShaderCompilationError(stage, error.what());
+}
+
+std::string ShaderCompilationError::formatMessage(Stage stage, const std::string& message, int line, int column) {
+    std::string text = "[";
+    text += stageName(stage);
+    text += " Error] ";
+    if (line > 0) {
+        text += std::to_string(line) + ":" + std::to_string(column) + ": ";
+    }
+    return text + message;
+}
+
+CompileDiagnostic CompileDiagnostic::fromException(const std::exception& error) {
+    CompileDiagnostic diagnostic;
+    if (auto* compilationError = dynamic_cast<const ShaderCompilationError*>(&error)) {
+        diagnostic.hasStage = true;
+        diagnostic.stage = compilationError->getStage();
+        diagnostic.line = compilationError->getLine();
+        diagnostic.column = compilationError->getColumn();
+        diagnostic.message = compilationError->getMessage();
+    } else {
+        diagnostic.message = error.what();
+    }
+    return diagnostic;
+}
+
+std::string CompileDiagnostic::format() const {
+    if (!hasStage) {
+        return message;
+    }
+    return ShaderCompilationError(stage, message, line, column).what();
+}
@@ -1,31 +1,54 @@
 #include "lexer.h"
+#include "diagnostics.h"
 #include <cctype>
 #include <stdexcept>
-#include <map>
 
-// Keyword map
-static const std::map<std::string, TokenType> keywords = {
-    {"shader", TokenType::SHADER},
-    {"vertex", TokenType::VERTEX},
-    {"fragment", TokenType::FRAGMENT},
-    {"input", TokenType::INPUT},
-    {"output", TokenType::OUTPUT},
-    {"uniform", TokenType::UNIFORM},
-    {"main", TokenType::MAIN},
-    {"vec2", TokenType::VEC2},
-    {"vec3", TokenType::VEC3},
-    {"vec4", TokenType::VEC4},
-    {"mat4", TokenType::MAT4},
-    {"float", TokenType::FLOAT},
-    {"int", TokenType::INT}
-};
+Lexer::Lexer(std::string_view src) : source(src) {}
 
-Lexer::Lexer(const std::string& src) : source(src) {}
+Lexer::Lexer(std::string_view src, size_t start, int startLine, int startColumn)
+    : source(src), position(start), line(startLine), column(startColumn) {}
 
-std::vector<Token> Lexer::tokenize() {
-    std::vector<Token> tokens;
-    
-    while (position < source.length()) {
+TokenType Lexer::keywordType(std::string_view word) {
+    // Dispatch on length, then compare: no hashing and no allocation
+    switch (word.size()) {
+        case 3:
+            if (word == "int") return TokenType::INT;
+            break;
+        case 4:
+            if (word[0] == 'v') {
+                if (word == "vec2") return TokenType::VEC2;
+                if (word == "vec3") return TokenType::VEC3;
+                if (word == "vec4") return TokenType::VEC4;
+            } else if (word == "mat4") {
+                return TokenType::MAT4;
+            } else if (word == "main") {
+                return TokenType::MAIN;
+            }
+            break;
+        case 5:
+            if (word == "input") return TokenType::INPUT;
+            if (word == "float") return TokenType::FLOAT;
+            if (word == "const") return TokenType::CONST;
+            break;
+        case 6:
+            if (word == "shader") return TokenType::SHADER;
+            if (word == "vertex") return TokenType::VERTEX;
+            if (word == "output") return TokenType::OUTPUT;
+            break;
+        case 7:
+            if (word == "uniform") return TokenType::UNIFORM;
+            break;
+        case 8:
+            if (word == "fragment") return TokenType::FRAGMENT;
+            break;
+        default:
+            break;
+    }
+    return TokenType::IDENTIFIER;
+}
+
+Token Lexer::next() {
+    while (true) {
         skipWhitespace();
         
         if (position >= source.length()) {
@@ -40,62 +63,76 @@ std::vector<Token> Lexer::tokenize() {
             continue;
         }
         
+        tokenCount++;
+        
         // Numbers
-        if (std::isdigit(c) || (c == '.' && std::isdigit(peek()))) {
-            tokens.push_back(readNumber());
-            continue;
+        if (std::isdigit(static_cast<unsigned char>(c)) ||
+            (c == '.' && std::isdigit(static_cast<unsigned char>(peek())))) {
+            return readNumber();
         }
         
         // Identifiers and keywords
-        if (std::isalpha(c) || c == '_') {
-            tokens.push_back(readIdentifier());
-            continue;
+        if (std::isalpha(static_cast<unsigned char>(c)) || c == '_') {
+            return readIdentifier();
         }
         
         // Single character tokens
         Token token;
-        token.line = line;
-        token.column = column;
-        
         switch (c) {
-            case '+': token = makeToken(TokenType::PLUS, "+"); break;
-            case '-': token = makeToken(TokenType::MINUS, "-"); break;
-            case '*': token = makeToken(TokenType::MULTIPLY, "*"); break;
-            case '/': token = makeToken(TokenType::DIVIDE, "/"); break;
-            case '=': token = makeToken(TokenType::ASSIGN, "="); break;
-            case '(': token = makeToken(TokenType::LPAREN, "("); break;
-            case ')': token = makeToken(TokenType::RPAREN, ")"); break;
-            case '{': token = makeToken(TokenType::LBRACE, "{"); break;
-            case '}': token = makeToken(TokenType::RBRACE, "}"); break;
-            case ';': token = makeToken(TokenType::SEMICOLON, ";"); break;
-            case ',': token = makeToken(TokenType::COMMA, ","); break;
-            case '.': token = makeToken(TokenType::DOT, "."); break;
+            case '+': token = makeToken(TokenType::PLUS, 1); break;
+            case '-': token = makeToken(TokenType::MINUS, 1); break;
+            case '*': token = makeToken(TokenType::MULTIPLY, 1); break;
+            case '/': token = makeToken(TokenType::DIVIDE, 1); break;
+            case '=': token = makeToken(TokenType::ASSIGN, 1); break;
+            case '(': token = makeToken(TokenType::LPAREN, 1); break;
+            case ')': token = makeToken(TokenType::RPAREN, 1); break;
+            case '{': token = makeToken(TokenType::LBRACE, 1); break;
+            case '}': token = makeToken(TokenType::RBRACE, 1); break;
+            case ';': token = makeToken(TokenType::SEMICOLON, 1); break;
+            case ',': token = makeToken(TokenType::COMMA, 1); break;
+            case '.': token = makeToken(TokenType::DOT, 1); break;
             default:
-                throw std::runtime_error("Unexpected character: " + std::string(1, c));
+                throw ShaderCompilationError(ShaderCompilationError::Stage::LEXING,
+                                             "Unexpected character '" + std::string(1, c) + "'", line, column);
         }
         
-        tokens.push_back(token);
         advance();
+        return token;
+    }
+    
+    if (!reachedEnd) {
+        reachedEnd = true;
+        tokenCount++;
     }
     
     Token eof;
     eof.type = TokenType::END_OF_FILE;
-    eof.value = "";
+    eof.value = source.substr(source.length());
     eof.line = line;
     eof.column = column;
-    tokens.push_back(eof);
+    return eof;
+}
+
+std::vector<Token> Lexer::tokenize() {
+    std::vector<Token> tokens;
+    
+    Token token;
+    do {
+        token = next();
+        tokens.push_back(token);
+    } while (token.type != TokenType::END_OF_FILE);
     
     return tokens;
 }
 
-char Lexer::currentChar() {
+char Lexer::currentChar() const {
     if (position >= source.length()) {
         return '\0';
     }
     return source[position];
 }
 
-char Lexer::peek(int offset) {
+char Lexer::peek(int offset) const {
     if (position + offset >= source.length()) {
         return '\0';
     }
@@ -115,7 +152,7 @@ void Lexer::advance() {
 }
 
 void Lexer::skipWhitespace() {
-    while (position < source.length() && std::isspace(currentChar())) {
+    while (position < source.length() && std::isspace(static_cast<unsigned char>(currentChar()))) {
         advance();
     }
 }
@@ -137,18 +174,17 @@ Token Lexer::readNumber() {
     token.column = column;
     token.type = TokenType::NUMBER;
     
-    std::string value;
+    size_t start = position;
     bool hasDecimal = false;
     
-    while (std::isdigit(currentChar()) || (currentChar() == '.' && !hasDecimal)) {
+    while (std::isdigit(static_cast<unsigned char>(currentChar())) || (currentChar() == '.' && !hasDecimal)) {
         if (currentChar() == '.') {
             hasDecimal = true;
         }
-        value += currentChar();
         advance();
     }
     
-    token.value = value;
+    token.value = source.substr(start, position - start);
     return token;
 }
 
@@ -157,29 +193,21 @@ Token Lexer::readIdentifier() {
     token.line = line;
     token.column = column;
     
-    std::string value;
-    while (std::isalnum(currentChar()) || currentChar() == '_') {
-        value += currentChar();
+    size_t start = position;
+    while (std::isalnum(static_cast<unsigned char>(currentChar())) || currentChar() == '_') {
         advance();
     }
     
-    // Check if it's a keyword
-    auto it = keywords.find(value);
-    if (it != keywords.end()) {
-        token.type = it->second;
-    } else {
-        token.type = TokenType::IDENTIFIER;
-    }
-    
-    token.value = value;
+    token.value = source.substr(start, position - start);
+    token.type = keywordType(token.value);
     return token;
 }
 
-Token Lexer::makeToken(TokenType type, const std::string& value) {
+Token Lexer::makeToken(TokenType type, size_t length) {
     Token token;
     token.type = type;
-    token.value = value;
+    token.value = source.substr(position, length);
     token.line = line;
     token.column = column;
     return token;
-}
\ No newline at end of file
+}
@@ -1,283 +1,686 @@
 #include "optimizer.h"
+#include "compile_trace.h"
 #include <cmath>
+#include <iomanip>
 #include <sstream>
 #include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iterator>
+#include <unordered_map>
+#include <unordered_set>
 
-Optimizer::Optimizer() {}
+namespace {
 
-void Optimizer::optimize(ProgramNode* ast) {
-    // Run optimization passes iteratively until no more changes
-    // This ensures we reach a fixed point
-    bool changed = true;
-    int maxPasses = 10; // Safety limit to prevent infinite loops
-    
-    while (changed && stats.totalPasses < maxPasses) {
-        changed = false;
-        stats.totalPasses++;
+// Visit every identifier read by an expression, in source order
+// Walks an explicit stack, so the depth of the tree does not matter. The
+// stack is kept per thread, and a walk started from fn works above the
+// entries of the one that called it
+template <typename Fn>
+void forEachIdentifier(const ASTNode* root, Fn&& fn) {
+    thread_local std::vector<const ASTNode*> pending;
+    size_t base = pending.size();
+    if (root) {
+        pending.push_back(root);
+    }
+    
+    while (pending.size() > base) {
+        const ASTNode* node = pending.back();
+        pending.pop_back();
         
-        // Run optimization passes on each shader declaration
-        for (auto& decl : ast->declarations) {
-            if (decl->type == ASTNodeType::SHADER_DECL) {
-                auto* shader = static_cast<ShaderDeclNode*>(decl.get());
+        switch (node->type) {
+            case ASTNodeType::IDENTIFIER:
+                fn(static_cast<const IdentifierNode*>(node)->name);
+                break;
+            case ASTNodeType::BINARY_OP: {
+                const NodeList& operands = static_cast<const BinaryOpNode*>(node)->operands;
+                pending.insert(pending.end(), std::make_reverse_iterator(operands.end()),
+                               std::make_reverse_iterator(operands.begin()));
+                break;
+            }
+            case ASTNodeType::MEMBER_ACCESS:
+                pending.push_back(static_cast<const MemberAccessNode*>(node)->object);
+                break;
+            case ASTNodeType::FUNCTION_CALL: {
+                const NodeList& arguments = static_cast<const FunctionCallNode*>(node)->arguments;
+                pending.insert(pending.end(), std::make_reverse_iterator(arguments.end()),
+                               std::make_reverse_iterator(arguments.begin()));
+                break;
+            }
+            default:
+                break;
+        }
+    }
+}
+
+// Variable written by an assignment (v = ... or v.xyz = ...), or empty
+std::string_view assignedVariable(const AssignmentNode* assign) {
+    const ASTNode* target = assign->target;
+    if (target->type == ASTNodeType::MEMBER_ACCESS) {
+        target = static_cast<const MemberAccessNode*>(target)->object;
+    }
+    if (target->type == ASTNodeType::IDENTIFIER) {
+        return static_cast<const IdentifierNode*>(target)->name;
+    }
+    return std::string_view();
+}
+
+double elapsedMs(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+Optimizer::Optimizer(AstArena& arena) : arena(arena) {}
+
+void Optimizer::optimize(ProgramNode* ast) {
+    // Each shader is optimized independently in one sweep:
+    // 1. Every expression is simplified bottom-up; a node is only revisited
+    //    when one of its own rewrites produced a new node, so the result is
+    //    a fixed point without re-walking the whole program
+    // 2. Dead assignments are removed with a use-count worklist, which only
+    //    touches statements whose last use just disappeared
+    // 3. Expressions evaluated more than once are hoisted into temporaries
+    //    (after DCE, so dead code never keeps a temporary alive)
+    stats.totalPasses++;
+    
+    for (auto* decl : ast->declarations) {
+        if (decl->type == ASTNodeType::SHADER_DECL) {
+            auto* shader = static_cast<ShaderDeclNode*>(decl);
+            
+            // Locals are typed as they are first assigned, so rewrites that
+            // depend on an operand's type see every variable in scope
+            auto simplifyStart = std::chrono::steady_clock::now();
+            {
+                CompileTrace::Scope span(trace, "simplify", "optimizer", shader->shaderType);
+                beginShader(shader);
                 
-                // Run passes on all statements
                 for (auto& stmt : shader->statements) {
-                    // Constant folding pass
-                    bool foldChanged = constantFoldingPass(stmt.get());
-                    changed |= foldChanged;
-                    
-                    // Algebraic simplification pass
-                    bool algChanged = algebraicSimplificationPass(stmt.get());
-                    changed |= algChanged;
+                    if (stmt->type == ASTNodeType::ASSIGNMENT) {
+                        auto* assign = static_cast<AssignmentNode*>(stmt);
+                        simplifyStatement(assign);
+                        declareAssignment(assign);
+                    }
                 }
-                
-                // Dead code elimination pass (runs on whole shader)
-                bool deadChanged = deadCodeEliminationPass(ast);
-                changed |= deadChanged;
             }
+            stats.simplifyTimeMs += elapsedMs(simplifyStart);
+            
+            finishShader(shader);
         }
     }
 }
 
-bool Optimizer::constantFoldingPass(ASTNode* node) {
-    if (!node) return false;
+void Optimizer::beginShader(const ShaderDeclNode* shader) {
+    types = TypeResolver();
+    types.declareShaderInterface(shader);
+}
+
+void Optimizer::simplifyStatement(AssignmentNode* assign) {
+    simplifyExpression(assign->value);
+}
+
+void Optimizer::declareAssignment(const AssignmentNode* assign) {
+    std::string_view target = assignedVariable(assign);
+    if (!target.empty() && !types.isDeclared(target)) {
+        types.declare(target, types.resolve(assign->value));
+    }
+}
+
+void Optimizer::finishShader(ShaderDeclNode* shader) {
+    auto deadCodeStart = std::chrono::steady_clock::now();
+    {
+        CompileTrace::Scope span(trace, "dead-code", "optimizer", shader->shaderType);
+        eliminateDeadCode(shader);
+    }
+    stats.deadCodeTimeMs += elapsedMs(deadCodeStart);
+    
+    auto cseStart = std::chrono::steady_clock::now();
+    {
+        CompileTrace::Scope span(trace, "cse", "optimizer", shader->shaderType);
+        eliminateCommonSubexpressions(shader);
+    }
+    stats.cseTimeMs += elapsedMs(cseStart);
+}
+
+std::string Optimizer::typeContext(const AssignmentNode* assign) const {
+    std::string context;
+    forEachIdentifier(assign->value, [&](std::string_view name) {
+        context.append(name);
+        context.push_back(':');
+        context.append(types.lookup(name).name());
+        context.push_back(';');
+    });
+    return context;
+}
+
+bool Optimizer::simplifyExpression(ASTNode*& root) {
+    if (!root) return false;
     
+    // Post-order over an explicit stack: operands first, so every rewrite
+    // below sees simplified children, and a deep tree does not recurse
+    std::vector<SimplifyFrame>& stack = simplifyStack;
+    stack.assign(1, {&root, false});
     bool changed = false;
     
-    switch (node->type) {
-        case ASTNodeType::ASSIGNMENT: {
-            auto* assign = static_cast<AssignmentNode*>(node);
-            
-            // Try to fold constants in the value expression
-            changed |= constantFoldingPass(assign->value.get());
-            
-            // After recursion, check if the value itself can be folded
-            if (assign->value->type == ASTNodeType::BINARY_OP) {
-                auto* binOp = static_cast<BinaryOpNode*>(assign->value.get());
-                
-                // Check if both operands are literals
-                if (isLiteral(binOp->left.get()) && isLiteral(binOp->right.get())) {
-                    float leftVal = getLiteralValue(binOp->left.get());
-                    float rightVal = getLiteralValue(binOp->right.get());
-                    
-                    auto folded = foldBinaryOp(binOp->op, leftVal, rightVal);
-                    if (folded) {
-                        // Replace the entire value expression with the folded literal
-                        assign->value = std::move(folded);
-                        stats.constantsFolded++;
-                        changed = true;
+    while (!stack.empty()) {
+        ASTNode** slot = stack.back().slot;
+        ASTNode* node = *slot;
+        
+        if (!stack.back().expanded) {
+            stack.back().expanded = true;
+            switch (node->type) {
+                case ASTNodeType::BINARY_OP:
+                    for (auto& operand : static_cast<BinaryOpNode*>(node)->operands) {
+                        stack.push_back({&operand, false});
                     }
-                }
+                    break;
+                case ASTNodeType::FUNCTION_CALL:
+                    for (auto& arg : static_cast<FunctionCallNode*>(node)->arguments) {
+                        stack.push_back({&arg, false});
+                    }
+                    break;
+                case ASTNodeType::MEMBER_ACCESS:
+                    stack.push_back({&static_cast<MemberAccessNode*>(node)->object, false});
+                    break;
+                default:
+                    break;
             }
-            break;
+            continue;
         }
+        stack.pop_back();
         
-        case ASTNodeType::BINARY_OP: {
-            auto* binOp = static_cast<BinaryOpNode*>(node);
-            
-            // Recursively optimize children first
-            changed |= constantFoldingPass(binOp->left.get());
-            changed |= constantFoldingPass(binOp->right.get());
-            
-            // After recursion, check if we can fold this operation
-            if (isLiteral(binOp->left.get()) && isLiteral(binOp->right.get())) {
-                float leftVal = getLiteralValue(binOp->left.get());
-                float rightVal = getLiteralValue(binOp->right.get());
-                
-                auto folded = foldBinaryOp(binOp->op, leftVal, rightVal);
-                if (folded) {
-                    // We can't replace ourselves, but we can transform into a literal
-                    auto* foldedLit = static_cast<LiteralNode*>(folded.get());
-                    
-                    // Transform this BinaryOpNode into a LiteralNode
-                    binOp->type = ASTNodeType::LITERAL;
-                    binOp->left.reset();
-                    binOp->right.reset();
-                    binOp->op.clear();
-                    
-                    // Reinterpret as LiteralNode and set value
-                    auto* litNode = reinterpret_cast<LiteralNode*>(binOp);
-                    litNode->value = foldedLit->value;
-                    
-                    stats.constantsFolded++;
-                    changed = true;
-                }
-            }
-            break;
+        if (node->type != ASTNodeType::BINARY_OP && node->type != ASTNodeType::FUNCTION_CALL &&
+            node->type != ASTNodeType::MEMBER_ACCESS) {
+            continue;
         }
         
-        case ASTNodeType::FUNCTION_CALL: {
-            auto* funcCall = static_cast<FunctionCallNode*>(node);
-            for (auto& arg : funcCall->arguments) {
-                changed |= constantFoldingPass(arg.get());
-                
-                // After recursion, check if argument can be folded
-                if (arg->type == ASTNodeType::BINARY_OP) {
-                    auto* binOp = static_cast<BinaryOpNode*>(arg.get());
-                    if (isLiteral(binOp->left.get()) && isLiteral(binOp->right.get())) {
-                        float leftVal = getLiteralValue(binOp->left.get());
-                        float rightVal = getLiteralValue(binOp->right.get());
-                        
-                        auto folded = foldBinaryOp(binOp->op, leftVal, rightVal);
-                        if (folded) {
-                            arg = std::move(folded);
-                            stats.constantsFolded++;
-                            changed = true;
-                        }
-                    }
-                }
+        // Rewrite this node until it is stable. Every rewrite strictly shrinks
+        // the subtree, so this terminates without a pass limit
+        while (true) {
+            ASTNode* rewritten = node->type == ASTNodeType::BINARY_OP
+                ? rewriteBinaryOp(static_cast<BinaryOpNode*>(node))
+                : foldConstantExpression(node);
+            if (!rewritten) {
+                break;
             }
-            break;
+            node = rewritten;
+            changed = true;
+        }
+        *slot = node;
+    }
+    
+    return changed;
+}
+
+ASTNode* Optimizer::rewriteBinaryOp(BinaryOpNode* binOp) {
+    // Constant folding of the whole chain, component-wise for constant vectors
+    Constant folded;
+    bool foldable = evaluateConstant(binOp->operands[0], folded);
+    for (size_t i = 1; foldable && i < binOp->operands.size(); i++) {
+        Constant operand;
+        foldable = evaluateConstant(binOp->operands[i], operand) &&
+                   combineConstants(binOp->op(i), folded, operand, folded);
+    }
+    if (foldable) {
+        stats.constantsFolded++;
+        return makeConstant(folded);
+    }
+    
+    // Algebraic rewrites on a working copy of the chain, all in one pass
+    Chain& chain = workingChain;
+    chain.operands.assign(binOp->operands.begin(), binOp->operands.end());
+    chain.ops.assign(binOp->ops);
+    
+    bool changed = gatherConstants(chain);
+    if (!binOp->isAdditive()) {
+        changed |= foldZeroProduct(chain);
+    }
+    changed |= dropIdentities(chain);
+    if (!changed) {
+        return nullptr;
+    }
+    
+    if (chain.operands.size() == 1) {
+        return chain.operands[0];
+    }
+    auto* rebuilt = arena.create<BinaryOpNode>();
+    for (auto* operand : chain.operands) {
+        rebuilt->operands.push_back(arena, operand);
+    }
+    rebuilt->ops = arena.intern(chain.ops);
+    return rebuilt;
+}
+
+ASTNode* Optimizer::foldConstantExpression(ASTNode* node) {
+    if (node->type != ASTNodeType::FUNCTION_CALL && node->type != ASTNodeType::MEMBER_ACCESS) {
+        return nullptr;
+    }
+    
+    // A constructor of plain literals is already in its folded form
+    if (node->type == ASTNodeType::FUNCTION_CALL) {
+        bool allLiterals = true;
+        for (auto* arg : static_cast<FunctionCallNode*>(node)->arguments) {
+            allLiterals &= isLiteral(arg);
+        }
+        if (allLiterals) {
+            return nullptr;
+        }
+    }
+    
+    Constant value;
+    if (!evaluateConstant(node, value)) {
+        return nullptr;
+    }
+    
+    stats.constantsFolded++;
+    return makeConstant(value);
+}
+
+bool Optimizer::eliminateDeadCode(ShaderDeclNode* shader) {
+    NodeList& statements = shader->statements;
+    
+    // Variables that are live on exit regardless of reads
+    std::unordered_set<std::string_view> liveOut = {"gl_Position", "gl_FragColor", "gl_FragDepth"};
+    for (auto* output : shader->outputs) {
+        if (output->type == ASTNodeType::VARIABLE_DECL) {
+            liveOut.insert(static_cast<VariableDeclNode*>(output)->name);
         }
+    }
+    
+    // Use counts and definitions, built once
+    std::unordered_map<std::string_view, size_t> useCounts;
+    std::unordered_map<std::string_view, std::vector<size_t>> definitions;
+    for (size_t i = 0; i < statements.size(); i++) {
+        if (statements[i]->type != ASTNodeType::ASSIGNMENT) {
+            continue;
+        }
+        auto* assign = static_cast<AssignmentNode*>(statements[i]);
+        forEachIdentifier(assign->value, [&](std::string_view name) { useCounts[name]++; });
         
-        case ASTNodeType::MEMBER_ACCESS: {
-            auto* member = static_cast<MemberAccessNode*>(node);
-            changed |= constantFoldingPass(member->object.get());
-            break;
+        std::string_view target = assignedVariable(assign);
+        if (!target.empty()) {
+            definitions[target].push_back(i);
         }
+    }
+    
+    // Seed the worklist with every definition of a variable nobody reads
+    std::vector<size_t> worklist;
+    for (const auto& def : definitions) {
+        if (useCounts[def.first] == 0 && liveOut.count(def.first) == 0) {
+            worklist.insert(worklist.end(), def.second.begin(), def.second.end());
+        }
+    }
+    
+    // Removing a statement releases its reads; a variable whose count
+    // drops to zero makes its own definitions dead in turn
+    std::vector<bool> dead(statements.size(), false);
+    while (!worklist.empty()) {
+        size_t index = worklist.back();
+        worklist.pop_back();
         
-        default:
-            break;
+        if (dead[index]) {
+            continue;
+        }
+        dead[index] = true;
+        stats.deadCodeRemoved++;
+        
+        auto* assign = static_cast<AssignmentNode*>(statements[index]);
+        forEachIdentifier(assign->value, [&](std::string_view name) {
+            if (--useCounts[name] == 0 && liveOut.count(name) == 0) {
+                auto it = definitions.find(name);
+                if (it != definitions.end()) {
+                    worklist.insert(worklist.end(), it->second.begin(), it->second.end());
+                }
+            }
+        });
     }
     
+    // Compact the statement list in one pass
+    size_t kept = 0;
+    for (size_t i = 0; i < statements.size(); i++) {
+        if (!dead[i]) {
+            statements[kept] = statements[i];
+            kept++;
+        }
+    }
+    bool changed = kept != statements.size();
+    statements.truncate(kept);
+    
     return changed;
 }
 
-bool Optimizer::deadCodeEliminationPass(ProgramNode* ast) {
-    bool changed = false;
+bool Optimizer::eliminateCommonSubexpressions(ShaderDeclNode* shader) {
+    NodeList& statements = shader->statements;
     
-    for (auto& decl : ast->declarations) {
-        if (decl->type == ASTNodeType::SHADER_DECL) {
-            auto* shader = static_cast<ShaderDeclNode*>(decl.get());
-            
-            // Collect all declared variables (from inputs/outputs)
-            std::set<std::string> declaredVars;
-            collectDeclaredVariables(shader, declaredVars);
-            
-            // Collect all used variables
-            std::set<std::string> usedVars;
-            collectUsedVariablesInStatements(shader->statements, usedVars);
-            
-            // Also mark output variables as used (they're implicitly used)
-            for (auto& output : shader->outputs) {
-                if (output->type == ASTNodeType::VARIABLE_DECL) {
-                    auto* varDecl = static_cast<VariableDeclNode*>(output.get());
-                    usedVars.insert(varDecl->name);
-                }
+    // Types of everything in scope, tracked in statement order like codegen
+    // does, so a temporary is only introduced when its type is known
+    TypeResolver resolver;
+    resolver.declareShaderInterface(shader);
+    
+    // 1. Value numbering: structurally equal expressions over the same
+    //    variable versions get the same number. Every assignment bumps the
+    //    target's version, so reads on either side of a write never match
+    std::unordered_map<std::string, uint32_t> numbering;
+    std::unordered_map<const ASTNode*, uint32_t> valueNumbers;
+    std::unordered_map<std::string_view, uint32_t> versions;
+    std::vector<bool> typeable; // Per value number: candidate for a temporary
+    std::vector<ValueType> valueTypes;
+    // Per chain of more than two operands: value numbers of its proper
+    // prefixes, operands[0..k] for k = 1 .. size - 2
+    std::unordered_map<const BinaryOpNode*, std::vector<uint32_t>> chainPrefixes;
+    
+    auto appendNumber = [](std::string& key, uint32_t number) {
+        key.append(reinterpret_cast<const char*>(&number), sizeof(number));
+    };
+    
+    std::function<uint32_t(const ASTNode*)> number = [&](const ASTNode* node) -> uint32_t {
+        std::string key(1, static_cast<char>(node->type));
+        bool candidate = false;
+        
+        switch (node->type) {
+            case ASTNodeType::LITERAL:
+                key.append(static_cast<const LiteralNode*>(node)->value);
+                break;
+            case ASTNodeType::IDENTIFIER: {
+                std::string_view name = static_cast<const IdentifierNode*>(node)->name;
+                key.append(name);
+                key.push_back('\0');
+                appendNumber(key, versions[name]);
+                break;
             }
-            
-            // Remove statements that assign to unused variables
-            auto it = shader->statements.begin();
-            while (it != shader->statements.end()) {
-                bool shouldRemove = false;
-                
-                if ((*it)->type == ASTNodeType::ASSIGNMENT) {
-                    auto* assign = static_cast<AssignmentNode*>(it->get());
-                    
-                    // Get the target variable name
-                    std::string targetName;
-                    if (assign->target->type == ASTNodeType::IDENTIFIER) {
-                        auto* id = static_cast<IdentifierNode*>(assign->target.get());
-                        targetName = id->name;
-                    } else if (assign->target->type == ASTNodeType::MEMBER_ACCESS) {
-                        auto* member = static_cast<MemberAccessNode*>(assign->target.get());
-                        if (member->object->type == ASTNodeType::IDENTIFIER) {
-                            auto* id = static_cast<IdentifierNode*>(member->object.get());
-                            targetName = id->name;
-                        }
+            case ASTNodeType::BINARY_OP: {
+                // A chain is numbered as its left-to-right binary steps, so a
+                // repeated prefix (a * b of a * b * c) is a value of its own
+                auto* binOp = static_cast<const BinaryOpNode*>(node);
+                std::vector<uint32_t> prefixes;
+                uint32_t vn = number(binOp->operands[0]);
+                for (size_t i = 1; i < binOp->operands.size(); i++) {
+                    uint32_t left = vn;
+                    uint32_t right = number(binOp->operands[i]);
+                    ValueType type = TypeResolver::binaryResultType(binOp->op(i), valueTypes[left], valueTypes[right]);
+                    // + commutes for every operand shape; * does not (matrices)
+                    if (binOp->ops[i] == '+' && right < left) {
+                        std::swap(left, right);
                     }
+                    std::string step = key;
+                    step.append(binOp->op(i));
+                    step.push_back('\0');
+                    appendNumber(step, left);
+                    appendNumber(step, right);
                     
-                    // Check if target is used and not an output variable
-                    if (!targetName.empty() && 
-                        usedVars.find(targetName) == usedVars.end() &&
-                        !isOutputVariable(targetName, shader)) {
-                        shouldRemove = true;
-                        stats.deadCodeRemoved++;
-                        changed = true;
+                    auto inserted = numbering.emplace(std::move(step), static_cast<uint32_t>(typeable.size()));
+                    if (inserted.second) {
+                        typeable.push_back(type.isValid());
+                        valueTypes.push_back(type);
+                    }
+                    vn = inserted.first->second;
+                    if (i + 1 < binOp->operands.size()) {
+                        prefixes.push_back(vn);
                     }
                 }
-                
-                if (shouldRemove) {
-                    it = shader->statements.erase(it);
-                } else {
-                    ++it;
+                if (!prefixes.empty()) {
+                    chainPrefixes[binOp] = std::move(prefixes);
+                }
+                valueNumbers[node] = vn;
+                return vn;
+            }
+            case ASTNodeType::MEMBER_ACCESS: {
+                auto* member = static_cast<const MemberAccessNode*>(node);
+                key.append(member->member);
+                key.push_back('\0');
+                appendNumber(key, number(member->object));
+                candidate = true;
+                break;
+            }
+            case ASTNodeType::FUNCTION_CALL: {
+                auto* funcCall = static_cast<const FunctionCallNode*>(node);
+                key.append(funcCall->functionName);
+                key.push_back('\0');
+                for (const auto* arg : funcCall->arguments) {
+                    appendNumber(key, number(arg));
                 }
+                candidate = true;
+                break;
             }
+            default:
+                break;
+        }
+        
+        auto inserted = numbering.emplace(std::move(key), static_cast<uint32_t>(typeable.size()));
+        uint32_t vn = inserted.first->second;
+        if (inserted.second) {
+            valueTypes.push_back(resolver.resolve(node));
+            typeable.push_back(candidate && valueTypes.back().isValid());
+        }
+        valueNumbers[node] = vn;
+        return vn;
+    };
+    
+    for (auto* stmt : statements) {
+        if (stmt->type != ASTNodeType::ASSIGNMENT) {
+            continue;
+        }
+        auto* assign = static_cast<AssignmentNode*>(stmt);
+        number(assign->value);
+        
+        std::string_view target = assignedVariable(assign);
+        if (!target.empty()) {
+            if (!resolver.isDeclared(target)) {
+                resolver.declare(target, resolver.resolve(assign->value));
+            }
+            versions[target]++;
         }
     }
     
-    return changed;
-}
-
-bool Optimizer::algebraicSimplificationPass(ASTNode* node) {
-    if (!node) return false;
+    // 2. Count occurrences top-down. A repeat of an expression is replaced
+    //    as a whole, so its operands are only counted in the first copy
+    std::vector<uint32_t> occurrences(typeable.size(), 0);
+    std::vector<size_t> firstStatement(typeable.size(), 0);
+    size_t currentStatement = 0;
     
-    bool changed = false;
+    std::function<void(const ASTNode*)> count = [&](const ASTNode* node) {
+        uint32_t vn = valueNumbers[node];
+        if (occurrences[vn]++ > 0) {
+            return;
+        }
+        firstStatement[vn] = currentStatement;
+        
+        switch (node->type) {
+            case ASTNodeType::BINARY_OP: {
+                // Each prefix is the left operand of the next; stop at one
+                // that was already counted
+                auto* binOp = static_cast<const BinaryOpNode*>(node);
+                size_t lowest = binOp->operands.size() - 1;
+                const std::vector<uint32_t>* prefixes = lowest > 1 ? &chainPrefixes[binOp] : nullptr;
+                while (lowest > 1) {
+                    uint32_t prefix = (*prefixes)[lowest - 2];
+                    if (occurrences[prefix]++ > 0) {
+                        break;
+                    }
+                    firstStatement[prefix] = currentStatement;
+                    lowest--;
+                }
+                if (lowest == 1) {
+                    count(binOp->operands[0]);
+                }
+                for (size_t i = lowest; i < binOp->operands.size(); i++) {
+                    count(binOp->operands[i]);
+                }
+                break;
+            }
+            case ASTNodeType::MEMBER_ACCESS:
+                count(static_cast<const MemberAccessNode*>(node)->object);
+                break;
+            case ASTNodeType::FUNCTION_CALL:
+                for (const auto* arg : static_cast<const FunctionCallNode*>(node)->arguments) {
+                    count(arg);
+                }
+                break;
+            default:
+                break;
+        }
+    };
     
-    switch (node->type) {
-        case ASTNodeType::ASSIGNMENT: {
-            auto* assign = static_cast<AssignmentNode*>(node);
+    bool anyRepeated = false;
+    for (size_t i = 0; i < statements.size(); i++) {
+        if (statements[i]->type == ASTNodeType::ASSIGNMENT) {
+            currentStatement = i;
+            count(static_cast<AssignmentNode*>(statements[i])->value);
+        }
+    }
+    for (uint32_t vn = 0; vn < typeable.size(); vn++) {
+        anyRepeated |= typeable[vn] && occurrences[vn] > 1;
+    }
+    if (!anyRepeated) {
+        return false;
+    }
+    
+    // 3. Rewrite: the first copy of a repeated expression becomes the value
+    //    of a temporary defined just before its statement (operands first),
+    //    and every copy is replaced by a read of the temporary
+    std::unordered_map<uint32_t, IdentifierNode*> temporaries;
+    std::vector<std::vector<ASTNode*>> definitionsBefore(statements.size());
+    int nextTemporary = 0;
+    
+    auto makeTemporaryName = [&]() {
+        std::string name;
+        do {
+            name = "_cse" + std::to_string(nextTemporary++);
+        } while (resolver.isDeclared(name));
+        return arena.intern(name);
+    };
+    
+    auto repeatedValue = [&](uint32_t vn) { return typeable[vn] && occurrences[vn] > 1; };
+    
+    auto defineTemporary = [&](uint32_t vn, ASTNode* value, size_t statement) {
+        auto* temporary = arena.create<IdentifierNode>();
+        temporary->name = makeTemporaryName();
+        temporaries[vn] = temporary;
+        
+        auto* definition = arena.create<AssignmentNode>();
+        definition->target = temporary;
+        definition->value = value;
+        definitionsBefore[statement].push_back(definition);
+        
+        auto* read = arena.create<IdentifierNode>();
+        read->name = temporary->name;
+        return read;
+    };
+    
+    std::function<void(ASTNode*&)> rewrite;
+    
+    // Rewrite the operands of a chain, replacing repeated prefixes as well:
+    // the longest prefix that already has a temporary is read from it, and
+    // each longer repeated prefix gets a temporary of its own
+    auto rewriteChain = [&](BinaryOpNode* binOp) {
+        size_t size = binOp->operands.size();
+        if (size == 2) {
+            rewrite(binOp->operands[0]);
+            rewrite(binOp->operands[1]);
+            return;
+        }
+        
+        const std::vector<uint32_t>& prefixes = chainPrefixes[binOp];
+        std::vector<ASTNode*> operands;
+        std::string ops(1, binOp->ops[0]);
+        bool changed = false;
+        
+        size_t lowest = size - 1;
+        while (lowest > 1) {
+            uint32_t prefix = prefixes[lowest - 2];
+            if (repeatedValue(prefix) && temporaries.count(prefix)) {
+                break;
+            }
+            lowest--;
+        }
+        if (lowest > 1) {
+            auto* read = arena.create<IdentifierNode>();
+            read->name = temporaries[prefixes[lowest - 2]]->name;
+            operands.push_back(read);
+            stats.commonSubexpressionsEliminated++;
+            changed = true;
+        } else {
+            rewrite(binOp->operands[0]);
+            operands.push_back(binOp->operands[0]);
+        }
+        
+        for (size_t i = lowest; i < size; i++) {
+            rewrite(binOp->operands[i]);
+            operands.push_back(binOp->operands[i]);
+            ops.push_back(binOp->ops[i]);
             
-            // Try to simplify the value expression
-            if (assign->value->type == ASTNodeType::BINARY_OP) {
-                auto* binOp = static_cast<BinaryOpNode*>(assign->value.get());
-                
-                // First, recursively simplify children
-                changed |= algebraicSimplificationPass(binOp->left.get());
-                changed |= algebraicSimplificationPass(binOp->right.get());
-                
-                // Try to simplify this binary operation
-                auto simplified = simplifyBinaryOp(binOp, changed);
-                if (simplified) {
-                    assign->value = std::move(simplified);
+            if (i + 1 < size && repeatedValue(prefixes[i - 1])) {
+                auto* prefix = arena.create<BinaryOpNode>();
+                for (auto* operand : operands) {
+                    prefix->operands.push_back(arena, operand);
                 }
-            } else {
-                // Recursively simplify other expression types
-                changed |= algebraicSimplificationPass(assign->value.get());
+                prefix->ops = arena.intern(ops);
+                operands = {defineTemporary(prefixes[i - 1], prefix, firstStatement[prefixes[i - 1]])};
+                ops.resize(1);
+                changed = true;
             }
-            break;
         }
         
-        case ASTNodeType::BINARY_OP: {
-            auto* binOp = static_cast<BinaryOpNode*>(node);
-            
-            // Recursively simplify children
-            changed |= algebraicSimplificationPass(binOp->left.get());
-            changed |= algebraicSimplificationPass(binOp->right.get());
-            break;
+        if (changed) {
+            binOp->operands = NodeList();
+            for (auto* operand : operands) {
+                binOp->operands.push_back(arena, operand);
+            }
+            binOp->ops = arena.intern(ops);
         }
+    };
+    
+    rewrite = [&](ASTNode*& node) {
+        uint32_t vn = valueNumbers[node];
+        bool repeated = repeatedValue(vn);
         
-        case ASTNodeType::FUNCTION_CALL: {
-            auto* funcCall = static_cast<FunctionCallNode*>(node);
-            for (auto& arg : funcCall->arguments) {
-                // Try to simplify each argument
-                if (arg->type == ASTNodeType::BINARY_OP) {
-                    auto* binOp = static_cast<BinaryOpNode*>(arg.get());
-                    changed |= algebraicSimplificationPass(binOp->left.get());
-                    changed |= algebraicSimplificationPass(binOp->right.get());
-                    
-                    auto simplified = simplifyBinaryOp(binOp, changed);
-                    if (simplified) {
-                        arg = std::move(simplified);
-                    }
-                } else {
-                    changed |= algebraicSimplificationPass(arg.get());
-                }
+        if (repeated) {
+            auto it = temporaries.find(vn);
+            if (it != temporaries.end()) {
+                auto* read = arena.create<IdentifierNode>();
+                read->name = it->second->name;
+                node = read;
+                stats.commonSubexpressionsEliminated++;
+                return;
             }
-            break;
         }
         
-        case ASTNodeType::MEMBER_ACCESS: {
-            auto* member = static_cast<MemberAccessNode*>(node);
-            changed |= algebraicSimplificationPass(member->object.get());
-            break;
+        switch (node->type) {
+            case ASTNodeType::BINARY_OP:
+                rewriteChain(static_cast<BinaryOpNode*>(node));
+                break;
+            case ASTNodeType::MEMBER_ACCESS:
+                rewrite(static_cast<MemberAccessNode*>(node)->object);
+                break;
+            case ASTNodeType::FUNCTION_CALL:
+                for (auto& arg : static_cast<FunctionCallNode*>(node)->arguments) {
+                    rewrite(arg);
+                }
+                break;
+            default:
+                break;
         }
         
-        default:
-            break;
+        if (repeated) {
+            node = defineTemporary(vn, node, firstStatement[vn]);
+        }
+    };
+    
+    for (auto& stmt : statements) {
+        if (stmt->type == ASTNodeType::ASSIGNMENT) {
+            rewrite(static_cast<AssignmentNode*>(stmt)->value);
+        }
     }
     
-    return changed;
+    // Splice the definitions in, walking backwards so indices stay valid
+    for (size_t i = statements.size(); i-- > 0;) {
+        const auto& definitions = definitionsBefore[i];
+        for (size_t d = definitions.size(); d-- > 0;) {
+            statements.insert(arena, i, definitions[d]);
+        }
+    }
+    
+    return true;
 }
 
 // Helper methods
@@ -286,343 +689,410 @@ bool Optimizer::isLiteral(ASTNode* node) {
     return node && node->type == ASTNodeType::LITERAL;
 }
 
-bool Optimizer::isLiteralValue(ASTNode* node, float value) {
-    if (!isLiteral(node)) {
-        return false;
+bool Optimizer::evaluateConstant(const ASTNode* node, Constant& result) const {
+    switch (node->type) {
+        case ASTNodeType::LITERAL: {
+            auto* lit = static_cast<const LiteralNode*>(node);
+            result = Constant();
+            result.components = 1;
+            result.isInteger = TypeResolver::literalType(lit->value).base == ValueType::Base::INT;
+            result.values[0] = std::stof(std::string(lit->value));
+            return true;
+        }
+        
+        case ASTNodeType::FUNCTION_CALL: {
+            // vecN(...) whose arguments are all constant: components are
+            // concatenated, a single scalar is broadcast and a single wider
+            // vector is truncated
+            auto* funcCall = static_cast<const FunctionCallNode*>(node);
+            ValueType type = ValueType::fromName(funcCall->functionName);
+            if (!type.isVector() || funcCall->arguments.empty()) {
+                return false;
+            }
+            
+            result = Constant();
+            result.components = type.components;
+            int provided = 0;
+            for (const auto* arg : funcCall->arguments) {
+                Constant part;
+                if (!evaluateConstant(arg, part)) {
+                    return false;
+                }
+                if (funcCall->arguments.size() == 1 && part.components > type.components) {
+                    part.components = type.components;
+                }
+                if (provided + part.components > type.components) {
+                    return false;
+                }
+                for (int i = 0; i < part.components; ++i) {
+                    result.values[provided++] = part.values[i];
+                }
+            }
+            
+            if (provided == 1 && funcCall->arguments.size() == 1) {
+                std::fill(result.values + 1, result.values + type.components, result.values[0]);
+                return true;
+            }
+            return provided == type.components;
+        }
+        
+        case ASTNodeType::MEMBER_ACCESS: {
+            auto* member = static_cast<const MemberAccessNode*>(node);
+            Constant object;
+            if (!evaluateConstant(member->object, object) || object.components < 2 ||
+                member->member.empty() || member->member.size() > 4) {
+                return false;
+            }
+            
+            result = Constant();
+            result.components = static_cast<int>(member->member.size());
+            for (size_t i = 0; i < member->member.size(); ++i) {
+                int index = TypeResolver::swizzleIndex(member->member[i]);
+                if (index < 0 || index >= object.components) {
+                    return false;
+                }
+                result.values[i] = object.values[index];
+            }
+            return true;
+        }
+        
+        default:
+            return false;
     }
-    
-    auto* lit = static_cast<LiteralNode*>(node);
-    float nodeValue = std::stof(lit->value);
-    return std::abs(nodeValue - value) < 0.0001f;
 }
 
-float Optimizer::getLiteralValue(ASTNode* node) {
-    if (!isLiteral(node)) {
-        throw std::runtime_error("Node is not a literal!");
+int Optimizer::constantSplatSize(ASTNode* node, float value) const {
+    Constant constant;
+    if (!evaluateConstant(node, constant)) {
+        return 0;
     }
     
-    auto* lit = static_cast<LiteralNode*>(node);
-    return std::stof(lit->value);
+    for (int i = 0; i < constant.components; ++i) {
+        if (std::abs(constant.values[i] - value) >= 0.0001f) {
+            return 0;
+        }
+    }
+    return constant.components;
 }
 
-std::unique_ptr<ASTNode> Optimizer::foldBinaryOp(const std::string& op, float left, float right) {
-    float result;
-    
-    if (op == "+") {
-        result = left + right;
-    } else if (op == "-") {
-        result = left - right;
-    } else if (op == "*") {
-        result = left * right;
-    } else if (op == "/") {
-        if (std::abs(right) < 0.0001f) {
-            return nullptr; // Don't fold division by zero
-        }
-        result = left / right;
-    } else {
-        return nullptr; // Unknown operator
+ValueType Optimizer::chainType(const Chain& chain, size_t count) const {
+    ValueType type = types.resolve(chain.operands[0]);
+    for (size_t i = 1; i < count && type.isValid(); i++) {
+        type = TypeResolver::binaryResultType(std::string_view(&chain.ops[i], 1), type,
+                                              types.resolve(chain.operands[i]));
     }
-    
-    auto literal = std::make_unique<LiteralNode>();
-    std::ostringstream oss;
-    oss << result;
-    literal->value = oss.str();
-    
-    return literal;
+    return type;
 }
 
-void Optimizer::collectDeclaredVariables(ShaderDeclNode* shader, std::set<std::string>& declared) {
-    for (auto& input : shader->inputs) {
-        if (input->type == ASTNodeType::VARIABLE_DECL) {
-            auto* varDecl = static_cast<VariableDeclNode*>(input.get());
-            declared.insert(varDecl->name);
-        }
+bool Optimizer::combineConstants(std::string_view op, const Constant& left, const Constant& right,
+                                 Constant& result) {
+    // Shapes must match, or one side is a scalar broadcast over the other
+    if (left.components != right.components && left.components != 1 && right.components != 1) {
+        return false;
     }
     
-    for (auto& output : shader->outputs) {
-        if (output->type == ASTNodeType::VARIABLE_DECL) {
-            auto* varDecl = static_cast<VariableDeclNode*>(output.get());
-            declared.insert(varDecl->name);
-        }
-    }
-}
-
-void Optimizer::collectUsedVariables(ASTNode* node, std::set<std::string>& used) {
-    if (!node) return;
+    Constant combined;
+    combined.components = std::max(left.components, right.components);
+    combined.isInteger = left.isInteger && right.isInteger;
     
-    switch (node->type) {
-        case ASTNodeType::IDENTIFIER: {
-            auto* id = static_cast<IdentifierNode*>(node);
-            used.insert(id->name);
-            break;
-        }
-        
-        case ASTNodeType::BINARY_OP: {
-            auto* binOp = static_cast<BinaryOpNode*>(node);
-            collectUsedVariables(binOp->left.get(), used);
-            collectUsedVariables(binOp->right.get(), used);
-            break;
-        }
-        
-        case ASTNodeType::MEMBER_ACCESS: {
-            auto* member = static_cast<MemberAccessNode*>(node);
-            collectUsedVariables(member->object.get(), used);
-            break;
-        }
+    for (int i = 0; i < combined.components; ++i) {
+        float a = left.values[left.components == 1 ? 0 : i];
+        float b = right.values[right.components == 1 ? 0 : i];
+        float value;
         
-        case ASTNodeType::FUNCTION_CALL: {
-            auto* funcCall = static_cast<FunctionCallNode*>(node);
-            for (auto& arg : funcCall->arguments) {
-                collectUsedVariables(arg.get(), used);
+        if (op == "+") {
+            value = a + b;
+        } else if (op == "-") {
+            value = a - b;
+        } else if (op == "*") {
+            value = a * b;
+        } else if (op == "/") {
+            if (std::abs(b) < 0.0001f) {
+                return false; // Don't fold division by zero
             }
-            break;
+            value = combined.isInteger ? std::trunc(a / b) : a / b;
+        } else {
+            return false; // Unknown operator
         }
         
-        case ASTNodeType::ASSIGNMENT: {
-            auto* assign = static_cast<AssignmentNode*>(node);
-            // Only collect from the right-hand side (value)
-            collectUsedVariables(assign->value.get(), used);
-            break;
+        if (!std::isfinite(value)) {
+            return false;
         }
-        
-        default:
-            break;
+        combined.values[i] = value;
     }
+    
+    result = combined;
+    return true;
 }
 
-void Optimizer::collectUsedVariablesInStatements(const std::vector<std::unique_ptr<ASTNode>>& statements, 
-                                                 std::set<std::string>& used) {
-    for (auto& stmt : statements) {
-        collectUsedVariables(stmt.get(), used);
+ASTNode* Optimizer::makeConstant(const Constant& value) {
+    if (value.components == 1) {
+        return makeLiteral(value.values[0], value.isInteger);
     }
+    
+    static constexpr std::string_view vectorNames[] = {"", "", "vec2", "vec3", "vec4"};
+    auto* constructor = arena.create<FunctionCallNode>();
+    constructor->functionName = vectorNames[value.components];
+    
+    // A splat is written as vecN(x)
+    bool uniform = std::all_of(value.values, value.values + value.components,
+                               [&](float v) { return v == value.values[0]; });
+    int count = uniform ? 1 : value.components;
+    for (int i = 0; i < count; ++i) {
+        constructor->arguments.push_back(arena, makeLiteral(value.values[i], false));
+    }
+    return constructor;
 }
 
-bool Optimizer::isOutputVariable(const std::string& varName, ShaderDeclNode* shader) {
-    for (auto& output : shader->outputs) {
-        if (output->type == ASTNodeType::VARIABLE_DECL) {
-            auto* varDecl = static_cast<VariableDeclNode*>(output.get());
-            if (varDecl->name == varName) {
-                return true;
+ASTNode* Optimizer::makeZero(ValueType type) {
+    Constant zero;
+    zero.components = type.components;
+    zero.isInteger = type.base == ValueType::Base::INT;
+    return makeConstant(zero);
+}
+
+LiteralNode* Optimizer::makeLiteral(float value, bool isInteger) {
+    auto* literal = arena.create<LiteralNode>();
+    std::ostringstream oss;
+    
+    if (isInteger) {
+        oss << static_cast<long long>(value);
+    } else {
+        // Shortest text that reads back as the same float, always with a
+        // decimal point or exponent so it stays a float literal (6.0, not 6)
+        for (int precision = 6; precision <= 9; ++precision) {
+            oss.str("");
+            oss << std::setprecision(precision) << value;
+            if (std::stof(oss.str()) == value) {
+                break;
             }
         }
+        if (oss.str().find_first_of(".eE") == std::string::npos) {
+            oss << ".0";
+        }
     }
     
-    // Built-in output variables
-    return varName == "gl_Position" || varName == "gl_FragColor" || 
-           varName == "gl_FragDepth";
+    literal->value = arena.intern(oss.str());
+    return literal;
 }
 
-std::unique_ptr<ASTNode> Optimizer::simplifyBinaryOp(BinaryOpNode* node, bool& changed) {
-    // Apply algebraic identities
-
-    // Combine adjacent literals in associative chains like ((x * c1) * c2) -> (x * (c1*c2))
-    // and ((x + c1) + c2) -> (x + (c1+c2)). This helps constant folding fire later.
-    // Handle multiplication
-    if (node->op == "*") {
-        // Shape: ( (X * c1) * c2 )
-        if (node->right && isLiteral(node->right.get())
-            && node->left && node->left->type == ASTNodeType::BINARY_OP) {
-            auto* leftBin = static_cast<BinaryOpNode*>(node->left.get());
-            if (leftBin->op == "*" && leftBin->right && isLiteral(leftBin->right.get())) {
-                float c1 = getLiteralValue(leftBin->right.get());
-                float c2 = getLiteralValue(node->right.get());
-                auto newNode = std::make_unique<BinaryOpNode>();
-                newNode->op = "*";
-                newNode->left = cloneNode(leftBin->left.get());
-                auto combined = std::make_unique<LiteralNode>();
-                {
-                    std::ostringstream oss;
-                    oss << (c1 * c2);
-                    combined->value = oss.str();
-                }
-                newNode->right = std::move(combined);
-                stats.algebraicSimplifications++; stats.constantsFolded++; changed = true; return newNode;
-            }
+bool Optimizer::gatherConstants(Chain& chain) {
+    // Merge the constants of a chain into one, keeping the order of the
+    // other operands: c1 + x - (y + c2) -> x - y + (c1 - c2). Constants of
+    // a nested chain of the same level are merged as well. Any constant
+    // moves in a sum; in a product only scalars do, and only when every
+    // operator is *, since scalars commute with vectors and matrices but
+    // integer division does not reassociate
+    bool additive = chain.ops[0] == '+';
+    if (!additive && chain.ops.find('/') != std::string::npos) {
+        return false;
+    }
+    
+    auto movable = [&](const ASTNode* operand, Constant& value) {
+        return evaluateConstant(operand, value) && (additive || value.components == 1);
+    };
+    auto nestedChain = [&](ASTNode* operand) -> BinaryOpNode* {
+        if (operand->type != ASTNodeType::BINARY_OP) {
+            return nullptr;
         }
-        // Symmetric shape: ( c1 * (X * c2) )
-        if (node->left && isLiteral(node->left.get())
-            && node->right && node->right->type == ASTNodeType::BINARY_OP) {
-            auto* rightBin = static_cast<BinaryOpNode*>(node->right.get());
-            if (rightBin->op == "*" && rightBin->right && isLiteral(rightBin->right.get())) {
-                float c1 = getLiteralValue(node->left.get());
-                float c2 = getLiteralValue(rightBin->right.get());
-                auto newNode = std::make_unique<BinaryOpNode>();
-                newNode->op = "*";
-                newNode->left = cloneNode(rightBin->left.get());
-                auto combined = std::make_unique<LiteralNode>();
-                {
-                    std::ostringstream oss;
-                    oss << (c1 * c2);
-                    combined->value = oss.str();
-                }
-                newNode->right = std::move(combined);
-                stats.algebraicSimplifications++; stats.constantsFolded++; changed = true; return newNode;
-            }
+        auto* nested = static_cast<BinaryOpNode*>(operand);
+        if (nested->isAdditive() != additive || (!additive && nested->ops.find('/') != std::string_view::npos)) {
+            return nullptr;
         }
-    }
-    // Handle addition
-    if (node->op == "+") {
-        // Shape: ( (X + c1) + c2 )
-        if (node->right && isLiteral(node->right.get())
-            && node->left && node->left->type == ASTNodeType::BINARY_OP) {
-            auto* leftBin = static_cast<BinaryOpNode*>(node->left.get());
-            if (leftBin->op == "+" && leftBin->right && isLiteral(leftBin->right.get())) {
-                float c1 = getLiteralValue(leftBin->right.get());
-                float c2 = getLiteralValue(node->right.get());
-                auto newNode = std::make_unique<BinaryOpNode>();
-                newNode->op = "+";
-                newNode->left = cloneNode(leftBin->left.get());
-                auto combined = std::make_unique<LiteralNode>();
-                {
-                    std::ostringstream oss;
-                    oss << (c1 + c2);
-                    combined->value = oss.str();
-                }
-                newNode->right = std::move(combined);
-                stats.algebraicSimplifications++; stats.constantsFolded++; changed = true; return newNode;
-            }
+        return nested;
+    };
+    
+    // Combine every constant with the sign it has in the whole chain
+    Constant gathered;
+    size_t constants = 0;
+    auto gather = [&](const Constant& value, bool negated) {
+        if (constants++ > 0) {
+            return combineConstants(!additive ? "*" : negated ? "-" : "+", gathered, value, gathered);
         }
-        // Symmetric shape: ( c1 + (X + c2) )
-        if (node->left && isLiteral(node->left.get())
-            && node->right && node->right->type == ASTNodeType::BINARY_OP) {
-            auto* rightBin = static_cast<BinaryOpNode*>(node->right.get());
-            if (rightBin->op == "+" && rightBin->right && isLiteral(rightBin->right.get())) {
-                float c1 = getLiteralValue(node->left.get());
-                float c2 = getLiteralValue(rightBin->right.get());
-                auto newNode = std::make_unique<BinaryOpNode>();
-                newNode->op = "+";
-                newNode->left = cloneNode(rightBin->left.get());
-                auto combined = std::make_unique<LiteralNode>();
-                {
-                    std::ostringstream oss;
-                    oss << (c1 + c2);
-                    combined->value = oss.str();
+        Constant zero;
+        zero.components = 1;
+        zero.isInteger = true;
+        gathered = value;
+        return !negated || combineConstants("-", zero, value, gathered);
+    };
+    
+    for (size_t i = 0; i < chain.operands.size(); i++) {
+        bool negated = chain.ops[i] == '-';
+        Constant value;
+        if (movable(chain.operands[i], value)) {
+            if (!gather(value, negated)) {
+                return false;
+            }
+        } else if (BinaryOpNode* nested = nestedChain(chain.operands[i])) {
+            for (size_t j = 0; j < nested->operands.size(); j++) {
+                if (movable(nested->operands[j], value) && !gather(value, negated != (nested->ops[j] == '-'))) {
+                    return false;
                 }
-                newNode->right = std::move(combined);
-                stats.algebraicSimplifications++; stats.constantsFolded++; changed = true; return newNode;
             }
         }
     }
-
-
     
-    // Multiplication simplifications
-    if (node->op == "*") {
-        // x * 1 -> x
-        if (isLiteralValue(node->right.get(), 1.0f)) {
-            stats.algebraicSimplifications++;
-            changed = true;
-            return cloneNode(node->left.get());
-        }
-        // 1 * x -> x
-        if (isLiteralValue(node->left.get(), 1.0f)) {
-            stats.algebraicSimplifications++;
-            changed = true;
-            return cloneNode(node->right.get());
-        }
-        // x * 0 -> 0
-        if (isLiteralValue(node->right.get(), 0.0f)) {
-            stats.algebraicSimplifications++;
-            changed = true;
-            auto zero = std::make_unique<LiteralNode>();
-            zero->value = "0.0";
-            return zero;
+    // Only worth it when at least two constants merge into one
+    if (constants < 2) {
+        return false;
+    }
+    
+    size_t kept = 0;
+    for (size_t i = 0; i < chain.operands.size(); i++) {
+        ASTNode* operand = chain.operands[i];
+        char op = chain.ops[i];
+        Constant value;
+        if (movable(operand, value)) {
+            continue;
         }
-        // 0 * x -> 0
-        if (isLiteralValue(node->left.get(), 0.0f)) {
-            stats.algebraicSimplifications++;
-            changed = true;
-            auto zero = std::make_unique<LiteralNode>();
-            zero->value = "0.0";
-            return zero;
+        if (BinaryOpNode* nested = nestedChain(operand)) {
+            operand = removeConstants(nested, op);
         }
+        chain.operands[kept] = operand;
+        chain.ops[kept] = op;
+        kept++;
     }
+    chain.operands.resize(kept);
+    chain.ops.resize(kept);
     
-    // Addition simplifications
-    if (node->op == "+") {
-        // x + 0 -> x
-        if (isLiteralValue(node->right.get(), 0.0f)) {
-            stats.algebraicSimplifications++;
-            changed = true;
-            return cloneNode(node->left.get());
-        }
-        // 0 + x -> x
-        if (isLiteralValue(node->left.get(), 0.0f)) {
-            stats.algebraicSimplifications++;
-            changed = true;
-            return cloneNode(node->right.get());
+    // The constant goes last, or first, with its sign, when the remaining
+    // chain starts with a subtraction; a negative scalar at the end is
+    // subtracted rather than added
+    char level = additive ? '+' : '*';
+    if (chain.operands.empty() || (additive && chain.ops[0] == '-')) {
+        chain.operands.insert(chain.operands.begin(), makeConstant(gathered));
+        chain.ops.insert(chain.ops.begin(), level);
+    } else {
+        char op = level;
+        if (additive && gathered.components == 1 && gathered.values[0] < 0.0f) {
+            gathered.values[0] = -gathered.values[0];
+            op = '-';
         }
+        chain.operands.push_back(makeConstant(gathered));
+        chain.ops.push_back(op);
     }
+    chain.ops[0] = level;
     
-    // Subtraction simplifications
-    if (node->op == "-") {
-        // x - 0 -> x
-        if (isLiteralValue(node->right.get(), 0.0f)) {
-            stats.algebraicSimplifications++;
-            changed = true;
-            return cloneNode(node->left.get());
+    stats.algebraicSimplifications++;
+    stats.constantsFolded++;
+    return true;
+}
+
+ASTNode* Optimizer::removeConstants(BinaryOpNode* nested, char& op) {
+    // What is left of a nested chain once gatherConstants() took its
+    // constants; a sum left starting with a subtraction is negated, along
+    // with op in front of it: a - (1.0 - x + y) -> a + (x - y) - 1.0
+    bool additive = nested->isAdditive();
+    std::vector<ASTNode*> operands;
+    std::string ops;
+    for (size_t i = 0; i < nested->operands.size(); i++) {
+        Constant value;
+        if (!evaluateConstant(nested->operands[i], value) || (!additive && value.components != 1)) {
+            operands.push_back(nested->operands[i]);
+            ops.push_back(nested->ops[i]);
         }
     }
+    if (operands.size() == nested->operands.size()) {
+        return nested;
+    }
     
-    // Division simplifications
-    if (node->op == "/") {
-        // x / 1 -> x
-        if (isLiteralValue(node->right.get(), 1.0f)) {
-            stats.algebraicSimplifications++;
-            changed = true;
-            return cloneNode(node->left.get());
+    if (additive && ops[0] == '-') {
+        for (char& c : ops) {
+            c = c == '-' ? '+' : '-';
         }
+        op = op == '-' ? '+' : '-';
+    }
+    if (operands.size() == 1) {
+        return operands[0];
     }
     
-    return nullptr; // No simplification
+    auto* rest = arena.create<BinaryOpNode>();
+    for (auto* operand : operands) {
+        rest->operands.push_back(arena, operand);
+    }
+    ops[0] = additive ? '+' : '*';
+    rest->ops = arena.intern(ops);
+    return rest;
 }
 
-std::unique_ptr<ASTNode> Optimizer::cloneNode(ASTNode* node) {
-    if (!node) return nullptr;
+bool Optimizer::foldZeroProduct(Chain& chain) {
+    // x * 0 -> 0 and 0 * x -> 0, as a zero of the product's type, for the
+    // leading run of * (a division after it still has to see its operands)
+    size_t run = 1;
+    while (run < chain.operands.size() && chain.ops[run] == '*') {
+        run++;
+    }
+    if (run < 2) {
+        return false;
+    }
     
-    switch (node->type) {
-        case ASTNodeType::LITERAL: {
-            auto* lit = static_cast<LiteralNode*>(node);
-            auto clone = std::make_unique<LiteralNode>();
-            clone->value = lit->value;
-            return clone;
-        }
-        
-        case ASTNodeType::IDENTIFIER: {
-            auto* id = static_cast<IdentifierNode*>(node);
-            auto clone = std::make_unique<IdentifierNode>();
-            clone->name = id->name;
-            return clone;
-        }
-        
-        case ASTNodeType::BINARY_OP: {
-            auto* binOp = static_cast<BinaryOpNode*>(node);
-            auto clone = std::make_unique<BinaryOpNode>();
-            clone->op = binOp->op;
-            clone->left = cloneNode(binOp->left.get());
-            clone->right = cloneNode(binOp->right.get());
-            return clone;
-        }
+    bool zero = false;
+    for (size_t i = 0; i < run && !zero; i++) {
+        zero = constantSplatSize(chain.operands[i], 0.0f) > 0;
+    }
+    if (!zero) {
+        return false;
+    }
+    
+    ValueType type = chainType(chain, run);
+    if (!type.isValid() || type.isMatrix()) {
+        return false;
+    }
+    
+    chain.operands.erase(chain.operands.begin() + 1, chain.operands.begin() + run);
+    chain.ops.erase(1, run - 1);
+    chain.operands[0] = makeZero(type);
+    stats.algebraicSimplifications++;
+    return true;
+}
+
+bool Optimizer::dropIdentities(Chain& chain) {
+    // x + 0, 0 + x, x - 0, x * 1, 1 * x and x / 1 -> x. Dropping the operand
+    // must not change the type of what is kept before it, so the rest of the
+    // chain sees the same types: a scalar is broadcast over anything, a
+    // vector only disappears against the same vector type (vec3 * vec3(1.0),
+    // but not float * vec3(1.0) or mat4 * vec4(1.0))
+    char level = chain.ops[0];
+    float identity = level == '+' ? 0.0f : 1.0f;
+    if (std::none_of(chain.operands.begin(), chain.operands.end(),
+                     [&](ASTNode* operand) { return constantSplatSize(operand, identity) > 0; })) {
+        return false;
+    }
+    
+    size_t kept = 0;
+    ValueType keptType;
+    ValueType type = types.resolve(chain.operands[0]);
+    for (size_t i = 0; i < chain.operands.size(); i++) {
+        ValueType next = i + 1 < chain.operands.size() ? types.resolve(chain.operands[i + 1]) : ValueType();
+        int size = constantSplatSize(chain.operands[i], identity);
+        bool removable = false;
         
-        case ASTNodeType::MEMBER_ACCESS: {
-            auto* member = static_cast<MemberAccessNode*>(node);
-            auto clone = std::make_unique<MemberAccessNode>();
-            clone->object = cloneNode(member->object.get());
-            clone->member = member->member;
-            return clone;
+        if (size > 0 && kept > 0) {
+            ValueType combined = TypeResolver::binaryResultType(std::string_view(&chain.ops[i], 1), keptType, type);
+            removable = keptType.isValid() && type.isValid() ? combined == keptType : size == 1;
+        } else if (size > 0 && i + 1 < chain.operands.size() && chain.ops[i + 1] == level) {
+            // The first operand can only go if the next one does not subtract or divide
+            ValueType combined = TypeResolver::binaryResultType(std::string_view(&level, 1), type, next);
+            removable = type.isValid() && next.isValid() ? combined == next : size == 1;
         }
         
-        case ASTNodeType::FUNCTION_CALL: {
-            auto* funcCall = static_cast<FunctionCallNode*>(node);
-            auto clone = std::make_unique<FunctionCallNode>();
-            clone->functionName = funcCall->functionName;
-            for (auto& arg : funcCall->arguments) {
-                clone->arguments.push_back(cloneNode(arg.get()));
-            }
-            return clone;
+        if (removable) {
+            stats.algebraicSimplifications++;
+        } else {
+            keptType = kept == 0 ? type
+                : TypeResolver::binaryResultType(std::string_view(&chain.ops[i], 1), keptType, type);
+            chain.operands[kept] = chain.operands[i];
+            chain.ops[kept] = kept == 0 ? level : chain.ops[i];
+            kept++;
         }
-        
-        default:
-            return nullptr;
+        type = next;
     }
-}
\ No newline at end of file
+    
+    if (kept == chain.operands.size()) {
+        return false;
+    }
+    chain.operands.resize(kept);
+    chain.ops.resize(kept);
+    chain.ops[0] = level;
+    return true;
+}
@@ -1,42 +1,36 @@
 #include "parser.h"
+#include <algorithm>
 #include <stdexcept>
 
-Parser::Parser(const std::vector<Token>& toks) : tokens(toks) {}
+Parser::Parser(Lexer& lexer, AstArena& arena) : lexer(&lexer), arena(arena) {
+    currentToken = lexer.next();
+}
+
+Parser::Parser(const std::vector<Token>& tokens, AstArena& arena) : tokens(&tokens), arena(arena) {
+    if (tokens.empty() || tokens.back().type != TokenType::END_OF_FILE) {
+        throw std::runtime_error("Token vector must end with END_OF_FILE");
+    }
+    currentToken = tokens[0];
+}
 
-std::unique_ptr<ProgramNode> Parser::parse() {
-    auto program = std::make_unique<ProgramNode>();
+ProgramNode* Parser::parse() {
+    auto* program = arena.create<ProgramNode>();
     
     // Parse all shader declarations until EOF
     while (current().type != TokenType::END_OF_FILE) {
         if (current().type == TokenType::SHADER) {
-            program->declarations.push_back(parseShaderDecl());
+            program->declarations.push_back(arena, parseShaderDecl());
         } else {
-            throw std::runtime_error("Expected 'shader' declaration at line " + 
-                                   std::to_string(current().line));
+            error("Expected 'shader' declaration");
         }
     }
     
     return program;
 }
 
-Token& Parser::current() {
-    if (position >= tokens.size()) {
-        return tokens.back(); // Return EOF
-    }
-    return tokens[position];
-}
-
-Token& Parser::peek(int offset) {
-    size_t pos = position + offset;
-    if (pos >= tokens.size()) {
-        return tokens.back();
-    }
-    return tokens[pos];
-}
-
 void Parser::advance() {
-    if (position < tokens.size()) {
-        position++;
+    if (currentToken.type != TokenType::END_OF_FILE) {
+        currentToken = lexer ? lexer->next() : (*tokens)[++tokenIndex];
     }
 }
 
@@ -48,10 +42,9 @@ bool Parser::match(TokenType type) {
     return false;
 }
 
-void Parser::expect(TokenType type, const std::string& message) {
+void Parser::expect(TokenType type, const char* message) {
     if (!match(type)) {
-        throw std::runtime_error("Parse error at line " + std::to_string(current().line) + 
-                               ": " + message + " (got '" + current().value + "')");
+        error(std::string(message) + " (got '" + std::string(current().value) + "')");
     }
 }
 
@@ -59,24 +52,27 @@ bool Parser::check(TokenType type) {
     return current().type == type;
 }
 
+void Parser::error(const std::string& message) const {
+    throw ShaderCompilationError(ShaderCompilationError::Stage::PARSING, message, current().line, current().column);
+}
+
 bool Parser::isTypeToken(TokenType type) {
     return type == TokenType::VEC2 || type == TokenType::VEC3 || 
            type == TokenType::VEC4 || type == TokenType::MAT4 ||
            type == TokenType::FLOAT || type == TokenType::INT;
 }
 
-std::string Parser::parseType() {
+std::string_view Parser::parseType() {
     if (!isTypeToken(current().type)) {
-        throw std::runtime_error("Expected type specifier at line " + 
-                               std::to_string(current().line));
+        error("Expected type specifier");
     }
-    std::string type = current().value;
+    std::string_view type = arena.intern(current().value);
     advance();
     return type;
 }
 
-std::unique_ptr<ShaderDeclNode> Parser::parseShaderDecl() {
-    auto node = std::make_unique<ShaderDeclNode>();
+ShaderDeclNode* Parser::parseShaderDecl() {
+    auto* node = arena.create<ShaderDeclNode>();
     
     // Expect 'shader' keyword
     expect(TokenType::SHADER, "Expected 'shader' keyword");
@@ -89,8 +85,7 @@ std::unique_ptr<ShaderDeclNode> Parser::parseShaderDecl() {
         node->shaderType = "fragment";
         advance();
     } else {
-        throw std::runtime_error("Expected 'vertex' or 'fragment' at line " + 
-                               std::to_string(current().line));
+        error("Expected 'vertex' or 'fragment'");
     }
     
     // Expect opening brace
@@ -100,23 +95,38 @@ std::unique_ptr<ShaderDeclNode> Parser::parseShaderDecl() {
     while (!check(TokenType::RBRACE) && !check(TokenType::END_OF_FILE)) {
         if (current().type == TokenType::INPUT) {
             advance(); // consume 'input'
-            node->inputs.push_back(parseVariableDecl(true));
+            node->inputs.push_back(arena, parseVariableDecl(true));
         } else if (current().type == TokenType::OUTPUT) {
             advance(); // consume 'output'
-            node->outputs.push_back(parseVariableDecl(false));
+            node->outputs.push_back(arena, parseVariableDecl(false));
+        } else if (current().type == TokenType::UNIFORM) {
+            advance(); // consume 'uniform'
+            node->uniforms.push_back(arena, parseVariableDecl(false));
+        } else if (current().type == TokenType::CONST) {
+            advance(); // consume 'const'
+            uint32_t constantId = static_cast<uint32_t>(node->constants.size());
+            node->constants.push_back(arena, parseSpecConstantDecl(constantId));
         } else if (current().type == TokenType::MAIN) {
             advance(); // consume 'main'
             expect(TokenType::LBRACE, "Expected '{' after 'main'");
             
             // Parse statements in main block
             while (!check(TokenType::RBRACE) && !check(TokenType::END_OF_FILE)) {
-                node->statements.push_back(parseStatement());
+                // A statement the caller already has is skipped, not parsed
+                size_t end = 0;
+                ASTNode* reused = (tokens && statementLookup) ? statementLookup(tokenIndex, end) : nullptr;
+                if (reused) {
+                    node->statements.push_back(arena, reused);
+                    tokenIndex = end;
+                    currentToken = (*tokens)[tokenIndex];
+                } else {
+                    node->statements.push_back(arena, parseStatement());
+                }
             }
             
             expect(TokenType::RBRACE, "Expected '}' after main block");
         } else {
-            throw std::runtime_error("Unexpected token in shader body at line " + 
-                                   std::to_string(current().line) + ": " + current().value);
+            error("Unexpected token in shader body: " + std::string(current().value));
         }
     }
     
@@ -126,18 +136,17 @@ std::unique_ptr<ShaderDeclNode> Parser::parseShaderDecl() {
     return node;
 }
 
-std::unique_ptr<VariableDeclNode> Parser::parseVariableDecl(bool isInput) {
-    auto node = std::make_unique<VariableDeclNode>();
+VariableDeclNode* Parser::parseVariableDecl(bool isInput) {
+    auto* node = arena.create<VariableDeclNode>();
     
     // Parse type
     node->varType = parseType();
     
     // Parse identifier name
     if (current().type != TokenType::IDENTIFIER) {
-        throw std::runtime_error("Expected identifier after type at line " + 
-                               std::to_string(current().line));
+        error("Expected identifier after type");
     }
-    node->name = current().value;
+    node->name = arena.intern(current().value);
     advance();
     
     // Expect semicolon
@@ -146,83 +155,198 @@ std::unique_ptr<VariableDeclNode> Parser::parseVariableDecl(bool isInput) {
     return node;
 }
 
-std::unique_ptr<ASTNode> Parser::parseStatement() {
+SpecConstantNode* Parser::parseSpecConstantDecl(uint32_t constantId) {
+    auto* node = arena.create<SpecConstantNode>();
+    node->constantId = constantId;
+    
+    // Specialization constants are scalars
+    if (current().type != TokenType::FLOAT && current().type != TokenType::INT) {
+        error("Expected 'float' or 'int' after 'const'");
+    }
+    node->varType = parseType();
+    
+    if (current().type != TokenType::IDENTIFIER) {
+        error("Expected identifier after type");
+    }
+    node->name = arena.intern(current().value);
+    advance();
+    
+    expect(TokenType::ASSIGN, "Expected '=' after constant name");
+    
+    // Default value: a numeric literal, optionally negated
+    bool negative = match(TokenType::MINUS);
+    if (current().type != TokenType::NUMBER) {
+        error("Expected numeric default value for constant '" + std::string(node->name) + "'");
+    }
+    std::string value = (negative ? "-" : "") + std::string(current().value);
+    if (node->varType == "int" && value.find_first_of(".eE") != std::string::npos) {
+        error("Expected integer default value for constant '" + std::string(node->name) + "'");
+    }
+    node->defaultValue = arena.intern(value);
+    advance();
+    
+    expect(TokenType::SEMICOLON, "Expected ';' after constant declaration");
+    
+    return node;
+}
+
+ASTNode* Parser::parseStatement() {
     // Parse assignment statement
     // Format: identifier = expression;
     // or: identifier.member = expression;
     
-    auto target = parsePrimary(); // Parse left-hand side
+    ASTNode* target = parsePrimary(); // Parse left-hand side
     
     // Expect assignment operator
     expect(TokenType::ASSIGN, "Expected '=' in assignment");
     
     // Parse right-hand side expression
-    auto value = parseExpression();
+    ASTNode* value = parseExpression();
     
     // Expect semicolon
     expect(TokenType::SEMICOLON, "Expected ';' after statement");
     
     // Create assignment node
-    auto assignment = std::make_unique<AssignmentNode>();
-    assignment->target = std::move(target);
-    assignment->value = std::move(value);
+    auto* assignment = arena.create<AssignmentNode>();
+    assignment->target = target;
+    assignment->value = value;
     
     return assignment;
 }
 
-std::unique_ptr<ASTNode> Parser::parseExpression() {
-    // Parse addition and subtraction (lowest precedence binary operators)
+ASTNode* Parser::parseExpression() {
+    // Precedence climbing over explicit stacks: neither long operator
+    // chains nor nested parentheses recurse. Factors collect until the term
+    // ends at a + or -, terms until the expression or its parenthesized
+    // group ends, and each level becomes one n-ary BinaryOpNode
     // Expression -> Term (('+' | '-') Term)*
-    
-    auto left = parseTerm();
-    
-    while (current().type == TokenType::PLUS || current().type == TokenType::MINUS) {
-        std::string op = current().value;
-        advance();
-        
-        auto right = parseTerm();
-        
-        auto binOp = std::make_unique<BinaryOpNode>();
-        binOp->op = op;
-        binOp->left = std::move(left);
-        binOp->right = std::move(right);
+    // Term -> Factor (('*' | '/') Factor)*
+    // Factor -> Primary | '(' Expression ')'
+    checkDepth(++nestedExpressions);
+    size_t baseFrame = frameStack.size();
+    frameStack.push_back({operandStack.size(), operandStack.size(), '+'});
+    char pending = '+'; // Operator in front of the next operand
+    
+    while (true) {
+        // Opening parentheses, then the operand itself
+        while (check(TokenType::LPAREN)) {
+            advance();
+            frameStack.push_back({operandStack.size(), operandStack.size(), pending});
+            pending = '+';
+        }
+        ASTNode* primary = parsePrimary();
+        pushOperand(primary, pending, expressionDepth);
         
-        left = std::move(binOp);
+        // Operators, closing any groups that end first
+        while (true) {
+            if (check(TokenType::MULTIPLY) || check(TokenType::DIVIDE)) {
+                pending = current().value[0];
+                advance();
+                break;
+            }
+            if (check(TokenType::PLUS) || check(TokenType::MINUS)) {
+                closeProduct(frameStack.back());
+                pending = current().value[0];
+                advance();
+                break;
+            }
+            if (frameStack.size() - baseFrame > 1) {
+                expect(TokenType::RPAREN, "Expected ')' after expression");
+                closeParenthesized();
+                continue;
+            }
+            
+            ASTNode* expression = closeGroup(frameStack.back());
+            frameStack.pop_back();
+            nestedExpressions--;
+            return expression;
+        }
     }
-    
-    return left;
 }
 
-std::unique_ptr<ASTNode> Parser::parseTerm() {
-    // Parse multiplication and division (higher precedence than +/-)
-    // Term -> Factor (('*' | '/') Factor)*
-    
-    auto left = parseFactor();
+void Parser::pushOperand(ASTNode* node, char op, uint32_t depth) {
+    operandStack.push_back(node);
+    depthStack.push_back(depth);
+    operatorStack.push_back(op);
+}
+
+void Parser::checkDepth(uint32_t depth) {
+    if (depth > maxExpressionDepth) {
+        error("Expression nested more than " + std::to_string(maxExpressionDepth) + " levels deep");
+    }
+}
+
+void Parser::closeProduct(ExpressionFrame& frame) {
+    // The term's first factor carries the + or - in front of the term
+    if (operandStack.size() - frame.productStart > 1) {
+        char op = operatorStack[frame.productStart];
+        ASTNode* product = makeChain(frame.productStart, '*');
+        pushOperand(product, op, expressionDepth);
+    }
+    frame.productStart = operandStack.size();
+}
+
+ASTNode* Parser::closeGroup(ExpressionFrame& frame) {
+    closeProduct(frame);
     
-    while (current().type == TokenType::MULTIPLY || current().type == TokenType::DIVIDE) {
-        std::string op = current().value;
-        advance();
-        
-        auto right = parseFactor();
-        
-        auto binOp = std::make_unique<BinaryOpNode>();
-        binOp->op = op;
-        binOp->left = std::move(left);
-        binOp->right = std::move(right);
-        
-        left = std::move(binOp);
+    ASTNode* group = operandStack[frame.sumStart];
+    if (operandStack.size() - frame.sumStart > 1) {
+        group = makeChain(frame.sumStart, '+');
+    } else {
+        expressionDepth = depthStack.back();
+        operandStack.pop_back();
+        depthStack.pop_back();
+        operatorStack.pop_back();
+    }
+    return group;
+}
+
+void Parser::closeParenthesized() {
+    ExpressionFrame group = frameStack.back();
+    frameStack.pop_back();
+    ExpressionFrame& parent = frameStack.back();
+    
+    // A group that starts a chain of its own level is spliced into it, as
+    // (a + b) + c is evaluated exactly like a + b + c. Generated code tends
+    // to parenthesize every step of a long chain this way
+    bool firstFactor = group.sumStart == parent.productStart;
+    bool firstTerm = firstFactor && parent.productStart == parent.sumStart;
+    
+    if (firstFactor && group.sumStart == group.productStart) {
+        // One term: its factors continue the parent's term
+        operatorStack[group.sumStart] = group.op;
+        return;
+    }
+    if (firstTerm && !check(TokenType::MULTIPLY) && !check(TokenType::DIVIDE)) {
+        // A sum that is not a factor: its terms continue the parent's sum
+        closeProduct(group);
+        operatorStack[group.sumStart] = group.op;
+        parent.productStart = operandStack.size();
+        return;
     }
     
-    return left;
+    ASTNode* node = closeGroup(group);
+    pushOperand(node, group.op, expressionDepth);
 }
 
-std::unique_ptr<ASTNode> Parser::parseFactor() {
-    // Factor is the same as Primary in this grammar
-    // (no unary operators to handle here)
-    return parsePrimary();
+ASTNode* Parser::makeChain(size_t start, char level) {
+    // Pops operands [start, end) into one node
+    auto* chain = arena.create<BinaryOpNode>();
+    operatorStack[start] = level;
+    chain->ops = arena.intern(std::string_view(operatorStack).substr(start));
+    for (size_t i = start; i < operandStack.size(); i++) {
+        chain->operands.push_back(arena, operandStack[i]);
+    }
+    expressionDepth = *std::max_element(depthStack.begin() + start, depthStack.end()) + 1;
+    checkDepth(expressionDepth);
+    
+    operandStack.resize(start);
+    depthStack.resize(start);
+    operatorStack.resize(start);
+    return chain;
 }
 
-std::unique_ptr<ASTNode> Parser::parsePrimary() {
+ASTNode* Parser::parsePrimary() {
     // Parse highest precedence items:
     // - Numbers
     // - Identifiers (with optional member access or function call)
@@ -231,29 +355,29 @@ std::unique_ptr<ASTNode> Parser::parsePrimary() {
     
     // Number literal
     if (current().type == TokenType::NUMBER) {
-        auto literal = std::make_unique<LiteralNode>();
-        literal->value = current().value;
+        auto* literal = arena.create<LiteralNode>();
+        literal->value = arena.intern(current().value);
         advance();
+        expressionDepth = 1;
         return literal;
     }
     
     // Type constructor (vec2, vec3, vec4, mat4, etc. used as functions)
     if (isTypeToken(current().type)) {
-        std::string typeName = current().value;
+        std::string_view typeName = arena.intern(current().value);
         advance();
         
         // Type constructors must be followed by parentheses
         if (current().type == TokenType::LPAREN) {
             return parseFunctionCall(typeName);
         } else {
-            throw std::runtime_error("Expected '(' after type constructor '" + typeName + 
-                                   "' at line " + std::to_string(current().line));
+            error("Expected '(' after type constructor '" + std::string(typeName) + "'");
         }
     }
     
     // Identifier (could be variable, member access, or function call)
     if (current().type == TokenType::IDENTIFIER) {
-        std::string name = current().value;
+        std::string_view name = arena.intern(current().value);
         advance();
         
         // Check for member access (e.g., position.xyz)
@@ -261,19 +385,19 @@ std::unique_ptr<ASTNode> Parser::parsePrimary() {
             advance(); // consume '.'
             
             if (current().type != TokenType::IDENTIFIER) {
-                throw std::runtime_error("Expected member name after '.' at line " + 
-                                       std::to_string(current().line));
+                error("Expected member name after '.'");
             }
             
-            std::string member = current().value;
+            std::string_view member = arena.intern(current().value);
             advance();
             
-            auto memberAccess = std::make_unique<MemberAccessNode>();
-            auto object = std::make_unique<IdentifierNode>();
+            auto* memberAccess = arena.create<MemberAccessNode>();
+            auto* object = arena.create<IdentifierNode>();
             object->name = name;
-            memberAccess->object = std::move(object);
+            memberAccess->object = object;
             memberAccess->member = member;
             
+            expressionDepth = 2;
             return memberAccess;
         }
         // Check for function call (e.g., vec4(...))
@@ -282,8 +406,9 @@ std::unique_ptr<ASTNode> Parser::parsePrimary() {
         }
         // Just an identifier
         else {
-            auto identifier = std::make_unique<IdentifierNode>();
+            auto* identifier = arena.create<IdentifierNode>();
             identifier->name = name;
+            expressionDepth = 1;
             return identifier;
         }
     }
@@ -291,36 +416,230 @@ std::unique_ptr<ASTNode> Parser::parsePrimary() {
     // Parenthesized expression
     if (current().type == TokenType::LPAREN) {
         advance(); // consume '('
-        auto expr = parseExpression();
+        ASTNode* expr = parseExpression();
         expect(TokenType::RPAREN, "Expected ')' after expression");
         return expr;
     }
     
-    throw std::runtime_error("Unexpected token in expression at line " + 
-                           std::to_string(current().line) + ": " + current().value);
+    error("Unexpected token in expression: " + std::string(current().value));
 }
 
-std::unique_ptr<FunctionCallNode> Parser::parseFunctionCall(const std::string& funcName) {
-    auto funcCall = std::make_unique<FunctionCallNode>();
+FunctionCallNode* Parser::parseFunctionCall(std::string_view funcName) {
+    auto* funcCall = arena.create<FunctionCallNode>();
     funcCall->functionName = funcName;
     
     // Expect opening parenthesis
     expect(TokenType::LPAREN, "Expected '(' after function name");
     
     // Parse arguments
+    uint32_t depth = 0;
     if (current().type != TokenType::RPAREN) {
         // Parse first argument
-        funcCall->arguments.push_back(parseExpression());
+        funcCall->arguments.push_back(arena, parseExpression());
+        depth = expressionDepth;
         
         // Parse remaining arguments
         while (current().type == TokenType::COMMA) {
             advance(); // consume ','
-            funcCall->arguments.push_back(parseExpression());
+            funcCall->arguments.push_back(arena, parseExpression());
+            depth = std::max(depth, expressionDepth);
         }
     }
     
     // Expect closing parenthesis
     expect(TokenType::RPAREN, "Expected ')' after function arguments");
     
+    expressionDepth = depth + 1;
+    checkDepth(expressionDepth);
     return funcCall;
+}
+
+namespace {
+
+template <typename T>
+T* copyNode(AstArena& arena, const ASTNode* node) {
+    return arena.create<T>(*static_cast<const T*>(node));
+}
+
+void cloneList(AstArena& arena, NodeList& list) {
+    NodeList original = list;
+    list = NodeList();
+    for (const auto* item : original) {
+        list.push_back(arena, cloneAST(arena, item));
+    }
+}
+
+} // namespace
+
+ASTNode* cloneAST(AstArena& arena, const ASTNode* node) {
+    if (!node) {
+        return nullptr;
+    }
+    
+    // Copy the node itself, then replace every child pointer with a copy
+    switch (node->type) {
+        case ASTNodeType::PROGRAM: {
+            auto* program = copyNode<ProgramNode>(arena, node);
+            cloneList(arena, program->declarations);
+            return program;
+        }
+        case ASTNodeType::SHADER_DECL: {
+            auto* shader = copyNode<ShaderDeclNode>(arena, node);
+            cloneList(arena, shader->inputs);
+            cloneList(arena, shader->outputs);
+            cloneList(arena, shader->uniforms);
+            cloneList(arena, shader->constants);
+            cloneList(arena, shader->statements);
+            return shader;
+        }
+        case ASTNodeType::VARIABLE_DECL:
+            return copyNode<VariableDeclNode>(arena, node);
+        case ASTNodeType::SPEC_CONSTANT_DECL:
+            return copyNode<SpecConstantNode>(arena, node);
+        case ASTNodeType::ASSIGNMENT: {
+            auto* assign = copyNode<AssignmentNode>(arena, node);
+            assign->target = cloneAST(arena, assign->target);
+            assign->value = cloneAST(arena, assign->value);
+            return assign;
+        }
+        case ASTNodeType::BINARY_OP: {
+            auto* binOp = copyNode<BinaryOpNode>(arena, node);
+            cloneList(arena, binOp->operands);
+            return binOp;
+        }
+        case ASTNodeType::IDENTIFIER:
+            return copyNode<IdentifierNode>(arena, node);
+        case ASTNodeType::LITERAL:
+            return copyNode<LiteralNode>(arena, node);
+        case ASTNodeType::MEMBER_ACCESS: {
+            auto* member = copyNode<MemberAccessNode>(arena, node);
+            member->object = cloneAST(arena, member->object);
+            return member;
+        }
+        case ASTNodeType::FUNCTION_CALL: {
+            auto* funcCall = copyNode<FunctionCallNode>(arena, node);
+            cloneList(arena, funcCall->arguments);
+            return funcCall;
+        }
+        case ASTNodeType::FUNCTION_DECL:
+            break;
+    }
+    
+    throw std::runtime_error("Cannot clone unsupported AST node");
+}
+
+namespace {
+
+// Two FNV-1a streams with different bases and primes; every string is
+// followed by its length so adjacent strings cannot run into each other
+struct AstHasher {
+    uint64_t primary = 14695981039346656037ull;
+    uint64_t secondary = 0x9e3779b97f4a7c15ull;
+    
+    void byte(uint8_t value) {
+        primary = (primary ^ value) * 1099511628211ull;
+        secondary = (secondary ^ value) * 0x100000001b3ull * 31 + 0x2545f4914f6cdd1dull;
+    }
+    
+    void word(uint64_t value) {
+        for (int i = 0; i < 8; i++) {
+            byte(static_cast<uint8_t>(value >> (i * 8)));
+        }
+    }
+    
+    void text(std::string_view str) {
+        for (char c : str) {
+            byte(static_cast<uint8_t>(c));
+        }
+        word(str.size());
+    }
+    
+    void list(const NodeList& nodes) {
+        word(nodes.size());
+        for (const auto* item : nodes) {
+            node(item);
+        }
+    }
+    
+    void node(const ASTNode* node) {
+        if (!node) {
+            byte(0xff);
+            return;
+        }
+        byte(static_cast<uint8_t>(node->type));
+        
+        switch (node->type) {
+            case ASTNodeType::PROGRAM:
+                list(static_cast<const ProgramNode*>(node)->declarations);
+                break;
+            case ASTNodeType::SHADER_DECL: {
+                auto* shader = static_cast<const ShaderDeclNode*>(node);
+                text(shader->shaderType);
+                list(shader->inputs);
+                list(shader->outputs);
+                list(shader->uniforms);
+                list(shader->constants);
+                list(shader->statements);
+                break;
+            }
+            case ASTNodeType::VARIABLE_DECL: {
+                auto* varDecl = static_cast<const VariableDeclNode*>(node);
+                text(varDecl->varType);
+                text(varDecl->name);
+                break;
+            }
+            case ASTNodeType::SPEC_CONSTANT_DECL: {
+                auto* constant = static_cast<const SpecConstantNode*>(node);
+                text(constant->varType);
+                text(constant->name);
+                text(constant->defaultValue);
+                word(constant->constantId);
+                break;
+            }
+            case ASTNodeType::ASSIGNMENT: {
+                auto* assign = static_cast<const AssignmentNode*>(node);
+                this->node(assign->target);
+                this->node(assign->value);
+                break;
+            }
+            case ASTNodeType::BINARY_OP: {
+                auto* binOp = static_cast<const BinaryOpNode*>(node);
+                text(binOp->ops);
+                list(binOp->operands);
+                break;
+            }
+            case ASTNodeType::IDENTIFIER:
+                text(static_cast<const IdentifierNode*>(node)->name);
+                break;
+            case ASTNodeType::LITERAL:
+                text(static_cast<const LiteralNode*>(node)->value);
+                break;
+            case ASTNodeType::MEMBER_ACCESS: {
+                auto* member = static_cast<const MemberAccessNode*>(node);
+                this->node(member->object);
+                text(member->member);
+                break;
+            }
+            case ASTNodeType::FUNCTION_CALL: {
+                auto* funcCall = static_cast<const FunctionCallNode*>(node);
+                text(funcCall->functionName);
+                list(funcCall->arguments);
+                break;
+            }
+            case ASTNodeType::FUNCTION_DECL:
+                break;
+        }
+    }
+};
+
+} // namespace
+
+AstHash hashAST(const ASTNode* node) {
+    AstHasher hasher;
+    hasher.node(node);
+    
+    AstHash hash;
+    hash.primary = hasher.primary;
+    hash.secondary = hasher.secondary;
+    return hash;
 }
\ No newline at end of file
@@ -0,0 +1,195 @@
+#include "shader_cache.h"
+#include <atomic>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <unistd.h>
+
+namespace {
+
+const uint32_t CACHE_MAGIC = 0x48435353; // "SSCH"
+const uint32_t CACHE_FORMAT_VERSION = 1;
+const uint32_t SPIRV_MAGIC = 0x07230203;
+
+struct EntryHeader {
+    uint32_t magic;
+    uint32_t formatVersion;
+    uint64_t secondaryHash;
+    uint64_t wordCount;
+};
+
+// 64-bit FNV-1a, seeded so the two key halves are independent
+uint64_t fnv1a(uint64_t hash, const void* data, size_t size) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+uint64_t hashField(uint64_t hash, std::string_view field) {
+    // Length-prefix every field so ("ab", "c") and ("a", "bc") differ
+    uint64_t length = field.size();
+    hash = fnv1a(hash, &length, sizeof(length));
+    return fnv1a(hash, field.data(), field.size());
+}
+
+std::atomic<uint64_t> tempFileCounter{0};
+
+} // namespace
+
+ShaderCache::ShaderCache(const std::string& dir) : directory(dir) {}
+
+ShaderCache::Key ShaderCache::makeKey(std::string_view source, std::string_view shaderType,
+                                      std::string_view optionsSignature) {
+    Key key;
+    key.primary = 0xcbf29ce484222325ULL;
+    key.secondary = 0x84222325cbf29ce4ULL;
+
+    for (std::string_view field : {source, shaderType, optionsSignature}) {
+        key.primary = hashField(key.primary, field);
+        key.secondary = hashField(key.secondary, field);
+    }
+
+    return key;
+}
+
+bool ShaderCache::load(const Key& key, std::vector<uint32_t>& spirv) const {
+    std::ifstream file(entryPath(key), std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    EntryHeader header{};
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header))) {
+        return false;
+    }
+
+    if (header.magic != CACHE_MAGIC || header.formatVersion != CACHE_FORMAT_VERSION ||
+        header.secondaryHash != key.secondary || header.wordCount == 0) {
+        return false;
+    }
+
+    // The word count must account for exactly the rest of the file, so a
+    // truncated or corrupt entry is a miss rather than a huge allocation
+    file.seekg(0, std::ios::end);
+    std::streamoff codeBytes = static_cast<std::streamoff>(file.tellg()) - static_cast<std::streamoff>(sizeof(header));
+    if (codeBytes <= 0 || static_cast<uint64_t>(codeBytes) % sizeof(uint32_t) != 0 ||
+        header.wordCount != static_cast<uint64_t>(codeBytes) / sizeof(uint32_t)) {
+        return false;
+    }
+    file.seekg(sizeof(header));
+
+    std::vector<uint32_t> words(header.wordCount);
+    if (!file.read(reinterpret_cast<char*>(words.data()), words.size() * sizeof(uint32_t))) {
+        return false;
+    }
+
+    if (words[0] != SPIRV_MAGIC) {
+        return false;
+    }
+
+    spirv = std::move(words);
+    return true;
+}
+
+bool ShaderCache::store(const Key& key, const std::vector<uint32_t>& spirv) const {
+    std::error_code ec;
+    std::filesystem::create_directories(directory, ec);
+    if (ec) {
+        return false;
+    }
+
+    std::string finalPath = entryPath(key);
+    std::string tempPath = finalPath + ".tmp." + std::to_string(getpid()) + "." +
+                           std::to_string(tempFileCounter++);
+
+    {
+        std::ofstream file(tempPath, std::ios::binary);
+        if (!file.is_open()) {
+            return false;
+        }
+
+        EntryHeader header{CACHE_MAGIC, CACHE_FORMAT_VERSION, key.secondary, spirv.size()};
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(spirv.data()), spirv.size() * sizeof(uint32_t));
+
+        if (!file) {
+            file.close();
+            std::remove(tempPath.c_str());
+            return false;
+        }
+    }
+
+    if (std::rename(tempPath.c_str(), finalPath.c_str()) != 0) {
+        std::remove(tempPath.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+std::string ShaderCache::entryPath(const Key& key) const {
+    std::ostringstream ss;
+    ss << directory << "/" << std::hex << std::setw(16) << std::setfill('0') << key.primary << ".spv";
+    return ss.str();
+}
+
+ShaderMemoryCache::ShaderMemoryCache(size_t capacity) : capacityBytes(capacity) {}
+
+bool ShaderMemoryCache::load(const ShaderCache::Key& key, std::vector<uint32_t>& spirv) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto it = index.find(key.primary);
+    if (it == index.end() || it->second->key.secondary != key.secondary) {
+        stats.misses++;
+        return false;
+    }
+
+    entries.splice(entries.begin(), entries, it->second);
+    spirv = it->second->spirv;
+    stats.hits++;
+    return true;
+}
+
+void ShaderMemoryCache::store(const ShaderCache::Key& key, const std::vector<uint32_t>& spirv) {
+    size_t size = spirv.size() * sizeof(uint32_t);
+    if (size > capacityBytes) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // A primary-hash collision replaces the older entry
+    auto it = index.find(key.primary);
+    if (it != index.end()) {
+        stats.bytes -= it->second->spirv.size() * sizeof(uint32_t);
+        entries.erase(it->second);
+        index.erase(it);
+    }
+
+    entries.push_front(Entry{key, spirv});
+    index[key.primary] = entries.begin();
+    stats.bytes += size;
+    evict();
+}
+
+ShaderMemoryCache::Stats ShaderMemoryCache::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    Stats result = stats;
+    result.entries = entries.size();
+    return result;
+}
+
+void ShaderMemoryCache::evict() {
+    while (stats.bytes > capacityBytes && !entries.empty()) {
+        const Entry& oldest = entries.back();
+        stats.bytes -= oldest.spirv.size() * sizeof(uint32_t);
+        index.erase(oldest.key.primary);
+        entries.pop_back();
+        stats.evictions++;
+    }
+}
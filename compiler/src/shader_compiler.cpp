@@ -3,17 +3,109 @@
 #include "parser.h"
 #include "optimizer.h"
 #include "codegen.h"
+#include "spirv_optimizer.h"
+#include "compile_trace.h"
+#include "shader_cache.h"
+#include "ast_arena.h"
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <algorithm>
 #include <chrono>
-#include <functional>
+#include <cstdlib>
+#include <unordered_map>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
-ShaderCompiler::ShaderCompiler() { optimizationEnabled = true; }
+#ifndef SHADER_COMPILER_VERSION
+#define SHADER_COMPILER_VERSION "dev"
+#endif
+
+// Hash of the compiler sources, set by CMake; builds without it fall back to
+// the time this file was compiled, which never reuses another build's entries
+#ifndef SHADER_COMPILER_BUILD_SIGNATURE
+#define SHADER_COMPILER_BUILD_SIGNATURE __DATE__ " " __TIME__
+#endif
+
+ShaderCompiler::ShaderCompiler() 
+    : backend(CodeGenerator::defaultBackend()), arena(std::make_unique<AstArena>()) { 
+    optimizationEnabled = true; 
+}
 
 ShaderCompiler::~ShaderCompiler() {}
 
-std::vector<uint32_t> ShaderCompiler::compile(const std::string& source, const std::string& shaderType) {
+void ShaderCompiler::setBackend(SpirvBackend newBackend) {
+    if (!CodeGenerator::isBackendAvailable(newBackend)) {
+        throw std::runtime_error(std::string("SPIR-V backend '") + 
+                                 CodeGenerator::backendName(newBackend) +
+                                 "' is not available in this build");
+    }
+    backend = newBackend;
+}
+
+void ShaderCompiler::setCacheDirectory(const std::string& directory) {
+    cacheDirectory = directory;
+    if (directory.empty()) {
+        cache.reset();
+    } else {
+        cache = std::make_unique<ShaderCache>(directory);
+    }
+}
+
+const char* ShaderCompiler::version() {
+    return SHADER_COMPILER_VERSION;
+}
+
+const char* ShaderCompiler::buildSignature() {
+    return SHADER_COMPILER_BUILD_SIGNATURE;
+}
+
+namespace {
+
+// Read-only mapping of a whole file, unmapped on destruction
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& filename) {
+        int fd = open(filename.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return;
+        }
+        
+        struct stat info;
+        if (fstat(fd, &info) == 0 && info.st_size > 0) {
+            void* mapped = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapped != MAP_FAILED) {
+                data = static_cast<const char*>(mapped);
+                size = static_cast<size_t>(info.st_size);
+            }
+        }
+        opened = true;
+        close(fd);
+    }
+    
+    ~MappedFile() {
+        if (data) {
+            munmap(const_cast<char*>(data), size);
+        }
+    }
+    
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    
+    bool isOpen() const { return opened; }
+    std::string_view contents() const { return std::string_view(data, size); }
+    
+private:
+    const char* data = nullptr;
+    size_t size = 0;
+    bool opened = false;
+};
+
+} // namespace
+
+std::vector<uint32_t> ShaderCompiler::compile(std::string_view source, const std::string& shaderType) {
     // Reset stats for new compilation
     resetStats();
     
@@ -21,98 +113,50 @@ std::vector<uint32_t> ShaderCompiler::compile(const std::string& source, const s
     validateShaderType(shaderType);
     
     double totalStartTime = getCurrentTimeMs();
+    CompileTrace::Scope compileSpan(trace, "compile", "compile", shaderType);
     
-    try {
-        // ====================================
-        // PHASE 1: LEXICAL ANALYSIS (LEXING)
-        // ====================================
-        logVerbose("Starting lexical analysis...");
-        double lexStartTime = getCurrentTimeMs();
-        
-        Lexer lexer(source);
-        std::vector<Token> tokens = lexer.tokenize();
-        
-        double lexEndTime = getCurrentTimeMs();
-        stats.lexingTimeMs = lexEndTime - lexStartTime;
-        stats.tokenCount = tokens.size();
-        
-        logVerbose("Lexing complete: " + std::to_string(stats.tokenCount) + " tokens generated");
-        
-        // ====================================
-        // PHASE 2: SYNTAX ANALYSIS (PARSING)
-        // ====================================
-        logVerbose("Starting syntax analysis...");
-        double parseStartTime = getCurrentTimeMs();
-        
-        Parser parser(tokens);
-        std::unique_ptr<ProgramNode> ast = parser.parse();
+    // ====================================
+    // CACHE LOOKUP
+    // ====================================
+    ShaderCache::Key cacheKey;
+    if (cache || memoryCache) {
+        cacheKey = ShaderCache::makeKey(source, shaderType, optionsSignature());
         
-        if (!ast) {
-            throw ShaderCompilationError(
-                ShaderCompilationError::Stage::PARSING,
-                "Parser returned null AST"
-            );
-        }
-        
-        double parseEndTime = getCurrentTimeMs();
-        stats.parsingTimeMs = parseEndTime - parseStartTime;
-        stats.astNodeCount = countASTNodes(ast.get());
-        stats.originalStatementCount = countStatements(ast.get());
-        
-        logVerbose("Parsing complete: " + std::to_string(stats.astNodeCount) + 
-                   " AST nodes, " + std::to_string(stats.originalStatementCount) + " statements");
-        
-        // ====================================
-        // PHASE 3: OPTIMIZATION
-        // ====================================
-        if (optimizationEnabled) {
-            logVerbose("Starting optimization passes...");
-            double optStartTime = getCurrentTimeMs();
-            
-            Optimizer optimizer;
-            optimizer.optimize(ast.get());
-            
-            double optEndTime = getCurrentTimeMs();
-            stats.optimizationTimeMs = optEndTime - optStartTime;
+        // Memory first; a disk hit is promoted into memory for the next lookup
+        std::vector<uint32_t> cached;
+        bool memoryHit = memoryCache && memoryCache->load(cacheKey, cached);
+        if (memoryHit || (cache && cache->load(cacheKey, cached))) {
+            if (!memoryHit && memoryCache) {
+                memoryCache->store(cacheKey, cached);
+            }
             
-            // Collect optimization statistics
-            auto optStats = optimizer.getStats();
-            stats.constantsFolded = optStats.constantsFolded;
-            stats.deadCodeEliminated = optStats.deadCodeRemoved;
-            stats.algebraicSimplifications = optStats.algebraicSimplifications;
-            stats.optimizationPasses = optStats.totalPasses;
-            stats.optimizedStatementCount = countStatements(ast.get());
+            stats.cacheHits = 1;
+            stats.memoryCacheHits = memoryHit ? 1 : 0;
+            stats.spirvSizeBytes = cached.size() * sizeof(uint32_t);
+            stats.spirvInstructionCount = cached.size();
+            stats.originalSpirvSizeBytes = stats.spirvSizeBytes;
+            stats.originalSpirvInstructionCount = stats.spirvInstructionCount;
+            stats.totalTimeMs = getCurrentTimeMs() - totalStartTime;
             
-            logVerbose("Optimization complete: " + std::to_string(stats.optimizationPasses) + 
-                       " passes, " + std::to_string(stats.constantsFolded) + " constants folded, " +
-                       std::to_string(stats.algebraicSimplifications) + " algebraic simplifications, " +
-                       std::to_string(stats.deadCodeEliminated) + " dead code eliminated");
-        } else {
-            logVerbose("Optimization disabled, skipping...");
-            stats.optimizedStatementCount = stats.originalStatementCount;
+            logVerbose("Cache hit in " + (memoryHit ? std::string("memory") : cache->getDirectory()) + ": " +
+                       std::to_string(stats.spirvSizeBytes) + " bytes SPIR-V");
+            return cached;
         }
         
-        // ====================================
-        // PHASE 4: CODE GENERATION
-        // ====================================
-        logVerbose("Starting code generation...");
-        double codegenStartTime = getCurrentTimeMs();
-        
-        CodeGenerator codegen;
-        std::vector<uint32_t> spirv = codegen.generate(ast.get(), shaderType);
-        
-        double codegenEndTime = getCurrentTimeMs();
-        stats.codegenTimeMs = codegenEndTime - codegenStartTime;
-        
-        // Store generated GLSL for inspection
-        generatedGLSL = codegen.getGeneratedGLSL();
-        
-        // Calculate SPIR-V statistics
-        stats.spirvSizeBytes = spirv.size() * sizeof(uint32_t);
-        stats.spirvInstructionCount = spirv.size();
+        stats.cacheMisses = 1;
+        logVerbose(cache ? "Cache miss in " + cache->getDirectory() : std::string("Cache miss in memory"));
+    }
+    
+    try {
+        ProgramNode* ast = parseSource(source);
+        std::vector<uint32_t> spirv = optimizeAndGenerate(ast, shaderType);
         
-        logVerbose("Code generation complete: " + std::to_string(stats.spirvSizeBytes) + 
-                   " bytes SPIR-V, " + std::to_string(stats.spirvInstructionCount) + " words");
+        if (cache && !cache->store(cacheKey, spirv)) {
+            logVerbose("Warning: failed to write cache entry to " + cache->getDirectory());
+        }
+        if (memoryCache) {
+            memoryCache->store(cacheKey, spirv);
+        }
         
         // ====================================
         // COMPILATION COMPLETE
@@ -123,69 +167,189 @@ std::vector<uint32_t> ShaderCompiler::compile(const std::string& source, const s
         if (verbose) {
             std::cout << "\n=== Compilation Summary ===" << std::endl;
             std::cout << "Total time: " << stats.totalTimeMs << " ms" << std::endl;
-            std::cout << "  Lexing: " << stats.lexingTimeMs << " ms" << std::endl;
-            std::cout << "  Parsing: " << stats.parsingTimeMs << " ms" << std::endl;
+            std::cout << "  Lexing + parsing: " << stats.parsingTimeMs << " ms" << std::endl;
             std::cout << "  Optimization: " << stats.optimizationTimeMs << " ms" << std::endl;
             std::cout << "  Code generation: " << stats.codegenTimeMs << " ms" << std::endl;
+            std::cout << "    GLSL emit: " << stats.glslGenerationTimeMs << " ms" << std::endl;
+            std::cout << "    SPIR-V: " << stats.spirvGenerationTimeMs << " ms" << std::endl;
+            if (spirvOptimizationEnabled) {
+                std::cout << "  SPIR-V optimization: " << stats.spirvOptimizationTimeMs << " ms" << std::endl;
+            }
             std::cout << "Tokens: " << stats.tokenCount << std::endl;
             std::cout << "AST nodes: " << stats.astNodeCount << std::endl;
             std::cout << "Statements: " << stats.originalStatementCount << " -> " 
                       << stats.optimizedStatementCount << std::endl;
-            std::cout << "SPIR-V size: " << stats.spirvSizeBytes << " bytes" << std::endl;
+            if (spirvOptimizationEnabled) {
+                std::cout << "SPIR-V size: " << stats.originalSpirvSizeBytes << " -> "
+                          << stats.spirvSizeBytes << " bytes" << std::endl;
+            } else {
+                std::cout << "SPIR-V size: " << stats.spirvSizeBytes << " bytes" << std::endl;
+            }
             std::cout << "==========================\n" << std::endl;
         }
         
         return spirv;
         
     } catch (const std::runtime_error& e) {
-        // Determine which phase failed based on the exception message
-        std::string errorMsg = e.what();
+        ShaderCompilationError::rethrow(currentStage, e);
+    }
+}
+
+ProgramNode* ShaderCompiler::parseSource(std::string_view source) {
+    // ====================================
+    // PHASE 1+2: LEXING AND PARSING
+    // ====================================
+    // The parser pulls tokens from the lexer one at a time, so there is
+    // no token vector and lexing time is included in parsing time
+    logVerbose("Starting lexical and syntax analysis...");
+    double parseStartTime = getCurrentTimeMs();
+    CompileTrace::Scope parseSpan(trace, "parse", "frontend");
+    // Lexer and parser errors carry their own stage and position
+    currentStage = ShaderCompilationError::Stage::PARSING;
+    
+    // The previous compile's AST is released in one go; its blocks are reused
+    arena->reset();
+    
+    Lexer lexer(source);
+    Parser parser(lexer, *arena);
+    ProgramNode* ast = parser.parse();
+    stats.tokenCount = lexer.getTokenCount();
+    
+    if (!ast) {
+        throw ShaderCompilationError(
+            ShaderCompilationError::Stage::PARSING,
+            "Parser returned null AST"
+        );
+    }
+    
+    double parseEndTime = getCurrentTimeMs();
+    stats.parsingTimeMs = parseEndTime - parseStartTime;
+    stats.astNodeCount = countASTNodes(ast);
+    stats.originalStatementCount = countStatements(ast);
+    stats.astArenaBytes = arena->bytesUsed();
+    
+    logVerbose("Parsing complete: " + std::to_string(stats.tokenCount) + " tokens, " +
+               std::to_string(stats.astNodeCount) + 
+               " AST nodes, " + std::to_string(stats.originalStatementCount) + " statements, " +
+               std::to_string(stats.astArenaBytes) + " arena bytes");
+    
+    return ast;
+}
+
+std::vector<uint32_t> ShaderCompiler::optimizeAndGenerate(ProgramNode* ast, const std::string& shaderType) {
+    // ====================================
+    // PHASE 3: OPTIMIZATION
+    // ====================================
+    if (optimizationEnabled) {
+        logVerbose("Starting optimization passes...");
+        double optStartTime = getCurrentTimeMs();
+        CompileTrace::Scope optimizeSpan(trace, "optimize", "optimizer");
+        currentStage = ShaderCompilationError::Stage::OPTIMIZATION;
+        
+        Optimizer optimizer(*arena);
+        optimizer.setTrace(trace);
+        optimizer.optimize(ast);
+        
+        double optEndTime = getCurrentTimeMs();
+        stats.optimizationTimeMs += optEndTime - optStartTime;
+        
+        // Collect optimization statistics
+        auto optStats = optimizer.getStats();
+        stats.constantsFolded += optStats.constantsFolded;
+        stats.deadCodeEliminated += optStats.deadCodeRemoved;
+        stats.algebraicSimplifications += optStats.algebraicSimplifications;
+        stats.commonSubexpressionsEliminated += optStats.commonSubexpressionsEliminated;
+        stats.optimizationPasses += optStats.totalPasses;
+        stats.optimizedStatementCount += countStatements(ast);
+        
+        logVerbose("Optimization complete: " + std::to_string(optStats.totalPasses) + 
+                   " passes, " + std::to_string(optStats.constantsFolded) + " constants folded, " +
+                   std::to_string(optStats.algebraicSimplifications) + " algebraic simplifications, " +
+                   std::to_string(optStats.deadCodeRemoved) + " dead code eliminated, " +
+                   std::to_string(optStats.commonSubexpressionsEliminated) + " common subexpressions eliminated");
+    } else {
+        logVerbose("Optimization disabled, skipping...");
+        stats.optimizedStatementCount += countStatements(ast);
+    }
+    
+    // ====================================
+    // PHASE 4: CODE GENERATION
+    // ====================================
+    logVerbose(std::string("Starting code generation (backend: ") + 
+               CodeGenerator::backendName(backend) + ")...");
+    double codegenStartTime = getCurrentTimeMs();
+    currentStage = ShaderCompilationError::Stage::CODE_GENERATION;
+    
+    CodeGenerator codegen(backend);
+    codegen.setTrace(trace);
+    std::vector<uint32_t> spirv;
+    try {
+        spirv = codegen.generate(ast, shaderType);
+    } catch (const std::runtime_error&) {
+        // GLSL the GLSL compiler rejected is kept rather than put in the message
+        generatedGLSL = codegen.getGeneratedGLSL();
+        throw;
+    }
+    
+    double codegenEndTime = getCurrentTimeMs();
+    stats.codegenTimeMs += codegenEndTime - codegenStartTime;
+    stats.glslGenerationTimeMs += codegen.getTimings().glslGenerationMs;
+    stats.spirvGenerationTimeMs += codegen.getTimings().spirvGenerationMs;
+    
+    // Store generated GLSL for inspection
+    generatedGLSL = codegen.getGeneratedGLSL();
+    
+    // Calculate SPIR-V statistics
+    stats.originalSpirvSizeBytes += spirv.size() * sizeof(uint32_t);
+    stats.originalSpirvInstructionCount += spirv.size();
+    
+    logVerbose("Code generation complete: " + std::to_string(spirv.size() * sizeof(uint32_t)) + 
+               " bytes SPIR-V, " + std::to_string(spirv.size()) + " words");
+    
+    // ====================================
+    // PHASE 5: SPIR-V OPTIMIZATION
+    // ====================================
+    if (spirvOptimizationEnabled) {
+        double spirvOptStartTime = getCurrentTimeMs();
+        CompileTrace::Scope spirvOptimizeSpan(trace, "spirv-optimize", "optimizer");
+        currentStage = ShaderCompilationError::Stage::OPTIMIZATION;
+        
+        SpirvOptimizer spirvOptimizer;
+        spirvOptimizer.optimize(spirv);
+        
+        double spirvOptEndTime = getCurrentTimeMs();
+        stats.spirvOptimizationTimeMs += spirvOptEndTime - spirvOptStartTime;
         
-        if (errorMsg.find("Lexer") != std::string::npos || 
-            errorMsg.find("token") != std::string::npos ||
-            errorMsg.find("Unexpected character") != std::string::npos) {
-            throw ShaderCompilationError(
-                ShaderCompilationError::Stage::LEXING,
-                errorMsg
-            );
-        } else if (errorMsg.find("Parse") != std::string::npos || 
-                   errorMsg.find("Expected") != std::string::npos ||
-                   errorMsg.find("syntax") != std::string::npos) {
-            throw ShaderCompilationError(
-                ShaderCompilationError::Stage::PARSING,
-                errorMsg
-            );
-        } else if (errorMsg.find("Optimizer") != std::string::npos ||
-                   errorMsg.find("optimization") != std::string::npos) {
-            throw ShaderCompilationError(
-                ShaderCompilationError::Stage::OPTIMIZATION,
-                errorMsg
-            );
+        const auto& spirvStats = spirvOptimizer.getStats();
+        if (spirvStats.skipped) {
+            logVerbose("SPIR-V optimization skipped: module contains an unsupported instruction");
         } else {
-            throw ShaderCompilationError(
-                ShaderCompilationError::Stage::CODE_GENERATION,
-                errorMsg
-            );
+            logVerbose("SPIR-V optimization complete: " + std::to_string(spirvStats.wordsBefore) + " -> " +
+                       std::to_string(spirvStats.wordsAfter) + " words, " +
+                       std::to_string(spirvStats.debugInstructionsStripped) + " debug instructions stripped, " +
+                       std::to_string(spirvStats.duplicatesMerged) + " duplicates merged, " +
+                       std::to_string(spirvStats.deadInstructionsRemoved) + " dead instructions removed, id bound " +
+                       std::to_string(spirvStats.idBoundBefore) + " -> " + std::to_string(spirvStats.idBoundAfter));
         }
     }
+    
+    stats.spirvSizeBytes += spirv.size() * sizeof(uint32_t);
+    stats.spirvInstructionCount += spirv.size();
+    
+    return spirv;
 }
 
 std::vector<uint32_t> ShaderCompiler::compileFromFile(const std::string& filename, 
                                                        const std::string& shaderType) {
     logVerbose("Loading shader from file: " + filename);
     
-    // Open and read the file
-    std::ifstream file(filename);
-    if (!file.is_open()) {
+    // Map the file; the lexer works on the mapping directly
+    MappedFile file(filename);
+    if (!file.isOpen()) {
         throw std::runtime_error("Failed to open shader file: " + filename);
     }
     
-    // Read entire file into string
-    std::stringstream buffer;
-    buffer << file.rdbuf();
-    std::string source = buffer.str();
-    
-    file.close();
+    std::string_view source = file.contents();
     
     if (source.empty()) {
         throw std::runtime_error("Shader file is empty: " + filename);
@@ -197,6 +361,247 @@ std::vector<uint32_t> ShaderCompiler::compileFromFile(const std::string& filenam
     return compile(source, shaderType);
 }
 
+namespace {
+
+// Part of a permutation's cache key: everything that changes its code
+std::string permutationSignature(const ShaderPermutation& permutation) {
+    std::string signature = "constants=";
+    for (const auto& constant : permutation.constants) {
+        signature += constant.first + "=" + constant.second + ",";
+    }
+    return signature;
+}
+
+// Replace reads of the baked constants with literals
+void substituteConstants(AstArena& arena, ASTNode*& node,
+                         const std::unordered_map<std::string_view, std::string_view>& values) {
+    switch (node->type) {
+        case ASTNodeType::IDENTIFIER: {
+            auto it = values.find(static_cast<IdentifierNode*>(node)->name);
+            if (it != values.end()) {
+                auto* literal = arena.create<LiteralNode>();
+                literal->value = it->second;
+                node = literal;
+            }
+            break;
+        }
+        case ASTNodeType::BINARY_OP:
+            for (auto& operand : static_cast<BinaryOpNode*>(node)->operands) {
+                substituteConstants(arena, operand, values);
+            }
+            break;
+        case ASTNodeType::MEMBER_ACCESS:
+            substituteConstants(arena, static_cast<MemberAccessNode*>(node)->object, values);
+            break;
+        case ASTNodeType::FUNCTION_CALL:
+            for (auto& arg : static_cast<FunctionCallNode*>(node)->arguments) {
+                substituteConstants(arena, arg, values);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+// Turn the constants a permutation sets into literals in a copy of the
+// shader; the rest keep their constant_id, so pipelines created for the
+// unbaked shader specialize every variant the same way
+void bakeConstants(AstArena& arena, ShaderDeclNode* shader, const ShaderPermutation& permutation) {
+    std::unordered_map<std::string_view, std::string_view> values;
+    
+    for (const auto& setting : permutation.constants) {
+        auto it = std::find_if(shader->constants.begin(), shader->constants.end(), [&](const ASTNode* node) {
+            return static_cast<const SpecConstantNode*>(node)->name == setting.first;
+        });
+        if (it == shader->constants.end()) {
+            throw std::runtime_error("Permutation '" + permutation.name + "' sets unknown constant '" +
+                                     setting.first + "'");
+        }
+        auto* constant = static_cast<const SpecConstantNode*>(*it);
+        
+        // Literals keep the constant's type: 1 becomes 1.0 for a float
+        const std::string& value = setting.second;
+        char* end = nullptr;
+        std::strtod(value.c_str(), &end);
+        bool isInteger = value.find_first_of(".eE") == std::string::npos;
+        if (value.empty() || *end != '\0' || (constant->varType == "int" && !isInteger)) {
+            throw std::runtime_error("Permutation '" + permutation.name + "' sets " + 
+                                     std::string(constant->varType) + " constant '" + setting.first + 
+                                     "' to invalid value '" + value + "'");
+        }
+        std::string literal = (constant->varType == "float" && isInteger) ? value + ".0" : value;
+        
+        values[constant->name] = arena.intern(literal);
+        shader->constants.erase(it);
+    }
+    
+    for (auto* stmt : shader->statements) {
+        if (stmt->type != ASTNodeType::ASSIGNMENT) {
+            continue;
+        }
+        auto* assign = static_cast<AssignmentNode*>(stmt);
+        
+        const ASTNode* target = assign->target;
+        if (target->type == ASTNodeType::MEMBER_ACCESS) {
+            target = static_cast<const MemberAccessNode*>(target)->object;
+        }
+        if (target->type == ASTNodeType::IDENTIFIER &&
+            values.count(static_cast<const IdentifierNode*>(target)->name)) {
+            throw std::runtime_error("Cannot assign to specialization constant '" +
+                                     std::string(static_cast<const IdentifierNode*>(target)->name) + "'");
+        }
+        
+        substituteConstants(arena, assign->value, values);
+    }
+}
+
+} // namespace
+
+std::vector<std::vector<uint32_t>> ShaderCompiler::compilePermutations(
+    std::string_view source, const std::string& shaderType, const std::vector<ShaderPermutation>& permutations) {
+    resetStats();
+    validateShaderType(shaderType);
+    
+    double totalStartTime = getCurrentTimeMs();
+    CompileTrace::Scope compileSpan(trace, "compile-permutations", "compile", shaderType);
+    std::vector<std::vector<uint32_t>> results(permutations.size());
+    
+    // Every permutation is cached on its own; the source is only parsed
+    // when at least one of them misses
+    std::vector<ShaderCache::Key> cacheKeys(permutations.size());
+    std::vector<size_t> misses;
+    for (size_t i = 0; i < permutations.size(); i++) {
+        if (!cache && !memoryCache) {
+            misses.push_back(i);
+            continue;
+        }
+        
+        cacheKeys[i] = ShaderCache::makeKey(source, shaderType,
+                                            optionsSignature() + ";" + permutationSignature(permutations[i]));
+        
+        bool memoryHit = memoryCache && memoryCache->load(cacheKeys[i], results[i]);
+        if (memoryHit || (cache && cache->load(cacheKeys[i], results[i]))) {
+            if (!memoryHit && memoryCache) {
+                memoryCache->store(cacheKeys[i], results[i]);
+            }
+            stats.cacheHits++;
+            stats.memoryCacheHits += memoryHit ? 1 : 0;
+            stats.spirvSizeBytes += results[i].size() * sizeof(uint32_t);
+            stats.spirvInstructionCount += results[i].size();
+            stats.originalSpirvSizeBytes += results[i].size() * sizeof(uint32_t);
+            stats.originalSpirvInstructionCount += results[i].size();
+            logVerbose("Permutation '" + permutations[i].name + "': cache hit");
+        } else {
+            stats.cacheMisses++;
+            misses.push_back(i);
+        }
+    }
+    
+    if (!misses.empty()) {
+        try {
+            ProgramNode* ast = parseSource(source);
+            
+            // Reported as code generation, like the same errors from a single compile
+            currentStage = ShaderCompilationError::Stage::CODE_GENERATION;
+            const ShaderDeclNode* shader = nullptr;
+            for (const auto* decl : ast->declarations) {
+                if (decl->type == ASTNodeType::SHADER_DECL &&
+                    static_cast<const ShaderDeclNode*>(decl)->shaderType == shaderType) {
+                    shader = static_cast<const ShaderDeclNode*>(decl);
+                }
+            }
+            if (!shader) {
+                throw std::runtime_error("No shader declaration found for type: " + shaderType);
+            }
+            
+            // The parsed shader is never modified: each permutation bakes and
+            // optimizes its own copy, allocated in the same arena
+            for (size_t i : misses) {
+                CompileTrace::Scope permutationSpan(trace, "permutation", "compile", permutations[i].name);
+                currentStage = ShaderCompilationError::Stage::CODE_GENERATION;
+                auto* variant = arena->create<ProgramNode>();
+                auto* copy = static_cast<ShaderDeclNode*>(cloneAST(*arena, shader));
+                bakeConstants(*arena, copy, permutations[i]);
+                variant->declarations.push_back(*arena, copy);
+                
+                logVerbose("Permutation '" + permutations[i].name + "'...");
+                results[i] = optimizeAndGenerate(variant, shaderType);
+                
+                if (cache && !cache->store(cacheKeys[i], results[i])) {
+                    logVerbose("Warning: failed to write cache entry to " + cache->getDirectory());
+                }
+                if (memoryCache) {
+                    memoryCache->store(cacheKeys[i], results[i]);
+                }
+            }
+        } catch (const std::runtime_error& e) {
+            ShaderCompilationError::rethrow(currentStage, e);
+        }
+    }
+    
+    stats.totalTimeMs = getCurrentTimeMs() - totalStartTime;
+    logVerbose("Compiled " + std::to_string(permutations.size()) + " permutations (" +
+               std::to_string(misses.size()) + " generated) in " + std::to_string(stats.totalTimeMs) + " ms");
+    
+    return results;
+}
+
+std::vector<std::vector<uint32_t>> ShaderCompiler::compilePermutationsFromFile(
+    const std::string& filename, const std::string& shaderType, const std::vector<ShaderPermutation>& permutations) {
+    logVerbose("Loading shader from file: " + filename);
+    
+    MappedFile file(filename);
+    if (!file.isOpen()) {
+        throw std::runtime_error("Failed to open shader file: " + filename);
+    }
+    if (file.contents().empty()) {
+        throw std::runtime_error("Shader file is empty: " + filename);
+    }
+    
+    return compilePermutations(file.contents(), shaderType, permutations);
+}
+
+std::vector<ShaderPermutation> ShaderCompiler::parsePermutationFile(const std::string& filename) {
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open permutation file: " + filename);
+    }
+    
+    std::vector<ShaderPermutation> permutations;
+    std::string line;
+    int lineNumber = 0;
+    
+    while (std::getline(file, line)) {
+        lineNumber++;
+        
+        std::istringstream fields(line);
+        ShaderPermutation permutation;
+        if (!(fields >> permutation.name) || permutation.name[0] == '#') {
+            continue;
+        }
+        
+        std::string setting;
+        while (fields >> setting) {
+            size_t equals = setting.find('=');
+            if (equals == 0 || equals == std::string::npos || equals + 1 == setting.size()) {
+                throw std::runtime_error(filename + ":" + std::to_string(lineNumber) +
+                                         ": expected CONSTANT=value, got '" + setting + "'");
+            }
+            permutation.constants.emplace_back(setting.substr(0, equals), setting.substr(equals + 1));
+        }
+        
+        for (const auto& existing : permutations) {
+            if (existing.name == permutation.name) {
+                throw std::runtime_error(filename + ":" + std::to_string(lineNumber) +
+                                         ": duplicate permutation '" + permutation.name + "'");
+            }
+        }
+        permutations.push_back(std::move(permutation));
+    }
+    
+    return permutations;
+}
+
 void ShaderCompiler::resetStats() {
     stats = CompilationStats();
     generatedGLSL.clear();
@@ -208,6 +613,15 @@ bool ShaderCompiler::isValidShaderType(const std::string& shaderType) {
 
 // Private helper methods
 
+std::string ShaderCompiler::optionsSignature() const {
+    // Everything except the source and shader type that changes the output
+    return std::string("version=") + version() +
+           ";build=" + buildSignature() +
+           ";opt=" + (optimizationEnabled ? "1" : "0") +
+           ";backend=" + CodeGenerator::backendName(backend) +
+           ";spirvopt=" + (spirvOptimizationEnabled ? "1" : "0");
+}
+
 void ShaderCompiler::logVerbose(const std::string& message) {
     if (verbose) {
         std::cout << "[ShaderCompiler] " << message << std::endl;
@@ -227,49 +641,51 @@ size_t ShaderCompiler::countASTNodes(const ProgramNode* ast) {
     
     size_t count = 1; // Count the program node itself
     
-    // Count nodes recursively
-    std::function<void(const ASTNode*)> countNode = [&](const ASTNode* node) {
-        if (!node) return;
-        
-        count++;
-        
-        switch (node->type) {
-            case ASTNodeType::SHADER_DECL: {
-                auto* shader = static_cast<const ShaderDeclNode*>(node);
-                for (auto& input : shader->inputs) countNode(input.get());
-                for (auto& output : shader->outputs) countNode(output.get());
-                for (auto& stmt : shader->statements) countNode(stmt.get());
-                break;
-            }
-            case ASTNodeType::ASSIGNMENT: {
-                auto* assign = static_cast<const AssignmentNode*>(node);
-                countNode(assign->target.get());
-                countNode(assign->value.get());
-                break;
-            }
-            case ASTNodeType::BINARY_OP: {
-                auto* binOp = static_cast<const BinaryOpNode*>(node);
-                countNode(binOp->left.get());
-                countNode(binOp->right.get());
-                break;
-            }
-            case ASTNodeType::MEMBER_ACCESS: {
-                auto* member = static_cast<const MemberAccessNode*>(node);
-                countNode(member->object.get());
-                break;
-            }
-            case ASTNodeType::FUNCTION_CALL: {
-                auto* funcCall = static_cast<const FunctionCallNode*>(node);
-                for (auto& arg : funcCall->arguments) countNode(arg.get());
-                break;
-            }
-            default:
-                break;
-        }
-    };
+    for (auto* decl : ast->declarations) {
+        count += countNodes(decl);
+    }
+    
+    return count;
+}
+
+size_t ShaderCompiler::countNodes(const ASTNode* node) {
+    if (!node) return 0;
     
-    for (auto& decl : ast->declarations) {
-        countNode(decl.get());
+    size_t count = 1;
+    
+    switch (node->type) {
+        case ASTNodeType::SHADER_DECL: {
+            auto* shader = static_cast<const ShaderDeclNode*>(node);
+            for (auto* input : shader->inputs) count += countNodes(input);
+            for (auto* output : shader->outputs) count += countNodes(output);
+            for (auto* uniform : shader->uniforms) count += countNodes(uniform);
+            for (auto* constant : shader->constants) count += countNodes(constant);
+            for (auto* stmt : shader->statements) count += countNodes(stmt);
+            break;
+        }
+        case ASTNodeType::ASSIGNMENT: {
+            auto* assign = static_cast<const AssignmentNode*>(node);
+            count += countNodes(assign->target);
+            count += countNodes(assign->value);
+            break;
+        }
+        case ASTNodeType::BINARY_OP: {
+            auto* binOp = static_cast<const BinaryOpNode*>(node);
+            for (auto* operand : binOp->operands) count += countNodes(operand);
+            break;
+        }
+        case ASTNodeType::MEMBER_ACCESS: {
+            auto* member = static_cast<const MemberAccessNode*>(node);
+            count += countNodes(member->object);
+            break;
+        }
+        case ASTNodeType::FUNCTION_CALL: {
+            auto* funcCall = static_cast<const FunctionCallNode*>(node);
+            for (auto* arg : funcCall->arguments) count += countNodes(arg);
+            break;
+        }
+        default:
+            break;
     }
     
     return count;
@@ -280,9 +696,9 @@ size_t ShaderCompiler::countStatements(const ProgramNode* ast) {
     
     size_t count = 0;
     
-    for (auto& decl : ast->declarations) {
+    for (auto* decl : ast->declarations) {
         if (decl->type == ASTNodeType::SHADER_DECL) {
-            auto* shader = static_cast<const ShaderDeclNode*>(decl.get());
+            auto* shader = static_cast<const ShaderDeclNode*>(decl);
             count += shader->statements.size();
         }
     }
@@ -291,7 +707,8 @@ size_t ShaderCompiler::countStatements(const ProgramNode* ast) {
 }
 
 double ShaderCompiler::getCurrentTimeMs() {
-    auto now = std::chrono::high_resolution_clock::now();
+    // Monotonic: high_resolution_clock may follow wall-clock adjustments
+    auto now = std::chrono::steady_clock::now();
     auto duration = now.time_since_epoch();
     return std::chrono::duration<double, std::milli>(duration).count();
 }
\ No newline at end of file
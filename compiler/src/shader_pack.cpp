@@ -0,0 +1,306 @@
+#include "shader_pack.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+using Format = ShaderPackFormat;
+
+size_t alignUp(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+// Strings section under construction
+class StringTable {
+public:
+    uint32_t add(const std::string& text) {
+        uint32_t offset = static_cast<uint32_t>(data.size());
+        data.append(text);
+        data.push_back('\0');
+        return offset;
+    }
+
+    const std::string& contents() const { return data; }
+
+private:
+    std::string data;
+};
+
+Format::Interface makeInterface(uint32_t kind, uint32_t nameOffset, uint32_t index) {
+    Format::Interface record{};
+    record.kind = kind;
+    record.nameOffset = nameOffset;
+    record.index = index;
+    return record;
+}
+
+}
+
+void ShaderPackWriter::add(const std::string& name, std::vector<uint32_t> spirv) {
+    for (const auto& module : modules) {
+        if (module.name == name) {
+            throw std::runtime_error("Duplicate shader '" + name + "' in pack");
+        }
+    }
+
+    Module module;
+    module.name = name;
+    module.reflection = ShaderReflection::fromSpirv(spirv.data(), spirv.size());
+    module.spirv = std::move(spirv);
+    modules.push_back(std::move(module));
+}
+
+void ShaderPackWriter::write(const std::string& path) const {
+    // Entries are sorted so the reader can binary search the mapping
+    std::vector<const Module*> sorted;
+    for (const auto& module : modules) {
+        sorted.push_back(&module);
+    }
+    std::sort(sorted.begin(), sorted.end(), [](const Module* a, const Module* b) { return a->name < b->name; });
+
+    StringTable strings;
+    std::vector<Format::Entry> entries;
+    std::vector<Format::Interface> interfaces;
+    for (const Module* module : sorted) {
+        const ShaderReflection& reflection = module->reflection;
+
+        Format::Entry entry{};
+        entry.nameOffset = strings.add(module->name);
+        entry.entryPointOffset = strings.add(reflection.entryPoint);
+        entry.stage = static_cast<uint32_t>(reflection.stage);
+        entry.codeWords = static_cast<uint32_t>(module->spirv.size());
+        entry.firstInterface = static_cast<uint32_t>(interfaces.size());
+
+        for (uint32_t kind = Format::INPUT; kind <= Format::OUTPUT; kind++) {
+            const auto& variables = kind == Format::INPUT ? reflection.inputs : reflection.outputs;
+            for (const auto& variable : variables) {
+                Format::Interface record = makeInterface(kind, strings.add(variable.name), variable.location);
+                record.type = static_cast<uint32_t>(variable.type);
+                record.components = variable.components;
+                record.columns = variable.columns;
+                interfaces.push_back(record);
+            }
+        }
+        for (const auto& block : reflection.uniformBlocks) {
+            Format::Interface record = makeInterface(Format::UNIFORM_BLOCK, strings.add(block.name), block.binding);
+            record.set = block.set;
+            record.value = block.sizeBytes;
+            interfaces.push_back(record);
+        }
+        for (const auto& constant : reflection.specConstants) {
+            Format::Interface record = makeInterface(Format::SPEC_CONSTANT, strings.add(constant.name), constant.id);
+            record.type = static_cast<uint32_t>(constant.type);
+            record.value = constant.defaultBits;
+            interfaces.push_back(record);
+        }
+
+        entry.interfaceCount = static_cast<uint32_t>(interfaces.size()) - entry.firstInterface;
+        entries.push_back(entry);
+    }
+
+    Format::Header header{};
+    header.magic = Format::MAGIC;
+    header.version = Format::VERSION;
+    header.entryCount = static_cast<uint32_t>(entries.size());
+    header.interfaceCount = static_cast<uint32_t>(interfaces.size());
+    header.stringsOffset = static_cast<uint32_t>(sizeof(Format::Header) + entries.size() * sizeof(Format::Entry) +
+                                                 interfaces.size() * sizeof(Format::Interface));
+    header.stringsSize = static_cast<uint32_t>(strings.contents().size());
+
+    size_t codeOffset = alignUp(header.stringsOffset + header.stringsSize, sizeof(uint32_t));
+    header.codeOffset = static_cast<uint32_t>(codeOffset);
+    for (size_t i = 0; i < entries.size(); i++) {
+        entries[i].codeOffset = static_cast<uint32_t>(codeOffset);
+        codeOffset += sorted[i]->spirv.size() * sizeof(uint32_t);
+    }
+    if (codeOffset > UINT32_MAX) {
+        throw std::runtime_error("Shader pack " + path + " would exceed 4 GB");
+    }
+    header.fileSize = static_cast<uint32_t>(codeOffset);
+
+    std::string tempPath = path + ".tmp." + std::to_string(getpid());
+    {
+        std::ofstream file(tempPath, std::ios::binary);
+        if (!file.is_open()) {
+            throw std::runtime_error("Failed to open output file: " + tempPath);
+        }
+
+        static const char padding[sizeof(uint32_t)] = {};
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(Format::Entry));
+        file.write(reinterpret_cast<const char*>(interfaces.data()), interfaces.size() * sizeof(Format::Interface));
+        file.write(strings.contents().data(), strings.contents().size());
+        file.write(padding, header.codeOffset - (header.stringsOffset + header.stringsSize));
+        for (const Module* module : sorted) {
+            file.write(reinterpret_cast<const char*>(module->spirv.data()), module->spirv.size() * sizeof(uint32_t));
+        }
+
+        if (!file) {
+            file.close();
+            std::remove(tempPath.c_str());
+            throw std::runtime_error("Failed to write output file: " + path);
+        }
+    }
+
+    if (std::rename(tempPath.c_str(), path.c_str()) != 0) {
+        std::remove(tempPath.c_str());
+        throw std::runtime_error("Failed to write output file: " + path);
+    }
+}
+
+ShaderPack::~ShaderPack() {
+    close();
+}
+
+void ShaderPack::open(const std::string& path) {
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to open shader pack: " + path);
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size < static_cast<off_t>(sizeof(Format::Header))) {
+        ::close(fd);
+        throw std::runtime_error("Invalid shader pack " + path + ": file is shorter than its header");
+    }
+    void* mapped = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        throw std::runtime_error("Failed to map shader pack: " + path);
+    }
+    data = static_cast<const char*>(mapped);
+    mappedSize = static_cast<size_t>(info.st_size);
+
+    auto invalid = [&](const std::string& reason) {
+        close();
+        throw std::runtime_error("Invalid shader pack " + path + ": " + reason);
+    };
+
+    header = reinterpret_cast<const Format::Header*>(data);
+    if (header->magic != Format::MAGIC) invalid("bad magic number");
+    if (header->version != Format::VERSION) {
+        invalid("format version " + std::to_string(header->version) + ", expected " +
+                std::to_string(Format::VERSION));
+    }
+    if (header->fileSize != mappedSize) invalid("file size does not match its header");
+
+    // Sizes are checked in 64 bits, so corrupt counts cannot wrap around
+    uint64_t tablesEnd = sizeof(Format::Header) + uint64_t(header->entryCount) * sizeof(Format::Entry) +
+                         uint64_t(header->interfaceCount) * sizeof(Format::Interface);
+    uint64_t stringsEnd = uint64_t(header->stringsOffset) + header->stringsSize;
+    if (tablesEnd > header->stringsOffset || stringsEnd > header->codeOffset || header->codeOffset > mappedSize) {
+        invalid("sections overlap or run past the end of the file");
+    }
+    if (header->stringsSize != 0 && data[stringsEnd - 1] != '\0') invalid("unterminated string section");
+
+    entries = reinterpret_cast<const Format::Entry*>(data + sizeof(Format::Header));
+    interfaces = reinterpret_cast<const Format::Interface*>(entries + header->entryCount);
+
+    modules.reserve(header->entryCount);
+    for (uint32_t i = 0; i < header->entryCount; i++) {
+        const Format::Entry& entry = entries[i];
+        uint64_t codeEnd = uint64_t(entry.codeOffset) + uint64_t(entry.codeWords) * sizeof(uint32_t);
+        if (entry.nameOffset >= header->stringsSize || entry.entryPointOffset >= header->stringsSize) {
+            invalid("entry " + std::to_string(i) + " names a string outside the string section");
+        }
+        if (entry.codeOffset < header->codeOffset || entry.codeOffset % sizeof(uint32_t) != 0 ||
+            codeEnd > mappedSize) {
+            invalid("entry " + std::to_string(i) + " has its code outside the code section");
+        }
+        if (uint64_t(entry.firstInterface) + entry.interfaceCount > header->interfaceCount) {
+            invalid("entry " + std::to_string(i) + " refers past the interface table");
+        }
+
+        Module module;
+        module.name = string(entry.nameOffset);
+        module.stage = static_cast<ShaderReflection::Stage>(entry.stage);
+        module.code = reinterpret_cast<const uint32_t*>(data + entry.codeOffset);
+        module.wordCount = entry.codeWords;
+        if (!modules.empty() && !(modules.back().name < module.name)) {
+            invalid("entries are not sorted by name");
+        }
+        modules.push_back(module);
+    }
+
+    for (uint32_t i = 0; i < header->interfaceCount; i++) {
+        if (interfaces[i].nameOffset >= header->stringsSize) {
+            invalid("interface record " + std::to_string(i) + " names a string outside the string section");
+        }
+    }
+}
+
+void ShaderPack::close() {
+    if (data) {
+        munmap(const_cast<char*>(data), mappedSize);
+    }
+    data = nullptr;
+    mappedSize = 0;
+    header = nullptr;
+    entries = nullptr;
+    interfaces = nullptr;
+    modules.clear();
+}
+
+size_t ShaderPack::find(std::string_view name) const {
+    auto it = std::lower_bound(modules.begin(), modules.end(), name,
+                               [](const Module& module, std::string_view key) { return module.name < key; });
+    return it != modules.end() && it->name == name ? static_cast<size_t>(it - modules.begin()) : modules.size();
+}
+
+ShaderReflection ShaderPack::reflection(size_t index) const {
+    const Format::Entry& entry = entries[index];
+
+    ShaderReflection reflection;
+    reflection.stage = static_cast<ShaderReflection::Stage>(entry.stage);
+    reflection.entryPoint = string(entry.entryPointOffset);
+
+    for (uint32_t i = entry.firstInterface; i < entry.firstInterface + entry.interfaceCount; i++) {
+        const Format::Interface& record = interfaces[i];
+        switch (record.kind) {
+            case Format::INPUT:
+            case Format::OUTPUT: {
+                ShaderReflection::Variable variable;
+                variable.name = string(record.nameOffset);
+                variable.location = record.index;
+                variable.type = static_cast<ShaderReflection::ScalarType>(record.type);
+                variable.components = record.components;
+                variable.columns = record.columns;
+                (record.kind == Format::INPUT ? reflection.inputs : reflection.outputs).push_back(variable);
+                break;
+            }
+            case Format::UNIFORM_BLOCK: {
+                ShaderReflection::UniformBlock block;
+                block.name = string(record.nameOffset);
+                block.set = record.set;
+                block.binding = record.index;
+                block.sizeBytes = record.value;
+                reflection.uniformBlocks.push_back(block);
+                break;
+            }
+            case Format::SPEC_CONSTANT: {
+                ShaderReflection::SpecConstant constant;
+                constant.name = string(record.nameOffset);
+                constant.id = record.index;
+                constant.type = static_cast<ShaderReflection::ScalarType>(record.type);
+                constant.defaultBits = record.value;
+                reflection.specConstants.push_back(constant);
+                break;
+            }
+            default:
+                break;  // Written by a newer compiler; skipped
+        }
+    }
+    return reflection;
+}
+
+const char* ShaderPack::string(uint32_t offset) const {
+    return data + header->stringsOffset + offset;
+}
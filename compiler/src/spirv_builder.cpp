@@ -0,0 +1,204 @@
+#include "spirv_builder.h"
+#include <cstring>
+
+SpirvModuleBuilder::SpirvModuleBuilder() {}
+
+void SpirvModuleBuilder::addCapability(uint32_t capability) {
+    appendInstruction(capabilities, OpCapability, {capability});
+}
+
+void SpirvModuleBuilder::setMemoryModel(uint32_t addressing, uint32_t memory) {
+    memoryModel.clear();
+    appendInstruction(memoryModel, OpMemoryModel, {addressing, memory});
+}
+
+void SpirvModuleBuilder::addEntryPoint(uint32_t executionModel, uint32_t function, const std::string& name,
+                                       const std::vector<uint32_t>& interface) {
+    std::vector<uint32_t> operands = {executionModel, function};
+    appendString(operands, name);
+    operands.insert(operands.end(), interface.begin(), interface.end());
+    appendInstruction(entryPoints, OpEntryPoint, operands);
+}
+
+void SpirvModuleBuilder::addExecutionMode(uint32_t function, uint32_t mode) {
+    appendInstruction(executionModes, OpExecutionMode, {function, mode});
+}
+
+void SpirvModuleBuilder::addName(uint32_t target, const std::string& name) {
+    std::vector<uint32_t> operands = {target};
+    appendString(operands, name);
+    appendInstruction(debugNames, OpName, operands);
+}
+
+void SpirvModuleBuilder::addDecoration(uint32_t target, uint32_t decoration, const std::vector<uint32_t>& operands) {
+    std::vector<uint32_t> words = {target, decoration};
+    words.insert(words.end(), operands.begin(), operands.end());
+    appendInstruction(annotations, OpDecorate, words);
+}
+
+void SpirvModuleBuilder::addMemberName(uint32_t structType, uint32_t member, const std::string& name) {
+    std::vector<uint32_t> operands = {structType, member};
+    appendString(operands, name);
+    appendInstruction(debugNames, OpMemberName, operands);
+}
+
+void SpirvModuleBuilder::addMemberDecoration(uint32_t structType, uint32_t member, uint32_t decoration,
+                                             const std::vector<uint32_t>& operands) {
+    std::vector<uint32_t> words = {structType, member, decoration};
+    words.insert(words.end(), operands.begin(), operands.end());
+    appendInstruction(annotations, OpMemberDecorate, words);
+}
+
+uint32_t SpirvModuleBuilder::typeVoid() {
+    return internGlobal(OpTypeVoid, {});
+}
+
+uint32_t SpirvModuleBuilder::typeFloat() {
+    return internGlobal(OpTypeFloat, {32});
+}
+
+uint32_t SpirvModuleBuilder::typeInt() {
+    return internGlobal(OpTypeInt, {32, 1});
+}
+
+uint32_t SpirvModuleBuilder::typeVector(uint32_t componentType, uint32_t count) {
+    return internGlobal(OpTypeVector, {componentType, count});
+}
+
+uint32_t SpirvModuleBuilder::typeMatrix(uint32_t columnType, uint32_t columns) {
+    return internGlobal(OpTypeMatrix, {columnType, columns});
+}
+
+uint32_t SpirvModuleBuilder::typePointer(uint32_t storageClass, uint32_t pointee) {
+    return internGlobal(OpTypePointer, {storageClass, pointee});
+}
+
+uint32_t SpirvModuleBuilder::typeFunction(uint32_t returnType, const std::vector<uint32_t>& params) {
+    std::vector<uint32_t> operands = {returnType};
+    operands.insert(operands.end(), params.begin(), params.end());
+    return internGlobal(OpTypeFunction, operands);
+}
+
+uint32_t SpirvModuleBuilder::typeStruct(const std::vector<uint32_t>& members) {
+    uint32_t id = newId();
+    std::vector<uint32_t> words = {id};
+    words.insert(words.end(), members.begin(), members.end());
+    appendInstruction(globals, OpTypeStruct, words);
+    return id;
+}
+
+uint32_t SpirvModuleBuilder::constantFloat(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return internGlobal(OpConstant, {typeFloat(), bits});
+}
+
+uint32_t SpirvModuleBuilder::constantInt(int32_t value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return internGlobal(OpConstant, {typeInt(), bits});
+}
+
+uint32_t SpirvModuleBuilder::specConstant(uint32_t type, uint32_t defaultBits) {
+    uint32_t id = newId();
+    appendInstruction(globals, OpSpecConstant, {type, id, defaultBits});
+    return id;
+}
+
+uint32_t SpirvModuleBuilder::globalVariable(uint32_t pointerType, uint32_t storageClass) {
+    uint32_t id = newId();
+    appendInstruction(globals, OpVariable, {pointerType, id, storageClass});
+    return id;
+}
+
+void SpirvModuleBuilder::beginFunction(uint32_t function, uint32_t returnType, uint32_t functionType) {
+    functionHeader.clear();
+    functionVariables.clear();
+    functionBody.clear();
+    appendInstruction(functionHeader, OpFunction, {returnType, function, FunctionControlNone, functionType});
+    appendInstruction(functionHeader, OpLabel, {newId()});
+}
+
+uint32_t SpirvModuleBuilder::localVariable(uint32_t pointerType) {
+    uint32_t id = newId();
+    appendInstruction(functionVariables, OpVariable, {pointerType, id, StorageClassFunction});
+    return id;
+}
+
+uint32_t SpirvModuleBuilder::emit(Op op, uint32_t resultType, const std::vector<uint32_t>& operands) {
+    uint32_t id = newId();
+    std::vector<uint32_t> words = {resultType, id};
+    words.insert(words.end(), operands.begin(), operands.end());
+    appendInstruction(functionBody, op, words);
+    return id;
+}
+
+void SpirvModuleBuilder::emitVoid(Op op, const std::vector<uint32_t>& operands) {
+    appendInstruction(functionBody, op, operands);
+}
+
+void SpirvModuleBuilder::endFunction() {
+    appendInstruction(functionBody, OpReturn, {});
+    appendInstruction(functionBody, OpFunctionEnd, {});
+}
+
+std::vector<uint32_t> SpirvModuleBuilder::finish() const {
+    std::vector<uint32_t> module = {
+        MagicNumber,
+        Version_1_0,
+        0,      // Generator
+        nextId, // Bound
+        0       // Schema
+    };
+
+    for (const auto* section : {&capabilities, &memoryModel, &entryPoints, &executionModes,
+                                &debugNames, &annotations, &globals,
+                                &functionHeader, &functionVariables, &functionBody}) {
+        module.insert(module.end(), section->begin(), section->end());
+    }
+
+    return module;
+}
+
+void SpirvModuleBuilder::appendString(std::vector<uint32_t>& words, const std::string& str) {
+    // Characters are packed little-endian, at least one nul terminator
+    size_t wordCount = str.size() / 4 + 1;
+    size_t base = words.size();
+    words.resize(base + wordCount, 0);
+    for (size_t i = 0; i < str.size(); ++i) {
+        words[base + i / 4] |= static_cast<uint32_t>(static_cast<unsigned char>(str[i])) << (8 * (i % 4));
+    }
+}
+
+void SpirvModuleBuilder::appendInstruction(std::vector<uint32_t>& section, Op op,
+                                           const std::vector<uint32_t>& operands) {
+    uint32_t wordCount = static_cast<uint32_t>(operands.size() + 1);
+    section.push_back((wordCount << 16) | op);
+    section.insert(section.end(), operands.begin(), operands.end());
+}
+
+uint32_t SpirvModuleBuilder::internGlobal(Op op, const std::vector<uint32_t>& operands) {
+    std::vector<uint32_t> key = {op};
+    key.insert(key.end(), operands.begin(), operands.end());
+
+    auto it = internedGlobals.find(key);
+    if (it != internedGlobals.end()) {
+        return it->second;
+    }
+
+    uint32_t id = newId();
+    std::vector<uint32_t> words;
+    if (op == OpConstant) {
+        // OpConstant: <result type> <result id> <value>
+        words = {operands[0], id};
+        words.insert(words.end(), operands.begin() + 1, operands.end());
+    } else {
+        // Types: <result id> <operands...>
+        words = {id};
+        words.insert(words.end(), operands.begin(), operands.end());
+    }
+    appendInstruction(globals, op, words);
+
+    internedGlobals[key] = id;
+    return id;
+}
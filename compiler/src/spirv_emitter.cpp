@@ -0,0 +1,624 @@
+#include "spirv_emitter.h"
+#include <cstring>
+#include <stdexcept>
+
+using Op = SpirvModuleBuilder::Op;
+
+SpirvEmitter::SpirvEmitter() {}
+
+std::vector<uint32_t> SpirvEmitter::emit(const ShaderDeclNode* shader) {
+    shaderType = shader->shaderType;
+
+    builder.addCapability(SpirvModuleBuilder::CapabilityShader);
+    builder.setMemoryModel(SpirvModuleBuilder::AddressingLogical, SpirvModuleBuilder::MemoryModelGLSL450);
+
+    // Global interface variables
+    declareInterface(shader);
+
+    // Entry point
+    uint32_t voidType = builder.typeVoid();
+    uint32_t mainFunction = builder.newId();
+    builder.addName(mainFunction, "main");
+    builder.beginFunction(mainFunction, voidType, builder.typeFunction(voidType));
+
+    // Locals are assigned without a declaration in the DSL; infer their
+    // types up front so every OpVariable lands in the entry block
+    declareLocals(shader->statements);
+
+    for (const auto* stmt : shader->statements) {
+        emitStatement(stmt);
+    }
+
+    builder.endFunction();
+
+    uint32_t executionModel = shaderType == "vertex" ? SpirvModuleBuilder::ExecutionModelVertex
+                                                     : SpirvModuleBuilder::ExecutionModelFragment;
+    builder.addEntryPoint(executionModel, mainFunction, "main", interfaceVariables);
+
+    if (shaderType == "fragment") {
+        builder.addExecutionMode(mainFunction, SpirvModuleBuilder::ExecutionModeOriginUpperLeft);
+    }
+
+    return builder.finish();
+}
+
+void SpirvEmitter::declareInterface(const ShaderDeclNode* shader) {
+    resolver.declareShaderInterface(shader);
+
+    // Locations are assigned in declaration order, matching the GLSL path
+    uint32_t location = 0;
+    for (const auto* input : shader->inputs) {
+        if (input->type == ASTNodeType::VARIABLE_DECL) {
+            auto* varDecl = static_cast<const VariableDeclNode*>(input);
+            uint32_t id = declareGlobal(varDecl->name, ValueType::fromName(varDecl->varType),
+                                        SpirvModuleBuilder::StorageClassInput);
+            builder.addDecoration(id, SpirvModuleBuilder::DecorationLocation, {location++});
+        }
+    }
+
+    location = 0;
+    for (const auto* output : shader->outputs) {
+        if (output->type == ASTNodeType::VARIABLE_DECL) {
+            auto* varDecl = static_cast<const VariableDeclNode*>(output);
+            uint32_t id = declareGlobal(varDecl->name, ValueType::fromName(varDecl->varType),
+                                        SpirvModuleBuilder::StorageClassOutput);
+            builder.addDecoration(id, SpirvModuleBuilder::DecorationLocation, {location++});
+        }
+    }
+    if (TypeResolver::writesFragColor(shader)) {
+        uint32_t id = declareGlobal("gl_FragColor", ValueType::vector(4), SpirvModuleBuilder::StorageClassOutput);
+        builder.addDecoration(id, SpirvModuleBuilder::DecorationLocation, {location++});
+    }
+
+    declareUniformBlock(shader->uniforms);
+    declareSpecConstants(shader->constants);
+
+    if (shaderType == "vertex") {
+        uint32_t id = declareGlobal("gl_Position", ValueType::vector(4), SpirvModuleBuilder::StorageClassOutput);
+        builder.addDecoration(id, SpirvModuleBuilder::DecorationBuiltIn, {SpirvModuleBuilder::BuiltInPosition});
+    }
+}
+
+uint32_t SpirvEmitter::declareGlobal(std::string_view name, ValueType type, uint32_t storageClass) {
+    if (!type.isValid()) {
+        throw std::runtime_error("Unsupported type for variable '" + std::string(name) + "'");
+    }
+
+    uint32_t id = builder.globalVariable(builder.typePointer(storageClass, typeId(type)), storageClass);
+    builder.addName(id, std::string(name));
+    variables[name] = {id, type, storageClass};
+    interfaceVariables.push_back(id);
+    return id;
+}
+
+void SpirvEmitter::declareUniformBlock(const NodeList& uniforms) {
+    if (uniforms.empty()) {
+        return;
+    }
+
+    // std140 layout: scalars and vec2 align to their size, vec3/vec4 to 16
+    // bytes, matrices are arrays of vec4-aligned columns
+    std::vector<uint32_t> memberTypes;
+    std::vector<uint32_t> offsets;
+    std::vector<const VariableDeclNode*> members;
+    uint32_t offset = 0;
+    for (const auto* uniform : uniforms) {
+        if (uniform->type != ASTNodeType::VARIABLE_DECL) {
+            continue;
+        }
+        auto* varDecl = static_cast<const VariableDeclNode*>(uniform);
+        ValueType type = ValueType::fromName(varDecl->varType);
+        if (!type.isValid()) {
+            throw std::runtime_error("Unsupported type for uniform '" + std::string(varDecl->name) + "'");
+        }
+
+        bool wide = type.isMatrix() || type.components >= 3;
+        uint32_t alignment = wide ? 16 : 4 * static_cast<uint32_t>(type.components);
+        uint32_t size = type.isMatrix() ? 16 * static_cast<uint32_t>(type.columns)
+                                        : 4 * static_cast<uint32_t>(type.components);
+        offset = (offset + alignment - 1) / alignment * alignment;
+
+        memberTypes.push_back(typeId(type));
+        offsets.push_back(offset);
+        members.push_back(varDecl);
+        offset += size;
+    }
+
+    uint32_t blockType = builder.typeStruct(memberTypes);
+    builder.addName(blockType, shaderType == "fragment" ? "FragmentUniforms" : "VertexUniforms");
+    builder.addDecoration(blockType, SpirvModuleBuilder::DecorationBlock);
+
+    uint32_t blockVar = builder.globalVariable(
+        builder.typePointer(SpirvModuleBuilder::StorageClassUniform, blockType), SpirvModuleBuilder::StorageClassUniform);
+    builder.addDecoration(blockVar, SpirvModuleBuilder::DecorationDescriptorSet, {TypeResolver::UNIFORM_SET});
+    builder.addDecoration(blockVar, SpirvModuleBuilder::DecorationBinding, {TypeResolver::uniformBinding(shaderType)});
+
+    for (uint32_t i = 0; i < members.size(); ++i) {
+        ValueType type = ValueType::fromName(members[i]->varType);
+        builder.addMemberName(blockType, i, std::string(members[i]->name));
+        builder.addMemberDecoration(blockType, i, SpirvModuleBuilder::DecorationOffset, {offsets[i]});
+        if (type.isMatrix()) {
+            builder.addMemberDecoration(blockType, i, SpirvModuleBuilder::DecorationColMajor);
+            builder.addMemberDecoration(blockType, i, SpirvModuleBuilder::DecorationMatrixStride, {16});
+        }
+
+        // SPIR-V 1.0 entry points list only Input/Output variables, so the
+        // block stays out of interfaceVariables
+        variables[members[i]->name] = {blockVar, type, SpirvModuleBuilder::StorageClassUniform,
+                                       static_cast<int32_t>(i)};
+    }
+}
+
+void SpirvEmitter::declareSpecConstants(const NodeList& specConstants) {
+    for (const auto* constant : specConstants) {
+        if (constant->type != ASTNodeType::SPEC_CONSTANT_DECL) {
+            continue;
+        }
+        auto* specConstant = static_cast<const SpecConstantNode*>(constant);
+        ValueType type = ValueType::fromName(specConstant->varType);
+        std::string value(specConstant->defaultValue);
+
+        uint32_t bits;
+        if (type.base == ValueType::Base::INT) {
+            int32_t intValue = std::stoi(value);
+            std::memcpy(&bits, &intValue, sizeof(bits));
+        } else {
+            float floatValue = std::stof(value);
+            std::memcpy(&bits, &floatValue, sizeof(bits));
+        }
+
+        uint32_t id = builder.specConstant(typeId(type), bits);
+        builder.addName(id, std::string(specConstant->name));
+        builder.addDecoration(id, SpirvModuleBuilder::DecorationSpecId, {specConstant->constantId});
+        constants[specConstant->name] = {id, type};
+    }
+}
+
+void SpirvEmitter::declareLocals(const NodeList& statements) {
+    for (const auto* stmt : statements) {
+        if (stmt->type != ASTNodeType::ASSIGNMENT) {
+            continue;
+        }
+
+        auto* assign = static_cast<const AssignmentNode*>(stmt);
+        if (assign->target->type != ASTNodeType::IDENTIFIER) {
+            continue;
+        }
+
+        std::string_view name = static_cast<const IdentifierNode*>(assign->target)->name;
+        if (resolver.isDeclared(name)) {
+            continue;
+        }
+
+        ValueType type = resolver.resolve(assign->value);
+        if (!type.isValid()) {
+            throw std::runtime_error("Cannot infer type of local variable '" + std::string(name) + "'");
+        }
+
+        resolver.declare(name, type);
+        uint32_t id = builder.localVariable(builder.typePointer(SpirvModuleBuilder::StorageClassFunction,
+                                                                typeId(type)));
+        builder.addName(id, std::string(name));
+        variables[name] = {id, type, SpirvModuleBuilder::StorageClassFunction};
+    }
+}
+
+void SpirvEmitter::emitStatement(const ASTNode* node) {
+    switch (node->type) {
+        case ASTNodeType::ASSIGNMENT:
+            emitAssignment(static_cast<const AssignmentNode*>(node));
+            break;
+
+        default:
+            throw std::runtime_error("Unsupported statement type in code generation");
+    }
+}
+
+void SpirvEmitter::emitAssignment(const AssignmentNode* assign) {
+    Value value = emitExpression(assign->value);
+
+    // Whole-variable store
+    if (assign->target->type == ASTNodeType::IDENTIFIER) {
+        std::string_view name = static_cast<const IdentifierNode*>(assign->target)->name;
+        const Variable& var = lookupVariable(name);
+        checkAssignable(var, name);
+
+        value = convert(value, var.type.base);
+        if (value.type != var.type) {
+            throw std::runtime_error("Cannot assign " + value.type.name() + " to '" + std::string(name) +
+                                     "' of type " + var.type.name());
+        }
+
+        builder.emitVoid(Op::OpStore, {var.id, value.id});
+        return;
+    }
+
+    // Swizzled store (e.g. color.rgb = ...)
+    if (assign->target->type == ASTNodeType::MEMBER_ACCESS) {
+        auto* member = static_cast<const MemberAccessNode*>(assign->target);
+        if (member->object->type != ASTNodeType::IDENTIFIER) {
+            throw std::runtime_error("Unsupported assignment target in code generation");
+        }
+
+        std::string_view name = static_cast<const IdentifierNode*>(member->object)->name;
+        const Variable& var = lookupVariable(name);
+        checkAssignable(var, name);
+
+        std::vector<uint32_t> indices = swizzleIndices(member->member, var.type);
+        ValueType expected = TypeResolver::swizzleType(var.type, member->member);
+        value = convert(value, ValueType::Base::FLOAT);
+        if (value.type != expected) {
+            throw std::runtime_error("Cannot assign " + value.type.name() + " to '" + std::string(name) + "." +
+                                     std::string(member->member) + "'");
+        }
+
+        if (indices.size() == 1) {
+            // Store through a pointer to the single component
+            uint32_t componentPtr = builder.typePointer(var.storageClass, builder.typeFloat());
+            uint32_t ptr = builder.emit(Op::OpAccessChain, componentPtr,
+                                        {var.id, builder.constantInt(static_cast<int32_t>(indices[0]))});
+            builder.emitVoid(Op::OpStore, {ptr, value.id});
+            return;
+        }
+
+        // Merge the written components into the current value
+        uint32_t vecType = typeId(var.type);
+        uint32_t current = builder.emit(Op::OpLoad, vecType, {var.id});
+        std::vector<uint32_t> operands = {current, value.id};
+        for (int i = 0; i < var.type.components; ++i) {
+            uint32_t selector = static_cast<uint32_t>(i);
+            for (size_t k = 0; k < indices.size(); ++k) {
+                if (indices[k] == static_cast<uint32_t>(i)) {
+                    selector = static_cast<uint32_t>(var.type.components + k);
+                }
+            }
+            operands.push_back(selector);
+        }
+        uint32_t merged = builder.emit(Op::OpVectorShuffle, vecType, operands);
+        builder.emitVoid(Op::OpStore, {var.id, merged});
+        return;
+    }
+
+    throw std::runtime_error("Unsupported assignment target in code generation");
+}
+
+SpirvEmitter::Value SpirvEmitter::emitExpression(const ASTNode* node) {
+    if (!node) {
+        throw std::runtime_error("Missing expression in code generation");
+    }
+
+    switch (node->type) {
+        case ASTNodeType::LITERAL:
+            return emitLiteral(static_cast<const LiteralNode*>(node));
+
+        case ASTNodeType::IDENTIFIER:
+            return emitLoad(static_cast<const IdentifierNode*>(node)->name);
+
+        case ASTNodeType::BINARY_OP:
+            return emitBinaryOp(static_cast<const BinaryOpNode*>(node));
+
+        case ASTNodeType::MEMBER_ACCESS:
+            return emitSwizzle(static_cast<const MemberAccessNode*>(node));
+
+        case ASTNodeType::FUNCTION_CALL:
+            return emitConstructor(static_cast<const FunctionCallNode*>(node));
+
+        default:
+            throw std::runtime_error("Unsupported expression type in code generation");
+    }
+}
+
+SpirvEmitter::Value SpirvEmitter::emitLiteral(const LiteralNode* lit) {
+    ValueType type = TypeResolver::literalType(lit->value);
+    if (type.base == ValueType::Base::INT) {
+        return {builder.constantInt(std::stoi(std::string(lit->value))), type};
+    }
+    return {builder.constantFloat(std::stof(std::string(lit->value))), type};
+}
+
+SpirvEmitter::Value SpirvEmitter::emitLoad(std::string_view name) {
+    auto constant = constants.find(name);
+    if (constant != constants.end()) {
+        return constant->second;
+    }
+
+    const Variable& var = lookupVariable(name);
+    uint32_t pointer = var.id;
+    if (var.member >= 0) {
+        // Uniforms are members of the stage's block
+        uint32_t memberPtr = builder.typePointer(var.storageClass, typeId(var.type));
+        pointer = builder.emit(Op::OpAccessChain, memberPtr, {var.id, builder.constantInt(var.member)});
+    }
+    return {builder.emit(Op::OpLoad, typeId(var.type), {pointer}), var.type};
+}
+
+SpirvEmitter::Value SpirvEmitter::emitBinaryOp(const BinaryOpNode* binOp) {
+    // One instruction (or one per matrix column) per operator, left to right
+    Value value = emitExpression(binOp->operands[0]);
+    for (size_t i = 1; i < binOp->operands.size(); ++i) {
+        value = emitOperator(binOp->op(i), value, emitExpression(binOp->operands[i]));
+    }
+    return value;
+}
+
+SpirvEmitter::Value SpirvEmitter::emitOperator(std::string_view op, Value left, Value right) {
+    ValueType result = TypeResolver::binaryResultType(op, left.type, right.type);
+    if (!result.isValid()) {
+        throw std::runtime_error("Type mismatch in '" + std::string(op) + "': " + left.type.name() +
+                                 " and " + right.type.name());
+    }
+
+    if (result.base == ValueType::Base::FLOAT) {
+        left = convert(left, ValueType::Base::FLOAT);
+        right = convert(right, ValueType::Base::FLOAT);
+    }
+
+    // Products with dedicated linear algebra instructions
+    if (op == "*") {
+        uint32_t resultType = typeId(result);
+        if (left.type.isMatrix() && right.type.isVector()) {
+            return {builder.emit(Op::OpMatrixTimesVector, resultType, {left.id, right.id}), result};
+        }
+        if (left.type.isVector() && right.type.isMatrix()) {
+            return {builder.emit(Op::OpVectorTimesMatrix, resultType, {left.id, right.id}), result};
+        }
+        if (left.type.isMatrix() && right.type.isMatrix()) {
+            return {builder.emit(Op::OpMatrixTimesMatrix, resultType, {left.id, right.id}), result};
+        }
+        if (left.type.isMatrix() && right.type.isScalar()) {
+            return {builder.emit(Op::OpMatrixTimesScalar, resultType, {left.id, right.id}), result};
+        }
+        if (left.type.isScalar() && right.type.isMatrix()) {
+            return {builder.emit(Op::OpMatrixTimesScalar, resultType, {right.id, left.id}), result};
+        }
+        if (left.type.isVector() && right.type.isScalar()) {
+            return {builder.emit(Op::OpVectorTimesScalar, resultType, {left.id, right.id}), result};
+        }
+        if (left.type.isScalar() && right.type.isVector()) {
+            return {builder.emit(Op::OpVectorTimesScalar, resultType, {right.id, left.id}), result};
+        }
+    }
+
+    // Matrices are handled one column at a time
+    if (result.isMatrix()) {
+        ValueType columnType = ValueType::vector(result.components);
+        std::vector<uint32_t> columns;
+        for (int c = 0; c < result.columns; ++c) {
+            Value lc = left.type.isMatrix() ? extractComponent(left, c) : splat(left, columnType);
+            Value rc = right.type.isMatrix() ? extractComponent(right, c) : splat(right, columnType);
+            columns.push_back(componentWise(op, lc, rc, columnType).id);
+        }
+        return {builder.emit(Op::OpCompositeConstruct, typeId(result), columns), result};
+    }
+
+    if (left.type.isScalar() && !result.isScalar()) {
+        left = splat(left, result);
+    }
+    if (right.type.isScalar() && !result.isScalar()) {
+        right = splat(right, result);
+    }
+
+    return componentWise(op, left, right, result);
+}
+
+SpirvEmitter::Value SpirvEmitter::componentWise(std::string_view op, Value left, Value right,
+                                                ValueType result) {
+    bool isFloat = result.base == ValueType::Base::FLOAT;
+    Op opcode;
+    if (op == "+") {
+        opcode = isFloat ? Op::OpFAdd : Op::OpIAdd;
+    } else if (op == "-") {
+        opcode = isFloat ? Op::OpFSub : Op::OpISub;
+    } else if (op == "*") {
+        opcode = isFloat ? Op::OpFMul : Op::OpIMul;
+    } else if (op == "/") {
+        opcode = isFloat ? Op::OpFDiv : Op::OpSDiv;
+    } else {
+        throw std::runtime_error("Unsupported operator in code generation: " + std::string(op));
+    }
+
+    return {builder.emit(opcode, typeId(result), {left.id, right.id}), result};
+}
+
+SpirvEmitter::Value SpirvEmitter::emitSwizzle(const MemberAccessNode* member) {
+    Value object = emitExpression(member->object);
+    std::vector<uint32_t> indices = swizzleIndices(member->member, object.type);
+    ValueType result = TypeResolver::swizzleType(object.type, member->member);
+
+    if (indices.size() == 1) {
+        return extractComponent(object, indices[0]);
+    }
+
+    std::vector<uint32_t> operands = {object.id, object.id};
+    operands.insert(operands.end(), indices.begin(), indices.end());
+    return {builder.emit(Op::OpVectorShuffle, typeId(result), operands), result};
+}
+
+SpirvEmitter::Value SpirvEmitter::emitConstructor(const FunctionCallNode* funcCall) {
+    ValueType target = ValueType::fromName(funcCall->functionName);
+    if (!target.isValid()) {
+        throw std::runtime_error("Unsupported function in native SPIR-V backend: " + std::string(funcCall->functionName));
+    }
+
+    std::vector<Value> args;
+    for (const auto* arg : funcCall->arguments) {
+        args.push_back(emitExpression(arg));
+    }
+
+    if (args.empty()) {
+        throw std::runtime_error("Constructor '" + std::string(funcCall->functionName) + "' needs arguments");
+    }
+
+    // Scalar conversions: float(x), int(x)
+    if (target.isScalar()) {
+        Value v = args[0].type.isScalar() ? args[0] : extractComponent(args[0], 0);
+        return convert(v, target.base);
+    }
+
+    // Single scalar: broadcast for vectors, diagonal for matrices
+    if (args.size() == 1 && args[0].type.isScalar()) {
+        Value s = convert(args[0], ValueType::Base::FLOAT);
+        if (target.isVector()) {
+            return splat(s, target);
+        }
+
+        uint32_t zero = builder.constantFloat(0.0f);
+        uint32_t columnType = typeId(ValueType::vector(target.components));
+        std::vector<uint32_t> columns;
+        for (int c = 0; c < target.columns; ++c) {
+            std::vector<uint32_t> components(target.components, zero);
+            components[c] = s.id;
+            columns.push_back(builder.emit(Op::OpCompositeConstruct, columnType, components));
+        }
+        return {builder.emit(Op::OpCompositeConstruct, typeId(target), columns), target};
+    }
+
+    if (args.size() == 1 && args[0].type == target) {
+        return args[0];
+    }
+
+    // Truncation: vec3(someVec4)
+    if (target.isVector() && args.size() == 1 && args[0].type.isVector() &&
+        args[0].type.components > target.components) {
+        std::vector<uint32_t> operands = {args[0].id, args[0].id};
+        for (int i = 0; i < target.components; ++i) {
+            operands.push_back(static_cast<uint32_t>(i));
+        }
+        return {builder.emit(Op::OpVectorShuffle, typeId(target), operands), target};
+    }
+
+    // General case: flatten every argument into float components
+    int needed = target.componentCount();
+    int provided = 0;
+    bool exact = true;
+    for (auto& arg : args) {
+        if (arg.type.isMatrix()) {
+            throw std::runtime_error("Matrix arguments are not supported in constructor '" +
+                                     std::string(funcCall->functionName) + "'");
+        }
+        arg = convert(arg, ValueType::Base::FLOAT);
+        provided += arg.type.components;
+        if (provided > needed) {
+            exact = false;
+        }
+    }
+
+    if (provided < needed) {
+        throw std::runtime_error("Not enough components in constructor '" + std::string(funcCall->functionName) + "'");
+    }
+
+    if (target.isVector() && exact) {
+        std::vector<uint32_t> constituents;
+        for (const auto& arg : args) {
+            constituents.push_back(arg.id);
+        }
+        return {builder.emit(Op::OpCompositeConstruct, typeId(target), constituents), target};
+    }
+
+    if (target.isMatrix() && exact && static_cast<int>(args.size()) == target.columns) {
+        bool allColumns = true;
+        for (const auto& arg : args) {
+            allColumns &= arg.type.components == target.components;
+        }
+        if (allColumns) {
+            std::vector<uint32_t> columns;
+            for (const auto& arg : args) {
+                columns.push_back(arg.id);
+            }
+            return {builder.emit(Op::OpCompositeConstruct, typeId(target), columns), target};
+        }
+    }
+
+    std::vector<uint32_t> scalars;
+    for (const auto& arg : args) {
+        if (arg.type.isScalar()) {
+            scalars.push_back(arg.id);
+        } else {
+            for (int i = 0; i < arg.type.components; ++i) {
+                scalars.push_back(extractComponent(arg, i).id);
+            }
+        }
+    }
+    scalars.resize(needed);
+
+    if (target.isVector()) {
+        return {builder.emit(Op::OpCompositeConstruct, typeId(target), scalars), target};
+    }
+
+    uint32_t columnType = typeId(ValueType::vector(target.components));
+    std::vector<uint32_t> columns;
+    for (int c = 0; c < target.columns; ++c) {
+        std::vector<uint32_t> components(scalars.begin() + c * target.components,
+                                         scalars.begin() + (c + 1) * target.components);
+        columns.push_back(builder.emit(Op::OpCompositeConstruct, columnType, components));
+    }
+    return {builder.emit(Op::OpCompositeConstruct, typeId(target), columns), target};
+}
+
+SpirvEmitter::Value SpirvEmitter::convert(Value value, ValueType::Base base) {
+    if (value.type.base == base || !value.type.isScalar()) {
+        return value;
+    }
+
+    ValueType result = ValueType::scalar(base);
+    Op op = base == ValueType::Base::FLOAT ? Op::OpConvertSToF : Op::OpConvertFToS;
+    return {builder.emit(op, typeId(result), {value.id}), result};
+}
+
+SpirvEmitter::Value SpirvEmitter::splat(Value scalar, ValueType target) {
+    std::vector<uint32_t> constituents(target.components, scalar.id);
+    return {builder.emit(Op::OpCompositeConstruct, typeId(target), constituents), target};
+}
+
+SpirvEmitter::Value SpirvEmitter::extractComponent(Value composite, uint32_t index) {
+    ValueType result = composite.type.isMatrix() ? ValueType::vector(composite.type.components)
+                                                 : ValueType::scalar(composite.type.base);
+    return {builder.emit(Op::OpCompositeExtract, typeId(result), {composite.id, index}), result};
+}
+
+const SpirvEmitter::Variable& SpirvEmitter::lookupVariable(std::string_view name) {
+    auto it = variables.find(name);
+    if (it == variables.end()) {
+        // Constants are never looked up for a load, so this is a store
+        if (constants.count(name)) {
+            throw std::runtime_error("Cannot assign to specialization constant '" + std::string(name) + "'");
+        }
+        throw std::runtime_error("Undeclared identifier in code generation: " + std::string(name));
+    }
+    return it->second;
+}
+
+void SpirvEmitter::checkAssignable(const Variable& var, std::string_view name) {
+    if (var.storageClass == SpirvModuleBuilder::StorageClassInput) {
+        throw std::runtime_error("Cannot assign to input variable '" + std::string(name) + "'");
+    }
+    if (var.storageClass == SpirvModuleBuilder::StorageClassUniform) {
+        throw std::runtime_error("Cannot assign to uniform '" + std::string(name) + "'");
+    }
+}
+
+uint32_t SpirvEmitter::typeId(ValueType type) {
+    uint32_t scalarType = type.base == ValueType::Base::INT ? builder.typeInt() : builder.typeFloat();
+    if (type.isScalar()) {
+        return scalarType;
+    }
+
+    uint32_t vectorType = builder.typeVector(scalarType, type.components);
+    if (type.isVector()) {
+        return vectorType;
+    }
+
+    return builder.typeMatrix(vectorType, type.columns);
+}
+
+std::vector<uint32_t> SpirvEmitter::swizzleIndices(std::string_view member, ValueType objectType) {
+    if (!TypeResolver::swizzleType(objectType, member).isValid()) {
+        throw std::runtime_error("Invalid swizzle '." + std::string(member) + "' on " + objectType.name());
+    }
+
+    std::vector<uint32_t> indices;
+    for (char c : member) {
+        indices.push_back(static_cast<uint32_t>(TypeResolver::swizzleIndex(c)));
+    }
+    return indices;
+}
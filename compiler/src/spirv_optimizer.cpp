@@ -0,0 +1,510 @@
+#include "spirv_optimizer.h"
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+constexpr uint32_t MagicNumber = 0x07230203;
+constexpr size_t HeaderWords = 5;
+constexpr uint32_t MemoryAccessVolatile = 0x1;
+constexpr uint32_t GlslModf = 35;
+constexpr uint32_t GlslFrexp = 51;
+
+enum : uint16_t {
+    OpUndef = 1,
+    OpSourceContinued = 2,
+    OpSource = 3,
+    OpSourceExtension = 4,
+    OpName = 5,
+    OpMemberName = 6,
+    OpString = 7,
+    OpLine = 8,
+    OpExtInstImport = 11,
+    OpExtInst = 12,
+    OpTypeVoid = 19,
+    OpTypeStruct = 30,
+    OpTypeOpaque = 31,
+    OpTypeFunction = 33,
+    OpConstantTrue = 41,
+    OpConstantNull = 46,
+    OpSpecConstantOp = 52,
+    OpVariable = 59,
+    OpLoad = 61,
+    OpDecorate = 71,
+    OpMemberDecorate = 72,
+    OpVectorShuffle = 79,
+    OpCompositeExtract = 81,
+    OpCompositeInsert = 82,
+    OpNoLine = 317,
+    OpModuleProcessed = 330,
+    OpDecorateId = 332
+};
+
+[[noreturn]] void malformed(const std::string& reason) {
+    throw std::runtime_error("SPIR-V optimization failed: " + reason);
+}
+
+// Operand layout of an instruction, one character per operand:
+//   t  result type id      r  result id
+//   i  id                  l  literal word
+//   s  literal string      p  literal and id pair (OpSwitch targets)
+//   *  the next kind repeats up to the end of the instruction
+// Trailing operands may be absent, which is how optional operands are
+// described. nullptr means the instruction is not known
+const char* operandLayout(const uint32_t* words, uint16_t wordCount) {
+    uint16_t opcode = static_cast<uint16_t>(words[0] & 0xFFFF);
+    switch (opcode) {
+        case 0: return "";                  // OpNop
+        case 1: return "tr";                // OpUndef
+        case 2: return "s";                 // OpSourceContinued
+        case 3: return "llis";              // OpSource
+        case 4: return "s";                 // OpSourceExtension
+        case 5: return "is";                // OpName
+        case 6: return "ils";               // OpMemberName
+        case 7: return "rs";                // OpString
+        case 8: return "ill";               // OpLine
+        case 10: return "s";                // OpExtension
+        case 11: return "rs";               // OpExtInstImport
+        case 12: return "tril*i";           // OpExtInst
+        case 14: return "ll";               // OpMemoryModel
+        case 15: return "lis*i";            // OpEntryPoint
+        case 16: return "il*l";             // OpExecutionMode
+        case 17: return "l";                // OpCapability
+
+        case 19: case 20: case 26: return "r";          // OpTypeVoid, OpTypeBool, OpTypeSampler
+        case 21: return "rll";              // OpTypeInt
+        case 22: return "rl";               // OpTypeFloat
+        case 23: case 24: return "ril";     // OpTypeVector, OpTypeMatrix
+        case 25: return "ri*l";             // OpTypeImage
+        case 27: case 29: return "ri";      // OpTypeSampledImage, OpTypeRuntimeArray
+        case 28: return "rii";              // OpTypeArray
+        case 30: case 33: return "r*i";     // OpTypeStruct, OpTypeFunction
+        case 31: return "rs";               // OpTypeOpaque
+        case 32: return "rli";              // OpTypePointer
+
+        case 41: case 42: case 46: case 48: case 49: return "tr";   // Boolean and null constants
+        case 43: case 50: return "tr*l";    // OpConstant, OpSpecConstant
+        case 44: case 51: return "tr*i";    // OpConstantComposite, OpSpecConstantComposite
+        case 45: return "trlll";            // OpConstantSampler
+        case OpSpecConstantOp: {
+            // The operands follow the layout of the wrapped opcode
+            uint32_t wrapped = wordCount > 3 ? words[3] : 0;
+            if (wrapped == OpVectorShuffle || wrapped == OpCompositeInsert) return "trlii*l";
+            if (wrapped == OpCompositeExtract) return "trli*l";
+            return "trl*i";
+        }
+
+        case 54: return "trli";             // OpFunction
+        case 55: return "tr";               // OpFunctionParameter
+        case 56: return "";                 // OpFunctionEnd
+        case 57: return "tr*i";             // OpFunctionCall
+
+        case 59: return "trli";             // OpVariable
+        case 60: return "triii";            // OpImageTexelPointer
+        case 61: return "tri*l";            // OpLoad
+        case 62: case 63: return "ii*l";    // OpStore, OpCopyMemory
+        case 64: return "iii*l";            // OpCopyMemorySized
+        case 65: case 66: return "tr*i";    // OpAccessChain, OpInBoundsAccessChain
+
+        case 71: return "il*l";             // OpDecorate
+        case 72: return "ill*l";            // OpMemberDecorate
+
+        case 77: return "trii";             // OpVectorExtractDynamic
+        case 78: return "triii";            // OpVectorInsertDynamic
+        case 79: case 82: return "trii*l";  // OpVectorShuffle, OpCompositeInsert
+        case 80: return "tr*i";             // OpCompositeConstruct
+        case 81: return "tri*l";            // OpCompositeExtract
+        case 83: case 84: return "tri";     // OpCopyObject, OpTranspose
+
+        case 86: return "trii";             // OpSampledImage
+        case 87: case 88: case 91: case 92: case 95: case 98:
+            return "triil*i";               // Sampling, fetch and read without a reference value
+        case 89: case 90: case 93: case 94: case 96: case 97:
+            return "triiil*i";              // Depth-comparison sampling and gathers
+        case 99: return "iiil*i";           // OpImageWrite
+        case 100: case 104: case 106: case 107: return "tri";       // OpImage and size queries
+        case 103: case 105: return "trii";  // OpImageQuerySizeLod, OpImageQueryLod
+
+        case 123: return "tril";            // OpGenericCastToPtrExplicit
+        case 161: case 162: case 163: return "trii";                // Ordered comparisons
+        case 169: return "triii";           // OpSelect
+        case 201: return "triiii";          // OpBitFieldInsert
+        case 202: case 203: return "triii"; // OpBitFieldSExtract, OpBitFieldUExtract
+
+        case 245: return "tr*i";            // OpPhi
+        case 246: return "iil*l";           // OpLoopMerge
+        case 247: return "il";              // OpSelectionMerge
+        case 248: return "r";               // OpLabel
+        case 249: return "i";               // OpBranch
+        case 250: return "iii*l";           // OpBranchConditional
+        case 251: return "ii*p";            // OpSwitch
+        case 252: case 253: case 255: case 317: return "";          // OpKill, OpReturn, OpUnreachable, OpNoLine
+        case 254: return "i";               // OpReturnValue
+
+        case 330: return "s";               // OpModuleProcessed
+        case 331: return "il*i";            // OpExecutionModeId
+        case 332: return "il*i";            // OpDecorateId
+        default: break;
+    }
+
+    // Conversions, arithmetic, relational and logical operations, and
+    // derivatives, which all take ids only
+    if ((opcode >= 109 && opcode <= 124) || (opcode >= 126 && opcode <= 160) ||
+        (opcode >= 164 && opcode <= 168) || (opcode >= 170 && opcode <= 200) ||
+        (opcode >= 204 && opcode <= 205) || (opcode >= 207 && opcode <= 215)) {
+        return "tr*i";
+    }
+    return nullptr;
+}
+
+// Instructions that can go when nothing reads their result: module-level
+// definitions other than specialization constants and functions, and
+// function-body instructions without side effects
+bool isRemovable(const uint32_t* words, uint16_t wordCount, uint32_t glslSet) {
+    uint16_t opcode = static_cast<uint16_t>(words[0] & 0xFFFF);
+    switch (opcode) {
+        case OpUndef:
+        case OpString:
+        case OpExtInstImport:
+        case OpVariable:
+            return true;
+        case OpExtInst:
+            return glslSet != 0 && words[3] == glslSet && words[4] != GlslModf && words[4] != GlslFrexp;
+        case OpLoad:
+            return wordCount <= 4 || (words[4] & MemoryAccessVolatile) == 0;
+        default:
+            break;
+    }
+    if (opcode >= OpTypeVoid && opcode <= OpTypeFunction) return true;
+    if (opcode >= OpConstantTrue && opcode <= OpConstantNull) return true;
+    if (opcode >= 65 && opcode <= 66) return true;      // Access chains
+    if (opcode >= 77 && opcode <= 84) return true;      // Composite operations
+    if (opcode >= 86 && opcode <= 98) return true;      // Sampling and reads
+    if (opcode >= 100 && opcode <= 107) return true;    // Image queries
+    if (opcode >= 109 && opcode <= 205) return true;    // Conversions and arithmetic
+    if (opcode >= 207 && opcode <= 215) return true;    // Derivatives
+    return opcode == 245;                               // OpPhi
+}
+
+// Types and constants that are interchangeable with an identical
+// definition; structs and opaque types are distinct by declaration, and
+// specialization constants are set individually by the pipeline
+bool isDeduplicable(uint16_t opcode) {
+    if (opcode >= OpTypeVoid && opcode <= OpTypeFunction) {
+        return opcode != OpTypeStruct && opcode != OpTypeOpaque;
+    }
+    return opcode >= OpConstantTrue && opcode <= OpConstantNull;
+}
+
+bool isDebug(uint16_t opcode) {
+    return (opcode >= OpSourceContinued && opcode <= OpLine) || opcode == OpNoLine || opcode == OpModuleProcessed;
+}
+
+// Number of words of the literal string at words[0], or 0 if it is not
+// terminated before end
+size_t stringWords(const uint32_t* words, const uint32_t* end) {
+    for (const uint32_t* word = words; word < end; word++) {
+        for (int shift = 0; shift < 32; shift += 8) {
+            if (((*word >> shift) & 0xFF) == 0) return static_cast<size_t>(word - words) + 1;
+        }
+    }
+    return 0;
+}
+
+}
+
+bool SpirvOptimizer::isAnnotation(uint16_t opcode) {
+    return opcode == OpName || opcode == OpMemberName || opcode == OpDecorate ||
+           opcode == OpMemberDecorate || opcode == OpDecorateId;
+}
+
+void SpirvOptimizer::optimize(std::vector<uint32_t>& spirv) {
+    stats = Stats();
+    stats.wordsBefore = spirv.size();
+    if (spirv.size() < HeaderWords) malformed("module is shorter than its header");
+    if (spirv[0] != MagicNumber) malformed("bad magic number");
+    stats.idBoundBefore = spirv[3];
+
+    if (!index(spirv)) {
+        stats.skipped = true;
+        stats.wordsAfter = spirv.size();
+        stats.idBoundAfter = stats.idBoundBefore;
+        return;
+    }
+
+    if (options.stripDebugInfo) stripDebugInfo(spirv);
+    if (options.deduplicateConstants) deduplicate(spirv);
+    if (options.removeDeadIds) removeDeadIds(spirv);
+    if (options.stripDebugInfo || options.deduplicateConstants || options.removeDeadIds) removeOrphanAnnotations(spirv);
+    if (options.compactIds) compactIds(spirv);
+    rebuild(spirv);
+
+    stats.wordsAfter = spirv.size();
+    stats.idBoundAfter = spirv[3];
+}
+
+bool SpirvOptimizer::index(const std::vector<uint32_t>& spirv) {
+    instructions.clear();
+    idOperands.clear();
+    idOperandStart.clear();
+    bound = spirv[3];
+    definitions.assign(bound, NoInstruction);
+    glslSet = 0;
+
+    const uint32_t* module = spirv.data();
+    size_t size = spirv.size();
+    size_t offset = HeaderWords;
+    while (offset < size) {
+        uint16_t opcode = static_cast<uint16_t>(module[offset] & 0xFFFF);
+        uint16_t wordCount = static_cast<uint16_t>(module[offset] >> 16);
+        if (wordCount == 0 || offset + wordCount > size) {
+            malformed("instruction at word " + std::to_string(offset) + " runs past the end of the module");
+        }
+
+        const uint32_t* words = module + offset;
+        const char* layout = operandLayout(words, wordCount);
+        if (!layout) return false;
+
+        Instruction instruction = {static_cast<uint32_t>(offset), opcode, wordCount, 0, false};
+        idOperandStart.push_back(static_cast<uint32_t>(idOperands.size()));
+
+        size_t word = 1;
+        bool repeat = false;
+        const char* kind = layout;
+        while (word < wordCount) {
+            if (*kind == '*') {
+                repeat = true;
+                kind++;
+            }
+            if (*kind == '\0') return false;    // More operands than the instruction takes
+
+            switch (*kind) {
+                case 't':
+                case 'i':
+                    idOperands.push_back(static_cast<uint32_t>(offset + word));
+                    word++;
+                    break;
+                case 'r':
+                    instruction.resultWord = static_cast<uint32_t>(offset + word);
+                    word++;
+                    break;
+                case 'l':
+                    word++;
+                    break;
+                case 's': {
+                    size_t length = stringWords(words + word, words + wordCount);
+                    if (length == 0) malformed("unterminated string at word " + std::to_string(offset + word));
+                    word += length;
+                    break;
+                }
+                case 'p':
+                    if (word + 1 < wordCount) idOperands.push_back(static_cast<uint32_t>(offset + word + 1));
+                    word += 2;
+                    break;
+            }
+            if (!repeat) kind++;
+        }
+
+        for (size_t i = idOperandStart.back(); i < idOperands.size(); i++) {
+            if (module[idOperands[i]] == 0 || module[idOperands[i]] >= bound) {
+                malformed("id " + std::to_string(module[idOperands[i]]) + " at word " +
+                          std::to_string(idOperands[i]) + " is outside the id bound");
+            }
+        }
+        if (instruction.resultWord != 0) {
+            uint32_t id = module[instruction.resultWord];
+            if (id == 0 || id >= bound) malformed("result id " + std::to_string(id) + " is outside the id bound");
+            if (definitions[id] != NoInstruction) malformed("id " + std::to_string(id) + " is defined twice");
+            definitions[id] = static_cast<uint32_t>(instructions.size());
+            if (opcode == OpExtInstImport && wordCount > 2) {
+                const char* name = reinterpret_cast<const char*>(words + 2);
+                size_t bytes = (wordCount - 2) * sizeof(uint32_t);
+                if (strnlen(name, bytes) == 12 && std::memcmp(name, "GLSL.std.450", 12) == 0) glslSet = id;
+            }
+        }
+
+        instructions.push_back(instruction);
+        offset += wordCount;
+    }
+    idOperandStart.push_back(static_cast<uint32_t>(idOperands.size()));
+    return true;
+}
+
+void SpirvOptimizer::stripDebugInfo(const std::vector<uint32_t>& spirv) {
+    // OpString is also read by non-semantic debug instructions, so it only
+    // goes if nothing but debug instructions refers to it
+    std::vector<bool> referenced(bound, false);
+    for (size_t i = 0; i < instructions.size(); i++) {
+        if (isDebug(instructions[i].opcode)) continue;
+        for (uint32_t j = idOperandStart[i]; j < idOperandStart[i + 1]; j++) referenced[spirv[idOperands[j]]] = true;
+    }
+
+    for (size_t i = 0; i < instructions.size(); i++) {
+        Instruction& instruction = instructions[i];
+        if (!isDebug(instruction.opcode)) continue;
+        if (instruction.opcode == OpString && referenced[spirv[instruction.resultWord]]) continue;
+        instruction.removed = true;
+        stats.debugInstructionsStripped++;
+    }
+}
+
+void SpirvOptimizer::deduplicate(std::vector<uint32_t>& spirv) {
+    std::vector<bool> decorated(bound, false);
+    for (size_t i = 0; i < instructions.size(); i++) {
+        uint16_t opcode = instructions[i].opcode;
+        if (opcode == OpDecorate || opcode == OpMemberDecorate || opcode == OpDecorateId) {
+            decorated[spirv[idOperands[idOperandStart[i]]]] = true;
+        }
+    }
+
+    // Definitions precede their uses outside of names, decorations and
+    // entry points, so one forward pass rewriting operands as it goes sees
+    // every duplicate in its final form
+    std::vector<uint32_t> replacement(bound);
+    for (uint32_t id = 0; id < bound; id++) replacement[id] = id;
+    std::map<std::vector<uint32_t>, uint32_t> definitionsByKey;
+    std::vector<uint32_t> key;
+    bool merged = false;
+
+    for (size_t i = 0; i < instructions.size(); i++) {
+        Instruction& instruction = instructions[i];
+        if (instruction.removed) continue;
+        for (uint32_t j = idOperandStart[i]; j < idOperandStart[i + 1]; j++) {
+            uint32_t& id = spirv[idOperands[j]];
+            id = replacement[id];
+        }
+        if (!isDeduplicable(instruction.opcode)) continue;
+
+        uint32_t result = spirv[instruction.resultWord];
+        if (decorated[result]) continue;
+
+        // Key: every word except the result id
+        key.clear();
+        for (uint32_t word = instruction.offset; word < instruction.offset + instruction.wordCount; word++) {
+            if (word != instruction.resultWord) key.push_back(spirv[word]);
+        }
+        auto inserted = definitionsByKey.emplace(key, result);
+        if (inserted.second) continue;
+
+        replacement[result] = inserted.first->second;
+        instruction.removed = true;
+        stats.duplicatesMerged++;
+        merged = true;
+    }
+    if (!merged) return;
+
+    // Second pass for what refers forward; names of merged ids go
+    for (size_t i = 0; i < instructions.size(); i++) {
+        Instruction& instruction = instructions[i];
+        if (instruction.removed) continue;
+        for (uint32_t j = idOperandStart[i]; j < idOperandStart[i + 1]; j++) {
+            uint32_t& id = spirv[idOperands[j]];
+            if (replacement[id] == id) continue;
+            if (isAnnotation(instruction.opcode) && j == idOperandStart[i]) {
+                instruction.removed = true;
+                break;
+            }
+            id = replacement[id];
+        }
+    }
+}
+
+void SpirvOptimizer::removeDeadIds(const std::vector<uint32_t>& spirv) {
+    // Uses by live instructions; the target of a name or decoration does
+    // not count
+    std::vector<uint32_t> uses(bound, 0);
+    for (size_t i = 0; i < instructions.size(); i++) {
+        if (instructions[i].removed) continue;
+        uint32_t first = idOperandStart[i] + (isAnnotation(instructions[i].opcode) ? 1 : 0);
+        for (uint32_t j = first; j < idOperandStart[i + 1]; j++) uses[spirv[idOperands[j]]]++;
+    }
+
+    const uint32_t* module = spirv.data();
+    std::vector<uint32_t> worklist;
+    for (size_t i = 0; i < instructions.size(); i++) {
+        const Instruction& instruction = instructions[i];
+        if (instruction.removed || instruction.resultWord == 0 || uses[module[instruction.resultWord]] != 0) continue;
+        if (isRemovable(module + instruction.offset, instruction.wordCount, glslSet)) {
+            worklist.push_back(static_cast<uint32_t>(i));
+        }
+    }
+
+    while (!worklist.empty()) {
+        uint32_t i = worklist.back();
+        worklist.pop_back();
+        instructions[i].removed = true;
+        stats.deadInstructionsRemoved++;
+
+        for (uint32_t j = idOperandStart[i]; j < idOperandStart[i + 1]; j++) {
+            uint32_t id = module[idOperands[j]];
+            if (--uses[id] != 0) continue;
+            uint32_t definition = definitions[id];
+            if (definition == NoInstruction) continue;
+            const Instruction& operand = instructions[definition];
+            if (!operand.removed && isRemovable(module + operand.offset, operand.wordCount, glslSet)) {
+                worklist.push_back(definition);
+            }
+        }
+    }
+}
+
+void SpirvOptimizer::removeOrphanAnnotations(const std::vector<uint32_t>& spirv) {
+    for (size_t i = 0; i < instructions.size(); i++) {
+        Instruction& instruction = instructions[i];
+        if (instruction.removed || !isAnnotation(instruction.opcode)) continue;
+        uint32_t definition = definitions[spirv[idOperands[idOperandStart[i]]]];
+        if (definition == NoInstruction || instructions[definition].removed) {
+            instruction.removed = true;
+            if (instruction.opcode == OpName || instruction.opcode == OpMemberName) {
+                stats.debugInstructionsStripped++;
+            } else {
+                stats.deadInstructionsRemoved++;
+            }
+        }
+    }
+}
+
+void SpirvOptimizer::compactIds(std::vector<uint32_t>& spirv) {
+    // New ids in definition order
+    std::vector<uint32_t> renumbered(bound, 0);
+    uint32_t next = 1;
+    for (const Instruction& instruction : instructions) {
+        if (!instruction.removed && instruction.resultWord != 0) renumbered[spirv[instruction.resultWord]] = next++;
+    }
+
+    // An id used without a live definition (e.g. a forward declaration
+    // this pass does not model) leaves the numbering as it is
+    for (size_t i = 0; i < instructions.size(); i++) {
+        if (instructions[i].removed) continue;
+        for (uint32_t j = idOperandStart[i]; j < idOperandStart[i + 1]; j++) {
+            if (renumbered[spirv[idOperands[j]]] == 0) return;
+        }
+    }
+
+    for (size_t i = 0; i < instructions.size(); i++) {
+        const Instruction& instruction = instructions[i];
+        if (instruction.removed) continue;
+        if (instruction.resultWord != 0) spirv[instruction.resultWord] = renumbered[spirv[instruction.resultWord]];
+        for (uint32_t j = idOperandStart[i]; j < idOperandStart[i + 1]; j++) {
+            spirv[idOperands[j]] = renumbered[spirv[idOperands[j]]];
+        }
+    }
+    spirv[3] = next;
+}
+
+void SpirvOptimizer::rebuild(std::vector<uint32_t>& spirv) const {
+    // Instructions only move towards the start, so copying in order is safe
+    size_t size = HeaderWords;
+    for (const Instruction& instruction : instructions) {
+        if (instruction.removed) continue;
+        if (size != instruction.offset) {
+            std::copy(spirv.begin() + instruction.offset, spirv.begin() + instruction.offset + instruction.wordCount,
+                      spirv.begin() + size);
+        }
+        size += instruction.wordCount;
+    }
+    spirv.resize(size);
+}
@@ -0,0 +1,314 @@
+#include "spirv_reflect.h"
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace {
+
+constexpr uint32_t MagicNumber = 0x07230203;
+constexpr size_t HeaderWords = 5;
+
+enum : uint16_t {
+    OpName = 5,
+    OpEntryPoint = 15,
+    OpTypeBool = 20,
+    OpTypeInt = 21,
+    OpTypeFloat = 22,
+    OpTypeVector = 23,
+    OpTypeMatrix = 24,
+    OpTypeArray = 28,
+    OpTypeStruct = 30,
+    OpTypePointer = 32,
+    OpConstant = 43,
+    OpSpecConstantTrue = 48,
+    OpSpecConstantFalse = 49,
+    OpSpecConstant = 50,
+    OpVariable = 59,
+    OpDecorate = 71,
+    OpMemberDecorate = 72
+};
+
+enum : uint32_t {
+    DecorationSpecId = 1,
+    DecorationArrayStride = 6,
+    DecorationMatrixStride = 7,
+    DecorationBuiltIn = 11,
+    DecorationLocation = 30,
+    DecorationBinding = 33,
+    DecorationDescriptorSet = 34,
+    DecorationOffset = 35
+};
+
+enum : uint32_t {
+    StorageClassInput = 1,
+    StorageClassUniform = 2,
+    StorageClassOutput = 3
+};
+
+constexpr uint32_t ExecutionModelVertex = 0;
+constexpr uint32_t ExecutionModelFragment = 4;
+
+// Deepest nesting of arrays and structs followed when sizing a block
+constexpr int MaxTypeDepth = 32;
+
+// Type declaration: opcode and operands after the result id
+struct TypeDecl {
+    uint16_t opcode = 0;
+    std::vector<uint32_t> operands;
+};
+
+// Decorations of one id, or of one struct member
+struct Decorations {
+    bool builtIn = false;
+    bool hasLocation = false;
+    bool hasSpecId = false;
+    uint32_t location = 0;
+    uint32_t binding = 0;
+    uint32_t set = 0;
+    uint32_t specId = 0;
+    uint32_t arrayStride = 0;
+    uint32_t matrixStride = 0;
+    uint32_t offset = 0;
+};
+
+std::string readString(const uint32_t* words, size_t wordCount) {
+    const char* text = reinterpret_cast<const char*>(words);
+    return std::string(text, strnlen(text, wordCount * sizeof(uint32_t)));
+}
+
+class Reflector {
+public:
+    ShaderReflection reflect(const uint32_t* module, size_t size) {
+        if (size < HeaderWords || module[0] != MagicNumber) {
+            throw std::runtime_error("Cannot reflect SPIR-V: not a SPIR-V module");
+        }
+
+        bool hasEntryPoint = false;
+        std::vector<std::pair<uint32_t, uint32_t>> variables;   // Id, pointer type
+        std::vector<uint32_t> specConstants;
+        std::unordered_map<uint32_t, uint32_t> specConstantTypes;
+
+        for (size_t offset = HeaderWords; offset < size;) {
+            uint16_t opcode = static_cast<uint16_t>(module[offset] & 0xFFFF);
+            uint16_t wordCount = static_cast<uint16_t>(module[offset] >> 16);
+            if (wordCount == 0 || offset + wordCount > size) {
+                throw std::runtime_error("Cannot reflect SPIR-V: instruction at word " + std::to_string(offset) +
+                                         " runs past the end of the module");
+            }
+            const uint32_t* words = module + offset;
+            offset += wordCount;
+
+            switch (opcode) {
+                case OpName:
+                    if (wordCount > 2) names[words[1]] = readString(words + 2, wordCount - 2);
+                    break;
+                case OpEntryPoint:
+                    if (!hasEntryPoint && wordCount > 3) {
+                        hasEntryPoint = true;
+                        result.stage = words[1] == ExecutionModelVertex ? ShaderReflection::Stage::VERTEX :
+                                       words[1] == ExecutionModelFragment ? ShaderReflection::Stage::FRAGMENT :
+                                       ShaderReflection::Stage::OTHER;
+                        result.entryPoint = readString(words + 3, wordCount - 3);
+                    }
+                    break;
+                case OpDecorate:
+                    if (wordCount > 2) decorate(decorations[words[1]], words[2], wordCount > 3 ? words[3] : 0);
+                    break;
+                case OpMemberDecorate:
+                    if (wordCount > 3) {
+                        decorate(memberDecorations[{words[1], words[2]}], words[3], wordCount > 4 ? words[4] : 0);
+                    }
+                    break;
+                case OpTypeBool:
+                case OpTypeInt:
+                case OpTypeFloat:
+                case OpTypeVector:
+                case OpTypeMatrix:
+                case OpTypeArray:
+                case OpTypeStruct:
+                case OpTypePointer:
+                    if (wordCount > 1) types[words[1]] = {opcode, std::vector<uint32_t>(words + 2, words + wordCount)};
+                    break;
+                case OpConstant:
+                    if (wordCount > 3) constants[words[2]] = words[3];
+                    break;
+                case OpSpecConstantTrue:
+                case OpSpecConstantFalse:
+                case OpSpecConstant:
+                    if (wordCount > 2) {
+                        specConstants.push_back(words[2]);
+                        specConstantTypes[words[2]] = words[1];
+                        constants[words[2]] = opcode == OpSpecConstantTrue ? 1 :
+                                              opcode == OpSpecConstantFalse ? 0 :
+                                              wordCount > 3 ? words[3] : 0;
+                    }
+                    break;
+                case OpVariable:
+                    if (wordCount > 3) variables.emplace_back(words[2], words[1]);
+                    break;
+                default:
+                    break;
+            }
+        }
+
+        if (!hasEntryPoint) {
+            throw std::runtime_error("Cannot reflect SPIR-V: module has no entry point");
+        }
+
+        for (const auto& variable : variables) {
+            const TypeDecl* pointer = find(variable.second);
+            if (!pointer || pointer->opcode != OpTypePointer || pointer->operands.size() < 2) continue;
+            uint32_t storageClass = pointer->operands[0];
+            uint32_t type = pointer->operands[1];
+            const Decorations& decoration = decorations[variable.first];
+
+            if ((storageClass == StorageClassInput || storageClass == StorageClassOutput) &&
+                decoration.hasLocation && !decoration.builtIn) {
+                ShaderReflection::Variable reflected;
+                reflected.name = names[variable.first];
+                reflected.location = decoration.location;
+                describe(type, reflected);
+                (storageClass == StorageClassInput ? result.inputs : result.outputs).push_back(reflected);
+            } else if (storageClass == StorageClassUniform) {
+                ShaderReflection::UniformBlock block;
+                block.name = names[variable.first].empty() ? names[type] : names[variable.first];
+                block.set = decoration.set;
+                block.binding = decoration.binding;
+                block.sizeBytes = sizeOf(type, 0, 0);
+                result.uniformBlocks.push_back(block);
+            }
+        }
+
+        for (uint32_t id : specConstants) {
+            const Decorations& decoration = decorations[id];
+            if (!decoration.hasSpecId) continue;
+            ShaderReflection::SpecConstant constant;
+            constant.name = names[id];
+            constant.id = decoration.specId;
+            constant.type = scalarType(specConstantTypes[id]);
+            constant.defaultBits = constants[id];
+            result.specConstants.push_back(constant);
+        }
+
+        auto byLocation = [](const ShaderReflection::Variable& a, const ShaderReflection::Variable& b) {
+            return a.location < b.location;
+        };
+        std::sort(result.inputs.begin(), result.inputs.end(), byLocation);
+        std::sort(result.outputs.begin(), result.outputs.end(), byLocation);
+        std::sort(result.uniformBlocks.begin(), result.uniformBlocks.end(),
+                  [](const ShaderReflection::UniformBlock& a, const ShaderReflection::UniformBlock& b) {
+                      return a.set != b.set ? a.set < b.set : a.binding < b.binding;
+                  });
+        std::sort(result.specConstants.begin(), result.specConstants.end(),
+                  [](const ShaderReflection::SpecConstant& a, const ShaderReflection::SpecConstant& b) {
+                      return a.id < b.id;
+                  });
+        return result;
+    }
+
+private:
+    static void decorate(Decorations& target, uint32_t decoration, uint32_t value) {
+        switch (decoration) {
+            case DecorationSpecId: target.hasSpecId = true; target.specId = value; break;
+            case DecorationArrayStride: target.arrayStride = value; break;
+            case DecorationMatrixStride: target.matrixStride = value; break;
+            case DecorationBuiltIn: target.builtIn = true; break;
+            case DecorationLocation: target.hasLocation = true; target.location = value; break;
+            case DecorationBinding: target.binding = value; break;
+            case DecorationDescriptorSet: target.set = value; break;
+            case DecorationOffset: target.offset = value; break;
+            default: break;
+        }
+    }
+
+    const TypeDecl* find(uint32_t id) const {
+        auto it = types.find(id);
+        return it == types.end() ? nullptr : &it->second;
+    }
+
+    ShaderReflection::ScalarType scalarType(uint32_t id) const {
+        const TypeDecl* type = find(id);
+        if (!type) return ShaderReflection::ScalarType::OTHER;
+        switch (type->opcode) {
+            case OpTypeBool: return ShaderReflection::ScalarType::BOOL;
+            case OpTypeFloat: return ShaderReflection::ScalarType::FLOAT;
+            case OpTypeInt:
+                return type->operands.size() > 1 && type->operands[1] != 0 ? ShaderReflection::ScalarType::INT :
+                                                                             ShaderReflection::ScalarType::UINT;
+            default: return ShaderReflection::ScalarType::OTHER;
+        }
+    }
+
+    void describe(uint32_t id, ShaderReflection::Variable& variable) const {
+        const TypeDecl* type = find(id);
+        if (type && type->opcode == OpTypeMatrix && type->operands.size() > 1) {
+            variable.columns = type->operands[1];
+            id = type->operands[0];
+            type = find(id);
+        }
+        if (type && type->opcode == OpTypeVector && type->operands.size() > 1) {
+            variable.components = type->operands[1];
+            variable.type = scalarType(type->operands[0]);
+        } else {
+            variable.components = 1;
+            variable.type = scalarType(id);
+        }
+    }
+
+    // Size of a type in a block; matrixStride comes from the enclosing member
+    uint32_t sizeOf(uint32_t id, uint32_t matrixStride, int depth) const {
+        const TypeDecl* type = find(id);
+        if (!type || depth > MaxTypeDepth) return 0;
+        switch (type->opcode) {
+            case OpTypeBool:
+                return 4;
+            case OpTypeInt:
+            case OpTypeFloat:
+                return type->operands.empty() ? 0 : type->operands[0] / 8;
+            case OpTypeVector:
+                return type->operands.size() < 2 ? 0 : type->operands[1] * sizeOf(type->operands[0], 0, depth + 1);
+            case OpTypeMatrix: {
+                if (type->operands.size() < 2) return 0;
+                uint32_t column = matrixStride != 0 ? matrixStride : sizeOf(type->operands[0], 0, depth + 1);
+                return type->operands[1] * column;
+            }
+            case OpTypeArray: {
+                if (type->operands.size() < 2) return 0;
+                auto length = constants.find(type->operands[1]);
+                if (length == constants.end()) return 0;
+                auto stride = decorations.find(id);
+                uint32_t element = stride != decorations.end() && stride->second.arrayStride != 0 ?
+                                   stride->second.arrayStride : sizeOf(type->operands[0], matrixStride, depth + 1);
+                return length->second * element;
+            }
+            case OpTypeStruct: {
+                uint32_t end = 0;
+                for (uint32_t member = 0; member < type->operands.size(); member++) {
+                    auto decoration = memberDecorations.find({id, member});
+                    uint32_t offset = decoration != memberDecorations.end() ? decoration->second.offset : end;
+                    uint32_t stride = decoration != memberDecorations.end() ? decoration->second.matrixStride : 0;
+                    end = std::max(end, offset + sizeOf(type->operands[member], stride, depth + 1));
+                }
+                return end;
+            }
+            default:
+                return 0;
+        }
+    }
+
+    ShaderReflection result;
+    std::unordered_map<uint32_t, std::string> names;
+    std::unordered_map<uint32_t, Decorations> decorations;
+    std::map<std::pair<uint32_t, uint32_t>, Decorations> memberDecorations;
+    std::unordered_map<uint32_t, TypeDecl> types;
+    std::unordered_map<uint32_t, uint32_t> constants;
+};
+
+}
+
+ShaderReflection ShaderReflection::fromSpirv(const uint32_t* words, size_t wordCount) {
+    Reflector reflector;
+    return reflector.reflect(words, wordCount);
+}
@@ -0,0 +1,227 @@
+#include "type_resolver.h"
+
+ValueType ValueType::fromName(std::string_view name) {
+    if (name == "float") return scalar(Base::FLOAT);
+    if (name == "int") return scalar(Base::INT);
+    if (name == "vec2") return vector(2);
+    if (name == "vec3") return vector(3);
+    if (name == "vec4") return vector(4);
+    if (name == "mat4") return matrix(4);
+    return ValueType();
+}
+
+std::string ValueType::name() const {
+    if (!isValid()) {
+        return "<invalid>";
+    }
+    if (isMatrix()) {
+        return "mat" + std::to_string(columns);
+    }
+    if (isVector()) {
+        return "vec" + std::to_string(components);
+    }
+    return base == Base::INT ? "int" : "float";
+}
+
+TypeResolver::TypeResolver() {}
+
+void TypeResolver::declareShaderInterface(const ShaderDeclNode* shader) {
+    for (const auto& input : shader->inputs) {
+        if (input->type == ASTNodeType::VARIABLE_DECL) {
+            auto* varDecl = static_cast<const VariableDeclNode*>(input);
+            declare(varDecl->name, ValueType::fromName(varDecl->varType));
+        }
+    }
+
+    for (const auto& output : shader->outputs) {
+        if (output->type == ASTNodeType::VARIABLE_DECL) {
+            auto* varDecl = static_cast<const VariableDeclNode*>(output);
+            declare(varDecl->name, ValueType::fromName(varDecl->varType));
+        }
+    }
+
+    for (const auto& uniform : shader->uniforms) {
+        if (uniform->type == ASTNodeType::VARIABLE_DECL) {
+            auto* varDecl = static_cast<const VariableDeclNode*>(uniform);
+            declare(varDecl->name, ValueType::fromName(varDecl->varType));
+        }
+    }
+
+    for (const auto& constant : shader->constants) {
+        if (constant->type == ASTNodeType::SPEC_CONSTANT_DECL) {
+            auto* specConstant = static_cast<const SpecConstantNode*>(constant);
+            declare(specConstant->name, ValueType::fromName(specConstant->varType));
+        }
+    }
+
+    if (shader->shaderType == "vertex") {
+        declare("gl_Position", ValueType::vector(4));
+    }
+
+    if (writesFragColor(shader)) {
+        declare("gl_FragColor", ValueType::vector(4));
+    }
+}
+
+void TypeResolver::declare(std::string_view name, ValueType type) {
+    symbols[name] = type;
+}
+
+bool TypeResolver::isDeclared(std::string_view name) const {
+    return symbols.find(name) != symbols.end();
+}
+
+ValueType TypeResolver::lookup(std::string_view name) const {
+    auto it = symbols.find(name);
+    if (it == symbols.end()) {
+        return ValueType();
+    }
+    return it->second;
+}
+
+ValueType TypeResolver::resolve(const ASTNode* expr) const {
+    if (!expr) {
+        return ValueType();
+    }
+
+    switch (expr->type) {
+        case ASTNodeType::LITERAL: {
+            auto* lit = static_cast<const LiteralNode*>(expr);
+            return literalType(lit->value);
+        }
+
+        case ASTNodeType::IDENTIFIER: {
+            auto* id = static_cast<const IdentifierNode*>(expr);
+            return lookup(id->name);
+        }
+
+        case ASTNodeType::BINARY_OP: {
+            // Left to right, like the chain is evaluated
+            auto* binOp = static_cast<const BinaryOpNode*>(expr);
+            ValueType type = resolve(binOp->operands[0]);
+            for (size_t i = 1; i < binOp->operands.size() && type.isValid(); i++) {
+                type = binaryResultType(binOp->op(i), type, resolve(binOp->operands[i]));
+            }
+            return type;
+        }
+
+        case ASTNodeType::MEMBER_ACCESS: {
+            auto* member = static_cast<const MemberAccessNode*>(expr);
+            return swizzleType(resolve(member->object), member->member);
+        }
+
+        case ASTNodeType::FUNCTION_CALL: {
+            // Only type constructors have a known result type
+            auto* funcCall = static_cast<const FunctionCallNode*>(expr);
+            ValueType type = ValueType::fromName(funcCall->functionName);
+            for (const auto& arg : funcCall->arguments) {
+                if (!resolve(arg).isValid()) {
+                    return ValueType();
+                }
+            }
+            return type;
+        }
+
+        default:
+            return ValueType();
+    }
+}
+
+ValueType TypeResolver::literalType(std::string_view literal) {
+    if (literal.find_first_of(".eE") != std::string_view::npos) {
+        return ValueType::scalar(ValueType::Base::FLOAT);
+    }
+    return ValueType::scalar(ValueType::Base::INT);
+}
+
+ValueType TypeResolver::binaryResultType(std::string_view op, ValueType left, ValueType right) {
+    if (!left.isValid() || !right.isValid()) {
+        return ValueType();
+    }
+
+    // Scalar arithmetic: int only if both sides are int
+    if (left.isScalar() && right.isScalar()) {
+        if (left.base == ValueType::Base::INT && right.base == ValueType::Base::INT) {
+            return left;
+        }
+        return ValueType::scalar(ValueType::Base::FLOAT);
+    }
+
+    // Scalar broadcast against a vector or matrix
+    if (left.isScalar()) {
+        return right;
+    }
+    if (right.isScalar()) {
+        return left;
+    }
+
+    // Linear algebra products
+    if (op == "*") {
+        if (left.isMatrix() && right.isVector()) {
+            return left.columns == right.components ? ValueType::vector(left.components) : ValueType();
+        }
+        if (left.isVector() && right.isMatrix()) {
+            return left.components == right.components ? ValueType::vector(right.columns) : ValueType();
+        }
+        if (left.isMatrix() && right.isMatrix()) {
+            return left.columns == right.components ? ValueType{ValueType::Base::FLOAT, left.components, right.columns}
+                                                    : ValueType();
+        }
+    }
+
+    // Component-wise operations require matching shapes
+    return left == right ? left : ValueType();
+}
+
+ValueType TypeResolver::swizzleType(ValueType object, std::string_view member) {
+    if (!object.isVector() || member.empty() || member.size() > 4) {
+        return ValueType();
+    }
+
+    for (char c : member) {
+        int index = swizzleIndex(c);
+        if (index < 0 || index >= object.components) {
+            return ValueType();
+        }
+    }
+
+    if (member.size() == 1) {
+        return ValueType::scalar(object.base);
+    }
+    return ValueType::vector(static_cast<int>(member.size()));
+}
+
+int TypeResolver::swizzleIndex(char c) {
+    switch (c) {
+        case 'x': case 'r': case 's': return 0;
+        case 'y': case 'g': case 't': return 1;
+        case 'z': case 'b': case 'p': return 2;
+        case 'w': case 'a': case 'q': return 3;
+        default: return -1;
+    }
+}
+
+bool TypeResolver::isBuiltinVariable(std::string_view name, std::string_view shaderType) {
+    return (shaderType == "vertex" && name == "gl_Position") ||
+           (shaderType == "fragment" && name == "gl_FragColor");
+}
+
+bool TypeResolver::writesFragColor(const ShaderDeclNode* shader) {
+    if (shader->shaderType != "fragment") {
+        return false;
+    }
+    for (const auto* stmt : shader->statements) {
+        if (stmt->type != ASTNodeType::ASSIGNMENT) {
+            continue;
+        }
+        const ASTNode* target = static_cast<const AssignmentNode*>(stmt)->target;
+        if (target->type == ASTNodeType::MEMBER_ACCESS) {
+            target = static_cast<const MemberAccessNode*>(target)->object;
+        }
+        if (target->type == ASTNodeType::IDENTIFIER &&
+            static_cast<const IdentifierNode*>(target)->name == "gl_FragColor") {
+            return true;
+        }
+    }
+    return false;
+}
@@ -1,9 +1,11 @@
 #pragma once
 
+#include "memory_allocator.h"
 #include <vulkan/vulkan.h>
 
 class VulkanContext;
 
+// A VkBuffer bound to a range of a MemoryAllocator block
 class Buffer {
 public:
     Buffer(VulkanContext* context);
@@ -12,16 +14,16 @@ public:
     void create(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties);
     void cleanup();
     
-    void copyData(const void* data, VkDeviceSize size);
-    void copyFrom(Buffer& srcBuffer, VkDeviceSize size);
+    // Write to a host-visible buffer
+    void copyData(const void* data, VkDeviceSize size, VkDeviceSize offset = 0);
     
     VkBuffer getBuffer() const { return buffer; }
-    VkDeviceMemory getMemory() const { return bufferMemory; }
+    VkDeviceMemory getMemory() const { return allocation.memory; }
+    VkDeviceSize getMemoryOffset() const { return allocation.offset; }
+    void* getMappedData() const { return allocation.mapped; }
     
 private:
-    uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
-    
     VulkanContext* context;
     VkBuffer buffer = VK_NULL_HANDLE;
-    VkDeviceMemory bufferMemory = VK_NULL_HANDLE;
+    MemoryAllocator::Allocation allocation;
 };
\ No newline at end of file
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class VulkanContext;
+
+// Parallel command buffer recording
+// A fixed set of worker threads records secondary command buffers for a
+// render pass; every thread has its own command pool per frame in flight,
+// so no pool is ever shared between threads and a whole frame's buffers are
+// recycled with one vkResetCommandPool instead of a reset per buffer. The
+// frame's primary buffer comes from a pool of its own in the same way
+class CommandRecorder {
+public:
+    // Records draws [first, first + count) into a secondary command buffer
+    // that has already been begun. Called concurrently from worker threads;
+    // secondaries inherit no state, so each one binds its own pipeline,
+    // dynamic state and descriptor sets
+    using RecordFunction = std::function<void(VkCommandBuffer commandBuffer, uint32_t first, uint32_t count)>;
+    
+    // threadCount 0 picks one worker per hardware thread; the caller only waits while they record
+    CommandRecorder(VulkanContext* context, uint32_t frameCount, uint32_t threadCount = 0);
+    ~CommandRecorder();
+    
+    CommandRecorder(const CommandRecorder&) = delete;
+    CommandRecorder& operator=(const CommandRecorder&) = delete;
+    
+    void create();
+    void cleanup();
+    
+    // Reset every pool of frameIndex; the frame's fence must have been waited on
+    void beginFrame(uint32_t frameIndex);
+    
+    // The current frame's primary command buffer (in the initial state after beginFrame)
+    VkCommandBuffer getPrimaryCommandBuffer();
+    
+    // Split itemCount items into contiguous ranges of at least minItemsPerBuffer
+    // and record one secondary per range in parallel (a single range is recorded
+    // on the calling thread). Blocks until all are recorded and returns them in
+    // item order, ready for vkCmdExecuteCommands
+    // in a render pass begun with VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS
+    std::vector<VkCommandBuffer> recordSecondaries(const VkCommandBufferInheritanceInfo& inheritance,
+                                                   uint32_t itemCount, const RecordFunction& record,
+                                                   uint32_t minItemsPerBuffer = 256);
+    
+    uint32_t getThreadCount() const { return threadCount; }
+    
+private:
+    // One command pool, used only by one thread during one frame
+    struct ThreadPool {
+        VkCommandPool pool = VK_NULL_HANDLE;
+        std::vector<VkCommandBuffer> buffers;  // Allocated so far, reused after each reset
+        uint32_t used = 0;                    // Handed out since the last reset
+    };
+    
+    VkCommandBuffer acquireBuffer(ThreadPool& threadPool, VkCommandBufferLevel level);
+    void workerLoop(uint32_t threadIndex);
+    
+    VulkanContext* context;
+    uint32_t frameCount;
+    uint32_t threadCount;
+    uint32_t currentFrame = 0;
+    
+    // Indexed [frame][thread]; the last pool of each frame is the primary's
+    std::vector<std::vector<ThreadPool>> pools;
+    
+    // Work handed to the workers, one dispatch at a time
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::vector<std::condition_variable> workReady;  // One per worker, so idle workers stay asleep
+    std::condition_variable workDone;
+    std::function<void(uint32_t)> task;
+    uint64_t dispatchId = 0;
+    uint32_t activeWorkers = 0;  // Workers [0, activeWorkers) take part in the current dispatch
+    uint32_t pending = 0;
+    bool stopping = false;
+    std::exception_ptr workerError;
+};
\ No newline at end of file
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+
+class VulkanContext;
+
+// CPU frame pacing and latency metrics
+// Splits the CPU side of every frame into time blocked on fences, time
+// blocked in vkAcquireNextImageKHR and time spent recording and submitting,
+// and measures acquire-to-present. With pacing on and VK_KHR_present_wait
+// available, presents carry a VK_KHR_present_id and waitForPacing() blocks
+// until at most maxQueuedPresents are still waiting for the display. Input
+// is sampled right after that wait, so beginFrame() to the present being
+// shown is the frame's input-to-photon latency (up to scanout)
+class FramePacer {
+public:
+    enum class Stage {
+        FenceWait,  // Frame and swapchain-image fences
+        Acquire,    // vkAcquireNextImageKHR
+        Record,     // Recording and vkQueueSubmit
+        Present     // vkQueuePresentKHR
+    };
+    
+    struct FrameTimings {
+        uint64_t frameNumber = 0;
+        double pacingWaitMs = 0.0;        // Blocked in waitForPacing() before the frame
+        double fenceWaitMs = 0.0;
+        double acquireMs = 0.0;
+        double recordMs = 0.0;
+        double presentMs = 0.0;
+        double acquireToPresentMs = 0.0;  // Acquire returned to present returned
+        double cpuFrameMs = 0.0;          // beginFrame() to endFrame()
+        double inputToPresentMs = -1.0;   // beginFrame() to the image being shown; < 0 when unknown
+    };
+    
+    FramePacer(VulkanContext* context, bool pacing, uint32_t maxQueuedPresents = 1);
+    
+    // Loads vkWaitForPresentKHR; pacing stays off when the device lacks present wait
+    void create();
+    
+    // Before sampling input: block until the display has caught up
+    void waitForPacing(VkSwapchainKHR swapchain);
+    
+    // Right after sampling input; drops a frame that never reached endFrame()
+    void beginFrame(uint64_t frameNumber);
+    
+    void beginStage(Stage stage);
+    void endStage(Stage stage);
+    
+    // Chain a present id into presentInfo when pacing; presentInfo must be
+    // submitted before the next call
+    void preparePresent(VkPresentInfoKHR& presentInfo);
+    
+    // After vkQueuePresentKHR; the frame is final once its present is shown
+    void endFrame();
+    
+    // Present ids restart with every swapchain; frames not yet shown lose their latency
+    void resetSwapchain();
+    
+    bool isPacing() const { return waitForPresent != nullptr; }
+    
+    // Completed frames, oldest first (bounded)
+    const std::deque<FrameTimings>& getHistory() const { return history; }
+    const FrameTimings* getLatest() const { return history.empty() ? nullptr : &history.back(); }
+    
+    // Mean and 99th percentile of each stage over the history
+    void printStats() const;
+    
+private:
+    using Clock = std::chrono::steady_clock;
+    
+    struct PendingFrame {
+        FrameTimings timings;
+        Clock::time_point inputTime;
+        uint64_t presentId;
+    };
+    
+    static constexpr size_t HISTORY_FRAMES = 600;
+    static constexpr uint64_t PRESENT_WAIT_TIMEOUT_NS = 100000000;  // Never stall the loop on a lost present
+    
+    static double elapsedMs(Clock::time_point from, Clock::time_point to);
+    void finishFrame(const FrameTimings& timings);
+    
+    VulkanContext* context;
+    bool pacingRequested;
+    uint32_t maxQueuedPresents;
+    PFN_vkWaitForPresentKHR waitForPresent = nullptr;
+    
+    bool frameOpen = false;
+    FrameTimings current;
+    Clock::time_point inputTime;
+    Clock::time_point stageStart;
+    Clock::time_point acquireEnd;
+    double nextPacingWaitMs = 0.0;
+    
+    uint64_t lastPresentId = 0;  // Per swapchain, starting at 1
+    uint64_t lastShownId = 0;
+    VkPresentIdKHR presentIdInfo{};
+    std::deque<PendingFrame> awaitingPresent;
+    
+    std::deque<FrameTimings> history;
+};
\ No newline at end of file
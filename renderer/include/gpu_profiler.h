@@ -0,0 +1,109 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <string>
+#include <vector>
+
+class VulkanContext;
+
+// GPU timing from timestamp queries
+// Each frame in flight owns a slice of one timestamp pool (and optionally one
+// pipeline-statistics query). A slice is read back when its frame slot comes
+// round again, after the slot's fence was waited on, so results lag
+// frameCount frames and vkGetQueryPoolResults never waits
+class GpuProfiler {
+public:
+    struct Scope {
+        std::string name;
+        double beginMs = 0.0;     // Relative to the start of the frame
+        double durationMs = 0.0;
+        uint32_t depth = 0;       // Nesting level, 0 for the whole frame
+    };
+    
+    struct FrameResult {
+        uint64_t frameNumber = 0;
+        uint64_t gpuBeginTicks = 0;  // Raw, masked timestamp of the frame start
+        std::vector<Scope> scopes;   // scopes[0] spans the whole frame
+        bool hasStatistics = false;
+        uint64_t vertexInvocations = 0;
+        uint64_t fragmentInvocations = 0;
+    };
+    
+    // statistics enables pipeline-statistics counts when the device supports them
+    GpuProfiler(VulkanContext* context, uint32_t frameCount, uint32_t maxScopes = 64, bool statistics = false);
+    ~GpuProfiler();
+    
+    GpuProfiler(const GpuProfiler&) = delete;
+    GpuProfiler& operator=(const GpuProfiler&) = delete;
+    
+    void create();
+    void cleanup();
+    
+    // Start of the frame's primary command buffer, outside any render pass;
+    // resolves the results this slot recorded frameCount frames ago
+    void beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex, uint64_t frameNumber);
+    void endFrame(VkCommandBuffer commandBuffer);
+    
+    // Nested GPU scopes; returns a handle for endScope (ignored when the frame is full)
+    uint32_t beginScope(VkCommandBuffer commandBuffer, const std::string& name);
+    void endScope(VkCommandBuffer commandBuffer, uint32_t scope);
+    
+    // Pipeline-statistics query around the draws (no-ops when unsupported)
+    // Secondaries executed inside it must inherit getInheritedStatistics()
+    void beginStatistics(VkCommandBuffer commandBuffer);
+    void endStatistics(VkCommandBuffer commandBuffer);
+    VkQueryPipelineStatisticFlags getInheritedStatistics() const { return statisticsActive ? statisticFlags : 0; }
+    
+    // Append every resolved frame to a CSV file (one row per scope)
+    bool setCsvOutput(const std::string& path);
+    
+    // Write the retained history as a Chrome trace (chrome://tracing, Perfetto)
+    bool writeChromeTrace(const std::string& path) const;
+    
+    bool isSupported() const { return timestampPool != VK_NULL_HANDLE; }
+    bool hasStatistics() const { return statisticsPool != VK_NULL_HANDLE; }
+    const std::deque<FrameResult>& getHistory() const { return history; }
+    const FrameResult* getLatest() const { return history.empty() ? nullptr : &history.back(); }
+    
+private:
+    struct PendingScope {
+        std::string name;
+        uint32_t beginQuery;
+        uint32_t endQuery = UINT32_MAX;  // Unset until endScope
+        uint32_t depth;
+    };
+    
+    struct FrameSlot {
+        bool recorded = false;
+        uint64_t frameNumber = 0;
+        uint32_t queryCount = 0;          // Timestamps written this frame
+        bool statisticsRecorded = false;
+        std::vector<PendingScope> scopes;
+    };
+    
+    void resolve(FrameSlot& slot, uint32_t frameIndex);
+    void writeCsvRows(const FrameResult& result);
+    
+    VulkanContext* context;
+    uint32_t frameCount;
+    uint32_t maxScopes;
+    bool statisticsRequested;
+    
+    VkQueryPool timestampPool = VK_NULL_HANDLE;
+    VkQueryPool statisticsPool = VK_NULL_HANDLE;
+    VkQueryPipelineStatisticFlags statisticFlags = 0;
+    double timestampPeriodNs = 1.0;
+    uint64_t timestampMask = ~0ull;
+    
+    std::vector<FrameSlot> slots;
+    uint32_t currentSlot = 0;
+    uint32_t openDepth = 0;
+    bool statisticsActive = false;
+    
+    std::deque<FrameResult> history;
+    size_t historyLength = 600;
+    std::ofstream csv;
+};
\ No newline at end of file
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+class VulkanContext;
+
+// Sub-allocator for device memory
+// Memory is taken from the driver in large blocks per memory type and handed
+// out in aligned ranges from a sorted free list; freed ranges are merged with
+// their neighbours and reused. Buffers and images never share a block, so
+// bufferImageGranularity never has to be padded for. Host-visible blocks are
+// mapped once for their whole lifetime
+class MemoryAllocator {
+public:
+    // A range inside a block; owned by whoever allocated it until free()
+    struct Allocation {
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkDeviceSize offset = 0;
+        VkDeviceSize size = 0;
+        void* mapped = nullptr;     // Host pointer to offset, null unless host-visible
+        uint32_t memoryType = 0;
+        uint32_t blockId = 0;       // Owning block, 0 for a dedicated allocation
+        
+        bool isValid() const { return memory != VK_NULL_HANDLE; }
+    };
+    
+    // Usage of one memory heap
+    struct HeapStats {
+        VkDeviceSize heapSize = 0;
+        VkDeviceSize allocatedBytes = 0;  // Taken from the driver (blocks + dedicated)
+        VkDeviceSize usedBytes = 0;       // Handed out to resources
+        uint32_t blockCount = 0;
+        uint32_t dedicatedCount = 0;
+        uint32_t allocationCount = 0;
+    };
+    
+    explicit MemoryAllocator(VulkanContext* context, VkDeviceSize blockSize = 64 * 1024 * 1024);
+    ~MemoryAllocator();
+    
+    MemoryAllocator(const MemoryAllocator&) = delete;
+    MemoryAllocator& operator=(const MemoryAllocator&) = delete;
+    
+    // Query memory types and limits; call once the device exists
+    void create();
+    
+    // Free every block; all allocations must have been released
+    void cleanup();
+    
+    // Allocate memory matching the requirements; linear is false for optimally tiled images
+    Allocation allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties,
+                        bool linear = true);
+    void free(Allocation& allocation);
+    
+    // Make host writes to a non-coherent allocation visible to the device (no-op when coherent)
+    void flush(const Allocation& allocation, VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE);
+    
+    uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
+    
+    const VkPhysicalDeviceMemoryProperties& getMemoryProperties() const { return memoryProperties; }
+    HeapStats getHeapStats(uint32_t heapIndex) const;
+    void printStats() const;
+
+private:
+    struct FreeRange {
+        VkDeviceSize offset;
+        VkDeviceSize size;
+    };
+    
+    struct Block {
+        uint32_t id;
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkDeviceSize size = 0;
+        VkDeviceSize usedBytes = 0;
+        uint32_t memoryType = 0;
+        bool linear = true;
+        void* mapped = nullptr;
+        uint32_t allocationCount = 0;
+        std::vector<FreeRange> freeRanges;  // Sorted by offset, never adjacent
+    };
+    
+    bool allocateFromBlock(Block& block, VkDeviceSize size, VkDeviceSize alignment, Allocation& allocation);
+    Block& createBlock(uint32_t memoryType, bool linear);
+    VkDeviceMemory allocateDeviceMemory(uint32_t memoryType, VkDeviceSize size, void** mapped);
+    void releaseDeviceMemory(VkDeviceMemory memory, uint32_t memoryType, VkDeviceSize size);
+    VkDeviceSize preferredBlockSize(uint32_t memoryType) const;
+    bool isCoherent(uint32_t memoryType) const;
+    
+    VulkanContext* context;
+    VkDeviceSize blockSize;
+    
+    VkPhysicalDeviceMemoryProperties memoryProperties{};
+    VkDeviceSize nonCoherentAtomSize = 1;
+    uint32_t maxAllocationCount = 0;
+    uint32_t driverAllocationCount = 0;
+    
+    std::vector<std::unique_ptr<Block>> blocks;
+    uint32_t nextBlockId = 1;
+    
+    // Per heap, indexed like memoryProperties.memoryHeaps
+    std::vector<HeapStats> heapStats;
+};
\ No newline at end of file
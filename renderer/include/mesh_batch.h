@@ -0,0 +1,89 @@
+#pragma once
+
+#include "buffer.h"
+#include "pipeline.h"
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+class VulkanContext;
+
+// Many meshes that share a pipeline, drawn with one indirect call
+// The geometry of every mesh lives in one vertex and one index megabuffer;
+// each draw is a VkDrawIndexedIndirectCommand selecting one mesh's range and
+// a range of instances. Draw commands are written into a persistently mapped
+// region per frame in flight and issued with a single
+// vkCmdDrawIndexedIndirect when the device supports multiDrawIndirect (one
+// vkCmdDrawIndexed per draw otherwise). Indices are 16-bit unless a mesh
+// needs more
+class MeshBatch {
+public:
+    // Vertices of every mesh are packed into vertexFormat
+    MeshBatch(VulkanContext* context, uint32_t frameCount, uint32_t maxDraws = 65536,
+              const VertexFormat& vertexFormat = VertexFormat::standard());
+    ~MeshBatch();
+    
+    MeshBatch(const MeshBatch&) = delete;
+    MeshBatch& operator=(const MeshBatch&) = delete;
+    
+    // Append a mesh to the megabuffers; non-indexed meshes get sequential indices
+    // All meshes must be added before build(). Returns the mesh id
+    uint32_t addMesh(const std::vector<Vertex>& vertices, const std::vector<uint16_t>& indices = {});
+    uint32_t addMesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices);
+    
+    // Upload the megabuffers and create the indirect buffer
+    void build();
+    
+    // Start frameIndex's draw list; its previous commands must no longer be in use
+    void beginFrame(uint32_t frameIndex);
+    
+    // Draw instanceCount instances of a mesh, starting at firstInstance in the instance buffer
+    void addDraw(uint32_t meshId, uint32_t instanceCount = 1, uint32_t firstInstance = 0);
+    
+    // Record this frame's draws; instances supplies binding 1 (InstanceData)
+    void record(VkCommandBuffer commandBuffer, const Buffer& instances);
+    
+    uint32_t getMeshCount() const { return static_cast<uint32_t>(meshes.size()); }
+    uint32_t getDrawCount() const { return static_cast<uint32_t>(draws.size()); }
+    bool usesMultiDrawIndirect() const { return multiDrawIndirect; }
+    VkIndexType getIndexType() const { return indexType; }
+    
+    // Upload timeline value after which the megabuffers hold their data
+    uint64_t getUploadValue() const { return uploadValue; }
+    
+private:
+    struct MeshRange {
+        uint32_t firstIndex;
+        uint32_t indexCount;
+        int32_t vertexOffset;
+    };
+    
+    // Shared by both addMesh overloads; one of inds16 and inds32 holds the indices
+    uint32_t addMeshIndices(const std::vector<Vertex>& vertices, const uint16_t* inds16,
+                            const uint32_t* inds32, size_t indexCount);
+    
+    VulkanContext* context;
+    uint32_t frameCount;
+    uint32_t maxDraws;
+    VertexFormat vertexFormat;
+    
+    // Geometry staged on the CPU until build(); indices are narrowed to 16
+    // bits there if they all fit
+    std::vector<uint8_t> vertexData;
+    uint32_t vertexCount = 0;
+    std::vector<uint32_t> indices;
+    std::vector<MeshRange> meshes;
+    VkIndexType indexType = VK_INDEX_TYPE_UINT16;
+    
+    std::unique_ptr<Buffer> vertexBuffer;
+    std::unique_ptr<Buffer> indexBuffer;
+    std::unique_ptr<Buffer> indirectBuffer;
+    uint64_t uploadValue = 0;
+    
+    bool multiDrawIndirect = false;
+    uint32_t maxDrawIndirectCount = 1;
+    
+    uint32_t currentFrame = 0;
+    std::vector<VkDrawIndexedIndirectCommand> draws;  // Current frame's draw list
+};
\ No newline at end of file
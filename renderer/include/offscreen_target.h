@@ -0,0 +1,48 @@
+#pragma once
+
+#include "memory_allocator.h"
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <vector>
+
+class VulkanContext;
+
+// Color images drawn to in place of swapchain images, for rendering without
+// a window or surface (headless benchmarks on machines without a display)
+// There is one image per frame in flight, so a frame only ever waits on its
+// own fence; nothing is acquired or presented. The render pass matches the
+// swapchain's except that images stay in COLOR_ATTACHMENT_OPTIMAL
+class OffscreenTarget {
+public:
+    OffscreenTarget(VulkanContext* context, uint32_t width, uint32_t height, uint32_t imageCount,
+                    VkFormat format = VK_FORMAT_B8G8R8A8_SRGB);
+    ~OffscreenTarget();
+    
+    OffscreenTarget(const OffscreenTarget&) = delete;
+    OffscreenTarget& operator=(const OffscreenTarget&) = delete;
+    
+    void create();
+    void cleanup();
+    
+    VkFormat getImageFormat() const { return format; }
+    VkExtent2D getExtent() const { return extent; }
+    VkRenderPass getRenderPass() const { return renderPass; }
+    const std::vector<VkImage>& getImages() const { return images; }
+    const std::vector<VkFramebuffer>& getFramebuffers() const { return framebuffers; }
+    
+private:
+    void createImages();
+    void createRenderPass();
+    void createFramebuffers();
+    
+    VulkanContext* context;
+    VkExtent2D extent;
+    uint32_t imageCount;
+    VkFormat format;
+    
+    std::vector<VkImage> images;
+    std::vector<MemoryAllocator::Allocation> allocations;
+    std::vector<VkImageView> imageViews;
+    std::vector<VkFramebuffer> framebuffers;
+    VkRenderPass renderPass = VK_NULL_HANDLE;
+};
\ No newline at end of file
@@ -1,36 +1,87 @@
 #pragma once
 
+#include "vertex_format.h"
 #include <vulkan/vulkan.h>
-#include <glm/glm.hpp>
 #include <vector>
 #include <string>
 
 class VulkanContext;
 class Swapchain;
+class PipelineCache;
+class ShaderLoader;
+class ShaderLibrary;
+struct ShaderReflection;
 
-struct Vertex {
-    glm::vec3 position;
-    glm::vec3 color;
-    
-    static VkVertexInputBindingDescription getBindingDescription();
-    static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions();
+// Specialization constant values for each stage (either may be null)
+// Ids are the DSL's 'const' declarations in order; the infos and their
+// data only need to live until create() returns
+struct PipelineSpecialization {
+    const VkSpecializationInfo* vertex = nullptr;
+    const VkSpecializationInfo* fragment = nullptr;
 };
 
 class Pipeline {
 public:
-    Pipeline(VulkanContext* context, Swapchain* swapchain);
+    // pipelineCache is optional; when given, every creation goes through it
+    Pipeline(VulkanContext* context, Swapchain* swapchain, PipelineCache* pipelineCache = nullptr);
     ~Pipeline();
     
-    void create(const std::string& vertShaderPath, const std::string& fragShaderPath);
+    void create(const std::string& vertShaderPath, const std::string& fragShaderPath,
+                const PipelineSpecialization& specialization = {});
+    
+    // Build from SPIR-V in memory against an explicit render pass; safe to
+    // call off the main thread (used by shader hot reload)
+    void create(const std::vector<uint32_t>& vertSpirv, const std::vector<uint32_t>& fragSpirv,
+                VkRenderPass renderPass, const PipelineSpecialization& specialization = {});
+    
+    // Build from modules of a shader pack; the library keeps ownership of them
+    void create(ShaderLibrary& library, const std::string& vertShader, const std::string& fragShader,
+                const PipelineSpecialization& specialization = {});
+    
+    // Layout of vertex binding 0 for later create() calls (standard() by default)
+    // Binding 1 is always InstanceData; the vertex input state holds just the
+    // attributes at the locations the vertex shader reads
+    void setVertexFormat(const VertexFormat& format) { vertexFormat = format; }
+    const VertexFormat& getVertexFormat() const { return vertexFormat; }
+    
+    // Render pass for the create() overloads that take none; the swapchain's
+    // when unset. Offscreen pipelines set it and pass a null swapchain
+    void setRenderPass(VkRenderPass renderPass) { targetRenderPass = renderPass; }
+    
+    // Destroys the pipeline and its layout; the descriptor set layout is kept
+    // so descriptor sets allocated from it stay valid across rebuilds
     void cleanup();
     
     VkPipeline getPipeline() const { return graphicsPipeline; }
     VkPipelineLayout getLayout() const { return pipelineLayout; }
+    VkRenderPass getRenderPass() const { return builtRenderPass; }
     
+    // Set 0: one dynamic uniform buffer per stage, binding 0 (vertex) and
+    // binding 1 (fragment), matching the compiler's uniform blocks
+    VkDescriptorSetLayout getDescriptorSetLayout() const { return descriptorSetLayout; }
+
 private:
+    void createDescriptorSetLayout();
+    void createWithModules(ShaderLoader& loader, VkShaderModule vertShaderModule,
+                           VkShaderModule fragShaderModule, const ShaderReflection& vertexReflection,
+                           VkRenderPass renderPass, const PipelineSpecialization& specialization);
+    void createPipeline(VkShaderModule vertShaderModule, VkShaderModule fragShaderModule,
+                        const ShaderReflection& vertexReflection, VkRenderPass renderPass,
+                        const PipelineSpecialization& specialization);
+    
+    // Attributes of binding 0 and 1 for each located vertex shader input
+    std::vector<VkVertexInputAttributeDescription> matchVertexInputs(const ShaderReflection& vertexReflection) const;
+    
+    VkRenderPass defaultRenderPass() const;
+    
     VulkanContext* context;
     Swapchain* swapchain;
+    PipelineCache* pipelineCache;
+    VertexFormat vertexFormat = VertexFormat::standard();
+    VkRenderPass targetRenderPass = VK_NULL_HANDLE;
     
     VkPipeline graphicsPipeline = VK_NULL_HANDLE;
     VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+    VkDescriptorSetLayout descriptorSetLayout = VK_NULL_HANDLE;
+    VkRenderPass builtRenderPass = VK_NULL_HANDLE;  // The render pass the pipeline was created for
 };
\ No newline at end of file
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class VulkanContext;
+
+// Driver pipeline cache persisted across runs
+// The file stores the device identity next to the driver's blob, so a cache
+// written by another GPU or driver version is discarded instead of handed
+// to vkCreatePipelineCache
+class PipelineCache {
+public:
+    PipelineCache(VulkanContext* context, const std::string& filePath);
+    ~PipelineCache();
+    
+    // Create the cache, seeded from the file when it matches this device
+    void create();
+    
+    // Write the cache back to disk (if it changed) and destroy it
+    void cleanup();
+    
+    // Write the current contents to disk; returns false if the file could not be written
+    bool save();
+    
+    VkPipelineCache getCache() const { return pipelineCache; }
+    bool wasLoadedFromDisk() const { return loadedFromDisk; }
+    
+private:
+    std::vector<char> loadFile() const;
+    bool isCompatible(const std::vector<char>& data) const;
+    
+    VulkanContext* context;
+    std::string filePath;
+    
+    VkPipelineCache pipelineCache = VK_NULL_HANDLE;
+    VkPhysicalDeviceProperties deviceProperties{};
+    bool loadedFromDisk = false;
+    uint64_t savedHash = 0;  // Hash of the data last read or written, to skip redundant writes
+};
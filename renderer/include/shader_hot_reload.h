@@ -0,0 +1,80 @@
+#pragma once
+
+#include "vertex_format.h"
+#include <vulkan/vulkan.h>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class VulkanContext;
+class Swapchain;
+class PipelineCache;
+class Pipeline;
+
+// Rebuilds the pipeline when its DSL sources change
+// A background thread watches the directories of both sources (inotify on
+// Linux, modification-time polling elsewhere), recompiles the pair through
+// ShaderCompiler's native backend and creates the new pipeline through the
+// shared pipeline cache. The render loop only picks up finished pipelines,
+// so it never waits on a compile; compile errors are logged and the
+// current pipeline is kept
+class ShaderHotReloader {
+public:
+    // Rebuilt pipelines take vertex binding 0 in vertexFormat, like the meshes they draw
+    ShaderHotReloader(VulkanContext* context, Swapchain* swapchain, PipelineCache* pipelineCache,
+                      const std::string& vertSourcePath, const std::string& fragSourcePath,
+                      const VertexFormat& vertexFormat = VertexFormat::standard());
+    ~ShaderHotReloader();
+    
+    ShaderHotReloader(const ShaderHotReloader&) = delete;
+    ShaderHotReloader& operator=(const ShaderHotReloader&) = delete;
+    
+    // Start watching; pipelines are built against renderPass
+    void start(VkRenderPass renderPass);
+    
+    // Stop the thread and drop any pipeline that was not taken
+    void stop();
+    
+    // Call after the swapchain's render pass was recreated; a pending or
+    // future pipeline is rebuilt for it
+    void setRenderPass(VkRenderPass renderPass);
+    
+    // At a frame boundary: the newest pipeline built since the last call, or
+    // null. The caller owns it and must retire the one it replaces
+    std::unique_ptr<Pipeline> takeReadyPipeline();
+    
+private:
+    void watchLoop();
+    bool sourcesChanged();  // Waits up to one poll interval
+    void rebuild(bool recompile);
+    
+    VulkanContext* context;
+    Swapchain* swapchain;
+    PipelineCache* pipelineCache;
+    std::string vertSourcePath;
+    std::string fragSourcePath;
+    VertexFormat vertexFormat;
+    
+    std::thread watcher;
+    std::atomic<bool> stopping{false};
+    int inotifyFd = -1;
+    std::vector<int64_t> lastWriteTimes;  // Polling fallback
+    
+    // Held while a pipeline is created, so the render pass it uses stays alive
+    std::mutex buildMutex;
+    
+    // Shared with the render loop
+    std::mutex mutex;
+    VkRenderPass renderPass = VK_NULL_HANDLE;
+    bool renderPassChanged = false;
+    std::unique_ptr<Pipeline> readyPipeline;
+    
+    // Last good SPIR-V, kept so a render pass change does not need a recompile
+    // Only touched by the watcher thread
+    std::vector<uint32_t> vertSpirv;
+    std::vector<uint32_t> fragSpirv;
+};
\ No newline at end of file
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "shader_pack.h"
+#include <vulkan/vulkan.h>
+#include <string>
+#include <vector>
+
+class VulkanContext;
+
+// Shader modules created from a memory-mapped shader pack
+// The pack is mapped once; each module is created from the mapped words on
+// first use (no copy) and kept until the library is destroyed. Not thread-safe
+class ShaderLibrary {
+public:
+    ShaderLibrary(VulkanContext* context, const std::string& packPath);
+    ~ShaderLibrary();
+    
+    ShaderLibrary(const ShaderLibrary&) = delete;
+    ShaderLibrary& operator=(const ShaderLibrary&) = delete;
+    
+    bool contains(const std::string& name) const { return pack.find(name) != pack.size(); }
+    
+    // Module for a pack entry, created and cached on the first call
+    VkShaderModule getModule(const std::string& name);
+    
+    // Interface of a pack entry, decoded from the pack's reflection records
+    ShaderReflection getReflection(const std::string& name) const;
+    
+    // Destroy every cached module and unmap the pack
+    void cleanup();
+    
+    const ShaderPack& getPack() const { return pack; }
+    
+private:
+    size_t indexOf(const std::string& name) const;  // Throws if the pack has no such entry
+    
+    VulkanContext* context;
+    ShaderPack pack;
+    std::vector<VkShaderModule> modules;  // Indexed like the pack's entries
+};
\ No newline at end of file
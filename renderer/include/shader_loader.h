@@ -14,13 +14,17 @@ public:
     // Load compiled SPIR-V shader from file
     VkShaderModule loadShaderModule(const std::string& filename);
     
+    // Read a compiled SPIR-V file without creating a module
+    std::vector<uint32_t> loadSpirv(const std::string& filename);
+    
     // Load SPIR-V from memory (used with custom compiler output)
     VkShaderModule createShaderModule(const std::vector<uint32_t>& code);
     
+    // Create straight from words owned elsewhere, such as a mapped shader pack
+    VkShaderModule createShaderModule(const uint32_t* code, size_t wordCount);
+    
     void destroyShaderModule(VkShaderModule module);
     
 private:
-    std::vector<char> readFile(const std::string& filename);
-    
     VulkanContext* context;
 };
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <vulkan/vulkan.h>
+#include <string>
 #include <vector>
 
 class VulkanContext;
@@ -13,12 +14,25 @@ struct SwapChainSupportDetails {
 
 class Swapchain {
 public:
-    Swapchain(VulkanContext* context, int width, int height);
+    Swapchain(VulkanContext* context, int width, int height,
+              VkPresentModeKHR preferredPresentMode = VK_PRESENT_MODE_MAILBOX_KHR);
     ~Swapchain();
     
     void create();
     void cleanup();
-    void recreate(int width, int height);
+    
+    // Build a new swapchain for the given size, handing the current one to
+    // the driver as oldSwapchain. Nothing is waited on: the previous
+    // swapchain, image views and framebuffers may still be referenced by
+    // frames in flight, so they are retired and kept until releaseRetired().
+    // The render pass is kept unless the surface format changed; returns
+    // true in that case, since pipelines built against it must be rebuilt
+    bool recreate(int width, int height);
+    
+    // Destroy resources retired by recreate(); call once every frame that
+    // was submitted before the recreate has completed
+    void releaseRetired();
+    bool hasRetired() const { return !retired.empty(); }
     
     VkSwapchainKHR getSwapchain() const { return swapchain; }
     VkFormat getImageFormat() const { return swapchainImageFormat; }
@@ -27,11 +41,30 @@ public:
     const std::vector<VkFramebuffer>& getFramebuffers() const { return swapchainFramebuffers; }
     VkRenderPass getRenderPass() const { return renderPass; }
     
+    // Present mode for the next create()/recreate(); FIFO, which every
+    // surface supports, is used when the surface lacks it
+    void setPreferredPresentMode(VkPresentModeKHR mode) { preferredPresentMode = mode; }
+    VkPresentModeKHR getPresentMode() const { return presentMode; }
+    bool isPresentModeSupported(VkPresentModeKHR mode);
+    
+    // "mailbox", "immediate", "fifo" and "fifo-relaxed"
+    static const char* presentModeName(VkPresentModeKHR mode);
+    static bool parsePresentMode(const std::string& name, VkPresentModeKHR& mode);
+    
     void createFramebuffers();
     
 private:
+    // Resources of a replaced swapchain, destroyed by releaseRetired()
+    struct RetiredResources {
+        VkSwapchainKHR swapchain = VK_NULL_HANDLE;
+        std::vector<VkImageView> imageViews;
+        std::vector<VkFramebuffer> framebuffers;
+        VkRenderPass renderPass = VK_NULL_HANDLE;
+    };
+    
     void createSwapchain();
     void createSwapchainWithOld(VkSwapchainKHR oldSwapchain);
+    void destroyResources(RetiredResources& resources);
     void createImageViews();
     void createRenderPass();
     
@@ -43,6 +76,8 @@ private:
     VulkanContext* context;
     int width;
     int height;
+    VkPresentModeKHR preferredPresentMode;
+    VkPresentModeKHR presentMode = VK_PRESENT_MODE_FIFO_KHR;
     
     VkSwapchainKHR swapchain = VK_NULL_HANDLE;
     std::vector<VkImage> swapchainImages;
@@ -51,4 +86,6 @@ private:
     std::vector<VkImageView> swapchainImageViews;
     std::vector<VkFramebuffer> swapchainFramebuffers;
     VkRenderPass renderPass = VK_NULL_HANDLE;
+    
+    std::vector<RetiredResources> retired;
 };
\ No newline at end of file
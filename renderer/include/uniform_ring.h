@@ -0,0 +1,58 @@
+#pragma once
+
+#include "buffer.h"
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <memory>
+
+class VulkanContext;
+
+// Per-frame uniform data in one persistently mapped buffer
+// The buffer is split into one region per frame in flight; each frame writes
+// its blocks linearly into its own region, so the CPU never touches memory
+// the GPU may still be reading. Blocks are addressed through dynamic offsets
+// into a single descriptor set instead of a descriptor update per draw
+class UniformRing {
+public:
+    // blockRange is the descriptor range: the largest block one push may hold
+    UniformRing(VulkanContext* context, uint32_t frameCount,
+                VkDeviceSize bytesPerFrame = 256 * 1024, VkDeviceSize blockRange = 256);
+    ~UniformRing();
+    
+    UniformRing(const UniformRing&) = delete;
+    UniformRing& operator=(const UniformRing&) = delete;
+    
+    // Allocates the buffer and a descriptor set of the given layout with
+    // bindings 0 and 1 pointing at it
+    void create(VkDescriptorSetLayout layout);
+    void cleanup();
+    
+    // Start writing frameIndex's region; its previous contents must no
+    // longer be in use (i.e. the frame's fence has been waited on)
+    void beginFrame(uint32_t frameIndex);
+    
+    // Copy a block into the current frame's region
+    // Returns its dynamic offset for vkCmdBindDescriptorSets
+    uint32_t push(const void* data, VkDeviceSize size);
+    
+    template <typename T>
+    uint32_t push(const T& data) { return push(&data, sizeof(T)); }
+    
+    VkDescriptorSet getDescriptorSet() const { return descriptorSet; }
+    VkBuffer getBuffer() const { return buffer ? buffer->getBuffer() : VK_NULL_HANDLE; }
+    VkDeviceSize getRange() const { return blockRange; }
+
+private:
+    VulkanContext* context;
+    uint32_t frameCount;
+    VkDeviceSize bytesPerFrame;
+    VkDeviceSize blockRange;
+    VkDeviceSize offsetAlignment = 256;
+    
+    std::unique_ptr<Buffer> buffer;
+    VkDeviceSize frameBegin = 0;  // Start of the current frame's region
+    VkDeviceSize frameHead = 0;   // Next free byte in it
+    
+    VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+    VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+};
\ No newline at end of file
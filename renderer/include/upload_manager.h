@@ -0,0 +1,78 @@
+#pragma once
+
+#include "buffer.h"
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <vector>
+
+class VulkanContext;
+
+// Batched, non-blocking buffer uploads
+// Data is copied into a persistently mapped staging ring and the copies are
+// recorded into one command buffer per batch, submitted on the transfer
+// queue (a dedicated transfer family when the device has one). Each batch
+// signals the next value of a timeline semaphore; staging space is reclaimed
+// once that value is reached, and consumers wait on it on the GPU instead
+// of idling a queue
+class UploadManager {
+public:
+    UploadManager(VulkanContext* context, VkDeviceSize stagingSize = 16 * 1024 * 1024);
+    ~UploadManager();
+    
+    UploadManager(const UploadManager&) = delete;
+    UploadManager& operator=(const UploadManager&) = delete;
+    
+    void create();
+    
+    // Waits for outstanding uploads, then destroys the staging ring and semaphore
+    void cleanup();
+    
+    // Queue a copy of size bytes into dst at dstOffset; the data is copied
+    // immediately, so it may be freed on return. Blocks only when the
+    // staging ring is full of uploads the GPU has not finished yet
+    // Returns the timeline value that marks the copy as complete
+    uint64_t upload(Buffer& dst, const void* data, VkDeviceSize size, VkDeviceSize dstOffset = 0);
+    
+    // Submit the copies queued since the last submit (no-op when there are none)
+    // Returns the value signalled once they are complete
+    uint64_t submit();
+    
+    bool isComplete(uint64_t value);
+    void wait(uint64_t value);
+    
+    // For a queue submit to wait on getLastSubmittedValue()
+    VkSemaphore getTimelineSemaphore() const { return timeline; }
+    uint64_t getLastSubmittedValue() const { return submittedValue; }
+
+private:
+    struct Batch {
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+        uint64_t value = 0;             // Timeline value signalled on completion
+        VkDeviceSize stagingBytes = 0;  // Ring bytes released on completion (including padding)
+    };
+    
+    VkDeviceSize reserveStaging(VkDeviceSize size);
+    bool tryReserve(VkDeviceSize size, VkDeviceSize& offset);
+    void beginBatch();
+    void retireCompleted();
+    
+    VulkanContext* context;
+    VkDeviceSize stagingSize;
+    
+    std::unique_ptr<Buffer> staging;
+    VkDeviceSize stagingHead = 0;  // Next free byte
+    VkDeviceSize stagingUsed = 0;  // Bytes owned by the open and in-flight batches
+    VkDeviceSize copyAlignment = 16;
+    
+    VkQueue queue = VK_NULL_HANDLE;
+    VkCommandPool commandPool = VK_NULL_HANDLE;
+    VkSemaphore timeline = VK_NULL_HANDLE;
+    uint64_t submittedValue = 0;
+    
+    bool batchOpen = false;
+    Batch openBatch;
+    std::deque<Batch> inFlight;  // Submitted, in submission order
+    std::vector<VkCommandBuffer> freeCommandBuffers;
+};
\ No newline at end of file
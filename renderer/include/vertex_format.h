@@ -0,0 +1,74 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+// Per-instance attributes, read from vertex binding 1
+struct InstanceData {
+    glm::vec3 offset;  // Added to the vertex position
+    float scale;
+};
+
+// Full-precision vertex as meshes are authored; packed by a VertexFormat on upload
+struct Vertex {
+    glm::vec3 position;
+    glm::vec3 color;
+};
+
+// Layout of one vertex buffer binding
+// Each attribute names the Vertex field it is encoded from and the Vulkan
+// format it is stored in, so one mesh can be uploaded full-precision or
+// packed. Pipelines take from it the attributes at the locations their
+// vertex shader reads (from its reflection); inputs there is no attribute
+// for fail pipeline creation
+class VertexFormat {
+public:
+    enum class Semantic {
+        POSITION,
+        COLOR,
+        NORMAL,  // From the normals passed to pack()
+        RAW      // Data already in this layout (instance data); pack() rejects it
+    };
+    
+    struct Attribute {
+        uint32_t location;
+        Semantic semantic;
+        VkFormat format;
+        uint32_t offset;
+    };
+    
+    // Append an attribute after the previous ones, 4-byte aligned
+    // Packable formats: R32G32B32(A32)_SFLOAT, R16G16(B16A16)_SFLOAT,
+    // R8G8B8A8_UNORM and A2B10G10R10_SNORM_PACK32
+    VertexFormat& add(uint32_t location, Semantic semantic, VkFormat format);
+    
+    // vec3 position, vec3 color: 24 bytes, the layout of Vertex itself
+    static VertexFormat standard();
+    
+    // Half-float position, RGBA8 color: 12 bytes
+    static VertexFormat compact();
+    
+    // compact() plus a 10:10:10:2 normal at location 4: 16 bytes
+    static VertexFormat compactWithNormals();
+    
+    // InstanceData, for binding 1
+    static VertexFormat instance();
+    
+    // Encode vertices into this layout; normals are needed if it has a NORMAL attribute
+    std::vector<uint8_t> pack(const std::vector<Vertex>& vertices,
+                              const std::vector<glm::vec3>& normals = {}) const;
+    
+    uint32_t getStride() const { return stride; }
+    const std::vector<Attribute>& getAttributes() const { return attributes; }
+    
+    // Attribute at a shader location, or null
+    const Attribute* find(uint32_t location) const;
+    
+    static uint32_t formatSize(VkFormat format);
+    
+private:
+    std::vector<Attribute> attributes;
+    uint32_t stride = 0;
+};
\ No newline at end of file
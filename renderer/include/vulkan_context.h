@@ -3,12 +3,17 @@
 #include <vulkan/vulkan.h>
 #include <GLFW/glfw3.h>
 #include <vector>
+#include <memory>
 #include <optional>
 #include <string>
 
+class MemoryAllocator;
+class UploadManager;
+
 struct QueueFamilyIndices {
     std::optional<uint32_t> graphicsFamily;
     std::optional<uint32_t> presentFamily;
+    std::optional<uint32_t> transferFamily;  // Transfer-only family, when the device has one
     
     bool isComplete() const {
         return graphicsFamily.has_value() && presentFamily.has_value();
@@ -20,17 +25,32 @@ public:
     VulkanContext();
     ~VulkanContext();
     
+    // A null window creates a headless context for offscreen rendering: no
+    // surface, no present queue and no swapchain extension, so GPUs without
+    // a display (and machines without a window system) qualify
     void init(GLFWwindow* window);
     void cleanup();
     
+    bool isHeadless() const { return headless; }
+    
     VkInstance getInstance() const { return instance; }
     VkPhysicalDevice getPhysicalDevice() const { return physicalDevice; }
     VkDevice getDevice() const { return device; }
     VkQueue getGraphicsQueue() const { return graphicsQueue; }
-    VkQueue getPresentQueue() const { return presentQueue; }
+    VkQueue getPresentQueue() const { return presentQueue; }  // Null when headless
+    VkQueue getTransferQueue() const { return transferQueue; }
+    uint32_t getTransferQueueFamily() const { return queueFamilies.transferFamily.value_or(queueFamilies.graphicsFamily.value()); }
     VkSurfaceKHR getSurface() const { return surface; }
     VkCommandPool getCommandPool() const { return commandPool; }
     QueueFamilyIndices getQueueFamilies() const { return queueFamilies; }
+    MemoryAllocator* getAllocator() const { return allocator.get(); }
+    UploadManager* getUploadManager() const { return uploadManager.get(); }
+    
+    // Optional core features that were available and turned on
+    const VkPhysicalDeviceFeatures& getEnabledFeatures() const { return enabledFeatures; }
+    
+    // VK_KHR_present_id and VK_KHR_present_wait are both enabled
+    bool isPresentWaitSupported() const { return presentWaitSupported; }
     
 private:
     void createInstance();
@@ -42,6 +62,7 @@ private:
     
     QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device);
     bool isDeviceSuitable(VkPhysicalDevice device);
+    bool hasDeviceExtension(VkPhysicalDevice device, const char* name);
     bool checkValidationLayerSupport();
     std::vector<const char*> getRequiredExtensions();
     
@@ -51,15 +72,24 @@ private:
     VkDevice device = VK_NULL_HANDLE;
     VkQueue graphicsQueue = VK_NULL_HANDLE;
     VkQueue presentQueue = VK_NULL_HANDLE;
+    VkQueue transferQueue = VK_NULL_HANDLE;  // The graphics queue when there is no transfer family
     VkSurfaceKHR surface = VK_NULL_HANDLE;
     VkCommandPool commandPool = VK_NULL_HANDLE;
     
+    // Shared by every Buffer; destroyed before the device
+    std::unique_ptr<MemoryAllocator> allocator;
+    std::unique_ptr<UploadManager> uploadManager;
+    
     QueueFamilyIndices queueFamilies;
+    VkPhysicalDeviceFeatures enabledFeatures{};
+    bool presentWaitSupported = false;
+    bool headless = false;
     
     const std::vector<const char*> validationLayers = {
         "VK_LAYER_KHRONOS_validation"
     };
     
+    // Required unless headless
     const std::vector<const char*> deviceExtensions = {
         VK_KHR_SWAPCHAIN_EXTENSION_NAME
     };
@@ -16,6 +16,19 @@ void Buffer::create(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropert
     bufferInfo.usage = usage;
     bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
     
+    // Upload targets are written on the transfer queue and read on the
+    // graphics queue; sharing them avoids queue family ownership transfers
+    auto indices = context->getQueueFamilies();
+    uint32_t queueFamilyIndices[] = {
+        indices.graphicsFamily.value(),
+        context->getTransferQueueFamily()
+    };
+    if ((usage & VK_BUFFER_USAGE_TRANSFER_DST_BIT) && queueFamilyIndices[0] != queueFamilyIndices[1]) {
+        bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+        bufferInfo.queueFamilyIndexCount = 2;
+        bufferInfo.pQueueFamilyIndices = queueFamilyIndices;
+    }
+    
     if (vkCreateBuffer(context->getDevice(), &bufferInfo, nullptr, &buffer) != VK_SUCCESS) {
         throw std::runtime_error("failed to create buffer!");
     }
@@ -23,16 +36,9 @@ void Buffer::create(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropert
     VkMemoryRequirements memRequirements;
     vkGetBufferMemoryRequirements(context->getDevice(), buffer, &memRequirements);
     
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
+    allocation = context->getAllocator()->allocate(memRequirements, properties);
     
-    if (vkAllocateMemory(context->getDevice(), &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS) {
-        throw std::runtime_error("failed to allocate buffer memory!");
-    }
-    
-    vkBindBufferMemory(context->getDevice(), buffer, bufferMemory, 0);
+    vkBindBufferMemory(context->getDevice(), buffer, allocation.memory, allocation.offset);
 }
 
 void Buffer::cleanup() {
@@ -41,62 +47,16 @@ void Buffer::cleanup() {
         buffer = VK_NULL_HANDLE;
     }
     
-    if (bufferMemory != VK_NULL_HANDLE) {
-        vkFreeMemory(context->getDevice(), bufferMemory, nullptr);
-        bufferMemory = VK_NULL_HANDLE;
+    if (allocation.isValid()) {
+        context->getAllocator()->free(allocation);
     }
 }
 
-void Buffer::copyData(const void* data, VkDeviceSize size) {
-    void* mappedData;
-    vkMapMemory(context->getDevice(), bufferMemory, 0, size, 0, &mappedData);
-    memcpy(mappedData, data, (size_t)size);
-    vkUnmapMemory(context->getDevice(), bufferMemory);
-}
-
-void Buffer::copyFrom(Buffer& srcBuffer, VkDeviceSize size) {
-    VkCommandBufferAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    allocInfo.commandPool = context->getCommandPool();
-    allocInfo.commandBufferCount = 1;
-    
-    VkCommandBuffer commandBuffer;
-    vkAllocateCommandBuffers(context->getDevice(), &allocInfo, &commandBuffer);
-    
-    VkCommandBufferBeginInfo beginInfo{};
-    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-    
-    vkBeginCommandBuffer(commandBuffer, &beginInfo);
-    
-    VkBufferCopy copyRegion{};
-    copyRegion.size = size;
-    vkCmdCopyBuffer(commandBuffer, srcBuffer.getBuffer(), buffer, 1, &copyRegion);
-    
-    vkEndCommandBuffer(commandBuffer);
-    
-    VkSubmitInfo submitInfo{};
-    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &commandBuffer;
-    
-    vkQueueSubmit(context->getGraphicsQueue(), 1, &submitInfo, VK_NULL_HANDLE);
-    vkQueueWaitIdle(context->getGraphicsQueue());
-    
-    vkFreeCommandBuffers(context->getDevice(), context->getCommandPool(), 1, &commandBuffer);
-}
-
-uint32_t Buffer::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) {
-    VkPhysicalDeviceMemoryProperties memProperties;
-    vkGetPhysicalDeviceMemoryProperties(context->getPhysicalDevice(), &memProperties);
-    
-    for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
-        if ((typeFilter & (1 << i)) &&
-            (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
-            return i;
-        }
+void Buffer::copyData(const void* data, VkDeviceSize size, VkDeviceSize offset) {
+    // Host-visible allocations are persistently mapped by the allocator
+    if (allocation.mapped == nullptr) {
+        throw std::runtime_error("buffer memory is not host visible!");
     }
-    
-    throw std::runtime_error("failed to find suitable memory type!");
+    memcpy(static_cast<char*>(allocation.mapped) + offset, data, (size_t)size);
+    context->getAllocator()->flush(allocation, offset, size);
 }
\ No newline at end of file
@@ -0,0 +1,205 @@
+#include "command_recorder.h"
+#include "vulkan_context.h"
+#include <algorithm>
+#include <stdexcept>
+
+CommandRecorder::CommandRecorder(VulkanContext* ctx, uint32_t frames, uint32_t threads)
+    : context(ctx), frameCount(frames), threadCount(threads) {
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+}
+
+CommandRecorder::~CommandRecorder() {
+    cleanup();
+}
+
+void CommandRecorder::create() {
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;  // Reset as a whole every frame
+    poolInfo.queueFamilyIndex = context->getQueueFamilies().graphicsFamily.value();
+    
+    pools.resize(frameCount);
+    for (auto& framePools : pools) {
+        framePools.resize(threadCount + 1);
+        for (auto& threadPool : framePools) {
+            if (vkCreateCommandPool(context->getDevice(), &poolInfo, nullptr, &threadPool.pool) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create recording command pool!");
+            }
+        }
+    }
+    
+    workReady = std::vector<std::condition_variable>(threadCount);
+    for (uint32_t i = 0; i < threadCount; i++) {
+        workers.emplace_back(&CommandRecorder::workerLoop, this, i);
+    }
+}
+
+void CommandRecorder::cleanup() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    for (auto& ready : workReady) {
+        ready.notify_one();
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    workers.clear();
+    stopping = false;
+    
+    // Destroying a pool frees every command buffer allocated from it
+    for (auto& framePools : pools) {
+        for (auto& threadPool : framePools) {
+            if (threadPool.pool != VK_NULL_HANDLE) {
+                vkDestroyCommandPool(context->getDevice(), threadPool.pool, nullptr);
+            }
+        }
+    }
+    pools.clear();
+}
+
+void CommandRecorder::beginFrame(uint32_t frameIndex) {
+    currentFrame = frameIndex % frameCount;
+    
+    for (auto& threadPool : pools[currentFrame]) {
+        if (threadPool.used > 0) {
+            vkResetCommandPool(context->getDevice(), threadPool.pool, 0);
+            threadPool.used = 0;
+        }
+    }
+}
+
+VkCommandBuffer CommandRecorder::getPrimaryCommandBuffer() {
+    ThreadPool& primaryPool = pools[currentFrame][threadCount];
+    if (primaryPool.used > 0) {
+        return primaryPool.buffers[0];
+    }
+    return acquireBuffer(primaryPool, VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+}
+
+std::vector<VkCommandBuffer> CommandRecorder::recordSecondaries(const VkCommandBufferInheritanceInfo& inheritance,
+                                                                uint32_t itemCount, const RecordFunction& record,
+                                                                uint32_t minItemsPerBuffer) {
+    if (itemCount == 0) {
+        return {};
+    }
+    
+    // Fewer, larger ranges when there is little work; one per thread at most
+    uint32_t rangeCount = (itemCount + minItemsPerBuffer - 1) / std::max(1u, minItemsPerBuffer);
+    rangeCount = std::max(1u, std::min(rangeCount, threadCount));
+    uint32_t itemsPerRange = (itemCount + rangeCount - 1) / rangeCount;
+    
+    std::vector<VkCommandBuffer> secondaries(rangeCount, VK_NULL_HANDLE);
+    
+    auto recordRange = [&](uint32_t threadIndex) {
+        if (threadIndex >= rangeCount) {
+            return;
+        }
+        uint32_t first = threadIndex * itemsPerRange;
+        if (first >= itemCount) {
+            return;
+        }
+        uint32_t count = std::min(itemsPerRange, itemCount - first);
+        
+        VkCommandBuffer commandBuffer = acquireBuffer(pools[currentFrame][threadIndex],
+                                                      VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+        
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT |
+                          VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+        beginInfo.pInheritanceInfo = &inheritance;
+        
+        if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+            throw std::runtime_error("failed to begin secondary command buffer!");
+        }
+        record(commandBuffer, first, count);
+        if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("failed to record secondary command buffer!");
+        }
+        
+        secondaries[threadIndex] = commandBuffer;
+    };
+    
+    // Handing a single range to a worker only adds a wake-up and a wait
+    if (rangeCount == 1) {
+        recordRange(0);
+        return secondaries;
+    }
+    
+    // Wake only the workers that have a range; the rest stay asleep
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        task = recordRange;
+        workerError = nullptr;
+        pending = rangeCount;
+        activeWorkers = rangeCount;
+        dispatchId++;
+        for (uint32_t i = 0; i < rangeCount; i++) {
+            workReady[i].notify_one();
+        }
+        workDone.wait(lock, [this] { return pending == 0; });
+        task = nullptr;
+    }
+    
+    if (workerError) {
+        std::rethrow_exception(workerError);
+    }
+    
+    // Ranges past the end of the items were never recorded
+    secondaries.erase(std::remove(secondaries.begin(), secondaries.end(), VK_NULL_HANDLE), secondaries.end());
+    return secondaries;
+}
+
+VkCommandBuffer CommandRecorder::acquireBuffer(ThreadPool& threadPool, VkCommandBufferLevel level) {
+    if (threadPool.used == threadPool.buffers.size()) {
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool = threadPool.pool;
+        allocInfo.level = level;
+        allocInfo.commandBufferCount = 1;
+        
+        VkCommandBuffer commandBuffer;
+        if (vkAllocateCommandBuffers(context->getDevice(), &allocInfo, &commandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate command buffer!");
+        }
+        threadPool.buffers.push_back(commandBuffer);
+    }
+    return threadPool.buffers[threadPool.used++];
+}
+
+void CommandRecorder::workerLoop(uint32_t threadIndex) {
+    uint64_t seenDispatch = 0;
+    
+    for (;;) {
+        std::function<void(uint32_t)> work;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            workReady[threadIndex].wait(lock, [&] {
+                return stopping || (dispatchId != seenDispatch && threadIndex < activeWorkers);
+            });
+            if (stopping) {
+                return;
+            }
+            seenDispatch = dispatchId;
+            work = task;
+        }
+        
+        try {
+            work(threadIndex);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!workerError) {
+                workerError = std::current_exception();
+            }
+        }
+        
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--pending == 0) {
+            workDone.notify_one();
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,177 @@
+#include "frame_pacer.h"
+#include "vulkan_context.h"
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+FramePacer::FramePacer(VulkanContext* ctx, bool pacing, uint32_t maxQueued)
+    : context(ctx), pacingRequested(pacing), maxQueuedPresents(std::max(1u, maxQueued)) {
+}
+
+void FramePacer::create() {
+    if (pacingRequested && context->isPresentWaitSupported()) {
+        waitForPresent = reinterpret_cast<PFN_vkWaitForPresentKHR>(
+            vkGetDeviceProcAddr(context->getDevice(), "vkWaitForPresentKHR"));
+    }
+    
+    presentIdInfo.sType = VK_STRUCTURE_TYPE_PRESENT_ID_KHR;
+    presentIdInfo.swapchainCount = 1;
+    presentIdInfo.pPresentIds = &lastPresentId;
+}
+
+void FramePacer::waitForPacing(VkSwapchainKHR swapchain) {
+    nextPacingWaitMs = 0.0;
+    if (!waitForPresent || lastPresentId <= maxQueuedPresents) {
+        return;
+    }
+    
+    uint64_t target = lastPresentId - maxQueuedPresents;
+    if (target <= lastShownId) {
+        return;
+    }
+    
+    Clock::time_point start = Clock::now();
+    VkResult result = waitForPresent(context->getDevice(), swapchain, target, PRESENT_WAIT_TIMEOUT_NS);
+    Clock::time_point shown = Clock::now();
+    nextPacingWaitMs = elapsedMs(start, shown);
+    
+    // A timeout or an out-of-date swapchain leaves the target unknown; it is
+    // not waited on again, so a lost present costs one timeout at most
+    lastShownId = target;
+    
+    // Presents are shown in order; earlier ones were either shown before the
+    // wait began or replaced (mailbox), so only the target's latency is known
+    while (!awaitingPresent.empty() && awaitingPresent.front().presentId <= target) {
+        PendingFrame& frame = awaitingPresent.front();
+        if (result == VK_SUCCESS && frame.presentId == target) {
+            frame.timings.inputToPresentMs = elapsedMs(frame.inputTime, shown);
+        }
+        finishFrame(frame.timings);
+        awaitingPresent.pop_front();
+    }
+}
+
+void FramePacer::beginFrame(uint64_t frameNumber) {
+    current = FrameTimings();
+    current.frameNumber = frameNumber;
+    current.pacingWaitMs = nextPacingWaitMs;
+    nextPacingWaitMs = 0.0;
+    
+    inputTime = Clock::now();
+    acquireEnd = inputTime;
+    frameOpen = true;
+}
+
+void FramePacer::beginStage(Stage) {
+    stageStart = Clock::now();
+}
+
+void FramePacer::endStage(Stage stage) {
+    Clock::time_point end = Clock::now();
+    double ms = elapsedMs(stageStart, end);
+    
+    switch (stage) {
+        case Stage::FenceWait:
+            current.fenceWaitMs += ms;
+            break;
+        case Stage::Acquire:
+            current.acquireMs += ms;
+            acquireEnd = end;
+            break;
+        case Stage::Record:
+            current.recordMs += ms;
+            break;
+        case Stage::Present:
+            current.presentMs += ms;
+            current.acquireToPresentMs = elapsedMs(acquireEnd, end);
+            break;
+    }
+}
+
+void FramePacer::preparePresent(VkPresentInfoKHR& presentInfo) {
+    if (!waitForPresent) {
+        return;
+    }
+    
+    lastPresentId++;
+    presentIdInfo.pNext = presentInfo.pNext;
+    presentInfo.pNext = &presentIdInfo;
+}
+
+void FramePacer::endFrame() {
+    if (!frameOpen) {
+        return;
+    }
+    frameOpen = false;
+    current.cpuFrameMs = elapsedMs(inputTime, Clock::now());
+    
+    if (waitForPresent) {
+        awaitingPresent.push_back({current, inputTime, lastPresentId});
+    } else {
+        finishFrame(current);
+    }
+}
+
+void FramePacer::resetSwapchain() {
+    for (const PendingFrame& frame : awaitingPresent) {
+        finishFrame(frame.timings);
+    }
+    awaitingPresent.clear();
+    lastPresentId = 0;
+    lastShownId = 0;
+}
+
+void FramePacer::printStats() const {
+    if (history.empty()) {
+        return;
+    }
+    
+    auto report = [&](const char* name, double FrameTimings::*field) {
+        std::vector<double> values;
+        for (const FrameTimings& frame : history) {
+            if (frame.*field >= 0.0) {
+                values.push_back(frame.*field);
+            }
+        }
+        if (values.empty()) {
+            return;
+        }
+        
+        double sum = 0.0;
+        for (double value : values) {
+            sum += value;
+        }
+        size_t p99 = std::min(values.size() - 1, values.size() * 99 / 100);
+        std::nth_element(values.begin(), values.begin() + p99, values.end());
+        
+        std::cout << "  " << std::left << std::setw(20) << name << std::right
+                  << std::setw(9) << sum / values.size() << " ms avg"
+                  << std::setw(9) << values[p99] << " ms p99" << std::endl;
+    };
+    
+    std::cout << "Frame pacing over the last " << history.size() << " frames"
+              << (isPacing() ? " (present wait, " + std::to_string(maxQueuedPresents) + " queued):" : ":")
+              << std::fixed << std::setprecision(3) << std::endl;
+    report("pacing wait", &FrameTimings::pacingWaitMs);
+    report("fence wait", &FrameTimings::fenceWaitMs);
+    report("acquire", &FrameTimings::acquireMs);
+    report("record + submit", &FrameTimings::recordMs);
+    report("present", &FrameTimings::presentMs);
+    report("acquire to present", &FrameTimings::acquireToPresentMs);
+    report("cpu frame", &FrameTimings::cpuFrameMs);
+    report("input to present", &FrameTimings::inputToPresentMs);
+    std::cout << std::defaultfloat;
+}
+
+double FramePacer::elapsedMs(Clock::time_point from, Clock::time_point to) {
+    return std::chrono::duration<double, std::milli>(to - from).count();
+}
+
+void FramePacer::finishFrame(const FrameTimings& timings) {
+    history.push_back(timings);
+    if (history.size() > HISTORY_FRAMES) {
+        history.pop_front();
+    }
+}
\ No newline at end of file
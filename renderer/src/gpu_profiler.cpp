@@ -0,0 +1,275 @@
+#include "gpu_profiler.h"
+#include "vulkan_context.h"
+#include <algorithm>
+#include <stdexcept>
+
+GpuProfiler::GpuProfiler(VulkanContext* ctx, uint32_t frames, uint32_t scopes, bool statistics)
+    : context(ctx), frameCount(frames), maxScopes(scopes), statisticsRequested(statistics) {
+}
+
+GpuProfiler::~GpuProfiler() {
+    cleanup();
+}
+
+void GpuProfiler::create() {
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(context->getPhysicalDevice(), &deviceProperties);
+    timestampPeriodNs = deviceProperties.limits.timestampPeriod;
+    
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(context->getPhysicalDevice(), &queueFamilyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(context->getPhysicalDevice(), &queueFamilyCount, queueFamilies.data());
+    
+    uint32_t validBits = queueFamilies[context->getQueueFamilies().graphicsFamily.value()].timestampValidBits;
+    if (validBits == 0) {
+        // Profiling is optional; every call becomes a no-op
+        return;
+    }
+    timestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+    
+    // Two timestamps per scope, one slice per frame in flight
+    VkQueryPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    poolInfo.queryCount = frameCount * maxScopes * 2;
+    
+    if (vkCreateQueryPool(context->getDevice(), &poolInfo, nullptr, &timestampPool) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create timestamp query pool!");
+    }
+    
+    // Draws are recorded into secondaries, so the query has to be inherited
+    const VkPhysicalDeviceFeatures& features = context->getEnabledFeatures();
+    if (statisticsRequested && features.pipelineStatisticsQuery && features.inheritedQueries) {
+        statisticFlags = VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+                         VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+        
+        VkQueryPoolCreateInfo statisticsInfo{};
+        statisticsInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        statisticsInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+        statisticsInfo.queryCount = frameCount;
+        statisticsInfo.pipelineStatistics = statisticFlags;
+        
+        if (vkCreateQueryPool(context->getDevice(), &statisticsInfo, nullptr, &statisticsPool) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create pipeline statistics query pool!");
+        }
+    }
+    
+    slots.assign(frameCount, FrameSlot());
+}
+
+void GpuProfiler::cleanup() {
+    if (statisticsPool != VK_NULL_HANDLE) {
+        vkDestroyQueryPool(context->getDevice(), statisticsPool, nullptr);
+        statisticsPool = VK_NULL_HANDLE;
+    }
+    if (timestampPool != VK_NULL_HANDLE) {
+        vkDestroyQueryPool(context->getDevice(), timestampPool, nullptr);
+        timestampPool = VK_NULL_HANDLE;
+    }
+    slots.clear();
+    csv.close();
+}
+
+void GpuProfiler::beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex, uint64_t frameNumber) {
+    if (!isSupported()) {
+        return;
+    }
+    
+    currentSlot = frameIndex % frameCount;
+    FrameSlot& slot = slots[currentSlot];
+    
+    // This slot's fence has been waited on, so its last frame is complete
+    if (slot.recorded) {
+        resolve(slot, currentSlot);
+    }
+    
+    slot = FrameSlot();
+    slot.recorded = true;
+    slot.frameNumber = frameNumber;
+    openDepth = 0;
+    
+    vkCmdResetQueryPool(commandBuffer, timestampPool, currentSlot * maxScopes * 2, maxScopes * 2);
+    if (hasStatistics()) {
+        vkCmdResetQueryPool(commandBuffer, statisticsPool, currentSlot, 1);
+    }
+    
+    beginScope(commandBuffer, "frame");
+}
+
+void GpuProfiler::endFrame(VkCommandBuffer commandBuffer) {
+    if (!isSupported()) {
+        return;
+    }
+    endScope(commandBuffer, 0);
+}
+
+uint32_t GpuProfiler::beginScope(VkCommandBuffer commandBuffer, const std::string& name) {
+    if (!isSupported()) {
+        return UINT32_MAX;
+    }
+    
+    FrameSlot& slot = slots[currentSlot];
+    if (slot.scopes.size() >= maxScopes) {
+        return UINT32_MAX;
+    }
+    
+    PendingScope scope;
+    scope.name = name;
+    scope.beginQuery = slot.queryCount++;
+    scope.depth = openDepth++;
+    slot.scopes.push_back(scope);
+    
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, timestampPool,
+                        currentSlot * maxScopes * 2 + scope.beginQuery);
+    return static_cast<uint32_t>(slot.scopes.size() - 1);
+}
+
+void GpuProfiler::endScope(VkCommandBuffer commandBuffer, uint32_t scopeIndex) {
+    if (!isSupported() || scopeIndex == UINT32_MAX) {
+        return;
+    }
+    
+    FrameSlot& slot = slots[currentSlot];
+    PendingScope& scope = slot.scopes[scopeIndex];
+    scope.endQuery = slot.queryCount++;
+    openDepth = scope.depth;
+    
+    // Bottom of pipe: the timestamp is written once all prior work has finished
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, timestampPool,
+                        currentSlot * maxScopes * 2 + scope.endQuery);
+}
+
+void GpuProfiler::beginStatistics(VkCommandBuffer commandBuffer) {
+    if (!hasStatistics()) {
+        return;
+    }
+    vkCmdBeginQuery(commandBuffer, statisticsPool, currentSlot, 0);
+    statisticsActive = true;
+}
+
+void GpuProfiler::endStatistics(VkCommandBuffer commandBuffer) {
+    if (!statisticsActive) {
+        return;
+    }
+    vkCmdEndQuery(commandBuffer, statisticsPool, currentSlot);
+    statisticsActive = false;
+    slots[currentSlot].statisticsRecorded = true;
+}
+
+void GpuProfiler::resolve(FrameSlot& slot, uint32_t frameIndex) {
+    if (slot.queryCount == 0) {
+        return;
+    }
+    
+    // No WAIT flag: a frame that is somehow not available is dropped, never waited for
+    std::vector<uint64_t> timestamps(slot.queryCount);
+    VkResult result = vkGetQueryPoolResults(context->getDevice(), timestampPool, frameIndex * maxScopes * 2,
+                                            slot.queryCount, timestamps.size() * sizeof(uint64_t),
+                                            timestamps.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+    if (result != VK_SUCCESS) {
+        return;
+    }
+    
+    FrameResult frame;
+    frame.frameNumber = slot.frameNumber;
+    uint64_t frameBegin = timestamps[slot.scopes[0].beginQuery] & timestampMask;
+    frame.gpuBeginTicks = frameBegin;
+    
+    double msPerTick = timestampPeriodNs / 1.0e6;
+    for (const auto& pending : slot.scopes) {
+        if (pending.endQuery == UINT32_MAX) {
+            continue;  // Never closed
+        }
+        uint64_t begin = timestamps[pending.beginQuery] & timestampMask;
+        uint64_t end = timestamps[pending.endQuery] & timestampMask;
+        
+        Scope scope;
+        scope.name = pending.name;
+        scope.depth = pending.depth;
+        scope.beginMs = static_cast<double>((begin - frameBegin) & timestampMask) * msPerTick;
+        scope.durationMs = static_cast<double>((end - begin) & timestampMask) * msPerTick;
+        frame.scopes.push_back(scope);
+    }
+    
+    if (slot.statisticsRecorded) {
+        // Results come in flag bit order: vertex invocations, then fragment invocations
+        uint64_t counts[2] = {};
+        if (vkGetQueryPoolResults(context->getDevice(), statisticsPool, frameIndex, 1, sizeof(counts), counts,
+                                  sizeof(counts), VK_QUERY_RESULT_64_BIT) == VK_SUCCESS) {
+            frame.hasStatistics = true;
+            frame.vertexInvocations = counts[0];
+            frame.fragmentInvocations = counts[1];
+        }
+    }
+    
+    if (csv.is_open()) {
+        writeCsvRows(frame);
+    }
+    
+    history.push_back(std::move(frame));
+    while (history.size() > historyLength) {
+        history.pop_front();
+    }
+}
+
+bool GpuProfiler::setCsvOutput(const std::string& path) {
+    csv.close();
+    csv.open(path, std::ios::trunc);
+    if (!csv) {
+        return false;
+    }
+    csv << "frame,scope,depth,begin_ms,duration_ms,vertex_invocations,fragment_invocations\n";
+    return true;
+}
+
+void GpuProfiler::writeCsvRows(const FrameResult& result) {
+    for (const auto& scope : result.scopes) {
+        csv << result.frameNumber << ',' << scope.name << ',' << scope.depth << ','
+            << scope.beginMs << ',' << scope.durationMs << ',';
+        if (result.hasStatistics) {
+            csv << result.vertexInvocations << ',' << result.fragmentInvocations;
+        } else {
+            csv << ',';
+        }
+        csv << '\n';
+    }
+    
+    // Keep the file usable while the application is still running
+    if (result.frameNumber % 60 == 0) {
+        csv.flush();
+    }
+}
+
+bool GpuProfiler::writeChromeTrace(const std::string& path) const {
+    std::ofstream file(path, std::ios::trunc);
+    if (!file) {
+        return false;
+    }
+    
+    // Complete ("X") events in microseconds on one GPU track; nesting follows from the times
+    uint64_t epoch = history.empty() ? 0 : history.front().gpuBeginTicks;
+    double usPerTick = timestampPeriodNs / 1.0e3;
+    
+    file << "{\"traceEvents\":[\n";
+    bool first = true;
+    for (const auto& frame : history) {
+        double frameUs = static_cast<double>((frame.gpuBeginTicks - epoch) & timestampMask) * usPerTick;
+        for (const auto& scope : frame.scopes) {
+            file << (first ? "" : ",\n")
+                 << "{\"name\":\"" << scope.name << "\",\"cat\":\"gpu\",\"ph\":\"X\",\"pid\":1,\"tid\":1"
+                 << ",\"ts\":" << frameUs + scope.beginMs * 1000.0
+                 << ",\"dur\":" << scope.durationMs * 1000.0
+                 << ",\"args\":{\"frame\":" << frame.frameNumber;
+            if (frame.hasStatistics && scope.depth == 0) {
+                file << ",\"vertex_invocations\":" << frame.vertexInvocations
+                     << ",\"fragment_invocations\":" << frame.fragmentInvocations;
+            }
+            file << "}}";
+            first = false;
+        }
+    }
+    file << "\n],\"displayTimeUnit\":\"ms\"}\n";
+    
+    return static_cast<bool>(file);
+}
\ No newline at end of file
@@ -0,0 +1,317 @@
+#include "memory_allocator.h"
+#include "vulkan_context.h"
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+namespace {
+
+VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+VkDeviceSize alignDown(VkDeviceSize value, VkDeviceSize alignment) {
+    return value / alignment * alignment;
+}
+
+} // namespace
+
+MemoryAllocator::MemoryAllocator(VulkanContext* ctx, VkDeviceSize size)
+    : context(ctx), blockSize(size) {
+}
+
+MemoryAllocator::~MemoryAllocator() {
+    cleanup();
+}
+
+void MemoryAllocator::create() {
+    vkGetPhysicalDeviceMemoryProperties(context->getPhysicalDevice(), &memoryProperties);
+    
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(context->getPhysicalDevice(), &deviceProperties);
+    nonCoherentAtomSize = std::max<VkDeviceSize>(1, deviceProperties.limits.nonCoherentAtomSize);
+    maxAllocationCount = deviceProperties.limits.maxMemoryAllocationCount;
+    
+    heapStats.assign(memoryProperties.memoryHeapCount, HeapStats());
+    for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++) {
+        heapStats[i].heapSize = memoryProperties.memoryHeaps[i].size;
+    }
+}
+
+void MemoryAllocator::cleanup() {
+    for (auto& block : blocks) {
+        if (block->allocationCount > 0) {
+            std::cerr << "MemoryAllocator: freeing block with " << block->allocationCount
+                      << " live allocation(s)" << std::endl;
+        }
+        
+        // Allocations still in the block go with it
+        HeapStats& stats = heapStats[memoryProperties.memoryTypes[block->memoryType].heapIndex];
+        stats.allocationCount -= block->allocationCount;
+        stats.usedBytes -= block->usedBytes;
+        stats.blockCount--;
+        releaseDeviceMemory(block->memory, block->memoryType, block->size);
+    }
+    blocks.clear();
+}
+
+MemoryAllocator::Allocation MemoryAllocator::allocate(const VkMemoryRequirements& requirements,
+                                                      VkMemoryPropertyFlags properties, bool linear) {
+    uint32_t memoryType = findMemoryType(requirements.memoryTypeBits, properties);
+    
+    VkDeviceSize size = requirements.size;
+    VkDeviceSize alignment = std::max<VkDeviceSize>(1, requirements.alignment);
+    if (!isCoherent(memoryType)) {
+        // Keep flush ranges of neighbouring allocations from overlapping
+        size = alignUp(size, nonCoherentAtomSize);
+        alignment = std::max(alignment, nonCoherentAtomSize);
+    }
+    
+    Allocation allocation;
+    allocation.memoryType = memoryType;
+    
+    // Large resources get their own allocation rather than fragmenting a block
+    if (size > preferredBlockSize(memoryType) / 2) {
+        allocation.memory = allocateDeviceMemory(memoryType, size, &allocation.mapped);
+        allocation.size = size;
+        
+        HeapStats& stats = heapStats[memoryProperties.memoryTypes[memoryType].heapIndex];
+        stats.dedicatedCount++;
+        stats.allocationCount++;
+        stats.usedBytes += size;
+        return allocation;
+    }
+    
+    for (auto& block : blocks) {
+        if (block->memoryType == memoryType && block->linear == linear &&
+            allocateFromBlock(*block, size, alignment, allocation)) {
+            return allocation;
+        }
+    }
+    
+    Block& block = createBlock(memoryType, linear);
+    if (!allocateFromBlock(block, size, alignment, allocation)) {
+        throw std::runtime_error("failed to sub-allocate buffer memory!");
+    }
+    return allocation;
+}
+
+void MemoryAllocator::free(Allocation& allocation) {
+    if (!allocation.isValid()) {
+        return;
+    }
+    
+    HeapStats& stats = heapStats[memoryProperties.memoryTypes[allocation.memoryType].heapIndex];
+    stats.allocationCount--;
+    stats.usedBytes -= allocation.size;
+    
+    if (allocation.blockId == 0) {
+        stats.dedicatedCount--;
+        releaseDeviceMemory(allocation.memory, allocation.memoryType, allocation.size);
+        allocation = Allocation();
+        return;
+    }
+    
+    auto it = std::find_if(blocks.begin(), blocks.end(),
+                           [&](const std::unique_ptr<Block>& b) { return b->id == allocation.blockId; });
+    if (it == blocks.end()) {
+        throw std::runtime_error("freeing memory from an unknown block!");
+    }
+    Block& block = **it;
+    
+    // Insert the range in offset order, merging with the neighbours it touches
+    FreeRange range = {allocation.offset, allocation.size};
+    auto next = std::lower_bound(block.freeRanges.begin(), block.freeRanges.end(), range.offset,
+                                 [](const FreeRange& r, VkDeviceSize offset) { return r.offset < offset; });
+    if (next != block.freeRanges.begin()) {
+        auto prev = next - 1;
+        if (prev->offset + prev->size == range.offset) {
+            range.offset = prev->offset;
+            range.size += prev->size;
+            next = block.freeRanges.erase(prev);
+        }
+    }
+    if (next != block.freeRanges.end() && range.offset + range.size == next->offset) {
+        range.size += next->size;
+        next = block.freeRanges.erase(next);
+    }
+    block.freeRanges.insert(next, range);
+    
+    block.usedBytes -= allocation.size;
+    block.allocationCount--;
+    allocation = Allocation();
+    
+    // Keep at most one empty block per memory type, so short-lived staging
+    // buffers do not allocate and free a block every time
+    if (block.allocationCount == 0) {
+        auto spare = std::find_if(blocks.begin(), blocks.end(), [&](const std::unique_ptr<Block>& b) {
+            return b.get() != &block && b->allocationCount == 0 &&
+                   b->memoryType == block.memoryType && b->linear == block.linear;
+        });
+        if (spare != blocks.end()) {
+            releaseDeviceMemory(block.memory, block.memoryType, block.size);
+            stats.blockCount--;
+            blocks.erase(it);
+        }
+    }
+}
+
+void MemoryAllocator::flush(const Allocation& allocation, VkDeviceSize offset, VkDeviceSize size) {
+    if (!allocation.isValid() || isCoherent(allocation.memoryType)) {
+        return;
+    }
+    
+    if (size == VK_WHOLE_SIZE) {
+        size = allocation.size - offset;
+    }
+    
+    // Allocations are atom aligned, so the widened range stays inside this one
+    VkDeviceSize begin = alignDown(allocation.offset + offset, nonCoherentAtomSize);
+    VkDeviceSize end = alignUp(allocation.offset + offset + size, nonCoherentAtomSize);
+    
+    VkMappedMemoryRange range{};
+    range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+    range.memory = allocation.memory;
+    range.offset = begin;
+    range.size = end - begin;
+    
+    if (vkFlushMappedMemoryRanges(context->getDevice(), 1, &range) != VK_SUCCESS) {
+        throw std::runtime_error("failed to flush mapped memory!");
+    }
+}
+
+uint32_t MemoryAllocator::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const {
+    for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+        if ((typeFilter & (1 << i)) &&
+            (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+            return i;
+        }
+    }
+    
+    throw std::runtime_error("failed to find suitable memory type!");
+}
+
+MemoryAllocator::HeapStats MemoryAllocator::getHeapStats(uint32_t heapIndex) const {
+    return heapIndex < heapStats.size() ? heapStats[heapIndex] : HeapStats();
+}
+
+void MemoryAllocator::printStats() const {
+    std::cout << "GPU memory (" << driverAllocationCount << " driver allocations):" << std::endl;
+    for (uint32_t i = 0; i < heapStats.size(); i++) {
+        const HeapStats& stats = heapStats[i];
+        if (stats.allocatedBytes == 0) {
+            continue;
+        }
+        bool deviceLocal = (memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+        std::cout << "  heap " << i << (deviceLocal ? " (device local)" : " (host)") << ": "
+                  << stats.usedBytes / 1024 << " KB used of " << stats.allocatedBytes / 1024
+                  << " KB in " << stats.blockCount << " block(s) + " << stats.dedicatedCount
+                  << " dedicated, " << stats.allocationCount << " allocation(s)" << std::endl;
+    }
+}
+
+bool MemoryAllocator::allocateFromBlock(Block& block, VkDeviceSize size, VkDeviceSize alignment,
+                                        Allocation& allocation) {
+    // First fit; alignment padding stays in the free list
+    for (size_t i = 0; i < block.freeRanges.size(); i++) {
+        FreeRange& range = block.freeRanges[i];
+        VkDeviceSize offset = alignUp(range.offset, alignment);
+        VkDeviceSize rangeEnd = range.offset + range.size;
+        if (offset + size > rangeEnd) {
+            continue;
+        }
+        
+        VkDeviceSize end = offset + size;
+        if (offset > range.offset) {
+            range.size = offset - range.offset;
+            if (end < rangeEnd) {
+                block.freeRanges.insert(block.freeRanges.begin() + i + 1, FreeRange{end, rangeEnd - end});
+            }
+        } else if (end < rangeEnd) {
+            range.offset = end;
+            range.size = rangeEnd - end;
+        } else {
+            block.freeRanges.erase(block.freeRanges.begin() + i);
+        }
+        
+        allocation.memory = block.memory;
+        allocation.offset = offset;
+        allocation.size = size;
+        allocation.mapped = block.mapped ? static_cast<char*>(block.mapped) + offset : nullptr;
+        allocation.blockId = block.id;
+        
+        block.usedBytes += size;
+        block.allocationCount++;
+        
+        HeapStats& stats = heapStats[memoryProperties.memoryTypes[block.memoryType].heapIndex];
+        stats.allocationCount++;
+        stats.usedBytes += size;
+        return true;
+    }
+    return false;
+}
+
+MemoryAllocator::Block& MemoryAllocator::createBlock(uint32_t memoryType, bool linear) {
+    auto block = std::make_unique<Block>();
+    block->id = nextBlockId++;
+    block->size = preferredBlockSize(memoryType);
+    block->memoryType = memoryType;
+    block->linear = linear;
+    block->memory = allocateDeviceMemory(memoryType, block->size, &block->mapped);
+    block->freeRanges.push_back(FreeRange{0, block->size});
+    
+    heapStats[memoryProperties.memoryTypes[memoryType].heapIndex].blockCount++;
+    
+    blocks.push_back(std::move(block));
+    return *blocks.back();
+}
+
+VkDeviceMemory MemoryAllocator::allocateDeviceMemory(uint32_t memoryType, VkDeviceSize size, void** mapped) {
+    if (maxAllocationCount > 0 && driverAllocationCount >= maxAllocationCount) {
+        throw std::runtime_error("failed to allocate buffer memory: maxMemoryAllocationCount reached!");
+    }
+    
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = size;
+    allocInfo.memoryTypeIndex = memoryType;
+    
+    VkDeviceMemory memory;
+    if (vkAllocateMemory(context->getDevice(), &allocInfo, nullptr, &memory) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate buffer memory!");
+    }
+    
+    // Host-visible memory stays mapped: a VkDeviceMemory can only be mapped
+    // once at a time, and every sub-allocation shares the block's mapping
+    *mapped = nullptr;
+    if (memoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+        if (vkMapMemory(context->getDevice(), memory, 0, VK_WHOLE_SIZE, 0, mapped) != VK_SUCCESS) {
+            vkFreeMemory(context->getDevice(), memory, nullptr);
+            throw std::runtime_error("failed to map buffer memory!");
+        }
+    }
+    
+    driverAllocationCount++;
+    heapStats[memoryProperties.memoryTypes[memoryType].heapIndex].allocatedBytes += size;
+    return memory;
+}
+
+void MemoryAllocator::releaseDeviceMemory(VkDeviceMemory memory, uint32_t memoryType, VkDeviceSize size) {
+    // Freeing implicitly unmaps
+    vkFreeMemory(context->getDevice(), memory, nullptr);
+    driverAllocationCount--;
+    heapStats[memoryProperties.memoryTypes[memoryType].heapIndex].allocatedBytes -= size;
+}
+
+VkDeviceSize MemoryAllocator::preferredBlockSize(uint32_t memoryType) const {
+    // Small heaps (integrated GPUs, the 256 MB BAR heap) get smaller blocks
+    VkDeviceSize heapSize = memoryProperties.memoryHeaps[memoryProperties.memoryTypes[memoryType].heapIndex].size;
+    if (heapSize <= 1024ull * 1024 * 1024) {
+        return std::min(blockSize, alignUp(heapSize / 8, 4096));
+    }
+    return blockSize;
+}
+
+bool MemoryAllocator::isCoherent(uint32_t memoryType) const {
+    return (memoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0;
+}
\ No newline at end of file
@@ -0,0 +1,162 @@
+#include "mesh_batch.h"
+#include "vulkan_context.h"
+#include "upload_manager.h"
+#include <algorithm>
+#include <stdexcept>
+
+MeshBatch::MeshBatch(VulkanContext* ctx, uint32_t frames, uint32_t draws, const VertexFormat& format)
+    : context(ctx), frameCount(frames), maxDraws(draws), vertexFormat(format) {
+}
+
+MeshBatch::~MeshBatch() {}
+
+uint32_t MeshBatch::addMesh(const std::vector<Vertex>& verts, const std::vector<uint16_t>& inds) {
+    return addMeshIndices(verts, inds.data(), nullptr, inds.size());
+}
+
+uint32_t MeshBatch::addMesh(const std::vector<Vertex>& verts, const std::vector<uint32_t>& inds) {
+    return addMeshIndices(verts, nullptr, inds.data(), inds.size());
+}
+
+uint32_t MeshBatch::addMeshIndices(const std::vector<Vertex>& verts, const uint16_t* inds16,
+                                   const uint32_t* inds32, size_t indexCount) {
+    if (vertexBuffer) {
+        throw std::runtime_error("cannot add meshes to a built mesh batch!");
+    }
+    
+    // Indices stay relative to the mesh; vertexOffset rebases them at draw time
+    MeshRange range{};
+    range.firstIndex = static_cast<uint32_t>(indices.size());
+    range.vertexOffset = static_cast<int32_t>(vertexCount);
+    
+    std::vector<uint8_t> packed = vertexFormat.pack(verts);
+    vertexData.insert(vertexData.end(), packed.begin(), packed.end());
+    vertexCount += static_cast<uint32_t>(verts.size());
+    
+    if (indexCount == 0) {
+        for (size_t i = 0; i < verts.size(); i++) {
+            indices.push_back(static_cast<uint32_t>(i));
+        }
+    } else if (inds16) {
+        indices.insert(indices.end(), inds16, inds16 + indexCount);
+    } else {
+        indices.insert(indices.end(), inds32, inds32 + indexCount);
+    }
+    
+    range.indexCount = static_cast<uint32_t>(indices.size()) - range.firstIndex;
+    meshes.push_back(range);
+    return static_cast<uint32_t>(meshes.size() - 1);
+}
+
+void MeshBatch::build() {
+    if (meshes.empty()) {
+        throw std::runtime_error("mesh batch has no meshes!");
+    }
+    
+    // Batching into one call needs both features; firstInstance selects each
+    // draw's instances inside the shared instance buffer
+    const VkPhysicalDeviceFeatures& features = context->getEnabledFeatures();
+    multiDrawIndirect = features.multiDrawIndirect && features.drawIndirectFirstInstance;
+    
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(context->getPhysicalDevice(), &deviceProperties);
+    maxDrawIndirectCount = std::max(1u, deviceProperties.limits.maxDrawIndirectCount);
+    
+    UploadManager* uploads = context->getUploadManager();
+    
+    VkDeviceSize vertexSize = vertexData.size();
+    vertexBuffer = std::make_unique<Buffer>(context);
+    vertexBuffer->create(vertexSize,
+        VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    uploads->upload(*vertexBuffer, vertexData.data(), vertexSize);
+    
+    // One mesh with more than 65536 vertices moves the whole batch to 32-bit indices
+    std::vector<uint16_t> narrowIndices;
+    const void* indexData = indices.data();
+    VkDeviceSize indexSize = sizeof(uint32_t) * indices.size();
+    indexType = VK_INDEX_TYPE_UINT32;
+    if (indices.empty() || *std::max_element(indices.begin(), indices.end()) <= UINT16_MAX) {
+        narrowIndices.assign(indices.begin(), indices.end());
+        indexData = narrowIndices.data();
+        indexSize = sizeof(uint16_t) * narrowIndices.size();
+        indexType = VK_INDEX_TYPE_UINT16;
+    }
+    
+    indexBuffer = std::make_unique<Buffer>(context);
+    indexBuffer->create(indexSize,
+        VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    uploadValue = uploads->upload(*indexBuffer, indexData, indexSize);
+    
+    // Written from the CPU every frame, one region per frame in flight
+    if (multiDrawIndirect) {
+        indirectBuffer = std::make_unique<Buffer>(context);
+        indirectBuffer->create(sizeof(VkDrawIndexedIndirectCommand) * maxDraws * frameCount,
+            VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    }
+    
+    // The upload manager copied the data already
+    vertexData.clear();
+    vertexData.shrink_to_fit();
+    indices.clear();
+    indices.shrink_to_fit();
+    
+    draws.reserve(maxDraws);
+}
+
+void MeshBatch::beginFrame(uint32_t frameIndex) {
+    currentFrame = frameIndex % frameCount;
+    draws.clear();
+}
+
+void MeshBatch::addDraw(uint32_t meshId, uint32_t instanceCount, uint32_t firstInstance) {
+    if (meshId >= meshes.size()) {
+        throw std::runtime_error("invalid mesh id!");
+    }
+    if (draws.size() >= maxDraws) {
+        throw std::runtime_error("mesh batch draw list is full!");
+    }
+    
+    const MeshRange& range = meshes[meshId];
+    
+    VkDrawIndexedIndirectCommand command{};
+    command.indexCount = range.indexCount;
+    command.instanceCount = instanceCount;
+    command.firstIndex = range.firstIndex;
+    command.vertexOffset = range.vertexOffset;
+    command.firstInstance = firstInstance;
+    draws.push_back(command);
+}
+
+void MeshBatch::record(VkCommandBuffer commandBuffer, const Buffer& instances) {
+    if (draws.empty()) {
+        return;
+    }
+    
+    VkBuffer vertexBuffers[] = {vertexBuffer->getBuffer(), instances.getBuffer()};
+    VkDeviceSize offsets[] = {0, 0};
+    vkCmdBindVertexBuffers(commandBuffer, 0, 2, vertexBuffers, offsets);
+    vkCmdBindIndexBuffer(commandBuffer, indexBuffer->getBuffer(), 0, indexType);
+    
+    if (!multiDrawIndirect) {
+        for (const auto& command : draws) {
+            vkCmdDrawIndexed(commandBuffer, command.indexCount, command.instanceCount,
+                             command.firstIndex, command.vertexOffset, command.firstInstance);
+        }
+        return;
+    }
+    
+    const VkDeviceSize stride = sizeof(VkDrawIndexedIndirectCommand);
+    VkDeviceSize regionOffset = stride * maxDraws * currentFrame;
+    indirectBuffer->copyData(draws.data(), stride * draws.size(), regionOffset);
+    
+    // One call per maxDrawIndirectCount draws (a single call on current hardware)
+    uint32_t drawCount = static_cast<uint32_t>(draws.size());
+    for (uint32_t first = 0; first < drawCount; first += maxDrawIndirectCount) {
+        uint32_t count = std::min(drawCount - first, maxDrawIndirectCount);
+        vkCmdDrawIndexedIndirect(commandBuffer, indirectBuffer->getBuffer(),
+                                 regionOffset + stride * first, count, static_cast<uint32_t>(stride));
+    }
+}
\ No newline at end of file
@@ -0,0 +1,308 @@
+#include "mesh_optimizer.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <numeric>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace {
+
+const uint32_t NO_VERTEX = UINT32_MAX;
+
+// Misses of a FIFO post-transform cache over an index buffer
+size_t countCacheMisses(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize) {
+    std::vector<uint32_t> insertedAt(vertexCount, 0);  // 0: never cached
+    uint32_t time = 0;
+    size_t misses = 0;
+    for (uint32_t index : indices) {
+        if (insertedAt[index] == 0 || time - insertedAt[index] >= cacheSize) {
+            insertedAt[index] = ++time;
+            misses++;
+        }
+    }
+    return misses;
+}
+
+// Vertices are merged only when bitwise identical, so hashing the bytes is exact
+struct VertexHash {
+    size_t operator()(const Vertex& vertex) const {
+        const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&vertex);
+        uint64_t hash = 0xcbf29ce484222325ULL;
+        for (size_t i = 0; i < sizeof(Vertex); i++) {
+            hash ^= bytes[i];
+            hash *= 0x100000001b3ULL;
+        }
+        return static_cast<size_t>(hash);
+    }
+};
+
+struct VertexEqual {
+    bool operator()(const Vertex& a, const Vertex& b) const {
+        return std::memcmp(&a, &b, sizeof(Vertex)) == 0;
+    }
+};
+
+} // namespace
+
+MeshOptimizer::Stats MeshOptimizer::optimize(MeshGeometry& geometry) const {
+    auto startTime = std::chrono::steady_clock::now();
+    std::vector<Vertex>& vertices = geometry.vertices;
+    std::vector<uint32_t>& indices = geometry.indices;
+    
+    if (indices.empty()) {
+        if (vertices.size() % 3 != 0) {
+            throw std::runtime_error("non-indexed mesh vertex count is not a multiple of 3!");
+        }
+        indices.resize(vertices.size());
+        std::iota(indices.begin(), indices.end(), 0u);
+    }
+    if (indices.size() % 3 != 0) {
+        throw std::runtime_error("mesh index count is not a multiple of 3!");
+    }
+    for (uint32_t index : indices) {
+        if (index >= vertices.size()) {
+            throw std::runtime_error("mesh index out of range!");
+        }
+    }
+    
+    Stats stats;
+    stats.vertexCountBefore = vertices.size();
+    size_t missesBefore = countCacheMisses(indices, vertices.size(), options.cacheSize);
+    
+    // Merge duplicates; CAD exporters often write every triangle's corners separately
+    std::unordered_map<Vertex, uint32_t, VertexHash, VertexEqual> unique;
+    unique.reserve(vertices.size());
+    std::vector<uint32_t> remap(vertices.size());
+    std::vector<Vertex> uniqueVertices;
+    for (size_t i = 0; i < vertices.size(); i++) {
+        auto inserted = unique.emplace(vertices[i], static_cast<uint32_t>(uniqueVertices.size()));
+        if (inserted.second) {
+            uniqueVertices.push_back(vertices[i]);
+        }
+        remap[i] = inserted.first->second;
+    }
+    
+    // Triangles that lost an edge to the merge cover no pixels
+    size_t kept = 0;
+    for (size_t i = 0; i < indices.size(); i += 3) {
+        uint32_t a = remap[indices[i]];
+        uint32_t b = remap[indices[i + 1]];
+        uint32_t c = remap[indices[i + 2]];
+        if (a == b || b == c || a == c) {
+            stats.degenerateTrianglesRemoved++;
+            continue;
+        }
+        indices[kept++] = a;
+        indices[kept++] = b;
+        indices[kept++] = c;
+    }
+    indices.resize(kept);
+    
+    std::vector<size_t> clusterStarts;
+    std::vector<uint32_t> order = tipsify(indices, uniqueVertices.size(), clusterStarts);
+    std::vector<uint32_t> ordered;
+    ordered.reserve(indices.size());
+    for (uint32_t triangle : order) {
+        ordered.insert(ordered.end(), indices.begin() + triangle * 3, indices.begin() + triangle * 3 + 3);
+    }
+    if (options.reduceOverdraw) {
+        ordered = sortClusters(ordered, uniqueVertices, clusterStarts);
+    }
+    
+    // Renumber in first-use order, so vertex fetches walk the buffer forwards
+    // Vertices no triangle uses any more are dropped here
+    std::fill(remap.begin(), remap.begin() + uniqueVertices.size(), NO_VERTEX);
+    vertices.clear();
+    for (uint32_t& index : ordered) {
+        if (remap[index] == NO_VERTEX) {
+            remap[index] = static_cast<uint32_t>(vertices.size());
+            vertices.push_back(uniqueVertices[index]);
+        }
+        index = remap[index];
+    }
+    indices = std::move(ordered);
+    
+    stats.vertexCountAfter = vertices.size();
+    stats.triangleCount = indices.size() / 3;
+    stats.clusterCount = clusterStarts.size();
+    size_t missesAfter = countCacheMisses(indices, vertices.size(), options.cacheSize);
+    if (stats.triangleCount > 0) {
+        // Measured against the triangles drawn before, degenerate ones included
+        stats.acmrBefore = static_cast<double>(missesBefore) / (stats.triangleCount + stats.degenerateTrianglesRemoved);
+        stats.acmrAfter = static_cast<double>(missesAfter) / stats.triangleCount;
+        stats.atvrBefore = static_cast<double>(missesBefore) / stats.vertexCountAfter;
+        stats.atvrAfter = static_cast<double>(missesAfter) / stats.vertexCountAfter;
+    }
+    stats.timeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+    return stats;
+}
+
+std::future<MeshOptimizer::Result> MeshOptimizer::optimizeAsync(MeshGeometry geometry) const {
+    // The lambda owns copies of both, so neither has to outlive the call
+    MeshOptimizer optimizer = *this;
+    return std::async(std::launch::async, [optimizer, geometry = std::move(geometry)]() mutable {
+        Result result;
+        result.stats = optimizer.optimize(geometry);
+        result.geometry = std::move(geometry);
+        return result;
+    });
+}
+
+double MeshOptimizer::computeAcmr(const std::vector<uint32_t>& indices, uint32_t cacheSize) {
+    if (indices.size() < 3) {
+        return 0.0;
+    }
+    size_t vertexCount = *std::max_element(indices.begin(), indices.end()) + size_t(1);
+    return static_cast<double>(countCacheMisses(indices, vertexCount, cacheSize)) / (indices.size() / 3);
+}
+
+std::vector<uint32_t> MeshOptimizer::tipsify(const std::vector<uint32_t>& indices, size_t vertexCount,
+                                             std::vector<size_t>& clusterStarts) const {
+    const uint32_t cacheSize = options.cacheSize;
+    size_t triangleCount = indices.size() / 3;
+    
+    // Triangles around each vertex, in compressed rows; live counts those
+    // not emitted yet
+    std::vector<uint32_t> live(vertexCount, 0);
+    for (uint32_t index : indices) {
+        live[index]++;
+    }
+    std::vector<uint32_t> offsets(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; v++) {
+        offsets[v + 1] = offsets[v] + live[v];
+    }
+    std::vector<uint32_t> adjacency(indices.size());
+    std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+    for (size_t i = 0; i < indices.size(); i++) {
+        adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+    }
+    
+    std::vector<uint32_t> cachedAt(vertexCount, 0);
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<uint32_t> deadEnd;  // Recently used vertices, to restart near the last fan
+    std::vector<uint32_t> candidates;
+    std::vector<uint32_t> order;
+    order.reserve(triangleCount);
+    deadEnd.reserve(indices.size());
+    
+    uint32_t time = cacheSize + 1;
+    size_t cursor = 0;
+    uint32_t fan = vertexCount > 0 ? 0 : NO_VERTEX;
+    clusterStarts.assign(triangleCount > 0 ? 1 : 0, 0);
+    
+    while (fan != NO_VERTEX) {
+        // Emit every remaining triangle around the fan vertex
+        candidates.clear();
+        for (uint32_t a = offsets[fan]; a < offsets[fan + 1]; a++) {
+            uint32_t triangle = adjacency[a];
+            if (emitted[triangle]) {
+                continue;
+            }
+            emitted[triangle] = true;
+            order.push_back(triangle);
+            
+            for (size_t corner = 0; corner < 3; corner++) {
+                uint32_t v = indices[triangle * 3 + corner];
+                deadEnd.push_back(v);
+                candidates.push_back(v);
+                live[v]--;
+                if (time - cachedAt[v] > cacheSize) {
+                    cachedAt[v] = time++;
+                }
+            }
+        }
+        
+        // Next fan: the candidate that stays in the cache the longest after its
+        // own triangles are emitted. Those that would fall out score 0 and are
+        // never picked; without a positive candidate, take the dead-end stack
+        fan = NO_VERTEX;
+        int64_t bestPriority = 0;
+        for (uint32_t v : candidates) {
+            if (live[v] == 0) {
+                continue;
+            }
+            int64_t age = time - cachedAt[v];
+            int64_t priority = age + 2 * int64_t(live[v]) <= cacheSize ? age : 0;
+            if (priority > bestPriority) {
+                bestPriority = priority;
+                fan = v;
+            }
+        }
+        if (fan != NO_VERTEX) {
+            continue;
+        }
+        
+        // Dead end: restart from a recently used vertex, else the next unfinished one
+        while (!deadEnd.empty() && fan == NO_VERTEX) {
+            uint32_t v = deadEnd.back();
+            deadEnd.pop_back();
+            if (live[v] > 0) {
+                fan = v;
+            }
+        }
+        while (cursor < vertexCount && fan == NO_VERTEX) {
+            if (live[cursor] > 0) {
+                fan = static_cast<uint32_t>(cursor);
+            }
+            cursor++;
+        }
+        if (fan != NO_VERTEX && clusterStarts.back() != order.size()) {
+            clusterStarts.push_back(order.size());
+        }
+    }
+    return order;
+}
+
+std::vector<uint32_t> MeshOptimizer::sortClusters(const std::vector<uint32_t>& indices,
+                                                  const std::vector<Vertex>& vertices,
+                                                  const std::vector<size_t>& clusterStarts) {
+    struct Cluster {
+        size_t first;
+        size_t end;
+        float key;
+    };
+    
+    size_t triangleCount = indices.size() / 3;
+    if (clusterStarts.size() < 2) {
+        return indices;
+    }
+    
+    glm::vec3 meshCenter(0.0f);
+    for (uint32_t index : indices) {
+        meshCenter = meshCenter + vertices[index].position;
+    }
+    meshCenter = meshCenter * (1.0f / indices.size());
+    
+    // Clusters facing away from the center are likely to cover the rest
+    // of the mesh; drawn first, they let early depth testing reject more
+    std::vector<Cluster> clusters;
+    for (size_t i = 0; i < clusterStarts.size(); i++) {
+        Cluster cluster{};
+        cluster.first = clusterStarts[i];
+        cluster.end = i + 1 < clusterStarts.size() ? clusterStarts[i + 1] : triangleCount;
+        
+        glm::vec3 center(0.0f);
+        glm::vec3 normal(0.0f);  // Area weighted
+        for (size_t t = cluster.first; t < cluster.end; t++) {
+            const glm::vec3& a = vertices[indices[t * 3]].position;
+            const glm::vec3& b = vertices[indices[t * 3 + 1]].position;
+            const glm::vec3& c = vertices[indices[t * 3 + 2]].position;
+            center = center + (a + b + c) * (1.0f / 3.0f);
+            normal = normal + glm::cross(b - a, c - a);
+        }
+        center = center * (1.0f / (cluster.end - cluster.first));
+        float length = glm::length(normal);
+        cluster.key = length > 0.0f ? glm::dot(center - meshCenter, normal) / length : 0.0f;
+        clusters.push_back(cluster);
+    }
+    std::stable_sort(clusters.begin(), clusters.end(),
+                     [](const Cluster& a, const Cluster& b) { return a.key > b.key; });
+    
+    std::vector<uint32_t> sorted;
+    sorted.reserve(indices.size());
+    for (const auto& cluster : clusters) {
+        sorted.insert(sorted.end(), indices.begin() + cluster.first * 3, indices.begin() + cluster.end * 3);
+    }
+    return sorted;
+}
\ No newline at end of file
@@ -2,70 +2,141 @@
 #include "vulkan_context.h"
 #include "swapchain.h"
 #include "shader_loader.h"
+#include "shader_library.h"
+#include "pipeline_cache.h"
+#include "spirv_reflect.h"
 #include <stdexcept>
 
-VkVertexInputBindingDescription Vertex::getBindingDescription() {
-    VkVertexInputBindingDescription bindingDescription{};
-    bindingDescription.binding = 0;
-    bindingDescription.stride = sizeof(Vertex);
-    bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-    return bindingDescription;
+Pipeline::Pipeline(VulkanContext* ctx, Swapchain* sc, PipelineCache* cache)
+    : context(ctx), swapchain(sc), pipelineCache(cache) {
 }
 
-std::vector<VkVertexInputAttributeDescription> Vertex::getAttributeDescriptions() {
-    std::vector<VkVertexInputAttributeDescription> attributeDescriptions(2);
+Pipeline::~Pipeline() {
+    cleanup();
     
-    // Position attribute
-    attributeDescriptions[0].binding = 0;
-    attributeDescriptions[0].location = 0;
-    attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-    attributeDescriptions[0].offset = offsetof(Vertex, position);
+    if (descriptorSetLayout != VK_NULL_HANDLE) {
+        vkDestroyDescriptorSetLayout(context->getDevice(), descriptorSetLayout, nullptr);
+        descriptorSetLayout = VK_NULL_HANDLE;
+    }
+}
+
+void Pipeline::createDescriptorSetLayout() {
+    // Dynamic offsets select the current frame's slice of the uniform ring
+    // at bind time, so a single descriptor set serves every frame
+    VkDescriptorSetLayoutBinding bindings[2]{};
+    bindings[0].binding = 0;
+    bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    bindings[0].descriptorCount = 1;
+    bindings[0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
     
-    // Color attribute
-    attributeDescriptions[1].binding = 0;
-    attributeDescriptions[1].location = 1;
-    attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-    attributeDescriptions[1].offset = offsetof(Vertex, color);
+    bindings[1].binding = 1;
+    bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    bindings[1].descriptorCount = 1;
+    bindings[1].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
     
-    return attributeDescriptions;
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = 2;
+    layoutInfo.pBindings = bindings;
+    
+    if (vkCreateDescriptorSetLayout(context->getDevice(), &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create descriptor set layout!");
+    }
 }
 
-Pipeline::Pipeline(VulkanContext* ctx, Swapchain* sc)
-    : context(ctx), swapchain(sc) {
+void Pipeline::create(const std::string& vertShaderPath, const std::string& fragShaderPath,
+                      const PipelineSpecialization& specialization) {
+    ShaderLoader loader(context);
+    
+    // Read as words first: the vertex input state comes from the shader's reflection
+    std::vector<uint32_t> vertSpirv = loader.loadSpirv(vertShaderPath);
+    std::vector<uint32_t> fragSpirv = loader.loadSpirv(fragShaderPath);
+    
+    create(vertSpirv, fragSpirv, defaultRenderPass(), specialization);
 }
 
-Pipeline::~Pipeline() {
-    cleanup();
+void Pipeline::create(const std::vector<uint32_t>& vertSpirv, const std::vector<uint32_t>& fragSpirv,
+                      VkRenderPass renderPass, const PipelineSpecialization& specialization) {
+    ShaderReflection vertexReflection = ShaderReflection::fromSpirv(vertSpirv.data(), vertSpirv.size());
+    
+    ShaderLoader loader(context);
+    
+    VkShaderModule vertShaderModule = loader.createShaderModule(vertSpirv);
+    VkShaderModule fragShaderModule = VK_NULL_HANDLE;
+    try {
+        fragShaderModule = loader.createShaderModule(fragSpirv);
+    } catch (...) {
+        loader.destroyShaderModule(vertShaderModule);
+        throw;
+    }
+    
+    createWithModules(loader, vertShaderModule, fragShaderModule, vertexReflection, renderPass, specialization);
 }
 
-void Pipeline::create(const std::string& vertShaderPath, const std::string& fragShaderPath) {
-    ShaderLoader loader(context);
+void Pipeline::create(ShaderLibrary& library, const std::string& vertShader, const std::string& fragShader,
+                      const PipelineSpecialization& specialization) {
+    VkShaderModule vertShaderModule = library.getModule(vertShader);
+    VkShaderModule fragShaderModule = library.getModule(fragShader);
     
-    VkShaderModule vertShaderModule = loader.loadShaderModule(vertShaderPath);
-    VkShaderModule fragShaderModule = loader.loadShaderModule(fragShaderPath);
+    createPipeline(vertShaderModule, fragShaderModule, library.getReflection(vertShader),
+                   defaultRenderPass(), specialization);
+}
+
+VkRenderPass Pipeline::defaultRenderPass() const {
+    return targetRenderPass != VK_NULL_HANDLE ? targetRenderPass : swapchain->getRenderPass();
+}
+
+void Pipeline::createWithModules(ShaderLoader& loader, VkShaderModule vertShaderModule,
+                                 VkShaderModule fragShaderModule, const ShaderReflection& vertexReflection,
+                                 VkRenderPass renderPass, const PipelineSpecialization& specialization) {
+    try {
+        createPipeline(vertShaderModule, fragShaderModule, vertexReflection, renderPass, specialization);
+    } catch (...) {
+        loader.destroyShaderModule(vertShaderModule);
+        loader.destroyShaderModule(fragShaderModule);
+        throw;
+    }
     
+    // Modules are only needed while the pipeline is created
+    loader.destroyShaderModule(vertShaderModule);
+    loader.destroyShaderModule(fragShaderModule);
+}
+
+void Pipeline::createPipeline(VkShaderModule vertShaderModule, VkShaderModule fragShaderModule,
+                              const ShaderReflection& vertexReflection, VkRenderPass renderPass,
+                              const PipelineSpecialization& specialization) {
     VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
     vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
     vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
     vertShaderStageInfo.module = vertShaderModule;
     vertShaderStageInfo.pName = "main";
+    vertShaderStageInfo.pSpecializationInfo = specialization.vertex;
     
     VkPipelineShaderStageCreateInfo fragShaderStageInfo{};
     fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
     fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
     fragShaderStageInfo.module = fragShaderModule;
     fragShaderStageInfo.pName = "main";
+    fragShaderStageInfo.pSpecializationInfo = specialization.fragment;
     
     VkPipelineShaderStageCreateInfo shaderStages[] = {vertShaderStageInfo, fragShaderStageInfo};
     
-    // Vertex input
-    auto bindingDescription = Vertex::getBindingDescription();
-    auto attributeDescriptions = Vertex::getAttributeDescriptions();
+    // Vertex input: binding 0 advances per vertex, binding 1 per instance (InstanceData)
+    VkVertexInputBindingDescription bindingDescriptions[2]{};
+    bindingDescriptions[0].binding = 0;
+    bindingDescriptions[0].stride = vertexFormat.getStride();
+    bindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+    
+    bindingDescriptions[1].binding = 1;
+    bindingDescriptions[1].stride = sizeof(InstanceData);
+    bindingDescriptions[1].inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+    
+    auto attributeDescriptions = matchVertexInputs(vertexReflection);
     
     VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
     vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-    vertexInputInfo.vertexBindingDescriptionCount = 1;
-    vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
+    vertexInputInfo.vertexBindingDescriptionCount = 2;
+    vertexInputInfo.pVertexBindingDescriptions = bindingDescriptions;
     vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
     vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
     
@@ -75,25 +146,22 @@ void Pipeline::create(const std::string& vertShaderPath, const std::string& frag
     inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
     inputAssembly.primitiveRestartEnable = VK_FALSE;
     
-    // Viewport and scissor
-    VkViewport viewport{};
-    viewport.x = 0.0f;
-    viewport.y = 0.0f;
-    viewport.width = (float)swapchain->getExtent().width;
-    viewport.height = (float)swapchain->getExtent().height;
-    viewport.minDepth = 0.0f;
-    viewport.maxDepth = 1.0f;
-    
-    VkRect2D scissor{};
-    scissor.offset = {0, 0};
-    scissor.extent = swapchain->getExtent();
-    
+    // Viewport and scissor are dynamic: set per frame from the swapchain
+    // extent, so a resize does not invalidate the pipeline
     VkPipelineViewportStateCreateInfo viewportState{};
     viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
     viewportState.viewportCount = 1;
-    viewportState.pViewports = &viewport;
     viewportState.scissorCount = 1;
-    viewportState.pScissors = &scissor;
+    
+    VkDynamicState dynamicStates[] = {
+        VK_DYNAMIC_STATE_VIEWPORT,
+        VK_DYNAMIC_STATE_SCISSOR
+    };
+    
+    VkPipelineDynamicStateCreateInfo dynamicState{};
+    dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicState.dynamicStateCount = 2;
+    dynamicState.pDynamicStates = dynamicStates;
     
     // Rasterizer
     VkPipelineRasterizationStateCreateInfo rasterizer{};
@@ -125,9 +193,14 @@ void Pipeline::create(const std::string& vertShaderPath, const std::string& frag
     colorBlending.pAttachments = &colorBlendAttachment;
     
     // Pipeline layout
+    if (descriptorSetLayout == VK_NULL_HANDLE) {
+        createDescriptorSetLayout();
+    }
+    
     VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
     pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    pipelineLayoutInfo.setLayoutCount = 0;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
     pipelineLayoutInfo.pushConstantRangeCount = 0;
     
     if (vkCreatePipelineLayout(context->getDevice(), &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
@@ -145,16 +218,56 @@ void Pipeline::create(const std::string& vertShaderPath, const std::string& frag
     pipelineInfo.pRasterizationState = &rasterizer;
     pipelineInfo.pMultisampleState = &multisampling;
     pipelineInfo.pColorBlendState = &colorBlending;
+    pipelineInfo.pDynamicState = &dynamicState;
     pipelineInfo.layout = pipelineLayout;
-    pipelineInfo.renderPass = swapchain->getRenderPass();
+    pipelineInfo.renderPass = renderPass;
     pipelineInfo.subpass = 0;
     
-    if (vkCreateGraphicsPipelines(context->getDevice(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS) {
+    VkPipelineCache cache = pipelineCache ? pipelineCache->getCache() : VK_NULL_HANDLE;
+    if (vkCreateGraphicsPipelines(context->getDevice(), cache, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS) {
         throw std::runtime_error("failed to create graphics pipeline!");
     }
+
+    builtRenderPass = renderPass;
+}
+
+std::vector<VkVertexInputAttributeDescription> Pipeline::matchVertexInputs(
+    const ShaderReflection& vertexReflection) const {
+    static const VertexFormat instanceFormat = VertexFormat::instance();
     
-    loader.destroyShaderModule(vertShaderModule);
-    loader.destroyShaderModule(fragShaderModule);
+    std::vector<VkVertexInputAttributeDescription> attributeDescriptions;
+    for (const auto& input : vertexReflection.inputs) {
+        // Matrices take one location per column
+        for (uint32_t column = 0; column < input.columns; column++) {
+            uint32_t location = input.location + column;
+            
+            uint32_t binding = 0;
+            const VertexFormat::Attribute* attribute = vertexFormat.find(location);
+            if (!attribute) {
+                binding = 1;
+                attribute = instanceFormat.find(location);
+            }
+            if (!attribute) {
+                throw std::runtime_error("failed to match vertex input " + input.name + " at location " +
+                                         std::to_string(location) + " to a vertex attribute!");
+            }
+            
+            VkFormatProperties properties;
+            vkGetPhysicalDeviceFormatProperties(context->getPhysicalDevice(), attribute->format, &properties);
+            if (!(properties.bufferFeatures & VK_FORMAT_FEATURE_VERTEX_BUFFER_BIT)) {
+                throw std::runtime_error("vertex attribute format at location " + std::to_string(location) +
+                                         " is not supported by the device!");
+            }
+            
+            VkVertexInputAttributeDescription description{};
+            description.binding = binding;
+            description.location = location;
+            description.format = attribute->format;
+            description.offset = attribute->offset;
+            attributeDescriptions.push_back(description);
+        }
+    }
+    return attributeDescriptions;
 }
 
 void Pipeline::cleanup() {
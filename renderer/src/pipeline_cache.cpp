@@ -0,0 +1,192 @@
+#include "pipeline_cache.h"
+#include "vulkan_context.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+namespace {
+
+const uint32_t CACHE_FILE_MAGIC = 0x43504b56; // "VKPC"
+const uint32_t CACHE_FILE_VERSION = 1;
+
+struct CacheFileHeader {
+    uint32_t magic;
+    uint32_t formatVersion;
+    uint32_t vendorID;
+    uint32_t deviceID;
+    uint32_t driverVersion;
+    uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+    uint64_t dataSize;
+    uint64_t dataHash;
+};
+
+// 64-bit FNV-1a over the driver blob, to reject truncated or corrupted files
+uint64_t hashData(const char* data, size_t size) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+} // namespace
+
+PipelineCache::PipelineCache(VulkanContext* ctx, const std::string& path)
+    : context(ctx), filePath(path) {
+}
+
+PipelineCache::~PipelineCache() {
+    cleanup();
+}
+
+void PipelineCache::create() {
+    vkGetPhysicalDeviceProperties(context->getPhysicalDevice(), &deviceProperties);
+    
+    std::vector<char> file = loadFile();
+    loadedFromDisk = !file.empty() && isCompatible(file);
+    
+    VkPipelineCacheCreateInfo cacheInfo{};
+    cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    if (loadedFromDisk) {
+        cacheInfo.initialDataSize = file.size() - sizeof(CacheFileHeader);
+        cacheInfo.pInitialData = file.data() + sizeof(CacheFileHeader);
+        savedHash = hashData(file.data() + sizeof(CacheFileHeader), cacheInfo.initialDataSize);
+    } else if (!file.empty()) {
+        std::cout << "Pipeline cache " << filePath << " does not match this device, starting empty" << std::endl;
+    }
+    
+    VkResult result = vkCreatePipelineCache(context->getDevice(), &cacheInfo, nullptr, &pipelineCache);
+    if (result != VK_SUCCESS && loadedFromDisk) {
+        // The driver may still reject data it wrote itself (e.g. after an update
+        // that kept the version number); fall back to an empty cache
+        loadedFromDisk = false;
+        savedHash = 0;
+        cacheInfo.initialDataSize = 0;
+        cacheInfo.pInitialData = nullptr;
+        result = vkCreatePipelineCache(context->getDevice(), &cacheInfo, nullptr, &pipelineCache);
+    }
+    if (result != VK_SUCCESS) {
+        throw std::runtime_error("failed to create pipeline cache!");
+    }
+    
+    if (loadedFromDisk) {
+        std::cout << "Loaded pipeline cache from " << filePath << " ("
+                  << cacheInfo.initialDataSize << " bytes)" << std::endl;
+    }
+}
+
+void PipelineCache::cleanup() {
+    if (pipelineCache != VK_NULL_HANDLE) {
+        save();
+        vkDestroyPipelineCache(context->getDevice(), pipelineCache, nullptr);
+        pipelineCache = VK_NULL_HANDLE;
+    }
+}
+
+bool PipelineCache::save() {
+    if (pipelineCache == VK_NULL_HANDLE) {
+        return false;
+    }
+    
+    size_t dataSize = 0;
+    if (vkGetPipelineCacheData(context->getDevice(), pipelineCache, &dataSize, nullptr) != VK_SUCCESS || dataSize == 0) {
+        return false;
+    }
+    
+    std::vector<char> data(dataSize);
+    if (vkGetPipelineCacheData(context->getDevice(), pipelineCache, &dataSize, data.data()) != VK_SUCCESS) {
+        return false;
+    }
+    data.resize(dataSize);
+    
+    uint64_t hash = hashData(data.data(), data.size());
+    if (hash == savedHash) {
+        return true; // Nothing new was compiled since the last load or save
+    }
+    
+    CacheFileHeader header{};
+    header.magic = CACHE_FILE_MAGIC;
+    header.formatVersion = CACHE_FILE_VERSION;
+    header.vendorID = deviceProperties.vendorID;
+    header.deviceID = deviceProperties.deviceID;
+    header.driverVersion = deviceProperties.driverVersion;
+    std::memcpy(header.pipelineCacheUUID, deviceProperties.pipelineCacheUUID, VK_UUID_SIZE);
+    header.dataSize = data.size();
+    header.dataHash = hash;
+    
+    // Write to a temporary file and rename it into place, so an interrupted
+    // write never leaves a truncated cache behind
+    std::string tempPath = filePath + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            return false;
+        }
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(data.data(), data.size());
+        if (!file) {
+            file.close();
+            std::remove(tempPath.c_str());
+            return false;
+        }
+    }
+    
+    if (std::rename(tempPath.c_str(), filePath.c_str()) != 0) {
+        std::remove(tempPath.c_str());
+        return false;
+    }
+    
+    savedHash = hash;
+    return true;
+}
+
+std::vector<char> PipelineCache::loadFile() const {
+    std::ifstream file(filePath, std::ios::ate | std::ios::binary);
+    if (!file.is_open()) {
+        return {};
+    }
+    
+    size_t fileSize = (size_t)file.tellg();
+    std::vector<char> buffer(fileSize);
+    
+    file.seekg(0);
+    if (!file.read(buffer.data(), fileSize)) {
+        return {};
+    }
+    return buffer;
+}
+
+bool PipelineCache::isCompatible(const std::vector<char>& data) const {
+    if (data.size() < sizeof(CacheFileHeader) + sizeof(VkPipelineCacheHeaderVersionOne)) {
+        return false;
+    }
+    
+    CacheFileHeader header;
+    std::memcpy(&header, data.data(), sizeof(header));
+    
+    // Our header: same device, same driver build, intact payload
+    if (header.magic != CACHE_FILE_MAGIC || header.formatVersion != CACHE_FILE_VERSION ||
+        header.vendorID != deviceProperties.vendorID || header.deviceID != deviceProperties.deviceID ||
+        header.driverVersion != deviceProperties.driverVersion ||
+        std::memcmp(header.pipelineCacheUUID, deviceProperties.pipelineCacheUUID, VK_UUID_SIZE) != 0 ||
+        header.dataSize != data.size() - sizeof(CacheFileHeader)) {
+        return false;
+    }
+    
+    const char* payload = data.data() + sizeof(CacheFileHeader);
+    if (hashData(payload, header.dataSize) != header.dataHash) {
+        return false;
+    }
+    
+    // The driver's own header must agree as well
+    VkPipelineCacheHeaderVersionOne driverHeader;
+    std::memcpy(&driverHeader, payload, sizeof(driverHeader));
+    return driverHeader.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+           driverHeader.headerSize >= sizeof(VkPipelineCacheHeaderVersionOne) &&
+           driverHeader.vendorID == deviceProperties.vendorID &&
+           driverHeader.deviceID == deviceProperties.deviceID &&
+           std::memcmp(driverHeader.pipelineCacheUUID, deviceProperties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
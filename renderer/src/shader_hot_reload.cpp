@@ -0,0 +1,208 @@
+#include "shader_hot_reload.h"
+#include "pipeline.h"
+#include "shader_compiler.h"
+#include "codegen.h"
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+// Editors save in several writes (or write a temp file and rename it);
+// changes are collected for this long before recompiling
+static const std::chrono::milliseconds SETTLE_TIME(100);
+static const int POLL_INTERVAL_MS = 250;
+
+ShaderHotReloader::ShaderHotReloader(VulkanContext* ctx, Swapchain* sc, PipelineCache* cache,
+                                     const std::string& vertSource, const std::string& fragSource,
+                                     const VertexFormat& format)
+    : context(ctx), swapchain(sc), pipelineCache(cache), vertSourcePath(vertSource), fragSourcePath(fragSource),
+      vertexFormat(format) {
+}
+
+ShaderHotReloader::~ShaderHotReloader() {
+    stop();
+}
+
+void ShaderHotReloader::start(VkRenderPass pass) {
+    renderPass = pass;
+    stopping = false;
+    
+#ifdef __linux__
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd >= 0) {
+        // Directories rather than files: saving by rename replaces the inode
+        for (const auto& source : {vertSourcePath, fragSourcePath}) {
+            fs::path dir = fs::path(source).parent_path();
+            std::string dirName = dir.empty() ? "." : dir.string();
+            inotify_add_watch(inotifyFd, dirName.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+        }
+    }
+#endif
+    
+    // Baseline for the polling fallback
+    lastWriteTimes.clear();
+    for (const auto& source : {vertSourcePath, fragSourcePath}) {
+        std::error_code ec;
+        auto time = fs::last_write_time(source, ec);
+        lastWriteTimes.push_back(ec ? 0 : static_cast<int64_t>(time.time_since_epoch().count()));
+    }
+    
+    watcher = std::thread(&ShaderHotReloader::watchLoop, this);
+    std::cout << "Watching " << vertSourcePath << " and " << fragSourcePath << " for changes" << std::endl;
+}
+
+void ShaderHotReloader::stop() {
+    stopping = true;
+    if (watcher.joinable()) {
+        watcher.join();
+    }
+    
+#ifdef __linux__
+    if (inotifyFd >= 0) {
+        close(inotifyFd);
+        inotifyFd = -1;
+    }
+#endif
+    
+    std::lock_guard<std::mutex> lock(mutex);
+    readyPipeline.reset();
+}
+
+void ShaderHotReloader::setRenderPass(VkRenderPass pass) {
+    // Waits out a pipeline creation that may still be using the old render pass
+    std::lock_guard<std::mutex> buildLock(buildMutex);
+    std::lock_guard<std::mutex> lock(mutex);
+    
+    renderPass = pass;
+    renderPassChanged = true;
+    
+    // Built for the old render pass; rebuilt from the kept SPIR-V instead
+    readyPipeline.reset();
+}
+
+std::unique_ptr<Pipeline> ShaderHotReloader::takeReadyPipeline() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return std::move(readyPipeline);
+}
+
+void ShaderHotReloader::watchLoop() {
+    while (!stopping) {
+        bool recompile = sourcesChanged();
+        
+        bool rebuildForRenderPass = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            rebuildForRenderPass = renderPassChanged && !vertSpirv.empty();
+            renderPassChanged = false;
+        }
+        
+        if (recompile || rebuildForRenderPass) {
+            rebuild(recompile);
+        }
+    }
+}
+
+bool ShaderHotReloader::sourcesChanged() {
+    bool changed = false;
+    
+#ifdef __linux__
+    if (inotifyFd >= 0) {
+        pollfd pfd{inotifyFd, POLLIN, 0};
+        if (poll(&pfd, 1, POLL_INTERVAL_MS) <= 0) {
+            return false;
+        }
+        
+        std::string vertName = fs::path(vertSourcePath).filename().string();
+        std::string fragName = fs::path(fragSourcePath).filename().string();
+        
+        // Drain events until the writer has been quiet for SETTLE_TIME
+        alignas(inotify_event) char buffer[4096];
+        for (;;) {
+            ssize_t length;
+            while ((length = read(inotifyFd, buffer, sizeof(buffer))) > 0) {
+                for (char* p = buffer; p < buffer + length;) {
+                    auto* event = reinterpret_cast<inotify_event*>(p);
+                    if (event->len > 0 && (vertName == event->name || fragName == event->name)) {
+                        changed = true;
+                    }
+                    p += sizeof(inotify_event) + event->len;
+                }
+            }
+            
+            if (!changed || poll(&pfd, 1, static_cast<int>(SETTLE_TIME.count())) <= 0) {
+                break;
+            }
+        }
+        return changed;
+    }
+#endif
+    
+    std::this_thread::sleep_for(std::chrono::milliseconds(POLL_INTERVAL_MS));
+    
+    const std::string* sources[] = {&vertSourcePath, &fragSourcePath};
+    for (size_t i = 0; i < lastWriteTimes.size(); i++) {
+        std::error_code ec;
+        auto time = fs::last_write_time(*sources[i], ec);
+        int64_t stamp = ec ? 0 : static_cast<int64_t>(time.time_since_epoch().count());
+        if (stamp != lastWriteTimes[i]) {
+            lastWriteTimes[i] = stamp;
+            changed = true;
+        }
+    }
+    
+    if (changed) {
+        std::this_thread::sleep_for(SETTLE_TIME);
+    }
+    return changed;
+}
+
+void ShaderHotReloader::rebuild(bool recompile) {
+    auto startTime = std::chrono::steady_clock::now();
+    
+    if (recompile) {
+        try {
+            // Native backend: no external tools, and the fastest turnaround
+            ShaderCompiler compiler;
+            compiler.setBackend(SpirvBackend::NATIVE);
+            auto vert = compiler.compileFromFile(vertSourcePath, "vertex");
+            auto frag = compiler.compileFromFile(fragSourcePath, "fragment");
+            
+            vertSpirv = std::move(vert);
+            fragSpirv = std::move(frag);
+        } catch (const std::exception& e) {
+            std::cerr << "Shader reload failed, keeping the current pipeline:\n" << e.what() << std::endl;
+            return;
+        }
+    }
+    
+    std::lock_guard<std::mutex> buildLock(buildMutex);
+    
+    VkRenderPass target;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        target = renderPass;
+    }
+    
+    auto pipeline = std::make_unique<Pipeline>(context, swapchain, pipelineCache);
+    pipeline->setVertexFormat(vertexFormat);
+    try {
+        pipeline->create(vertSpirv, fragSpirv, target);
+    } catch (const std::exception& e) {
+        std::cerr << "Shader reload failed, keeping the current pipeline:\n" << e.what() << std::endl;
+        return;
+    }
+    
+    double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+    std::cout << "Shaders reloaded in " << elapsedMs << " ms" << std::endl;
+    
+    // Replaces a pipeline the render loop has not picked up yet
+    std::lock_guard<std::mutex> lock(mutex);
+    readyPipeline = std::move(pipeline);
+}
\ No newline at end of file
@@ -0,0 +1,46 @@
+#include "shader_library.h"
+#include "shader_loader.h"
+#include "vulkan_context.h"
+#include <stdexcept>
+
+ShaderLibrary::ShaderLibrary(VulkanContext* ctx, const std::string& packPath) : context(ctx) {
+    pack.open(packPath);
+    modules.assign(pack.size(), VK_NULL_HANDLE);
+}
+
+ShaderLibrary::~ShaderLibrary() {
+    cleanup();
+}
+
+VkShaderModule ShaderLibrary::getModule(const std::string& name) {
+    size_t index = indexOf(name);
+    if (modules[index] == VK_NULL_HANDLE) {
+        // The mapping is 4-byte aligned, so the words go to the driver as they are
+        const ShaderPack::Module& module = pack.module(index);
+        ShaderLoader loader(context);
+        modules[index] = loader.createShaderModule(module.code, module.wordCount);
+    }
+    return modules[index];
+}
+
+ShaderReflection ShaderLibrary::getReflection(const std::string& name) const {
+    return pack.reflection(indexOf(name));
+}
+
+size_t ShaderLibrary::indexOf(const std::string& name) const {
+    size_t index = pack.find(name);
+    if (index == pack.size()) {
+        throw std::runtime_error("failed to find shader " + name + " in pack!");
+    }
+    return index;
+}
+
+void ShaderLibrary::cleanup() {
+    for (VkShaderModule module : modules) {
+        if (module != VK_NULL_HANDLE) {
+            vkDestroyShaderModule(context->getDevice(), module, nullptr);
+        }
+    }
+    modules.clear();
+    pack.close();
+}
\ No newline at end of file
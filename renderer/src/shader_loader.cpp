@@ -9,23 +9,19 @@ ShaderLoader::ShaderLoader(VulkanContext* ctx) : context(ctx) {}
 ShaderLoader::~ShaderLoader() {}
 
 VkShaderModule ShaderLoader::loadShaderModule(const std::string& filename) {
-    auto code = readFile(filename);
-    
-    // Convert char vector to uint32_t vector safely
-    if (code.size() % sizeof(uint32_t) != 0) {
-        throw std::runtime_error("SPIR-V file size is not 4-byte aligned: " + filename);
-    }
-    const uint32_t* p = reinterpret_cast<const uint32_t*>(code.data());
-    size_t wordCount = code.size() / sizeof(uint32_t);
-    std::vector<uint32_t> codeUint(p, p + wordCount);
-    return createShaderModule(codeUint);
+    auto code = loadSpirv(filename);
+    return createShaderModule(code);
 }
 
 VkShaderModule ShaderLoader::createShaderModule(const std::vector<uint32_t>& code) {
+    return createShaderModule(code.data(), code.size());
+}
+
+VkShaderModule ShaderLoader::createShaderModule(const uint32_t* code, size_t wordCount) {
     VkShaderModuleCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-    createInfo.codeSize = code.size() * sizeof(uint32_t);
-    createInfo.pCode = code.data();
+    createInfo.codeSize = wordCount * sizeof(uint32_t);
+    createInfo.pCode = code;
     
     VkShaderModule shaderModule;
     if (vkCreateShaderModule(context->getDevice(), &createInfo, nullptr, &shaderModule) != VK_SUCCESS) {
@@ -39,7 +35,7 @@ void ShaderLoader::destroyShaderModule(VkShaderModule module) {
     vkDestroyShaderModule(context->getDevice(), module, nullptr);
 }
 
-std::vector<char> ShaderLoader::readFile(const std::string& filename) {
+std::vector<uint32_t> ShaderLoader::loadSpirv(const std::string& filename) {
     std::ifstream file(filename, std::ios::ate | std::ios::binary);
     
     if (!file.is_open()) {
@@ -47,10 +43,15 @@ std::vector<char> ShaderLoader::readFile(const std::string& filename) {
     }
     
     size_t fileSize = (size_t)file.tellg();
-    std::vector<char> buffer(fileSize);
+    if (fileSize % sizeof(uint32_t) != 0) {
+        throw std::runtime_error("SPIR-V file size is not 4-byte aligned: " + filename);
+    }
+    
+    // Read straight into words, so the code is not copied a second time
+    std::vector<uint32_t> buffer(fileSize / sizeof(uint32_t));
     
     file.seekg(0);
-    file.read(buffer.data(), fileSize);
+    file.read(reinterpret_cast<char*>(buffer.data()), fileSize);
     file.close();
     
     return buffer;
@@ -4,8 +4,8 @@
 #include <algorithm>
 #include <limits>
 
-Swapchain::Swapchain(VulkanContext* ctx, int w, int h)
-    : context(ctx), width(w), height(h) {
+Swapchain::Swapchain(VulkanContext* ctx, int w, int h, VkPresentModeKHR preferredMode)
+    : context(ctx), width(w), height(h), preferredPresentMode(preferredMode) {
 }
 
 Swapchain::~Swapchain() {
@@ -20,85 +20,89 @@ void Swapchain::create() {
 }
 
 void Swapchain::cleanup() {
-    // Clean up framebuffers first
-    for (auto framebuffer : swapchainFramebuffers) {
-        if (framebuffer != VK_NULL_HANDLE) {
-            vkDestroyFramebuffer(context->getDevice(), framebuffer, nullptr);
-        }
-    }
-    swapchainFramebuffers.clear();
-    
-    // Clean up image views
-    for (auto imageView : swapchainImageViews) {
-        if (imageView != VK_NULL_HANDLE) {
-            vkDestroyImageView(context->getDevice(), imageView, nullptr);
-        }
-    }
-    swapchainImageViews.clear();
+    releaseRetired();
     
-    // Clean up render pass
-    if (renderPass != VK_NULL_HANDLE) {
-        vkDestroyRenderPass(context->getDevice(), renderPass, nullptr);
-        renderPass = VK_NULL_HANDLE;
-    }
+    RetiredResources current;
+    current.swapchain = swapchain;
+    current.imageViews = std::move(swapchainImageViews);
+    current.framebuffers = std::move(swapchainFramebuffers);
+    current.renderPass = renderPass;
+    destroyResources(current);
     
-    // Clean up swapchain last
-    if (swapchain != VK_NULL_HANDLE) {
-        vkDestroySwapchainKHR(context->getDevice(), swapchain, nullptr);
-        swapchain = VK_NULL_HANDLE;
-    }
+    swapchain = VK_NULL_HANDLE;
+    renderPass = VK_NULL_HANDLE;
+    swapchainImageViews.clear();
+    swapchainFramebuffers.clear();
     
     // Clear the images vector (we don't own these, they're destroyed with swapchain)
     swapchainImages.clear();
 }
 
-void Swapchain::recreate(int w, int h) {
+bool Swapchain::recreate(int w, int h) {
     width = w;
     height = h;
     
-    // Wait for device to finish current operations
-    vkDeviceWaitIdle(context->getDevice());
+    // Retire the current resources; frames in flight may still use them
+    RetiredResources old;
+    old.swapchain = swapchain;
+    old.imageViews = std::move(swapchainImageViews);
+    old.framebuffers = std::move(swapchainFramebuffers);
+    swapchainImageViews.clear();
+    swapchainFramebuffers.clear();
+    swapchainImages.clear();
+    retired.push_back(std::move(old));
     
-    // Store old swapchain for potential reuse
-    VkSwapchainKHR oldSwapchain = swapchain;
+    // Create new swapchain (passing old one so the driver can reuse its images)
+    VkFormat oldFormat = swapchainImageFormat;
+    swapchain = VK_NULL_HANDLE;
+    createSwapchainWithOld(retired.back().swapchain);
+    
+    // The render pass only depends on the image format
+    bool renderPassChanged = swapchainImageFormat != oldFormat;
+    if (renderPassChanged) {
+        retired.back().renderPass = renderPass;
+        renderPass = VK_NULL_HANDLE;
+        createRenderPass();
+    }
+    
+    createImageViews();
+    createFramebuffers();
     
-    // Clean up old resources (but preserve old swapchain temporarily)
-    for (auto framebuffer : swapchainFramebuffers) {
+    return renderPassChanged;
+}
+
+void Swapchain::releaseRetired() {
+    for (auto& resources : retired) {
+        destroyResources(resources);
+    }
+    retired.clear();
+}
+
+void Swapchain::destroyResources(RetiredResources& resources) {
+    // Framebuffers first, the swapchain last
+    for (auto framebuffer : resources.framebuffers) {
         if (framebuffer != VK_NULL_HANDLE) {
             vkDestroyFramebuffer(context->getDevice(), framebuffer, nullptr);
         }
     }
-    swapchainFramebuffers.clear();
+    resources.framebuffers.clear();
     
-    for (auto imageView : swapchainImageViews) {
+    for (auto imageView : resources.imageViews) {
         if (imageView != VK_NULL_HANDLE) {
             vkDestroyImageView(context->getDevice(), imageView, nullptr);
         }
     }
-    swapchainImageViews.clear();
+    resources.imageViews.clear();
     
-    if (renderPass != VK_NULL_HANDLE) {
-        vkDestroyRenderPass(context->getDevice(), renderPass, nullptr);
-        renderPass = VK_NULL_HANDLE;
+    if (resources.renderPass != VK_NULL_HANDLE) {
+        vkDestroyRenderPass(context->getDevice(), resources.renderPass, nullptr);
+        resources.renderPass = VK_NULL_HANDLE;
     }
     
-    swapchainImages.clear();
-    
-    // Reset swapchain handle so createSwapchain can use oldSwapchain
-    swapchain = VK_NULL_HANDLE;
-    
-    // Create new swapchain (passing old one for optimization)
-    createSwapchainWithOld(oldSwapchain);
-    
-    // Destroy old swapchain after new one is created
-    if (oldSwapchain != VK_NULL_HANDLE) {
-        vkDestroySwapchainKHR(context->getDevice(), oldSwapchain, nullptr);
+    if (resources.swapchain != VK_NULL_HANDLE) {
+        vkDestroySwapchainKHR(context->getDevice(), resources.swapchain, nullptr);
+        resources.swapchain = VK_NULL_HANDLE;
     }
-    
-    // Create new resources
-    createImageViews();
-    createRenderPass();
-    createFramebuffers();
 }
 
 void Swapchain::createSwapchain() {
@@ -109,7 +113,7 @@ void Swapchain::createSwapchainWithOld(VkSwapchainKHR oldSwapchain) {
     SwapChainSupportDetails swapChainSupport = querySwapChainSupport();
     
     VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(swapChainSupport.formats);
-    VkPresentModeKHR presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
+    VkPresentModeKHR chosenPresentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
     VkExtent2D extent = chooseSwapExtent(swapChainSupport.capabilities);
     
     uint32_t imageCount = swapChainSupport.capabilities.minImageCount + 1;
@@ -144,7 +148,7 @@ void Swapchain::createSwapchainWithOld(VkSwapchainKHR oldSwapchain) {
     
     createInfo.preTransform = swapChainSupport.capabilities.currentTransform;
     createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
-    createInfo.presentMode = presentMode;
+    createInfo.presentMode = chosenPresentMode;
     createInfo.clipped = VK_TRUE;
     createInfo.oldSwapchain = oldSwapchain;
     
@@ -158,6 +162,7 @@ void Swapchain::createSwapchainWithOld(VkSwapchainKHR oldSwapchain) {
     
     swapchainImageFormat = surfaceFormat.format;
     swapchainExtent = extent;
+    presentMode = chosenPresentMode;
 }
 
 void Swapchain::createImageViews() {
@@ -287,7 +292,7 @@ VkSurfaceFormatKHR Swapchain::chooseSwapSurfaceFormat(const std::vector<VkSurfac
 
 VkPresentModeKHR Swapchain::chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes) {
     for (const auto& availablePresentMode : availablePresentModes) {
-        if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR) {
+        if (availablePresentMode == preferredPresentMode) {
             return availablePresentMode;
         }
     }
@@ -295,6 +300,37 @@ VkPresentModeKHR Swapchain::chooseSwapPresentMode(const std::vector<VkPresentMod
     return VK_PRESENT_MODE_FIFO_KHR;
 }
 
+bool Swapchain::isPresentModeSupported(VkPresentModeKHR mode) {
+    std::vector<VkPresentModeKHR> modes = querySwapChainSupport().presentModes;
+    return std::find(modes.begin(), modes.end(), mode) != modes.end();
+}
+
+const char* Swapchain::presentModeName(VkPresentModeKHR mode) {
+    switch (mode) {
+        case VK_PRESENT_MODE_MAILBOX_KHR: return "mailbox";
+        case VK_PRESENT_MODE_IMMEDIATE_KHR: return "immediate";
+        case VK_PRESENT_MODE_FIFO_KHR: return "fifo";
+        case VK_PRESENT_MODE_FIFO_RELAXED_KHR: return "fifo-relaxed";
+        default: return "unknown";
+    }
+}
+
+bool Swapchain::parsePresentMode(const std::string& name, VkPresentModeKHR& mode) {
+    const VkPresentModeKHR modes[] = {
+        VK_PRESENT_MODE_MAILBOX_KHR,
+        VK_PRESENT_MODE_IMMEDIATE_KHR,
+        VK_PRESENT_MODE_FIFO_KHR,
+        VK_PRESENT_MODE_FIFO_RELAXED_KHR
+    };
+    for (VkPresentModeKHR candidate : modes) {
+        if (name == presentModeName(candidate)) {
+            mode = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
 VkExtent2D Swapchain::chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities) {
     if (capabilities.currentExtent.width != std::numeric_limits<uint32_t>::max()) {
         return capabilities.currentExtent;
@@ -0,0 +1,107 @@
+#include "uniform_ring.h"
+#include "vulkan_context.h"
+#include <algorithm>
+#include <stdexcept>
+
+UniformRing::UniformRing(VulkanContext* ctx, uint32_t frames, VkDeviceSize perFrame, VkDeviceSize range)
+    : context(ctx), frameCount(frames), bytesPerFrame(perFrame), blockRange(range) {
+}
+
+UniformRing::~UniformRing() {
+    cleanup();
+}
+
+void UniformRing::create(VkDescriptorSetLayout layout) {
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(context->getPhysicalDevice(), &deviceProperties);
+    
+    if (blockRange > deviceProperties.limits.maxUniformBufferRange) {
+        throw std::runtime_error("uniform block range exceeds maxUniformBufferRange!");
+    }
+    
+    // Every dynamic offset (and so every region start) must be aligned
+    offsetAlignment = std::max<VkDeviceSize>(1, deviceProperties.limits.minUniformBufferOffsetAlignment);
+    bytesPerFrame = (bytesPerFrame + offsetAlignment - 1) / offsetAlignment * offsetAlignment;
+    
+    // Mapped once by the allocator; writes go straight to the buffer
+    buffer = std::make_unique<Buffer>(context);
+    buffer->create(bytesPerFrame * frameCount,
+        VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    
+    VkDescriptorPoolSize poolSize{};
+    poolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    poolSize.descriptorCount = 2;
+    
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.maxSets = 1;
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes = &poolSize;
+    
+    if (vkCreateDescriptorPool(context->getDevice(), &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create descriptor pool!");
+    }
+    
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = descriptorPool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &layout;
+    
+    if (vkAllocateDescriptorSets(context->getDevice(), &allocInfo, &descriptorSet) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate descriptor set!");
+    }
+    
+    // Both stages read from the same buffer; the dynamic offsets pick the block
+    VkDescriptorBufferInfo bufferInfo{};
+    bufferInfo.buffer = buffer->getBuffer();
+    bufferInfo.offset = 0;
+    bufferInfo.range = blockRange;
+    
+    VkWriteDescriptorSet writes[2]{};
+    for (uint32_t i = 0; i < 2; i++) {
+        writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[i].dstSet = descriptorSet;
+        writes[i].dstBinding = i;
+        writes[i].descriptorCount = 1;
+        writes[i].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+        writes[i].pBufferInfo = &bufferInfo;
+    }
+    vkUpdateDescriptorSets(context->getDevice(), 2, writes, 0, nullptr);
+    
+    beginFrame(0);
+}
+
+void UniformRing::cleanup() {
+    if (descriptorPool != VK_NULL_HANDLE) {
+        // Destroying the pool frees the descriptor set
+        vkDestroyDescriptorPool(context->getDevice(), descriptorPool, nullptr);
+        descriptorPool = VK_NULL_HANDLE;
+        descriptorSet = VK_NULL_HANDLE;
+    }
+    
+    buffer.reset();
+}
+
+void UniformRing::beginFrame(uint32_t frameIndex) {
+    frameBegin = bytesPerFrame * (frameIndex % frameCount);
+    frameHead = frameBegin;
+}
+
+uint32_t UniformRing::push(const void* data, VkDeviceSize size) {
+    if (size > blockRange) {
+        throw std::runtime_error("uniform block is larger than the descriptor range!");
+    }
+    
+    // The shader may read the whole range at the offset, so it has to fit too
+    VkDeviceSize offset = (frameHead + offsetAlignment - 1) / offsetAlignment * offsetAlignment;
+    if (offset + blockRange > frameBegin + bytesPerFrame) {
+        throw std::runtime_error("uniform ring frame region is full!");
+    }
+    
+    buffer->copyData(data, size, offset);
+    frameHead = offset + size;
+    
+    return static_cast<uint32_t>(offset);
+}
\ No newline at end of file
@@ -0,0 +1,258 @@
+#include "upload_manager.h"
+#include "vulkan_context.h"
+#include <algorithm>
+#include <stdexcept>
+
+UploadManager::UploadManager(VulkanContext* ctx, VkDeviceSize size)
+    : context(ctx), stagingSize(size) {
+}
+
+UploadManager::~UploadManager() {
+    cleanup();
+}
+
+void UploadManager::create() {
+    queue = context->getTransferQueue();
+    
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(context->getPhysicalDevice(), &deviceProperties);
+    copyAlignment = std::max<VkDeviceSize>(copyAlignment, deviceProperties.limits.optimalBufferCopyOffsetAlignment);
+    
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    poolInfo.queueFamilyIndex = context->getTransferQueueFamily();
+    
+    if (vkCreateCommandPool(context->getDevice(), &poolInfo, nullptr, &commandPool) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create upload command pool!");
+    }
+    
+    VkSemaphoreTypeCreateInfo typeInfo{};
+    typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    typeInfo.initialValue = 0;
+    
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphoreInfo.pNext = &typeInfo;
+    
+    if (vkCreateSemaphore(context->getDevice(), &semaphoreInfo, nullptr, &timeline) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create upload timeline semaphore!");
+    }
+    
+    staging = std::make_unique<Buffer>(context);
+    staging->create(stagingSize,
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+}
+
+void UploadManager::cleanup() {
+    if (timeline == VK_NULL_HANDLE) {
+        return;
+    }
+    
+    // Staging memory and command buffers may still be read by the GPU
+    submit();
+    wait(submittedValue);
+    
+    staging.reset();
+    
+    // Destroying the pool frees every command buffer allocated from it
+    vkDestroyCommandPool(context->getDevice(), commandPool, nullptr);
+    commandPool = VK_NULL_HANDLE;
+    freeCommandBuffers.clear();
+    inFlight.clear();
+    
+    vkDestroySemaphore(context->getDevice(), timeline, nullptr);
+    timeline = VK_NULL_HANDLE;
+}
+
+uint64_t UploadManager::upload(Buffer& dst, const void* data, VkDeviceSize size, VkDeviceSize dstOffset) {
+    const char* bytes = static_cast<const char*>(data);
+    
+    // Large uploads are split so a single copy never needs the whole ring
+    VkDeviceSize maxChunk = stagingSize / 2;
+    for (VkDeviceSize done = 0; done < size;) {
+        VkDeviceSize chunk = std::min(size - done, maxChunk);
+        VkDeviceSize offset = reserveStaging(chunk);
+        
+        staging->copyData(bytes + done, chunk, offset);
+        
+        VkBufferCopy copyRegion{};
+        copyRegion.srcOffset = offset;
+        copyRegion.dstOffset = dstOffset + done;
+        copyRegion.size = chunk;
+        vkCmdCopyBuffer(openBatch.commandBuffer, staging->getBuffer(), dst.getBuffer(), 1, &copyRegion);
+        
+        done += chunk;
+    }
+    
+    return batchOpen ? submittedValue + 1 : submittedValue;
+}
+
+uint64_t UploadManager::submit() {
+    if (!batchOpen) {
+        return submittedValue;
+    }
+    
+    if (vkEndCommandBuffer(openBatch.commandBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to record upload command buffer!");
+    }
+    
+    uint64_t signalValue = submittedValue + 1;
+    
+    VkTimelineSemaphoreSubmitInfo timelineInfo{};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.signalSemaphoreValueCount = 1;
+    timelineInfo.pSignalSemaphoreValues = &signalValue;
+    
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.pNext = &timelineInfo;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &openBatch.commandBuffer;
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores = &timeline;
+    
+    if (vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+        throw std::runtime_error("failed to submit upload command buffer!");
+    }
+    
+    submittedValue = signalValue;
+    openBatch.value = signalValue;
+    inFlight.push_back(openBatch);
+    openBatch = Batch();
+    batchOpen = false;
+    
+    return submittedValue;
+}
+
+bool UploadManager::isComplete(uint64_t value) {
+    uint64_t completed = 0;
+    vkGetSemaphoreCounterValue(context->getDevice(), timeline, &completed);
+    return completed >= value;
+}
+
+void UploadManager::wait(uint64_t value) {
+    if (!isComplete(value)) {
+        VkSemaphoreWaitInfo waitInfo{};
+        waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+        waitInfo.semaphoreCount = 1;
+        waitInfo.pSemaphores = &timeline;
+        waitInfo.pValues = &value;
+        
+        if (vkWaitSemaphores(context->getDevice(), &waitInfo, UINT64_MAX) != VK_SUCCESS) {
+            throw std::runtime_error("failed to wait for uploads!");
+        }
+    }
+    retireCompleted();
+}
+
+VkDeviceSize UploadManager::reserveStaging(VkDeviceSize size) {
+    retireCompleted();
+    
+    VkDeviceSize offset;
+    VkDeviceSize used = stagingUsed;
+    while (!tryReserve(size, offset)) {
+        if (batchOpen) {
+            // The open batch holds staging space itself; hand it to the GPU first
+            submit();
+        } else if (!inFlight.empty()) {
+            wait(inFlight.front().value);
+        } else {
+            throw std::runtime_error("upload does not fit in the staging buffer!");
+        }
+        used = stagingUsed;
+    }
+    
+    // Space taken after a mid-upload submit belongs to the new batch
+    if (!batchOpen) {
+        beginBatch();
+    }
+    openBatch.stagingBytes += stagingUsed - used;
+    
+    return offset;
+}
+
+bool UploadManager::tryReserve(VkDeviceSize size, VkDeviceSize& offset) {
+    if (stagingUsed == 0) {
+        stagingHead = 0;
+    } else if (stagingUsed == stagingSize) {
+        return false;
+    }
+    
+    // Batches release space in submission order, so the used bytes always
+    // end at the head and start at the tail
+    VkDeviceSize tail = (stagingHead + stagingSize - stagingUsed) % stagingSize;
+    VkDeviceSize aligned = (stagingHead + copyAlignment - 1) / copyAlignment * copyAlignment;
+    
+    if (tail <= stagingHead) {
+        // Free space is [head, end) and [0, tail)
+        if (aligned + size <= stagingSize) {
+            offset = aligned;
+        } else if (size <= tail) {
+            // Wrap around; the skipped end of the ring is released with this batch
+            offset = 0;
+        } else {
+            return false;
+        }
+    } else {
+        // Free space is [head, tail)
+        if (aligned + size > tail) {
+            return false;
+        }
+        offset = aligned;
+    }
+    
+    VkDeviceSize newHead = (offset + size) % stagingSize;
+    stagingUsed += (offset + size + stagingSize - stagingHead) % stagingSize;
+    if (stagingUsed == 0) {
+        stagingUsed = stagingSize;  // Filled the whole ring exactly
+    }
+    stagingHead = newHead;
+    return true;
+}
+
+void UploadManager::beginBatch() {
+    if (freeCommandBuffers.empty()) {
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandPool = commandPool;
+        allocInfo.commandBufferCount = 1;
+        
+        VkCommandBuffer commandBuffer;
+        if (vkAllocateCommandBuffers(context->getDevice(), &allocInfo, &commandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate upload command buffer!");
+        }
+        freeCommandBuffers.push_back(commandBuffer);
+    }
+    
+    openBatch = Batch();
+    openBatch.commandBuffer = freeCommandBuffers.back();
+    freeCommandBuffers.pop_back();
+    
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    
+    if (vkBeginCommandBuffer(openBatch.commandBuffer, &beginInfo) != VK_SUCCESS) {
+        throw std::runtime_error("failed to begin upload command buffer!");
+    }
+    batchOpen = true;
+}
+
+void UploadManager::retireCompleted() {
+    if (inFlight.empty()) {
+        return;
+    }
+    
+    uint64_t completed = 0;
+    vkGetSemaphoreCounterValue(context->getDevice(), timeline, &completed);
+    
+    while (!inFlight.empty() && inFlight.front().value <= completed) {
+        stagingUsed -= inFlight.front().stagingBytes;
+        freeCommandBuffers.push_back(inFlight.front().commandBuffer);
+        inFlight.pop_front();
+    }
+}
\ No newline at end of file
@@ -0,0 +1,186 @@
+#include "vertex_format.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+// IEEE half from float, rounded to nearest even
+uint16_t toHalf(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    
+    uint32_t sign = (bits >> 16) & 0x8000;
+    uint32_t exponent = (bits >> 23) & 0xFF;
+    uint32_t mantissa = bits & 0x7FFFFF;
+    
+    if (exponent == 0xFF) {
+        return static_cast<uint16_t>(sign | 0x7C00 | (mantissa ? 0x200 : 0));  // Infinity or NaN
+    }
+    
+    int32_t halfExponent = static_cast<int32_t>(exponent) - 127 + 15;
+    if (halfExponent >= 31) {
+        return static_cast<uint16_t>(sign | 0x7C00);  // Too large: infinity
+    }
+    
+    uint32_t half;
+    uint32_t shift;
+    if (halfExponent <= 0) {
+        if (halfExponent < -10) {
+            return static_cast<uint16_t>(sign);  // Too small even for a subnormal
+        }
+        // Subnormal: the implicit leading bit becomes part of the mantissa
+        mantissa |= 0x800000;
+        shift = static_cast<uint32_t>(14 - halfExponent);
+        half = sign | (mantissa >> shift);
+    } else {
+        shift = 13;
+        half = sign | (static_cast<uint32_t>(halfExponent) << 10) | (mantissa >> shift);
+    }
+    
+    // A carry out of the mantissa correctly moves on to the next exponent
+    uint32_t rest = mantissa & ((1u << shift) - 1);
+    uint32_t halfway = 1u << (shift - 1);
+    if (rest > halfway || (rest == halfway && (half & 1))) {
+        half++;
+    }
+    return static_cast<uint16_t>(half);
+}
+
+uint32_t toUnorm8(float value) {
+    return static_cast<uint32_t>(std::lround(std::clamp(value, 0.0f, 1.0f) * 255.0f));
+}
+
+uint32_t toSnorm(float value, float scale, uint32_t mask) {
+    return static_cast<uint32_t>(std::lround(std::clamp(value, -1.0f, 1.0f) * scale)) & mask;
+}
+
+} // namespace
+
+VertexFormat& VertexFormat::add(uint32_t location, Semantic semantic, VkFormat format) {
+    uint32_t size = formatSize(format);
+    if (size == 0) {
+        throw std::runtime_error("unsupported vertex attribute format!");
+    }
+    if (find(location)) {
+        throw std::runtime_error("vertex format has two attributes at location " + std::to_string(location) + "!");
+    }
+    
+    Attribute attribute{};
+    attribute.location = location;
+    attribute.semantic = semantic;
+    attribute.format = format;
+    attribute.offset = stride;
+    attributes.push_back(attribute);
+    
+    stride += (size + 3) & ~3u;
+    return *this;
+}
+
+VertexFormat VertexFormat::standard() {
+    VertexFormat format;
+    format.add(0, Semantic::POSITION, VK_FORMAT_R32G32B32_SFLOAT)
+          .add(1, Semantic::COLOR, VK_FORMAT_R32G32B32_SFLOAT);
+    return format;
+}
+
+VertexFormat VertexFormat::compact() {
+    // Half floats keep 11 bits of precision, enough for positions in a
+    // model's local space; the shader still reads vec3 (w is dropped)
+    VertexFormat format;
+    format.add(0, Semantic::POSITION, VK_FORMAT_R16G16B16A16_SFLOAT)
+          .add(1, Semantic::COLOR, VK_FORMAT_R8G8B8A8_UNORM);
+    return format;
+}
+
+VertexFormat VertexFormat::compactWithNormals() {
+    VertexFormat format = compact();
+    format.add(4, Semantic::NORMAL, VK_FORMAT_A2B10G10R10_SNORM_PACK32);
+    return format;
+}
+
+VertexFormat VertexFormat::instance() {
+    VertexFormat format;
+    format.add(2, Semantic::RAW, VK_FORMAT_R32G32B32_SFLOAT)
+          .add(3, Semantic::RAW, VK_FORMAT_R32_SFLOAT);
+    return format;
+}
+
+std::vector<uint8_t> VertexFormat::pack(const std::vector<Vertex>& vertices,
+                                        const std::vector<glm::vec3>& normals) const {
+    for (const auto& attribute : attributes) {
+        if (attribute.semantic == Semantic::RAW) {
+            throw std::runtime_error("cannot pack vertices into a raw vertex format!");
+        }
+        if (attribute.semantic == Semantic::NORMAL && normals.size() != vertices.size()) {
+            throw std::runtime_error("vertex format needs one normal per vertex!");
+        }
+    }
+    
+    std::vector<uint8_t> data(static_cast<size_t>(stride) * vertices.size());
+    for (size_t i = 0; i < vertices.size(); i++) {
+        uint8_t* vertex = data.data() + i * stride;
+        for (const auto& attribute : attributes) {
+            glm::vec4 value;
+            switch (attribute.semantic) {
+                case Semantic::POSITION: value = glm::vec4(vertices[i].position, 1.0f); break;
+                case Semantic::COLOR: value = glm::vec4(vertices[i].color, 1.0f); break;
+                default: value = glm::vec4(normals[i], 0.0f); break;
+            }
+            
+            uint8_t* out = vertex + attribute.offset;
+            switch (attribute.format) {
+                case VK_FORMAT_R32_SFLOAT:
+                case VK_FORMAT_R32G32_SFLOAT:
+                case VK_FORMAT_R32G32B32_SFLOAT:
+                case VK_FORMAT_R32G32B32A32_SFLOAT:
+                    std::memcpy(out, &value[0], formatSize(attribute.format));
+                    break;
+                case VK_FORMAT_R16G16_SFLOAT:
+                case VK_FORMAT_R16G16B16A16_SFLOAT: {
+                    uint16_t halves[4] = {toHalf(value.x), toHalf(value.y), toHalf(value.z), toHalf(value.w)};
+                    std::memcpy(out, halves, formatSize(attribute.format));
+                    break;
+                }
+                case VK_FORMAT_R8G8B8A8_UNORM: {
+                    uint32_t packed = toUnorm8(value.x) | toUnorm8(value.y) << 8 |
+                                      toUnorm8(value.z) << 16 | toUnorm8(value.w) << 24;
+                    std::memcpy(out, &packed, sizeof(packed));
+                    break;
+                }
+                default: {
+                    // A2B10G10R10: red in the low bits, the 2-bit alpha on top
+                    uint32_t packed = toSnorm(value.x, 511.0f, 0x3FF) | toSnorm(value.y, 511.0f, 0x3FF) << 10 |
+                                      toSnorm(value.z, 511.0f, 0x3FF) << 20 | toSnorm(value.w, 1.0f, 0x3) << 30;
+                    std::memcpy(out, &packed, sizeof(packed));
+                    break;
+                }
+            }
+        }
+    }
+    return data;
+}
+
+const VertexFormat::Attribute* VertexFormat::find(uint32_t location) const {
+    for (const auto& attribute : attributes) {
+        if (attribute.location == location) {
+            return &attribute;
+        }
+    }
+    return nullptr;
+}
+
+uint32_t VertexFormat::formatSize(VkFormat format) {
+    switch (format) {
+        case VK_FORMAT_R32_SFLOAT: return 4;
+        case VK_FORMAT_R32G32_SFLOAT: return 8;
+        case VK_FORMAT_R32G32B32_SFLOAT: return 12;
+        case VK_FORMAT_R32G32B32A32_SFLOAT: return 16;
+        case VK_FORMAT_R16G16_SFLOAT: return 4;
+        case VK_FORMAT_R16G16B16A16_SFLOAT: return 8;
+        case VK_FORMAT_R8G8B8A8_UNORM: return 4;
+        case VK_FORMAT_A2B10G10R10_SNORM_PACK32: return 4;
+        default: return 0;
+    }
+}
\ No newline at end of file
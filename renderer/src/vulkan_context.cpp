@@ -1,4 +1,6 @@
 #include "vulkan_context.h"
+#include "memory_allocator.h"
+#include "upload_manager.h"
 #include <stdexcept>
 #include <iostream>
 #include <set>
@@ -46,15 +48,28 @@ VulkanContext::~VulkanContext() {
 }
 
 void VulkanContext::init(GLFWwindow* window) {
+    headless = window == nullptr;
+    
     createInstance();
     setupDebugMessenger();
-    createSurface(window);
+    if (!headless) {
+        createSurface(window);
+    }
     pickPhysicalDevice();
     createLogicalDevice();
     createCommandPool();
+    
+    allocator = std::make_unique<MemoryAllocator>(this);
+    allocator->create();
+    
+    uploadManager = std::make_unique<UploadManager>(this);
+    uploadManager->create();
 }
 
 void VulkanContext::cleanup() {
+    uploadManager.reset();
+    allocator.reset();
+    
     if (commandPool != VK_NULL_HANDLE) {
         vkDestroyCommandPool(device, commandPool, nullptr);
     }
@@ -174,9 +189,14 @@ void VulkanContext::createLogicalDevice() {
     
     std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
     std::set<uint32_t> uniqueQueueFamilies = {
-        queueFamilies.graphicsFamily.value(),
-        queueFamilies.presentFamily.value()
+        queueFamilies.graphicsFamily.value()
     };
+    if (queueFamilies.presentFamily.has_value()) {
+        uniqueQueueFamilies.insert(queueFamilies.presentFamily.value());
+    }
+    if (queueFamilies.transferFamily.has_value()) {
+        uniqueQueueFamilies.insert(queueFamilies.transferFamily.value());
+    }
     
     float queuePriority = 1.0f;
     for (uint32_t queueFamily : uniqueQueueFamilies) {
@@ -188,15 +208,62 @@ void VulkanContext::createLogicalDevice() {
         queueCreateInfos.push_back(queueCreateInfo);
     }
     
+    // Indirect multi-draw lets MeshBatch submit a whole batch in one call;
+    // enabled when present, MeshBatch falls back to direct draws otherwise
+    VkPhysicalDeviceFeatures supportedFeatures;
+    vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+    
     VkPhysicalDeviceFeatures deviceFeatures{};
+    deviceFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+    deviceFeatures.drawIndirectFirstInstance = supportedFeatures.drawIndirectFirstInstance;
+    
+    // Pipeline statistics for GpuProfiler; inherited by the secondaries that hold the draws
+    deviceFeatures.pipelineStatisticsQuery = supportedFeatures.pipelineStatisticsQuery;
+    deviceFeatures.inheritedQueries = supportedFeatures.inheritedQueries;
+    enabledFeatures = deviceFeatures;
+    
+    // Timeline semaphores signal upload completion (core in Vulkan 1.2)
+    VkPhysicalDeviceVulkan12Features vulkan12Features{};
+    vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    vulkan12Features.timelineSemaphore = VK_TRUE;
+    
+    // Optional present pacing: present_id tags each present, present_wait
+    // blocks until a tagged present has been shown
+    std::vector<const char*> enabledExtensions;
+    if (!headless) {
+        enabledExtensions.assign(deviceExtensions.begin(), deviceExtensions.end());
+    }
+    
+    VkPhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures{};
+    presentWaitFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+    
+    VkPhysicalDevicePresentIdFeaturesKHR presentIdFeatures{};
+    presentIdFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+    presentIdFeatures.pNext = &presentWaitFeatures;
+    
+    if (!headless && hasDeviceExtension(physicalDevice, VK_KHR_PRESENT_ID_EXTENSION_NAME) &&
+        hasDeviceExtension(physicalDevice, VK_KHR_PRESENT_WAIT_EXTENSION_NAME)) {
+        VkPhysicalDeviceFeatures2 features{};
+        features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features.pNext = &presentIdFeatures;
+        vkGetPhysicalDeviceFeatures2(physicalDevice, &features);
+        presentWaitSupported = presentIdFeatures.presentId && presentWaitFeatures.presentWait;
+    }
+    
+    if (presentWaitSupported) {
+        enabledExtensions.push_back(VK_KHR_PRESENT_ID_EXTENSION_NAME);
+        enabledExtensions.push_back(VK_KHR_PRESENT_WAIT_EXTENSION_NAME);
+        vulkan12Features.pNext = &presentIdFeatures;
+    }
     
     VkDeviceCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    createInfo.pNext = &vulkan12Features;
     createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
     createInfo.pQueueCreateInfos = queueCreateInfos.data();
     createInfo.pEnabledFeatures = &deviceFeatures;
-    createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-    createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+    createInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size());
+    createInfo.ppEnabledExtensionNames = enabledExtensions.data();
     
     if (enableValidationLayers) {
         createInfo.enabledLayerCount = static_cast<uint32_t>(validationLayers.size());
@@ -210,7 +277,10 @@ void VulkanContext::createLogicalDevice() {
     }
     
     vkGetDeviceQueue(device, queueFamilies.graphicsFamily.value(), 0, &graphicsQueue);
-    vkGetDeviceQueue(device, queueFamilies.presentFamily.value(), 0, &presentQueue);
+    if (queueFamilies.presentFamily.has_value()) {
+        vkGetDeviceQueue(device, queueFamilies.presentFamily.value(), 0, &presentQueue);
+    }
+    vkGetDeviceQueue(device, getTransferQueueFamily(), 0, &transferQueue);
 }
 
 void VulkanContext::createCommandPool() {
@@ -235,19 +305,25 @@ QueueFamilyIndices VulkanContext::findQueueFamilies(VkPhysicalDevice device) {
     
     int i = 0;
     for (const auto& queueFamily : queueFamilies) {
-        if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+        if (!indices.graphicsFamily.has_value() && (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT)) {
             indices.graphicsFamily = i;
         }
         
         VkBool32 presentSupport = false;
-        vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
+        if (surface != VK_NULL_HANDLE) {
+            vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
+        }
         
-        if (presentSupport) {
+        if (!indices.presentFamily.has_value() && presentSupport) {
             indices.presentFamily = i;
         }
         
-        if (indices.isComplete()) {
-            break;
+        // A family with transfer but neither graphics nor compute is usually a
+        // separate DMA engine that copies without competing with rendering
+        bool transferOnly = (queueFamily.queueFlags & VK_QUEUE_TRANSFER_BIT) &&
+                            !(queueFamily.queueFlags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT));
+        if (!indices.transferFamily.has_value() && transferOnly) {
+            indices.transferFamily = i;
         }
         
         i++;
@@ -257,6 +333,13 @@ QueueFamilyIndices VulkanContext::findQueueFamilies(VkPhysicalDevice device) {
 }
 
 bool VulkanContext::isDeviceSuitable(VkPhysicalDevice device) {
+    // The 1.2 feature query below is only valid on a 1.2 device
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(device, &properties);
+    if (properties.apiVersion < VK_API_VERSION_1_2) {
+        return false;
+    }
+    
     QueueFamilyIndices indices = findQueueFamilies(device);
     
     uint32_t extensionCount;
@@ -265,13 +348,41 @@ bool VulkanContext::isDeviceSuitable(VkPhysicalDevice device) {
     std::vector<VkExtensionProperties> availableExtensions(extensionCount);
     vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
     
-    std::set<std::string> requiredExtensions(deviceExtensions.begin(), deviceExtensions.end());
+    // Offscreen rendering needs neither a present queue nor a swapchain
+    std::set<std::string> requiredExtensions;
+    if (!headless) {
+        requiredExtensions.insert(deviceExtensions.begin(), deviceExtensions.end());
+    }
     
     for (const auto& extension : availableExtensions) {
         requiredExtensions.erase(extension.extensionName);
     }
     
-    return indices.isComplete() && requiredExtensions.empty();
+    VkPhysicalDeviceVulkan12Features vulkan12Features{};
+    vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    
+    VkPhysicalDeviceFeatures2 features{};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features.pNext = &vulkan12Features;
+    vkGetPhysicalDeviceFeatures2(device, &features);
+    
+    bool queuesFound = headless ? indices.graphicsFamily.has_value() : indices.isComplete();
+    return queuesFound && requiredExtensions.empty() && vulkan12Features.timelineSemaphore;
+}
+
+bool VulkanContext::hasDeviceExtension(VkPhysicalDevice device, const char* name) {
+    uint32_t extensionCount;
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+    
+    std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
+    
+    for (const auto& extension : availableExtensions) {
+        if (strcmp(extension.extensionName, name) == 0) {
+            return true;
+        }
+    }
+    return false;
 }
 
 bool VulkanContext::checkValidationLayerSupport() {
@@ -300,11 +411,15 @@ bool VulkanContext::checkValidationLayerSupport() {
 }
 
 std::vector<const char*> VulkanContext::getRequiredExtensions() {
-    uint32_t glfwExtensionCount = 0;
-    const char** glfwExtensions;
-    glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
-    
-    std::vector<const char*> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+    std::vector<const char*> extensions;
+    
+    // Surface extensions; headless contexts never initialize GLFW
+    if (!headless) {
+        uint32_t glfwExtensionCount = 0;
+        const char** glfwExtensions;
+        glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+        extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+    }
     
     if (enableValidationLayers) {
         extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
@@ -0,0 +1,551 @@
+#include "shader_compiler.h"
+#include "lexer.h"
+#include "parser.h"
+#include "ast_arena.h"
+#include "optimizer.h"
+#include "codegen.h"
+#include "spirv_optimizer.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <chrono>
+#include <atomic>
+#include <random>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#include <new>
+#include <string>
+#include <vector>
+
+// Every heap allocation made by the process is counted, so a stage's
+// allocations are the difference of the counters around it
+static std::atomic<size_t> allocationCount{0};
+static std::atomic<size_t> allocatedBytes{0};
+
+// GCC sees free() on memory from operator new once these are inlined into
+// their callers; both sides go through malloc/free here
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void* operator new(size_t size) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { operator delete(p); }
+void operator delete(void* p, size_t) noexcept { operator delete(p); }
+void operator delete[](void* p, size_t) noexcept { operator delete(p); }
+
+struct BenchOptions {
+    int statements = 200;       // Assignments per shader
+    int depth = 4;              // Binary operator nesting of each expression
+    int shaders = 8;            // Alternating vertex and fragment
+    int iterations = 100;
+    int warmup = 5;
+    unsigned seed = 1;
+    bool optimize = true;
+    bool spirvOptimize = false;
+    SpirvBackend backend = SpirvBackend::NATIVE;
+    std::string outputFile;     // JSON report; "-" for stdout
+};
+
+struct GeneratedShader {
+    std::string type;
+    std::string source;
+};
+
+/**
+ * Synthetic DSL programs
+ * Temporaries alternate between float and vec3 and read the shader inputs
+ * and earlier temporaries; literal subtrees give the folder work, repeated
+ * subexpressions give CSE work and unread temporaries give DCE work
+ */
+class ProgramGenerator {
+public:
+    ProgramGenerator(const BenchOptions& options, unsigned seed) : options(options), rng(seed) {}
+    
+    GeneratedShader generate(const std::string& shaderType) {
+        floats.clear();
+        vectors.clear();
+        repeated.clear();
+        
+        bool vertex = shaderType == "vertex";
+        std::ostringstream out;
+        out << "shader " << shaderType << " {\n";
+        if (vertex) {
+            out << "    input vec3 inPosition;\n";
+            out << "    input vec3 inColor;\n";
+            out << "    input float inScale;\n";
+            out << "    output vec3 fragColor;\n";
+            out << "    uniform mat4 uMVP;\n";
+            floats = {"inScale", "inPosition.x", "inColor.y"};
+            vectors = {"inPosition", "inColor"};
+        } else {
+            out << "    input vec3 fragColor;\n";
+            out << "    output vec4 outColor;\n";
+            floats = {"fragColor.x", "fragColor.z"};
+            vectors = {"fragColor"};
+        }
+        out << "\n    main {\n";
+        
+        for (int i = 0; i < options.statements; i++) {
+            bool isVector = i % 2 == 1;
+            std::string name = (isVector ? "v" : "f") + std::to_string(i);
+            out << "        " << name << " = " << (isVector ? vectorExpr(options.depth) : floatExpr(options.depth)) << ";\n";
+            (isVector ? vectors : floats).push_back(name);
+        }
+        
+        // Outputs read the last temporaries, so most of the program stays live
+        std::string lastVector = vectors.back();
+        std::string lastFloat = floats.back();
+        if (vertex) {
+            out << "        fragColor = " << lastVector << " * " << lastFloat << ";\n";
+            out << "        gl_Position = uMVP * vec4(" << lastVector << ", 1.0);\n";
+        } else {
+            out << "        outColor = vec4(" << lastVector << " * " << lastFloat << ", 1.0);\n";
+        }
+        out << "    }\n}\n";
+        
+        return {shaderType, out.str()};
+    }
+
+private:
+    int pick(int count) {
+        return std::uniform_int_distribution<int>(0, count - 1)(rng);
+    }
+    
+    std::string literal() {
+        std::ostringstream out;
+        out << std::fixed << std::setprecision(1) << (pick(40) + 1) * 0.5;
+        return out.str();
+    }
+    
+    // Recent names are favoured so the dependency chains stay short-ranged
+    const std::string& recent(const std::vector<std::string>& names) {
+        size_t window = std::min<size_t>(names.size(), 8);
+        return names[names.size() - 1 - pick(static_cast<int>(window))];
+    }
+    
+    std::string floatExpr(int depth) {
+        if (depth == 0) {
+            return pick(3) == 0 ? literal() : recent(floats);
+        }
+        
+        int choice = pick(10);
+        if (choice == 0) {
+            return "(" + literal() + " * " + literal() + ")";
+        }
+        if (choice == 1 && !repeated.empty()) {
+            return repeated[pick(static_cast<int>(repeated.size()))];
+        }
+        
+        static const char* ops[] = {" + ", " - ", " * "};
+        std::string expr = "(" + floatExpr(depth - 1) + ops[pick(3)] + floatExpr(depth - 1) + ")";
+        if (choice == 2 && repeated.size() < 16) {
+            repeated.push_back(expr);
+        }
+        return expr;
+    }
+    
+    std::string vectorExpr(int depth) {
+        if (depth == 0) {
+            if (pick(4) == 0) {
+                return "vec3(" + floatExpr(0) + ", " + floatExpr(0) + ", " + literal() + ")";
+            }
+            return recent(vectors);
+        }
+        
+        switch (pick(4)) {
+            case 0:
+                return "(" + vectorExpr(depth - 1) + " * " + floatExpr(depth - 1) + ")";
+            case 1:
+                return "(" + vectorExpr(depth - 1) + " - " + vectorExpr(depth - 1) + ")";
+            default:
+                return "(" + vectorExpr(depth - 1) + " + " + vectorExpr(depth - 1) + ")";
+        }
+    }
+    
+    const BenchOptions& options;
+    std::mt19937 rng;
+    std::vector<std::string> floats;
+    std::vector<std::string> vectors;
+    std::vector<std::string> repeated;  // Float subexpressions reused verbatim
+};
+
+/**
+ * Samples of one stage, one per iteration (summed over all shaders)
+ */
+struct StageSamples {
+    const char* name;
+    bool countsAllocations;
+    std::vector<double> timesMs;
+    size_t allocations = 0;
+    size_t allocatedBytes = 0;
+    
+    static double percentile(const std::vector<double>& sorted, double p) {
+        size_t rank = static_cast<size_t>(p / 100.0 * (sorted.size() - 1) + 0.5);
+        return sorted[std::min(rank, sorted.size() - 1)];
+    }
+};
+
+// Counter snapshot around one stage
+class StageTimer {
+public:
+    StageTimer()
+        : start(std::chrono::steady_clock::now()),
+          allocations(allocationCount.load(std::memory_order_relaxed)),
+          bytes(allocatedBytes.load(std::memory_order_relaxed)) {}
+    
+    void stop(StageSamples& stage, double& iterationMs, bool record) {
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (record) {
+            iterationMs += ms;
+            stage.allocations += allocationCount.load(std::memory_order_relaxed) - allocations;
+            stage.allocatedBytes += allocatedBytes.load(std::memory_order_relaxed) - bytes;
+        }
+    }
+
+private:
+    std::chrono::steady_clock::time_point start;
+    size_t allocations;
+    size_t bytes;
+};
+
+enum Stage {
+    STAGE_LEX,
+    STAGE_PARSE,
+    STAGE_OPTIMIZE,
+    STAGE_OPT_SIMPLIFY,
+    STAGE_OPT_DEAD_CODE,
+    STAGE_OPT_CSE,
+    STAGE_CODEGEN,
+    STAGE_CODEGEN_GLSL,
+    STAGE_CODEGEN_SPIRV,
+    STAGE_SPIRV_OPTIMIZE,
+    STAGE_COMPILE,
+    STAGE_COUNT
+};
+
+struct Workload {
+    size_t sourceBytes = 0;
+    size_t tokens = 0;
+    size_t astNodes = 0;
+    size_t arenaBytes = 0;
+    size_t spirvWords = 0;
+    size_t optimizedSpirvWords = 0;
+};
+
+void runBenchmark(const BenchOptions& options, const std::vector<GeneratedShader>& shaders,
+                  std::vector<StageSamples>& stages, Workload& workload) {
+    AstArena arena;
+    ShaderCompiler compiler;
+    compiler.setOptimizationEnabled(options.optimize);
+    compiler.setBackend(options.backend);
+    compiler.setSpirvOptimizationEnabled(options.spirvOptimize);
+    
+    for (const auto& shader : shaders) {
+        workload.sourceBytes += shader.source.size();
+    }
+    
+    for (int iteration = -options.warmup; iteration < options.iterations; iteration++) {
+        bool record = iteration >= 0;
+        double iterationMs[STAGE_COUNT] = {};
+        
+        for (const auto& shader : shaders) {
+            // Lexing alone; the parser streams tokens, so parse time includes a second lex
+            StageTimer lexTimer;
+            Lexer lexOnly(shader.source);
+            while (lexOnly.next().type != TokenType::END_OF_FILE) {
+            }
+            lexTimer.stop(stages[STAGE_LEX], iterationMs[STAGE_LEX], record);
+            
+            StageTimer parseTimer;
+            arena.reset();
+            Lexer lexer(shader.source);
+            Parser parser(lexer, arena);
+            ProgramNode* ast = parser.parse();
+            parseTimer.stop(stages[STAGE_PARSE], iterationMs[STAGE_PARSE], record);
+            
+            if (options.optimize) {
+                StageTimer optimizeTimer;
+                Optimizer optimizer(arena);
+                optimizer.optimize(ast);
+                optimizeTimer.stop(stages[STAGE_OPTIMIZE], iterationMs[STAGE_OPTIMIZE], record);
+                
+                const auto& passes = optimizer.getStats();
+                iterationMs[STAGE_OPT_SIMPLIFY] += passes.simplifyTimeMs;
+                iterationMs[STAGE_OPT_DEAD_CODE] += passes.deadCodeTimeMs;
+                iterationMs[STAGE_OPT_CSE] += passes.cseTimeMs;
+            }
+            
+            StageTimer codegenTimer;
+            CodeGenerator codegen(options.backend);
+            std::vector<uint32_t> spirv = codegen.generate(ast, shader.type);
+            codegenTimer.stop(stages[STAGE_CODEGEN], iterationMs[STAGE_CODEGEN], record);
+            iterationMs[STAGE_CODEGEN_GLSL] += codegen.getTimings().glslGenerationMs;
+            iterationMs[STAGE_CODEGEN_SPIRV] += codegen.getTimings().spirvGenerationMs;
+            
+            size_t spirvWords = spirv.size();
+            if (options.spirvOptimize) {
+                StageTimer spirvOptimizeTimer;
+                SpirvOptimizer spirvOptimizer;
+                spirvOptimizer.optimize(spirv);
+                spirvOptimizeTimer.stop(stages[STAGE_SPIRV_OPTIMIZE], iterationMs[STAGE_SPIRV_OPTIMIZE], record);
+            }
+            
+            // End to end through the public API, as the tools and the renderer use it
+            StageTimer compileTimer;
+            compiler.compile(shader.source, shader.type);
+            compileTimer.stop(stages[STAGE_COMPILE], iterationMs[STAGE_COMPILE], record);
+            
+            if (iteration == 0) {
+                workload.tokens += lexer.getTokenCount();
+                workload.astNodes += compiler.getStats().astNodeCount;
+                workload.arenaBytes += arena.bytesUsed();
+                workload.spirvWords += spirvWords;
+                workload.optimizedSpirvWords += spirv.size();
+            }
+        }
+        
+        if (record) {
+            for (int stage = 0; stage < STAGE_COUNT; stage++) {
+                stages[stage].timesMs.push_back(iterationMs[stage]);
+            }
+        }
+    }
+    
+    // Stages that did not run are left out of the report
+    if (!options.optimize) {
+        for (int stage = STAGE_OPTIMIZE; stage <= STAGE_OPT_CSE; stage++) {
+            stages[stage].timesMs.clear();
+        }
+    }
+    if (options.backend == SpirvBackend::NATIVE) {
+        stages[STAGE_CODEGEN_GLSL].timesMs.clear();
+    }
+    if (!options.spirvOptimize) {
+        stages[STAGE_SPIRV_OPTIMIZE].timesMs.clear();
+    }
+}
+
+void writeJson(std::ostream& out, const BenchOptions& options, const std::vector<StageSamples>& stages,
+               const Workload& workload) {
+    out << std::fixed << std::setprecision(6);
+    out << "{\n";
+    out << "  \"benchmark\": \"compiler_bench\",\n";
+    out << "  \"compiler_version\": \"" << ShaderCompiler::version() << "\",\n";
+    out << "  \"compiler_build\": \"" << ShaderCompiler::buildSignature() << "\",\n";
+    out << "  \"config\": {\"statements\": " << options.statements << ", \"depth\": " << options.depth
+        << ", \"shaders\": " << options.shaders << ", \"iterations\": " << options.iterations
+        << ", \"warmup\": " << options.warmup << ", \"seed\": " << options.seed
+        << ", \"optimize\": " << (options.optimize ? "true" : "false")
+        << ", \"spirv_optimize\": " << (options.spirvOptimize ? "true" : "false")
+        << ", \"backend\": \"" << CodeGenerator::backendName(options.backend) << "\"},\n";
+    out << "  \"workload\": {\"source_bytes\": " << workload.sourceBytes << ", \"tokens\": " << workload.tokens
+        << ", \"ast_nodes\": " << workload.astNodes << ", \"arena_bytes\": " << workload.arenaBytes
+        << ", \"spirv_words\": " << workload.spirvWords
+        << ", \"optimized_spirv_words\": " << workload.optimizedSpirvWords << "},\n";
+    out << "  \"stages\": {";
+    
+    bool first = true;
+    for (const auto& stage : stages) {
+        if (stage.timesMs.empty()) {
+            continue;
+        }
+        std::vector<double> sorted = stage.timesMs;
+        std::sort(sorted.begin(), sorted.end());
+        double sum = 0.0;
+        for (double ms : sorted) {
+            sum += ms;
+        }
+        
+        out << (first ? "\n" : ",\n") << "    \"" << stage.name << "\": {"
+            << "\"mean_ms\": " << sum / sorted.size()
+            << ", \"min_ms\": " << sorted.front()
+            << ", \"p50_ms\": " << StageSamples::percentile(sorted, 50)
+            << ", \"p90_ms\": " << StageSamples::percentile(sorted, 90)
+            << ", \"p99_ms\": " << StageSamples::percentile(sorted, 99)
+            << ", \"max_ms\": " << sorted.back();
+        if (stage.countsAllocations) {
+            // Per iteration, summed over shaders
+            out << ", \"allocations\": " << stage.allocations / sorted.size()
+                << ", \"allocated_bytes\": " << stage.allocatedBytes / sorted.size();
+        }
+        out << "}";
+        first = false;
+    }
+    out << "\n  }\n}\n";
+}
+
+void printTable(const std::vector<StageSamples>& stages, const Workload& workload) {
+    std::cout << "=== Compiler Benchmark ===" << std::endl;
+    std::cout << "Source: " << workload.sourceBytes << " bytes, " << workload.tokens << " tokens, "
+              << workload.astNodes << " AST nodes, " << workload.spirvWords << " SPIR-V words";
+    if (workload.optimizedSpirvWords != workload.spirvWords) {
+        std::cout << " (" << workload.optimizedSpirvWords << " optimized)";
+    }
+    std::cout << std::endl;
+    std::cout << "\n" << std::left << std::setw(18) << "Stage" << std::right
+              << std::setw(11) << "p50 ms" << std::setw(11) << "p90 ms" << std::setw(11) << "p99 ms"
+              << std::setw(13) << "allocs/iter" << std::endl;
+    
+    std::cout << std::fixed << std::setprecision(4);
+    for (const auto& stage : stages) {
+        if (stage.timesMs.empty()) {
+            continue;
+        }
+        std::vector<double> sorted = stage.timesMs;
+        std::sort(sorted.begin(), sorted.end());
+        std::cout << std::left << std::setw(18) << stage.name << std::right
+                  << std::setw(11) << StageSamples::percentile(sorted, 50)
+                  << std::setw(11) << StageSamples::percentile(sorted, 90)
+                  << std::setw(11) << StageSamples::percentile(sorted, 99);
+        if (stage.countsAllocations) {
+            std::cout << std::setw(13) << stage.allocations / sorted.size();
+        }
+        std::cout << std::endl;
+    }
+    std::cout << "==========================" << std::endl;
+}
+
+void printUsage(const char* programName) {
+    std::cout << "Shader Compiler Benchmark - per-stage timings on synthetic DSL programs\n" << std::endl;
+    std::cout << "Usage: " << programName << " [options]\n";
+    std::cout << "\nOptions:\n";
+    std::cout << "  --statements <n>  Assignments per shader (default: 200)\n";
+    std::cout << "  --depth <n>       Operator nesting of each expression (default: 4)\n";
+    std::cout << "  --shaders <n>     Shaders per iteration, alternating vertex and fragment (default: 8)\n";
+    std::cout << "  --iterations <n>  Measured iterations (default: 100)\n";
+    std::cout << "  --warmup <n>      Unmeasured iterations first (default: 5)\n";
+    std::cout << "  --seed <n>        Program generator seed (default: 1)\n";
+    std::cout << "  --no-opt          Skip the optimizer\n";
+    std::cout << "  --spirv-opt       Also run the SPIR-V optimizer on each module\n";
+    std::cout << "  --backend <b>     SPIR-V backend (default: native)\n";
+    std::cout << "  --json <file>     Write the report as JSON ('-' for stdout)\n";
+    std::cout << "  --dump <dir>      Write the generated shaders to <dir> and exit\n";
+    std::cout << "  --help, -h        Show this help message\n";
+}
+
+int main(int argc, char* argv[]) {
+    BenchOptions options;
+    std::string dumpDirectory;
+    
+    auto positive = [](const char* arg, int minimum) { return std::max(minimum, atoi(arg)); };
+    
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--statements") == 0 && i + 1 < argc) {
+            options.statements = positive(argv[++i], 1);
+        } else if (strcmp(argv[i], "--depth") == 0 && i + 1 < argc) {
+            options.depth = positive(argv[++i], 0);
+        } else if (strcmp(argv[i], "--shaders") == 0 && i + 1 < argc) {
+            options.shaders = positive(argv[++i], 1);
+        } else if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+            options.iterations = positive(argv[++i], 1);
+        } else if (strcmp(argv[i], "--warmup") == 0 && i + 1 < argc) {
+            options.warmup = positive(argv[++i], 0);
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            options.seed = static_cast<unsigned>(strtoul(argv[++i], nullptr, 10));
+        } else if (strcmp(argv[i], "--no-opt") == 0) {
+            options.optimize = false;
+        } else if (strcmp(argv[i], "--spirv-opt") == 0) {
+            options.spirvOptimize = true;
+        } else if (strcmp(argv[i], "--backend") == 0 && i + 1 < argc) {
+            std::string backendArg = argv[++i];
+            if (!CodeGenerator::parseBackendName(backendArg, options.backend)) {
+                std::cerr << "Error: Unknown backend '" << backendArg << "'" << std::endl;
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            options.outputFile = argv[++i];
+        } else if (strcmp(argv[i], "--dump") == 0 && i + 1 < argc) {
+            dumpDirectory = argv[++i];
+        } else if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0) {
+            printUsage(argv[0]);
+            return 0;
+        } else {
+            std::cerr << "Error: Unknown option '" << argv[i] << "'" << std::endl;
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    
+    if (!CodeGenerator::isBackendAvailable(options.backend)) {
+        std::cerr << "Error: Backend '" << CodeGenerator::backendName(options.backend)
+                  << "' is not available in this build" << std::endl;
+        return 1;
+    }
+    
+    // One generator per shader index, so changing --shaders keeps the existing programs stable
+    std::vector<GeneratedShader> shaders;
+    for (int i = 0; i < options.shaders; i++) {
+        ProgramGenerator generator(options, options.seed + static_cast<unsigned>(i));
+        shaders.push_back(generator.generate(i % 2 == 0 ? "vertex" : "fragment"));
+    }
+    
+    if (!dumpDirectory.empty()) {
+        for (int i = 0; i < options.shaders; i++) {
+            std::string path = dumpDirectory + "/bench" + std::to_string(i) +
+                               (shaders[i].type == "vertex" ? ".vert.dsl" : ".frag.dsl");
+            std::ofstream file(path);
+            if (!file) {
+                std::cerr << "Error: Failed to write " << path << std::endl;
+                return 1;
+            }
+            file << shaders[i].source;
+        }
+        std::cout << "Wrote " << options.shaders << " shaders to " << dumpDirectory << std::endl;
+        return 0;
+    }
+    
+    std::vector<StageSamples> stages = {
+        {"lex", true, {}},
+        {"parse", true, {}},           // Lexing included
+        {"optimize", true, {}},
+        {"optimize.simplify", false, {}},
+        {"optimize.dce", false, {}},
+        {"optimize.cse", false, {}},
+        {"codegen", true, {}},
+        {"codegen.glsl", false, {}},
+        {"codegen.spirv", false, {}},
+        {"spirv_optimize", true, {}},
+        {"compile", true, {}}          // ShaderCompiler::compile, end to end
+    };
+    
+    Workload workload;
+    try {
+        runBenchmark(options, shaders, stages, workload);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: Benchmark program failed to compile: " << e.what() << std::endl;
+        return 1;
+    }
+    
+    if (options.outputFile == "-") {
+        writeJson(std::cout, options, stages, workload);
+        return 0;
+    }
+    
+    printTable(stages, workload);
+    if (!options.outputFile.empty()) {
+        std::ofstream file(options.outputFile);
+        if (!file) {
+            std::cerr << "Error: Failed to write " << options.outputFile << std::endl;
+            return 1;
+        }
+        writeJson(file, options, stages, workload);
+        std::cout << "Report written to " << options.outputFile << std::endl;
+    }
+    
+    return 0;
+}
@@ -1,46 +1,176 @@
 #include "vulkan_context.h"
 #include "swapchain.h"
+#include "offscreen_target.h"
 #include "pipeline.h"
-#include "mesh.h"
+#include "pipeline_cache.h"
+#include "shader_library.h"
+#include "mesh_batch.h"
+#include "mesh_optimizer.h"
+#include "memory_allocator.h"
+#include "upload_manager.h"
+#include "uniform_ring.h"
+#include "command_recorder.h"
+#include "shader_hot_reload.h"
+#include "gpu_profiler.h"
+#include "frame_pacer.h"
 #include <GLFW/glfw3.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <sstream>
 #include <stdexcept>
 #include <vector>
-#include <thread>
-#include <chrono>
 
 const int WIDTH = 800;
 const int HEIGHT = 600;
-const int MAX_FRAMES_IN_FLIGHT = 2;
+const uint32_t DEFAULT_FRAMES_IN_FLIGHT = 2;
+const uint32_t MAX_FRAMES_IN_FLIGHT = 8;
+const char* PIPELINE_CACHE_FILE = "pipeline_cache.bin";
+const char* SHADER_PACK_FILE = "shaders/shaders.pack";  // From myshaderc --pack; loose .spv files without it
+const char* GPU_PROFILE_CSV = "gpu_profile.csv";   // Rolling, one row per GPU scope
+const char* GPU_TRACE_FILE = "gpu_trace.json";     // Chrome trace of the last frames, written on exit
+const uint32_t DEFAULT_BENCH_FRAMES = 1000;
+const uint32_t DEFAULT_WARMUP_FRAMES = 100;
+
+// Per-draw uniform block (std140), read at set 0 binding 0 by the vertex stage
+struct ObjectUniforms {
+    glm::mat4 mvp;
+};
+
+// Frame pacing, set from the command line
+struct RendererOptions {
+    VkPresentModeKHR presentMode = VK_PRESENT_MODE_MAILBOX_KHR;  // FIFO when unsupported
+    uint32_t framesInFlight = DEFAULT_FRAMES_IN_FLIGHT;
+    bool presentWait = false;        // Pace on VK_KHR_present_wait when available
+    uint32_t maxQueuedPresents = 1;  // Presents allowed to wait for the display
+    bool compactVertices = true;     // VertexFormat::compact() instead of full-precision floats
+    
+    // Scene and shaders, for both modes
+    uint32_t objectCount = 1;        // Draw commands per frame, batched into one indirect draw
+    uint32_t instanceCount = 1;      // Instances per draw
+    std::string shaderSet = "shader";  // Pack entries <set>.vert/<set>.frag, or shaders/<set>.vert.spv/.frag.spv
+    std::string shaderPack = SHADER_PACK_FILE;
+    
+    // Headless benchmark: offscreen images, no window, a fixed number of frames
+    bool headless = false;
+    uint32_t width = WIDTH;
+    uint32_t height = HEIGHT;
+    uint32_t benchFrames = DEFAULT_BENCH_FRAMES;
+    uint32_t warmupFrames = DEFAULT_WARMUP_FRAMES;
+    std::string benchJson;           // Report file; none when empty
+};
+
+// Median and tail of a set of timings
+double percentile(const std::vector<double>& sorted, double p) {
+    size_t rank = static_cast<size_t>(p / 100.0 * (sorted.size() - 1) + 0.5);
+    return sorted[std::min(rank, sorted.size() - 1)];
+}
+
+void writeTimingJson(std::ostream& out, const std::vector<double>& samples) {
+    if (samples.empty()) {
+        out << "null";
+        return;
+    }
+    std::vector<double> sorted = samples;
+    std::sort(sorted.begin(), sorted.end());
+    double sum = 0.0;
+    for (double ms : sorted) {
+        sum += ms;
+    }
+    out << "{\"mean_ms\": " << sum / sorted.size()
+        << ", \"min_ms\": " << sorted.front()
+        << ", \"p50_ms\": " << percentile(sorted, 50)
+        << ", \"p90_ms\": " << percentile(sorted, 90)
+        << ", \"p99_ms\": " << percentile(sorted, 99)
+        << ", \"max_ms\": " << sorted.back() << "}";
+}
 
 class VulkanRenderer {
 public:
+    explicit VulkanRenderer(const RendererOptions& options)
+        : options(options), framesInFlight(options.framesInFlight),
+          vertexFormat(options.compactVertices ? VertexFormat::compact() : VertexFormat::standard()) {
+    }
+    
     void run() {
-        initWindow();
-        initVulkan();
-        mainLoop();
+        if (options.headless) {
+            initVulkan();
+            benchmarkLoop();
+        } else {
+            initWindow();
+            initVulkan();
+            mainLoop();
+        }
         cleanup();
     }
     
 private:
-    GLFWwindow* window = nullptr;
+    RendererOptions options;
+    uint32_t framesInFlight;  // Frame slots: sync objects, uniform regions, command pools, queries
+    VertexFormat vertexFormat;  // Of the mesh and every pipeline drawing it
+    
+    GLFWwindow* window = nullptr;    // Null when headless
     VulkanContext context;
     Swapchain* swapchain = nullptr;
+    OffscreenTarget* offscreen = nullptr;  // Drawn to instead of the swapchain when headless
+    PipelineCache* pipelineCache = nullptr;
+    ShaderLibrary* shaderLibrary = nullptr;  // Null when there is no shader pack
     Pipeline* pipeline = nullptr;
-    Mesh* mesh = nullptr;
+    ShaderHotReloader* shaderReloader = nullptr;
+    MeshBatch* meshBatch = nullptr;    // Every object's draw, issued as one indirect draw
+    uint32_t triangleMesh = 0;         // Mesh id in meshBatch
+    uint32_t meshVertexCount = 0;
+    uint32_t meshIndexCount = 0;
+    std::future<MeshOptimizer::Result> pendingGeometry;  // Optimized while the device is created
+    Buffer* instanceBuffer = nullptr;  // InstanceData for binding 1
+    uint32_t objectCount = 0;          // One draw of the mesh per object
+    uint32_t instancesPerObject = 1;   // Object i draws instances [i * instancesPerObject, (i + 1) * instancesPerObject)
+    UniformRing* uniforms = nullptr;
     
-    std::vector<VkCommandBuffer> commandBuffers;
+    CommandRecorder* recorder = nullptr;  // Per-frame primaries and parallel secondaries
+    GpuProfiler* profiler = nullptr;
+    FramePacer* pacer = nullptr;
+    double lastOverlayUpdate = 0.0;
     std::vector<VkSemaphore> imageAvailableSemaphores;
     std::vector<VkSemaphore> renderFinishedSemaphores;
     std::vector<VkFence> inFlightFences;
     std::vector<VkFence> imagesInFlight;  // Track which fence is using each swapchain image
     uint32_t currentFrame = 0;
     bool framebufferResized = false;
+    bool presentModeChangeRequested = false;  // P cycles through the supported present modes
+    
+    // Frames submitted so far; swapchain resources retired by a resize are
+    // released once every frame submitted before it has completed
+    uint64_t frameNumber = 0;
+    uint64_t swapchainRetiredAt = 0;
     
-    // Add throttling for resize events
-    double lastResizeTime = 0.0;
-    const double RESIZE_THROTTLE = 0.1; // 100ms minimum between recreations
+    // Pipelines replaced by a shader reload, freed once their frames retire
+    struct RetiredPipeline {
+        Pipeline* pipeline;
+        uint64_t retiredAt;
+    };
+    std::deque<RetiredPipeline> retiredPipelines;
     int resizeCount = 0;
+    
+    // Per measured frame of a headless run
+    struct BenchmarkSamples {
+        std::vector<double> frameMs;   // Fence wait + record + submit: the frame-to-frame interval
+        std::vector<double> recordMs;  // Record + submit
+        std::vector<double> gpuMs;     // Whole-frame GPU scope; empty without timestamp support
+        double elapsedMs = 0.0;        // First measured frame to the last one's submit
+        
+        // Pipeline statistics of the last measured frame that has them
+        bool hasStatistics = false;
+        uint64_t vertexInvocations = 0;
+        uint64_t fragmentInvocations = 0;
+    };
 
     void initWindow() {
         glfwInit();
@@ -48,6 +178,7 @@ private:
         window = glfwCreateWindow(WIDTH, HEIGHT, "Vulkan Triangle", nullptr, nullptr);
         glfwSetWindowUserPointer(window, this);
         glfwSetFramebufferSizeCallback(window, framebufferResizeCallback);
+        glfwSetKeyCallback(window, keyCallback);
     }
     
     static void framebufferResizeCallback(GLFWwindow* window, int width, int height) {
@@ -55,19 +186,52 @@ private:
         app->framebufferResized = true;
     }
     
+    static void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods) {
+        auto app = reinterpret_cast<VulkanRenderer*>(glfwGetWindowUserPointer(window));
+        if (key == GLFW_KEY_P && action == GLFW_PRESS) {
+            app->presentModeChangeRequested = true;
+        }
+    }
+    
     void initVulkan() {
-        std::cout << "Initializing Vulkan..." << std::endl;
+        // Asset preparation needs no device, so it overlaps with Vulkan setup
+        pendingGeometry = MeshOptimizer().optimizeAsync(createTriangleGeometry());
+        
+        std::cout << "Initializing Vulkan" << (options.headless ? " (headless)..." : "...") << std::endl;
         context.init(window);
         
-        std::cout << "Creating swapchain..." << std::endl;
-        swapchain = new Swapchain(&context, WIDTH, HEIGHT);
-        swapchain->create();
+        if (options.headless) {
+            // One image per frame in flight; nothing is presented
+            offscreen = new OffscreenTarget(&context, options.width, options.height, framesInFlight);
+            offscreen->create();
+            std::cout << "Offscreen target: " << options.width << "x" << options.height
+                      << ", " << framesInFlight << " frames in flight" << std::endl;
+        } else {
+            std::cout << "Creating swapchain..." << std::endl;
+            swapchain = new Swapchain(&context, WIDTH, HEIGHT, options.presentMode);
+            swapchain->create();
+            std::cout << "Present mode: " << Swapchain::presentModeName(swapchain->getPresentMode())
+                      << ", " << framesInFlight << " frames in flight" << std::endl;
+        }
+        
+        // Shared by every pipeline creation, including rebuilds on resize
+        pipelineCache = new PipelineCache(&context, PIPELINE_CACHE_FILE);
+        pipelineCache->create();
         
         std::cout << "Loading shaders..." << std::endl;
         // Load compiled SPIR-V shaders (ensure they exist in ./shaders)
-        pipeline = new Pipeline(&context, swapchain);
+        pipeline = new Pipeline(&context, swapchain, pipelineCache);
+        pipeline->setVertexFormat(vertexFormat);
+        if (offscreen) {
+            pipeline->setRenderPass(offscreen->getRenderPass());
+        }
         try {
-            pipeline->create("shaders/shader.vert.spv", "shaders/shader.frag.spv");
+            if (std::ifstream(options.shaderPack).good()) {
+                shaderLibrary = new ShaderLibrary(&context, options.shaderPack);
+                std::cout << "Shader pack: " << options.shaderPack << " (" << shaderLibrary->getPack().size()
+                          << " modules)" << std::endl;
+            }
+            createPipeline();
             std::cout << "Shaders loaded successfully!" << std::endl;
         } catch (const std::exception& e) {
             std::cerr << "Failed to load shaders: " << e.what() << std::endl;
@@ -76,49 +240,125 @@ private:
             throw;
         }
         
-        createCommandBuffers();
+        // Edits to the DSL sources replace the pipeline while running; a
+        // benchmark keeps the shaders it started with
+        if (!options.headless) {
+            shaderReloader = new ShaderHotReloader(&context, swapchain, pipelineCache,
+                                                   "shaders/shader.vert.dsl", "shaders/shader.frag.dsl", vertexFormat);
+            shaderReloader->start(swapchain->getRenderPass());
+        }
+        
+        // One region per frame in flight, bound through dynamic offsets
+        uniforms = new UniformRing(&context, framesInFlight);
+        uniforms->create(pipeline->getDescriptorSetLayout());
+        
+        recorder = new CommandRecorder(&context, framesInFlight);
+        recorder->create();
+        std::cout << "Recording on " << recorder->getThreadCount() << " worker threads" << std::endl;
+        
         createSyncObjects();
         createTriangleMesh();
         
+        profiler = new GpuProfiler(&context, framesInFlight, 64, true);
+        profiler->create();
+        if (profiler->isSupported() && !options.headless) {
+            profiler->setCsvOutput(GPU_PROFILE_CSV);
+        }
+        
+        if (options.headless) {
+            std::cout << "Vulkan initialized." << std::endl;
+            return;
+        }
+        
+        pacer = new FramePacer(&context, options.presentWait, options.maxQueuedPresents);
+        pacer->create();
+        if (options.presentWait && !pacer->isPacing()) {
+            std::cout << "VK_KHR_present_wait is not available; frames are not paced" << std::endl;
+        }
+        
         // Initialize images in flight tracking
         imagesInFlight.resize(swapchain->getImageViews().size(), VK_NULL_HANDLE);
         
         std::cout << "Vulkan initialized." << std::endl;
     }
     
-    void createTriangleMesh() {
-        mesh = new Mesh(&context);
+    // Modules come from the shader pack when there is one, loose .spv files otherwise
+    void createPipeline() {
+        const std::string& set = options.shaderSet;
+        if (shaderLibrary) {
+            pipeline->create(*shaderLibrary, set + ".vert", set + ".frag");
+        } else {
+            pipeline->create("shaders/" + set + ".vert.spv", "shaders/" + set + ".frag.spv");
+        }
+    }
+    
+    // Where frames are drawn: the swapchain, or the offscreen images when headless
+    VkRenderPass getRenderPass() const {
+        return offscreen ? offscreen->getRenderPass() : swapchain->getRenderPass();
+    }
+    
+    VkExtent2D getExtent() const {
+        return offscreen ? offscreen->getExtent() : swapchain->getExtent();
+    }
+    
+    static MeshGeometry createTriangleGeometry() {
         // Simple RGB triangle
-        std::vector<Vertex> vertices = {
+        MeshGeometry geometry;
+        geometry.vertices = {
             {{ 0.0f, -0.5f, 0.0f}, {1.0f, 0.0f, 0.0f}},
             {{-0.5f,  0.5f, 0.0f}, {0.0f, 0.0f, 1.0f}},
             {{ 0.5f,  0.5f, 0.0f}, {0.0f, 1.0f, 0.0f}}
         };
-
-        
-        mesh->setVertices(vertices);
-        
-        std::cout << "Created triangle mesh with " << vertices.size() << " vertices" << std::endl;
+        return geometry;
     }
     
-    void createCommandBuffers() {
-        commandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+    void createTriangleMesh() {
+        MeshOptimizer::Result optimized = pendingGeometry.get();
+        const MeshOptimizer::Stats& meshStats = optimized.stats;
+        std::cout << "Mesh optimizer: " << meshStats.vertexCountBefore << " -> " << meshStats.vertexCountAfter
+                  << " vertices, ACMR " << meshStats.acmrBefore << " -> " << meshStats.acmrAfter
+                  << " (" << meshStats.timeMs << " ms)" << std::endl;
         
-        VkCommandBufferAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-        allocInfo.commandPool = context.getCommandPool();
-        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-        allocInfo.commandBufferCount = (uint32_t)commandBuffers.size();
+        // One draw command per object, all in a single indirect draw
+        meshBatch = new MeshBatch(&context, framesInFlight, options.objectCount, vertexFormat);
+        triangleMesh = meshBatch->addMesh(optimized.geometry.vertices, optimized.geometry.indices);
+        meshBatch->build();
+        meshVertexCount = static_cast<uint32_t>(optimized.geometry.vertices.size());
+        meshIndexCount = static_cast<uint32_t>(optimized.geometry.indices.size());
         
-        if (vkAllocateCommandBuffers(context.getDevice(), &allocInfo, commandBuffers.data()) != VK_SUCCESS) {
-            throw std::runtime_error("failed to allocate command buffers!");
+        // Every instance of every object on a square grid over the viewport;
+        // a single instance is the untransformed triangle
+        instancesPerObject = options.instanceCount;
+        uint32_t instanceTotal = options.objectCount * options.instanceCount;
+        uint32_t columns = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(instanceTotal))));
+        float cellSize = 2.0f / columns;
+        
+        std::vector<InstanceData> instances(instanceTotal);
+        for (uint32_t i = 0; i < instanceTotal; i++) {
+            instances[i].offset = glm::vec3(-1.0f + cellSize * (i % columns + 0.5f),
+                                            -1.0f + cellSize * (i / columns + 0.5f), 0.0f);
+            instances[i].scale = 1.0f / columns;
         }
+        VkDeviceSize instanceSize = sizeof(InstanceData) * instances.size();
+        instanceBuffer = new Buffer(&context);
+        instanceBuffer->create(instanceSize,
+            VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        context.getUploadManager()->upload(*instanceBuffer, instances.data(), instanceSize);
+        objectCount = options.objectCount;
+        
+        std::cout << "Created triangle mesh with " << meshVertexCount << " vertices ("
+                  << vertexFormat.getStride() << " bytes each), " << objectCount << " objects x "
+                  << instancesPerObject << " instances, "
+                  << (meshBatch->usesMultiDrawIndirect() ? "one indirect draw" : "one direct draw per object")
+                  << std::endl;
+        context.getAllocator()->printStats();
     }
     
     void createSyncObjects() {
-        imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-        renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-        inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
+        imageAvailableSemaphores.resize(framesInFlight);
+        renderFinishedSemaphores.resize(framesInFlight);
+        inFlightFences.resize(framesInFlight);
         
         VkSemaphoreCreateInfo semaphoreInfo{};
         semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
@@ -127,7 +367,7 @@ private:
         fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
         fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
         
-        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        for (size_t i = 0; i < framesInFlight; i++) {
             if (vkCreateSemaphore(context.getDevice(), &semaphoreInfo, nullptr, &imageAvailableSemaphores[i]) != VK_SUCCESS ||
                 vkCreateSemaphore(context.getDevice(), &semaphoreInfo, nullptr, &renderFinishedSemaphores[i]) != VK_SUCCESS ||
                 vkCreateFence(context.getDevice(), &fenceInfo, nullptr, &inFlightFences[i]) != VK_SUCCESS) {
@@ -136,7 +376,6 @@ private:
         }
     }
 
-    // NEW: make swapchain recreation robust by fully tearing down per-frame resources
     void destroySyncObjects() {
         for (size_t i = 0; i < imageAvailableSemaphores.size(); i++) {
             if (renderFinishedSemaphores[i])
@@ -150,54 +389,242 @@ private:
         renderFinishedSemaphores.clear();
         inFlightFences.clear();
     }
-
-
-    // NEW: free command buffers so old references can't linger across many recreations
-    void freeCommandBuffers() {
-        if (!commandBuffers.empty()) {
-            vkFreeCommandBuffers(context.getDevice(), context.getCommandPool(),
-                                 static_cast<uint32_t>(commandBuffers.size()),
-                                 commandBuffers.data());
-            commandBuffers.clear();
-        }
-    }
-
     
     void mainLoop() {
         std::cout << "Entering render loop..." << std::endl;
         
         while (!glfwWindowShouldClose(window)) {
+            // Let the display catch up before sampling input, so the frame
+            // shows the newest input instead of waiting in the present queue
+            pacer->waitForPacing(swapchain->getSwapchain());
             glfwPollEvents();
+            pacer->beginFrame(frameNumber);
             
             // Check for ESC key
             if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
                 glfwSetWindowShouldClose(window, GLFW_TRUE);
             }
             
+            if (presentModeChangeRequested) {
+                presentModeChangeRequested = false;
+                cyclePresentMode();
+            }
+            
             drawFrame();
+            updateProfilerOverlay();
         }
         
         vkDeviceWaitIdle(context.getDevice());
         std::cout << "Exiting render loop..." << std::endl;
     }
     
+    // Fixed number of offscreen frames as fast as the GPU takes them; the
+    // warmup frames absorb the initial uploads and pipeline first-use costs
+    void benchmarkLoop() {
+        using Clock = std::chrono::steady_clock;
+        const uint64_t firstMeasured = options.warmupFrames;
+        const uint64_t endMeasured = firstMeasured + options.benchFrames;
+        std::cout << "Rendering " << options.warmupFrames << " warmup + " << options.benchFrames
+                  << " measured frames offscreen..." << std::endl;
+        
+        BenchmarkSamples samples;
+        samples.frameMs.reserve(options.benchFrames);
+        samples.recordMs.reserve(options.benchFrames);
+        uint64_t lastResolved = UINT64_MAX;
+        Clock::time_point measureStart;
+        
+        // GPU results resolve framesInFlight frames late, so the last measured
+        // frames are followed by as many unmeasured ones
+        while (frameNumber < endMeasured + framesInFlight) {
+            bool measured = frameNumber >= firstMeasured && frameNumber < endMeasured;
+            Clock::time_point start = Clock::now();
+            if (frameNumber == firstMeasured) {
+                measureStart = start;
+            }
+            
+            double recordMs = drawOffscreenFrame();
+            
+            Clock::time_point end = Clock::now();
+            if (measured) {
+                samples.frameMs.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+                samples.recordMs.push_back(recordMs);
+                samples.elapsedMs = std::chrono::duration<double, std::milli>(end - measureStart).count();
+            }
+            
+            const GpuProfiler::FrameResult* latest = profiler->getLatest();
+            if (latest && latest->frameNumber != lastResolved && !latest->scopes.empty() &&
+                latest->frameNumber >= firstMeasured && latest->frameNumber < endMeasured) {
+                lastResolved = latest->frameNumber;
+                samples.gpuMs.push_back(latest->scopes[0].durationMs);
+                if (latest->hasStatistics) {
+                    samples.hasStatistics = true;
+                    samples.vertexInvocations = latest->vertexInvocations;
+                    samples.fragmentInvocations = latest->fragmentInvocations;
+                }
+            }
+        }
+        
+        vkDeviceWaitIdle(context.getDevice());
+        printBenchmarkSummary(samples);
+        
+        if (!options.benchJson.empty()) {
+            std::ofstream file(options.benchJson);
+            writeBenchmarkJson(file, samples);
+            if (!file) {
+                throw std::runtime_error("failed to write benchmark report!");
+            }
+            std::cout << "Benchmark report written to " << options.benchJson << std::endl;
+        }
+    }
+    
+    // One headless frame into this slot's offscreen image; no image is
+    // acquired, so only the uploads are waited on. Returns the CPU time spent
+    // recording and submitting
+    double drawOffscreenFrame() {
+        vkWaitForFences(context.getDevice(), 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+        auto recordStart = std::chrono::steady_clock::now();
+        
+        uniforms->beginFrame(currentFrame);
+        recorder->beginFrame(currentFrame);
+        vkResetFences(context.getDevice(), 1, &inFlightFences[currentFrame]);
+        
+        VkCommandBuffer commandBuffer = recorder->getPrimaryCommandBuffer();
+        recordCommandBuffer(commandBuffer, offscreen->getFramebuffers()[currentFrame]);
+        
+        UploadManager* uploads = context.getUploadManager();
+        uploads->submit();
+        
+        VkSemaphore waitSemaphores[] = {uploads->getTimelineSemaphore()};
+        VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_VERTEX_INPUT_BIT};
+        uint64_t waitValues[] = {uploads->getLastSubmittedValue()};
+        
+        VkTimelineSemaphoreSubmitInfo timelineInfo{};
+        timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+        timelineInfo.waitSemaphoreValueCount = 1;
+        timelineInfo.pWaitSemaphoreValues = waitValues;
+        
+        VkSubmitInfo submitInfo{};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.pNext = &timelineInfo;
+        submitInfo.waitSemaphoreCount = 1;
+        submitInfo.pWaitSemaphores = waitSemaphores;
+        submitInfo.pWaitDstStageMask = waitStages;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &commandBuffer;
+        
+        if (vkQueueSubmit(context.getGraphicsQueue(), 1, &submitInfo, inFlightFences[currentFrame]) != VK_SUCCESS) {
+            throw std::runtime_error("failed to submit draw command buffer!");
+        }
+        frameNumber++;
+        currentFrame = (currentFrame + 1) % framesInFlight;
+        
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - recordStart).count();
+    }
+    
+    void printBenchmarkSummary(const BenchmarkSamples& samples) const {
+        auto report = [](const char* name, const std::vector<double>& values) {
+            if (values.empty()) {
+                return;
+            }
+            std::vector<double> sorted = values;
+            std::sort(sorted.begin(), sorted.end());
+            std::cout << "  " << std::left << std::setw(16) << name << std::right
+                      << std::setw(9) << percentile(sorted, 50) << " ms p50"
+                      << std::setw(9) << percentile(sorted, 90) << " ms p90"
+                      << std::setw(9) << percentile(sorted, 99) << " ms p99" << std::endl;
+        };
+        
+        std::cout << "=== Headless Benchmark ===" << std::endl;
+        std::cout << std::fixed << std::setprecision(3);
+        std::cout << samples.frameMs.size() << " frames in " << samples.elapsedMs << " ms ("
+                  << samples.frameMs.size() * 1000.0 / std::max(samples.elapsedMs, 1e-9) << " fps)" << std::endl;
+        report("frame", samples.frameMs);
+        report("record + submit", samples.recordMs);
+        report("gpu frame", samples.gpuMs);
+        if (samples.hasStatistics) {
+            std::cout << "  VS " << samples.vertexInvocations << " FS " << samples.fragmentInvocations
+                      << " invocations per frame" << std::endl;
+        }
+        std::cout << std::defaultfloat;
+        context.getAllocator()->printStats();
+    }
+    
+    // Same layout as compiler_bench --json, so CI can keep both side by side
+    void writeBenchmarkJson(std::ostream& out, const BenchmarkSamples& samples) const {
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(context.getPhysicalDevice(), &properties);
+        
+        out << std::fixed << std::setprecision(6);
+        out << "{\n";
+        out << "  \"benchmark\": \"renderer_bench\",\n";
+        out << "  \"device\": {\"name\": \"" << properties.deviceName << "\", \"vendor_id\": " << properties.vendorID
+            << ", \"device_id\": " << properties.deviceID << ", \"driver_version\": " << properties.driverVersion
+            << ", \"api_version\": \"" << VK_VERSION_MAJOR(properties.apiVersion) << "."
+            << VK_VERSION_MINOR(properties.apiVersion) << "." << VK_VERSION_PATCH(properties.apiVersion) << "\"},\n";
+        out << "  \"config\": {\"width\": " << options.width << ", \"height\": " << options.height
+            << ", \"frames\": " << options.benchFrames << ", \"warmup\": " << options.warmupFrames
+            << ", \"frames_in_flight\": " << framesInFlight << ", \"objects\": " << objectCount
+            << ", \"instances\": " << instancesPerObject << ", \"shader_set\": \"" << options.shaderSet << "\""
+            << ", \"shader_pack\": " << (shaderLibrary ? "\"" + options.shaderPack + "\"" : std::string("null"))
+            << ", \"vertex_format\": \"" << (options.compactVertices ? "compact" : "standard") << "\""
+            << ", \"vertices\": " << meshVertexCount << ", \"indices\": " << meshIndexCount
+            << ", \"multi_draw_indirect\": " << (meshBatch->usesMultiDrawIndirect() ? "true" : "false")
+            << ", \"recording_threads\": " << recorder->getThreadCount() << "},\n";
+        out << "  \"elapsed_ms\": " << samples.elapsedMs << ",\n";
+        out << "  \"fps\": " << samples.frameMs.size() * 1000.0 / std::max(samples.elapsedMs, 1e-9) << ",\n";
+        out << "  \"frame_time\": ";
+        writeTimingJson(out, samples.frameMs);
+        out << ",\n  \"cpu_record\": ";
+        writeTimingJson(out, samples.recordMs);
+        out << ",\n  \"gpu_time\": ";
+        writeTimingJson(out, samples.gpuMs);
+        out << ",\n  \"pipeline_statistics\": ";
+        if (samples.hasStatistics) {
+            out << "{\"vertex_invocations\": " << samples.vertexInvocations
+                << ", \"fragment_invocations\": " << samples.fragmentInvocations << "}";
+        } else {
+            out << "null";
+        }
+        out << ",\n  \"memory_heaps\": [";
+        
+        // Every resource of the run is still alive, so this is its footprint
+        const VkPhysicalDeviceMemoryProperties& memory = context.getAllocator()->getMemoryProperties();
+        for (uint32_t heap = 0; heap < memory.memoryHeapCount; heap++) {
+            MemoryAllocator::HeapStats stats = context.getAllocator()->getHeapStats(heap);
+            out << (heap == 0 ? "\n" : ",\n") << "    {\"index\": " << heap
+                << ", \"device_local\": "
+                << ((memory.memoryHeaps[heap].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) ? "true" : "false")
+                << ", \"heap_size\": " << stats.heapSize << ", \"allocated_bytes\": " << stats.allocatedBytes
+                << ", \"used_bytes\": " << stats.usedBytes << ", \"blocks\": " << stats.blockCount
+                << ", \"dedicated\": " << stats.dedicatedCount << ", \"allocations\": " << stats.allocationCount << "}";
+        }
+        out << "\n  ]\n}\n";
+    }
+    
     void drawFrame() {
+        pacer->beginStage(FramePacer::Stage::FenceWait);
         vkWaitForFences(context.getDevice(), 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+        pacer->endStage(FramePacer::Stage::FenceWait);
+        
+        // This frame's fence covers every frame up to frameNumber - framesInFlight
+        if (swapchain->hasRetired() && frameNumber >= swapchainRetiredAt + framesInFlight) {
+            swapchain->releaseRetired();
+        }
+        
+        swapReloadedPipeline();
+        
+        // The fence also covers this frame's uniform region and command pools
+        uniforms->beginFrame(currentFrame);
+        recorder->beginFrame(currentFrame);
         
         uint32_t imageIndex;
+        pacer->beginStage(FramePacer::Stage::Acquire);
         VkResult result = vkAcquireNextImageKHR(context.getDevice(), swapchain->getSwapchain(), UINT64_MAX,
                                                imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
+        pacer->endStage(FramePacer::Stage::Acquire);
         
         if (result == VK_ERROR_OUT_OF_DATE_KHR) {
-            // Throttle resize events
-            double currentTime = glfwGetTime();
-            if (currentTime - lastResizeTime >= RESIZE_THROTTLE) {
-                lastResizeTime = currentTime;
-                recreateSwapchain();
-            } else {
-                // Avoid busy-spin when skipping a frame due to resize
-                std::this_thread::sleep_for(std::chrono::milliseconds(16));
-            }
+            recreateSwapchain();
             return;
         } else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
             throw std::runtime_error("failed to acquire swap chain image!");
@@ -205,7 +632,9 @@ private:
         
         // Check if a previous frame is using this image (wait for it to finish)
         if (imagesInFlight[imageIndex] != VK_NULL_HANDLE) {
+            pacer->beginStage(FramePacer::Stage::FenceWait);
             vkWaitForFences(context.getDevice(), 1, &imagesInFlight[imageIndex], VK_TRUE, UINT64_MAX);
+            pacer->endStage(FramePacer::Stage::FenceWait);
         }
         // Mark the image as now being in use by this frame
         imagesInFlight[imageIndex] = inFlightFences[currentFrame];
@@ -213,19 +642,36 @@ private:
         // Only reset fence after we know we will submit work
         vkResetFences(context.getDevice(), 1, &inFlightFences[currentFrame]);
         
-        vkResetCommandBuffer(commandBuffers[currentFrame], 0);
-        recordCommandBuffer(commandBuffers[currentFrame], imageIndex);
+        pacer->beginStage(FramePacer::Stage::Record);
+        VkCommandBuffer commandBuffer = recorder->getPrimaryCommandBuffer();
+        recordCommandBuffer(commandBuffer, swapchain->getFramebuffers()[imageIndex]);
+        
+        // Flush uploads queued since the last frame; the GPU waits for them
+        // before vertex input, the CPU never does
+        UploadManager* uploads = context.getUploadManager();
+        uploads->submit();
         
         VkSubmitInfo submitInfo{};
         submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
         
-        VkSemaphore waitSemaphores[] = {imageAvailableSemaphores[currentFrame]};
-        VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-        submitInfo.waitSemaphoreCount = 1;
+        VkSemaphore waitSemaphores[] = {imageAvailableSemaphores[currentFrame], uploads->getTimelineSemaphore()};
+        VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT};
+        uint64_t waitValues[] = {0, uploads->getLastSubmittedValue()};  // Binary semaphores ignore their value
+        uint64_t signalValues[] = {0};
+        
+        VkTimelineSemaphoreSubmitInfo timelineInfo{};
+        timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+        timelineInfo.waitSemaphoreValueCount = 2;
+        timelineInfo.pWaitSemaphoreValues = waitValues;
+        timelineInfo.signalSemaphoreValueCount = 1;
+        timelineInfo.pSignalSemaphoreValues = signalValues;
+        submitInfo.pNext = &timelineInfo;
+        
+        submitInfo.waitSemaphoreCount = 2;
         submitInfo.pWaitSemaphores = waitSemaphores;
         submitInfo.pWaitDstStageMask = waitStages;
         submitInfo.commandBufferCount = 1;
-        submitInfo.pCommandBuffers = &commandBuffers[currentFrame];
+        submitInfo.pCommandBuffers = &commandBuffer;
         
         VkSemaphore signalSemaphores[] = {renderFinishedSemaphores[currentFrame]};
         submitInfo.signalSemaphoreCount = 1;
@@ -234,6 +680,8 @@ private:
         if (vkQueueSubmit(context.getGraphicsQueue(), 1, &submitInfo, inFlightFences[currentFrame]) != VK_SUCCESS) {
             throw std::runtime_error("failed to submit draw command buffer!");
         }
+        frameNumber++;
+        pacer->endStage(FramePacer::Stage::Record);
         
         VkPresentInfoKHR presentInfo{};
         presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
@@ -244,28 +692,68 @@ private:
         presentInfo.swapchainCount = 1;
         presentInfo.pSwapchains = swapChains;
         presentInfo.pImageIndices = &imageIndex;
+        pacer->preparePresent(presentInfo);
         
+        pacer->beginStage(FramePacer::Stage::Present);
         result = vkQueuePresentKHR(context.getPresentQueue(), &presentInfo);
+        pacer->endStage(FramePacer::Stage::Present);
+        pacer->endFrame();
         
         if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || framebufferResized) {
             framebufferResized = false;
-            // Throttle resize events
-            double currentTime = glfwGetTime();
-            if (currentTime - lastResizeTime >= RESIZE_THROTTLE) {
-                lastResizeTime = currentTime;
-                recreateSwapchain();
-            } else {
-                // Avoid busy-spin when skipping a frame due to resize
-                std::this_thread::sleep_for(std::chrono::milliseconds(16));
-            }
+            recreateSwapchain();
         } else if (result != VK_SUCCESS) {
             throw std::runtime_error("failed to present swap chain image!");
         }
         
-        currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+        currentFrame = (currentFrame + 1) % framesInFlight;
+    }
+    
+    // GPU time of the latest resolved frame and CPU timings of the latest
+    // completed frame in the window title, twice a second
+    void updateProfilerOverlay() {
+        double now = glfwGetTime();
+        const GpuProfiler::FrameResult* latest = profiler->getLatest();
+        if (!latest || latest->scopes.empty() || now - lastOverlayUpdate < 0.5) {
+            return;
+        }
+        lastOverlayUpdate = now;
+        
+        std::ostringstream title;
+        title << std::fixed << std::setprecision(3)
+              << "Vulkan Triangle | GPU " << latest->scopes[0].durationMs << " ms";
+        if (latest->hasStatistics) {
+            title << " | VS " << latest->vertexInvocations << " FS " << latest->fragmentInvocations;
+        }
+        
+        const FramePacer::FrameTimings* timings = pacer->getLatest();
+        if (timings) {
+            title << " | CPU " << timings->recordMs << " ms, fences " << timings->fenceWaitMs << " ms";
+            if (timings->inputToPresentMs >= 0.0) {
+                title << " | latency " << timings->inputToPresentMs << " ms";
+            }
+        }
+        title << " | " << Swapchain::presentModeName(swapchain->getPresentMode());
+        glfwSetWindowTitle(window, title.str().c_str());
+    }
+    
+    // Frame boundary: nothing recorded yet uses the current pipeline
+    void swapReloadedPipeline() {
+        std::unique_ptr<Pipeline> reloaded = shaderReloader->takeReadyPipeline();
+        if (reloaded) {
+            retiredPipelines.push_back({pipeline, frameNumber});
+            pipeline = reloaded.release();
+        }
+        
+        // Same rule as retired swapchains: frames before frameNumber - framesInFlight are done
+        while (!retiredPipelines.empty() &&
+               frameNumber >= retiredPipelines.front().retiredAt + framesInFlight) {
+            delete retiredPipelines.front().pipeline;
+            retiredPipelines.pop_front();
+        }
     }
     
-    void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex) {
+    void recordCommandBuffer(VkCommandBuffer commandBuffer, VkFramebuffer framebuffer) {
         VkCommandBufferBeginInfo beginInfo{};
         beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
         
@@ -273,49 +761,95 @@ private:
             throw std::runtime_error("failed to begin recording command buffer!");
         }
         
+        profiler->beginFrame(commandBuffer, currentFrame, frameNumber);
+        
         VkRenderPassBeginInfo renderPassInfo{};
         renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-        renderPassInfo.renderPass = swapchain->getRenderPass();
-        renderPassInfo.framebuffer = swapchain->getFramebuffers()[imageIndex];
+        renderPassInfo.renderPass = getRenderPass();
+        renderPassInfo.framebuffer = framebuffer;
         renderPassInfo.renderArea.offset = {0, 0};
-        renderPassInfo.renderArea.extent = swapchain->getExtent();
+        renderPassInfo.renderArea.extent = getExtent();
         
         VkClearValue clearColor = {{{0.0f, 0.0f, 0.0f, 1.0f}}};
         renderPassInfo.clearValueCount = 1;
         renderPassInfo.pClearValues = &clearColor;
         
-        vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline->getPipeline());
+        // Uniform data is written here; the ring is not shared with the workers
+        ObjectUniforms objectUniforms{};
+        objectUniforms.mvp = glm::mat4(1.0f);
+        uint32_t uniformOffset = uniforms->push(objectUniforms);
+        
+        profiler->beginStatistics(commandBuffer);
+        uint32_t renderPassScope = profiler->beginScope(commandBuffer, "render pass");
+        vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
         
-        mesh->draw(commandBuffer);
+        VkCommandBufferInheritanceInfo inheritance{};
+        inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+        inheritance.renderPass = getRenderPass();
+        inheritance.subpass = 0;
+        inheritance.framebuffer = framebuffer;
+        inheritance.pipelineStatistics = profiler->getInheritedStatistics();
         
-        vkCmdDraw(commandBuffer, mesh->getVertexCount(), 1, 0, 0);
+        // One draw command per object; the fence waited on covers this
+        // frame's region of the indirect buffer
+        meshBatch->beginFrame(currentFrame);
+        for (uint32_t object = 0; object < objectCount; object++) {
+            meshBatch->addDraw(triangleMesh, instancesPerObject, object * instancesPerObject);
+        }
+        
+        // The whole batch is a single indirect draw, so one secondary holds it
+        std::vector<VkCommandBuffer> secondaries = recorder->recordSecondaries(inheritance, 1,
+            [&](VkCommandBuffer secondary, uint32_t, uint32_t) {
+                recordBatch(secondary, uniformOffset);
+            });
+        
+        if (!secondaries.empty()) {
+            vkCmdExecuteCommands(commandBuffer, static_cast<uint32_t>(secondaries.size()), secondaries.data());
+        }
         
         vkCmdEndRenderPass(commandBuffer);
+        profiler->endScope(commandBuffer, renderPassScope);
+        profiler->endStatistics(commandBuffer);
+        profiler->endFrame(commandBuffer);
         
         if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
             throw std::runtime_error("failed to record command buffer!");
         }
     }
     
+    // Secondaries inherit no state: bind everything, then draw the batch
+    void recordBatch(VkCommandBuffer commandBuffer, uint32_t uniformOffset) {
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline->getPipeline());
+        
+        // Viewport and scissor are dynamic pipeline state
+        VkExtent2D extent = getExtent();
+        
+        VkViewport viewport{};
+        viewport.x = 0.0f;
+        viewport.y = 0.0f;
+        viewport.width = (float)extent.width;
+        viewport.height = (float)extent.height;
+        viewport.minDepth = 0.0f;
+        viewport.maxDepth = 1.0f;
+        vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+        
+        VkRect2D scissor{};
+        scissor.offset = {0, 0};
+        scissor.extent = extent;
+        vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+        
+        // Both bindings are dynamic and each needs an offset. The renderer's
+        // fragment shader declares no uniforms, so binding 1 is never read and
+        // points at the vertex block
+        uint32_t dynamicOffsets[] = {uniformOffset, uniformOffset};
+        VkDescriptorSet descriptorSet = uniforms->getDescriptorSet();
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline->getLayout(),
+                                0, 1, &descriptorSet, 2, dynamicOffsets);
+        
+        meshBatch->record(commandBuffer, *instanceBuffer);
+    }
+    
     void recreateSwapchain() {
-        // Debounce: wait for a short stable window (no size change)
-        auto stable_for_ms = [&](int ms) {
-            int w0, h0;
-            glfwGetFramebufferSize(window, &w0, &h0);
-            double start = glfwGetTime();
-            while ((glfwGetTime() - start) * 1000.0 < ms) {
-                int w1, h1;
-                glfwGetFramebufferSize(window, &w1, &h1);
-                if (w1 != w0 || h1 != h0) { // size changed; restart timer
-                    w0 = w1; h0 = h1;
-                    start = glfwGetTime();
-                }
-                glfwWaitEventsTimeout(0.01);
-            }
-        };
-        stable_for_ms(75);
-
         int width = 0, height = 0;
         glfwGetFramebufferSize(window, &width, &height);
         while (width == 0 || height == 0) {
@@ -327,63 +861,179 @@ private:
         std::cout << "Recreating swapchain #" << resizeCount
                   << " (" << width << "x" << height << ")..." << std::endl;
 
-        // 1) Ensure all GPU work referencing current swapchain is complete
-        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-            if (i < inFlightFences.size() && inFlightFences[i])
-                vkWaitForFences(context.getDevice(), 1, &inFlightFences[i], VK_TRUE, UINT64_MAX);
-        }
-        // IMPORTANT: make both queues idle (present can still be using old swapchain)
-        vkQueueWaitIdle(context.getGraphicsQueue());
-        vkQueueWaitIdle(context.getPresentQueue());
-
-        // 2) Now it's safe to tear down per-frame resources bound to the old swapchain
-        freeCommandBuffers();
-        destroySyncObjects();
-
-        // 3) Tear down pipeline (depends on render pass) and rebuild around new swapchain
-        pipeline->cleanup();
-        swapchain->recreate(width, height);
+        // No device stall: the old swapchain, image views and framebuffers are
+        // retired and released from drawFrame() once the frames using them retire.
+        // Command buffers are re-recorded every frame and sync objects do not
+        // depend on the swapchain, so both are kept as they are
+        bool renderPassChanged = swapchain->recreate(width, height);
+        swapchainRetiredAt = frameNumber;
+        pacer->resetSwapchain();
 
-        // Recreate pipeline with new extent
-        pipeline->create("shaders/shader.vert.spv", "shaders/shader.frag.spv");
-
-        // Recreate per-frame resources
-        createCommandBuffers();
-        createSyncObjects();
+        if (renderPassChanged) {
+            // Surface format changed (rare): the pipeline was built against the old render pass
+            vkDeviceWaitIdle(context.getDevice());
+            pipeline->cleanup();
+            createPipeline();
+            
+            // Reloaded shaders are rebuilt for the new render pass in the background
+            shaderReloader->setRenderPass(swapchain->getRenderPass());
+        }
 
         // Reset image tracking to match the new image count
         imagesInFlight.assign(swapchain->getImageViews().size(), VK_NULL_HANDLE);
-
-        std::cout << "Swapchain recreation #" << resizeCount << " complete" << std::endl;
     }
-
+    
+    // Switch to the next present mode the surface supports; applied by a swapchain recreate
+    void cyclePresentMode() {
+        const VkPresentModeKHR modes[] = {
+            VK_PRESENT_MODE_FIFO_KHR,
+            VK_PRESENT_MODE_FIFO_RELAXED_KHR,
+            VK_PRESENT_MODE_MAILBOX_KHR,
+            VK_PRESENT_MODE_IMMEDIATE_KHR
+        };
+        const size_t modeCount = sizeof(modes) / sizeof(modes[0]);
+        
+        size_t index = std::find(modes, modes + modeCount, swapchain->getPresentMode()) - modes;
+        for (size_t step = 1; step < modeCount; step++) {
+            VkPresentModeKHR next = modes[(index + step) % modeCount];
+            if (swapchain->isPresentModeSupported(next)) {
+                swapchain->setPreferredPresentMode(next);
+                std::cout << "Present mode: " << Swapchain::presentModeName(next) << std::endl;
+                recreateSwapchain();
+                return;
+            }
+        }
+    }
     
     void cleanup() {
         // Make sure GPU is fully idle
         vkQueueWaitIdle(context.getGraphicsQueue());
-        vkQueueWaitIdle(context.getPresentQueue());
+        if (!context.isHeadless()) {
+            vkQueueWaitIdle(context.getPresentQueue());
+        }
         vkDeviceWaitIdle(context.getDevice());
 
-        // Free cmd buffers explicitly (optional but tidy)
-        freeCommandBuffers();
-
-        for (size_t i = 0; i < imageAvailableSemaphores.size(); i++) {
-            vkDestroySemaphore(context.getDevice(), renderFinishedSemaphores[i], nullptr);
-            vkDestroySemaphore(context.getDevice(), imageAvailableSemaphores[i], nullptr);
-            vkDestroyFence(context.getDevice(), inFlightFences[i], nullptr);
+        delete recorder;  // Joins the workers and destroys their pools
+        
+        if (profiler->isSupported() && profiler->writeChromeTrace(GPU_TRACE_FILE)) {
+            std::cout << "GPU trace written to " << GPU_TRACE_FILE << std::endl;
+        }
+        delete profiler;
+        if (pacer) {
+            pacer->printStats();
         }
+        delete pacer;
+        destroySyncObjects();
 
-        delete mesh;
+        delete meshBatch;
+        delete instanceBuffer;
+        delete uniforms;
+        delete shaderReloader;  // Joins the watcher thread
+        for (auto& retired : retiredPipelines) {
+            delete retired.pipeline;
+        }
+        retiredPipelines.clear();
         delete pipeline;
+        delete shaderLibrary;  // Destroys the pack's modules and unmaps it
+        delete pipelineCache;  // Writes the cache back to disk
         delete swapchain;
+        delete offscreen;
 
-        glfwDestroyWindow(window);
-        glfwTerminate();
+        if (window) {
+            glfwDestroyWindow(window);
+            glfwTerminate();
+        }
     }
 };
 
-int main() {
-    VulkanRenderer app;
+void printUsage(const char* programName) {
+    std::cout << "Usage: " << programName << " [options]\n";
+    std::cout << "Options:\n";
+    std::cout << "  --present-mode <mode>       mailbox (default), immediate, fifo or fifo-relaxed\n";
+    std::cout << "  --frames-in-flight <n>      Frames the CPU may record ahead of the GPU (1-" << MAX_FRAMES_IN_FLIGHT
+              << ", default " << DEFAULT_FRAMES_IN_FLIGHT << ")\n";
+    std::cout << "  --present-wait              Pace frames on VK_KHR_present_wait and report input-to-present latency\n";
+    std::cout << "  --max-queued-presents <n>   Presents allowed to wait for the display when pacing (default 1)\n";
+    std::cout << "  --vertex-format <format>    compact (default: half-float position, RGBA8 color) or standard (32-bit floats)\n";
+    std::cout << "  --objects <n>               Draw calls per frame (default 1)\n";
+    std::cout << "  --instances <n>             Instances per draw (default 1)\n";
+    std::cout << "  --shader-set <name>         Shaders <name>.vert/<name>.frag from the pack or shaders/ (default shader)\n";
+    std::cout << "  --shader-pack <file>        Shader pack to load (default " << SHADER_PACK_FILE << ")\n";
+    std::cout << "Headless benchmark:\n";
+    std::cout << "  --headless                  Render offscreen without a window and exit after a fixed number of frames\n";
+    std::cout << "  --frames <n>                Measured frames (default " << DEFAULT_BENCH_FRAMES << ")\n";
+    std::cout << "  --warmup <n>                Unmeasured frames first (default " << DEFAULT_WARMUP_FRAMES << ")\n";
+    std::cout << "  --resolution <w>x<h>        Offscreen image size (default " << WIDTH << "x" << HEIGHT << ")\n";
+    std::cout << "  --bench-json <file>         Write frame-time percentiles, GPU times and memory usage as JSON\n";
+    std::cout << "Press P while running to cycle through the supported present modes\n";
+}
+
+int main(int argc, char* argv[]) {
+    RendererOptions options;
+    
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--present-mode") == 0 && i + 1 < argc) {
+            if (!Swapchain::parsePresentMode(argv[++i], options.presentMode)) {
+                std::cerr << "Error: Unknown present mode '" << argv[i] << "'" << std::endl;
+                return EXIT_FAILURE;
+            }
+        } else if (strcmp(argv[i], "--frames-in-flight") == 0 && i + 1 < argc) {
+            int frames = atoi(argv[++i]);
+            if (frames < 1 || frames > static_cast<int>(MAX_FRAMES_IN_FLIGHT)) {
+                std::cerr << "Error: --frames-in-flight must be between 1 and " << MAX_FRAMES_IN_FLIGHT << std::endl;
+                return EXIT_FAILURE;
+            }
+            options.framesInFlight = static_cast<uint32_t>(frames);
+        } else if (strcmp(argv[i], "--present-wait") == 0) {
+            options.presentWait = true;
+        } else if (strcmp(argv[i], "--max-queued-presents") == 0 && i + 1 < argc) {
+            options.maxQueuedPresents = static_cast<uint32_t>(std::max(1, atoi(argv[++i])));
+        } else if (strcmp(argv[i], "--vertex-format") == 0 && i + 1 < argc) {
+            std::string format = argv[++i];
+            if (format != "compact" && format != "standard") {
+                std::cerr << "Error: Unknown vertex format '" << format << "'" << std::endl;
+                return EXIT_FAILURE;
+            }
+            options.compactVertices = format == "compact";
+        } else if (strcmp(argv[i], "--objects") == 0 && i + 1 < argc) {
+            options.objectCount = static_cast<uint32_t>(std::max(1, atoi(argv[++i])));
+        } else if (strcmp(argv[i], "--instances") == 0 && i + 1 < argc) {
+            options.instanceCount = static_cast<uint32_t>(std::max(1, atoi(argv[++i])));
+        } else if (strcmp(argv[i], "--shader-set") == 0 && i + 1 < argc) {
+            options.shaderSet = argv[++i];
+        } else if (strcmp(argv[i], "--shader-pack") == 0 && i + 1 < argc) {
+            options.shaderPack = argv[++i];
+        } else if (strcmp(argv[i], "--headless") == 0) {
+            options.headless = true;
+        } else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            options.benchFrames = static_cast<uint32_t>(std::max(1, atoi(argv[++i])));
+        } else if (strcmp(argv[i], "--warmup") == 0 && i + 1 < argc) {
+            options.warmupFrames = static_cast<uint32_t>(std::max(0, atoi(argv[++i])));
+        } else if (strcmp(argv[i], "--resolution") == 0 && i + 1 < argc) {
+            int width = 0, height = 0;
+            if (sscanf(argv[++i], "%dx%d", &width, &height) != 2 || width < 1 || height < 1) {
+                std::cerr << "Error: --resolution expects <width>x<height>, got '" << argv[i] << "'" << std::endl;
+                return EXIT_FAILURE;
+            }
+            options.width = static_cast<uint32_t>(width);
+            options.height = static_cast<uint32_t>(height);
+        } else if (strcmp(argv[i], "--bench-json") == 0 && i + 1 < argc) {
+            options.benchJson = argv[++i];
+        } else if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0) {
+            printUsage(argv[0]);
+            return EXIT_SUCCESS;
+        } else {
+            std::cerr << "Error: Unknown option '" << argv[i] << "'" << std::endl;
+            printUsage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    
+    if (!options.headless && (!options.benchJson.empty() || options.width != WIDTH || options.height != HEIGHT)) {
+        std::cerr << "Warning: --resolution and --bench-json only apply with --headless" << std::endl;
+    }
+    
+    VulkanRenderer app(options);
     
     try {
         app.run();
@@ -1,11 +1,27 @@
 #include "shader_compiler.h"
+#include "codegen.h"
+#include "batch_compiler.h"
+#include "compile_server.h"
+#include "shader_pack.h"
+#include "spirv_reflect.h"
+#include "compile_trace.h"
 #include <iostream>
 #include <fstream>
+#include <sstream>
+#include <csignal>
 #include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#include <filesystem>
+#include <vector>
 
 void printUsage(const char* programName) {
     std::cout << "Vulkan Shader Compiler - Custom DSL to SPIR-V\n" << std::endl;
     std::cout << "Usage: " << programName << " <input.dsl> -o <output.spv> -t <vertex|fragment> [options]\n";
+    std::cout << "       " << programName << " --batch <a.vert.dsl> <b.frag.dsl> ... [-o <dir>] [options]\n";
+    std::cout << "       " << programName << " --manifest <shaders.txt> [options]\n";
+    std::cout << "       " << programName << " --daemon <socket> [-j <n>] [--cache-dir <d>] [--memory-cache-mb <n>]\n";
+    std::cout << "       " << programName << " --server <socket> <input.dsl> ... [options]\n";
     std::cout << "\nRequired Arguments:\n";
     std::cout << "  <input.dsl>     Input shader file in custom DSL format\n";
     std::cout << "  -o <file>       Output SPIR-V file\n";
@@ -15,14 +31,408 @@ void printUsage(const char* programName) {
     std::cout << "  --stats         Show detailed compilation statistics\n";
     std::cout << "  --verbose       Enable verbose compilation output\n";
     std::cout << "  --glsl          Output generated GLSL to stdout (for debugging)\n";
+    std::cout << "  --reflect       Print the module's interface: input and output\n";
+    std::cout << "                  locations, uniform blocks and specialization constants\n";
+    std::cout << "  --backend <b>   SPIR-V backend: 'glslang' (in-process), 'validator'\n";
+    std::cout << "                  (spawns glslangValidator) or 'native' (AST -> SPIR-V,\n";
+    std::cout << "                  no GLSL). Default: "
+              << CodeGenerator::backendName(CodeGenerator::defaultBackend()) << "\n";
+    std::cout << "  --spirv-opt     Shrink the SPIR-V: strip debug names, merge duplicate\n";
+    std::cout << "                  types and constants, drop unused ids and renumber\n";
+    std::cout << "  --cache-dir <d> Reuse SPIR-V from (and store it to) a content-addressed\n";
+    std::cout << "                  cache keyed by source, type, options and compiler version\n";
+    std::cout << "  --permutations <f>  Compile one variant per line of <f>,\n";
+    std::cout << "                  '<name> [CONSTANT=value ...]', parsing the shader once;\n";
+    std::cout << "                  variant <name> is written to <output>.<name>.spv\n";
+    std::cout << "  --compare-backends  Also compile with every available backend and\n";
+    std::cout << "                  report codegen timings and SPIR-V sizes side by side\n";
+    std::cout << "  --trace <f>     Write a Chrome trace (chrome://tracing, Perfetto) of every\n";
+    std::cout << "                  stage and optimizer pass to <f>; works with --batch\n";
     std::cout << "  --help, -h      Show this help message\n";
+    std::cout << "\nBatch Mode:\n";
+    std::cout << "  --batch         Compile every input file; the type is inferred from\n";
+    std::cout << "                  '.vert'/'.frag' in the name (or forced with -t) and -o\n";
+    std::cout << "                  names an output directory (default: next to the input)\n";
+    std::cout << "  --manifest <f>  Compile the jobs listed in <f>, one\n";
+    std::cout << "                  '<input> <vertex|fragment> [output]' per line\n";
+    std::cout << "  -j <n>          Worker threads (default: one per hardware thread)\n";
+    std::cout << "  --pack <f>      Write every module into the shader pack <f>, with its\n";
+    std::cout << "                  reflection, instead of one .spv per shader; a module is\n";
+    std::cout << "                  named after its output file without '.spv'\n";
+    std::cout << "\nCompile Server:\n";
+    std::cout << "  --daemon <s>    Serve compile requests on the Unix socket <s> until\n";
+    std::cout << "                  interrupted; compiled SPIR-V is kept in memory\n";
+    std::cout << "  --memory-cache-mb <n>  Memory cache size for --daemon (default: 64)\n";
+    std::cout << "  --server <s>    Send the shaders to the daemon on <s> as one batch\n";
+    std::cout << "                  instead of compiling them here; takes the same\n";
+    std::cout << "                  inputs, -o and -t as a single or --batch compile\n";
     std::cout << "\nExamples:\n";
     std::cout << "  # Compile vertex shader with optimizations\n";
     std::cout << "  " << programName << " shader.vert.dsl -o shader.vert.spv -t vertex\n\n";
     std::cout << "  # Compile fragment shader without optimizations\n";
     std::cout << "  " << programName << " shader.frag.dsl -o shader.frag.spv -t fragment --no-opt\n\n";
     std::cout << "  # Compile with detailed statistics\n";
-    std::cout << "  " << programName << " shader.vert.dsl -o shader.vert.spv -t vertex --stats --verbose\n";
+    std::cout << "  " << programName << " shader.vert.dsl -o shader.vert.spv -t vertex --stats --verbose\n\n";
+    std::cout << "  # Compile a directory of shaders on all cores\n";
+    std::cout << "  " << programName << " --batch shaders/*.dsl -o build/shaders --stats\n\n";
+    std::cout << "  # Keep a compiler running and send it shaders\n";
+    std::cout << "  " << programName << " --daemon /tmp/myshaderc.sock --cache-dir .shader-cache &\n";
+    std::cout << "  " << programName << " --server /tmp/myshaderc.sock shaders/*.dsl -o build/shaders\n";
+}
+
+// An empty path means tracing is off
+void writeTrace(const std::string& traceFile, const CompileTrace& trace) {
+    if (traceFile.empty()) {
+        return;
+    }
+    if (trace.writeChromeTrace(traceFile)) {
+        std::cout << "Trace written to: " << traceFile << std::endl;
+    } else {
+        std::cerr << "Warning: failed to write trace file: " << traceFile << std::endl;
+    }
+}
+
+// shader.frag.spv + "lit" -> shader.frag.lit.spv
+std::string permutationOutputFile(const std::string& outputFile, const std::string& name) {
+    size_t slash = outputFile.find_last_of('/');
+    size_t dot = outputFile.find_last_of('.');
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+        return outputFile + "." + name;
+    }
+    return outputFile.substr(0, dot) + "." + name + outputFile.substr(dot);
+}
+
+int runPermutations(ShaderCompiler& compiler, const std::string& inputFile, const std::string& outputFile,
+                    const std::string& shaderType, const std::vector<ShaderPermutation>& permutations,
+                    bool showStats) {
+    std::cout << "Compiling " << permutations.size() << " permutations..." << std::endl;
+    auto modules = compiler.compilePermutationsFromFile(inputFile, shaderType, permutations);
+    
+    for (size_t i = 0; i < permutations.size(); i++) {
+        std::string variantFile = permutationOutputFile(outputFile, permutations[i].name);
+        std::ofstream outFile(variantFile, std::ios::binary);
+        if (!outFile.is_open()) {
+            std::cerr << "Error: Failed to open output file: " << variantFile << std::endl;
+            return 1;
+        }
+        outFile.write(reinterpret_cast<const char*>(modules[i].data()), modules[i].size() * sizeof(uint32_t));
+        
+        std::cout << "  " << permutations[i].name << " -> " << variantFile << " ("
+                  << modules[i].size() * sizeof(uint32_t) << " bytes)" << std::endl;
+    }
+    
+    if (showStats) {
+        // Parsed once, optimized and generated once per permutation
+        const auto& stats = compiler.getStats();
+        std::cout << "\n=== Permutation Statistics ===" << std::endl;
+        std::cout << "  Total:        " << stats.totalTimeMs << " ms" << std::endl;
+        std::cout << "  Lex + Parse:  " << stats.parsingTimeMs << " ms (once)" << std::endl;
+        std::cout << "  Optimization: " << stats.optimizationTimeMs << " ms" << std::endl;
+        std::cout << "  Code Gen:     " << stats.codegenTimeMs << " ms" << std::endl;
+        std::cout << "  Constants folded: " << stats.constantsFolded << std::endl;
+        std::cout << "  Dead code eliminated: " << stats.deadCodeEliminated << std::endl;
+        if (stats.cacheHits + stats.cacheMisses > 0) {
+            std::cout << "  Cache hits: " << stats.cacheHits << "/" << stats.cacheHits + stats.cacheMisses << std::endl;
+        }
+        std::cout << "==============================" << std::endl;
+    }
+    
+    std::cout << "\nSuccess! You can now use this SPIR-V with Vulkan." << std::endl;
+    return 0;
+}
+
+// GLSL spelling of a reflected type: float, vec3, ivec2, mat4, ...
+std::string reflectedTypeName(ShaderReflection::ScalarType type, uint32_t components, uint32_t columns) {
+    const char* scalar = "?";
+    const char* prefix = "";
+    switch (type) {
+        case ShaderReflection::ScalarType::FLOAT: scalar = "float"; break;
+        case ShaderReflection::ScalarType::INT: scalar = "int"; prefix = "i"; break;
+        case ShaderReflection::ScalarType::UINT: scalar = "uint"; prefix = "u"; break;
+        case ShaderReflection::ScalarType::BOOL: scalar = "bool"; prefix = "b"; break;
+        default: break;
+    }
+    if (columns > 1) {
+        return std::string(prefix) + "mat" + std::to_string(columns);
+    }
+    return components > 1 ? std::string(prefix) + "vec" + std::to_string(components) : scalar;
+}
+
+void printReflection(const ShaderReflection& reflection) {
+    const char* stage = reflection.stage == ShaderReflection::Stage::VERTEX ? "vertex" :
+                        reflection.stage == ShaderReflection::Stage::FRAGMENT ? "fragment" : "other";
+    std::cout << "\n=== Reflection ===" << std::endl;
+    std::cout << "Stage: " << stage << ", entry point '" << reflection.entryPoint << "'" << std::endl;
+    
+    for (const auto* variables : {&reflection.inputs, &reflection.outputs}) {
+        std::cout << (variables == &reflection.inputs ? "Inputs:" : "Outputs:") << std::endl;
+        for (const auto& variable : *variables) {
+            std::cout << "  location " << variable.location << ": "
+                      << reflectedTypeName(variable.type, variable.components, variable.columns) << " "
+                      << (variable.name.empty() ? "(unnamed)" : variable.name) << std::endl;
+        }
+    }
+    
+    std::cout << "Uniform blocks:" << std::endl;
+    for (const auto& block : reflection.uniformBlocks) {
+        std::cout << "  set " << block.set << ", binding " << block.binding << ": "
+                  << (block.name.empty() ? "(unnamed)" : block.name) << " (" << block.sizeBytes << " bytes)" << std::endl;
+    }
+    
+    std::cout << "Specialization constants:" << std::endl;
+    for (const auto& constant : reflection.specConstants) {
+        std::cout << "  id " << constant.id << ": " << reflectedTypeName(constant.type, 1, 1) << " "
+                  << (constant.name.empty() ? "(unnamed)" : constant.name) << " = ";
+        if (constant.type == ShaderReflection::ScalarType::FLOAT) {
+            float value;
+            std::memcpy(&value, &constant.defaultBits, sizeof(value));
+            std::cout << value;
+        } else if (constant.type == ShaderReflection::ScalarType::BOOL) {
+            std::cout << (constant.defaultBits ? "true" : "false");
+        } else if (constant.type == ShaderReflection::ScalarType::INT) {
+            std::cout << static_cast<int32_t>(constant.defaultBits);
+        } else {
+            std::cout << constant.defaultBits;
+        }
+        std::cout << std::endl;
+    }
+    std::cout << "==================" << std::endl;
+}
+
+// shaders/water.frag.spv -> water.frag
+std::string packEntryName(const std::string& outputFile) {
+    std::string name = outputFile.substr(outputFile.find_last_of('/') + 1);
+    if (name.size() > 4 && name.compare(name.size() - 4, 4, ".spv") == 0) {
+        name.resize(name.size() - 4);
+    }
+    return name;
+}
+
+// Only a fully successful batch replaces the pack, so a renderer never
+// loads one with shaders missing
+int writePack(const std::string& packFile, ShaderPackWriter& pack, size_t failed) {
+    if (failed > 0) {
+        std::cerr << "Shader pack not written: " << failed << " shader(s) failed" << std::endl;
+        return 1;
+    }
+    pack.write(packFile);
+    std::cout << "Pack:      " << packFile << " (" << pack.size() << " modules)" << std::endl;
+    return 0;
+}
+
+// One line per failed job, the same for local and server batches
+void printJobFailure(const std::string& inputFile, const std::string& error) {
+    std::cerr << "  FAIL  " << inputFile << ": " << error.substr(0, error.find('\n')) << std::endl;
+}
+
+int runBatch(const std::vector<BatchJob>& jobs, const BatchCompiler::Options& options, const std::string& packFile,
+             bool showStats) {
+    BatchCompiler batch(options);
+    
+    std::cout << "=== Vulkan Shader Compiler (batch) ===" << std::endl;
+    std::cout << "Jobs:    " << jobs.size() << std::endl;
+    std::cout << "Threads: " << BatchCompiler::resolveThreadCount(options.threadCount, jobs.size()) << std::endl;
+    std::cout << "Optimization: " << (options.optimizationEnabled ? "enabled" : "disabled") << std::endl;
+    std::cout << "Backend: " << CodeGenerator::backendName(options.backend) << std::endl;
+    if (options.spirvOptimizationEnabled) {
+        std::cout << "SPIR-V optimization: enabled" << std::endl;
+    }
+    if (!options.cacheDirectory.empty()) {
+        std::cout << "Cache:   " << options.cacheDirectory << std::endl;
+    }
+    std::cout << "======================================\n" << std::endl;
+    
+    auto results = batch.run(jobs);
+    
+    ShaderPackWriter pack;
+    for (size_t i = 0; i < jobs.size(); i++) {
+        if (results[i].success && !packFile.empty()) {
+            std::string name = packEntryName(jobs[i].outputFile);
+            pack.add(name, std::move(results[i].spirv));
+            std::cout << "  ok    " << jobs[i].inputFile << " -> " << packFile << ":" << name << std::endl;
+        } else if (results[i].success) {
+            std::cout << "  ok    " << jobs[i].inputFile << " -> " << jobs[i].outputFile << std::endl;
+        } else {
+            printJobFailure(jobs[i].inputFile, results[i].error);
+        }
+    }
+    
+    const auto& summary = batch.getSummary();
+    const auto& totals = summary.totals;
+    
+    std::cout << "\n=== Batch Summary ===" << std::endl;
+    std::cout << "Succeeded: " << summary.succeeded << "/" << jobs.size() << std::endl;
+    std::cout << "Failed:    " << summary.failed << std::endl;
+    std::cout << "Wall time: " << summary.wallTimeMs << " ms on " << summary.threadCount << " threads" << std::endl;
+    std::cout << "SPIR-V:    " << totals.spirvSizeBytes << " bytes total";
+    if (options.spirvOptimizationEnabled) {
+        std::cout << " (" << totals.originalSpirvSizeBytes << " before SPIR-V optimization)";
+    }
+    std::cout << std::endl;
+    
+    if (showStats) {
+        // Stage times are summed over jobs, so they exceed the wall time when running in parallel
+        std::cout << "\nTiming (summed over jobs):" << std::endl;
+        std::cout << "  Total:        " << totals.totalTimeMs << " ms" << std::endl;
+        std::cout << "  Lex + Parse:  " << totals.parsingTimeMs << " ms" << std::endl;
+        std::cout << "  Optimization: " << totals.optimizationTimeMs << " ms" << std::endl;
+        std::cout << "  Code Gen:     " << totals.codegenTimeMs << " ms" << std::endl;
+        if (options.spirvOptimizationEnabled) {
+            std::cout << "  SPIR-V Opt:   " << totals.spirvOptimizationTimeMs << " ms" << std::endl;
+        }
+        if (summary.wallTimeMs > 0.0) {
+            std::cout << "  Compile time / wall time: " << totals.totalTimeMs / summary.wallTimeMs << "x" << std::endl;
+        }
+        
+        if (!options.cacheDirectory.empty()) {
+            std::cout << "\nCache:" << std::endl;
+            std::cout << "  Hits: " << totals.cacheHits << std::endl;
+            std::cout << "  Misses: " << totals.cacheMisses << std::endl;
+        }
+        
+        std::cout << "\nTotals:" << std::endl;
+        std::cout << "  Tokens: " << totals.tokenCount << std::endl;
+        std::cout << "  AST Nodes: " << totals.astNodeCount << std::endl;
+        std::cout << "  Statements: " << totals.originalStatementCount 
+                  << " -> " << totals.optimizedStatementCount << std::endl;
+        if (options.optimizationEnabled) {
+            std::cout << "  Constants folded: " << totals.constantsFolded << std::endl;
+            std::cout << "  Algebraic simplifications: " << totals.algebraicSimplifications << std::endl;
+            std::cout << "  Dead code eliminated: " << totals.deadCodeEliminated << std::endl;
+            std::cout << "  Common subexpressions eliminated: " << totals.commonSubexpressionsEliminated << std::endl;
+        }
+    }
+    
+    std::cout << "=====================" << std::endl;
+    
+    if (!packFile.empty()) {
+        return writePack(packFile, pack, summary.failed);
+    }
+    return summary.failed == 0 ? 0 : 1;
+}
+
+int runDaemon(const CompileServer::Options& options) {
+    // Blocked before the server starts so every thread inherits the mask and
+    // the signals are only ever taken by sigwait below
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+    
+    CompileServer server(options);
+    server.start();
+    
+    std::cout << "=== Vulkan Shader Compiler (daemon) ===" << std::endl;
+    std::cout << "Socket:  " << options.socketPath << std::endl;
+    std::cout << "Threads: " << server.getThreadCount() << std::endl;
+    std::cout << "Memory cache: " << options.memoryCacheBytes / (1024 * 1024) << " MB" << std::endl;
+    if (!options.cacheDirectory.empty()) {
+        std::cout << "Cache:   " << options.cacheDirectory << std::endl;
+    }
+    std::cout << "=======================================" << std::endl;
+    
+    int signal = 0;
+    sigwait(&signals, &signal);
+    server.stop();
+    
+    auto stats = server.getStats();
+    std::cout << "\n=== Daemon Summary ===" << std::endl;
+    std::cout << "Connections: " << stats.connections << std::endl;
+    std::cout << "Batches:     " << stats.batches << std::endl;
+    std::cout << "Shaders:     " << stats.shaders << " (" << stats.failures << " failed)" << std::endl;
+    std::cout << "Memory cache: " << stats.memoryCache.hits << " hits, " << stats.memoryCache.misses
+              << " misses, " << stats.memoryCache.evictions << " evictions, "
+              << stats.memoryCache.entries << " entries (" << stats.memoryCache.bytes << " bytes)" << std::endl;
+    std::cout << "======================" << std::endl;
+    
+    return 0;
+}
+
+int runClient(const std::string& socketPath, const std::vector<BatchJob>& jobs, bool optimizationEnabled,
+              SpirvBackend backend, bool spirvOptimizationEnabled, const std::string& packFile, bool showStats) {
+    std::vector<CompileRequest> requests;
+    for (const auto& job : jobs) {
+        std::ifstream file(job.inputFile, std::ios::binary);
+        if (!file.is_open()) {
+            throw std::runtime_error("Failed to open shader file: " + job.inputFile);
+        }
+        std::ostringstream source;
+        source << file.rdbuf();
+        
+        CompileRequest request;
+        request.name = job.inputFile;
+        request.shaderType = job.shaderType;
+        request.source = source.str();
+        request.optimizationEnabled = optimizationEnabled;
+        request.backend = backend;
+        request.spirvOptimizationEnabled = spirvOptimizationEnabled;
+        requests.push_back(std::move(request));
+    }
+    
+    CompileClient client(socketPath);
+    auto responses = client.compile(requests);
+    
+    size_t failed = 0;
+    size_t cached = 0;
+    double serverTimeMs = 0.0;
+    ShaderPackWriter pack;
+    for (size_t i = 0; i < jobs.size(); i++) {
+        auto& response = responses[i];
+        if (!response.success) {
+            printJobFailure(jobs[i].inputFile, response.error);
+            failed++;
+            continue;
+        }
+        
+        cached += response.cache != CompileResponse::CacheResult::MISS;
+        serverTimeMs += response.compileTimeMs;
+        
+        if (!packFile.empty()) {
+            std::string name = packEntryName(jobs[i].outputFile);
+            pack.add(name, std::move(response.spirv));
+            std::cout << "  ok    " << jobs[i].inputFile << " -> " << packFile << ":" << name << std::endl;
+            continue;
+        }
+        
+        // Output directories are created like BatchCompiler does for local jobs
+        std::filesystem::path outputPath(jobs[i].outputFile);
+        if (outputPath.has_parent_path()) {
+            std::error_code ec;
+            std::filesystem::create_directories(outputPath.parent_path(), ec);
+        }
+        
+        std::ofstream outFile(jobs[i].outputFile, std::ios::binary);
+        if (!outFile.is_open()) {
+            printJobFailure(jobs[i].inputFile, "Failed to open output file: " + jobs[i].outputFile);
+            failed++;
+            continue;
+        }
+        outFile.write(reinterpret_cast<const char*>(response.spirv.data()), 
+                      response.spirv.size() * sizeof(uint32_t));
+        if (!outFile) {
+            printJobFailure(jobs[i].inputFile, "Failed to write output file: " + jobs[i].outputFile);
+            failed++;
+            continue;
+        }
+        
+        const char* source = response.cache == CompileResponse::CacheResult::MEMORY ? " (memory cache)" :
+                             response.cache == CompileResponse::CacheResult::DISK ? " (disk cache)" : "";
+        std::cout << "  ok    " << jobs[i].inputFile << " -> " << jobs[i].outputFile << source << std::endl;
+    }
+    
+    if (showStats) {
+        std::cout << "\n=== Server Summary ===" << std::endl;
+        std::cout << "Succeeded: " << jobs.size() - failed << "/" << jobs.size() << std::endl;
+        std::cout << "Cached:    " << cached << std::endl;
+        std::cout << "Compile time (server, summed): " << serverTimeMs << " ms" << std::endl;
+        std::cout << "======================" << std::endl;
+    }
+    
+    if (!packFile.empty()) {
+        return writePack(packFile, pack, failed);
+    }
+    return failed == 0 ? 0 : 1;
 }
 
 int main(int argc, char* argv[]) {
@@ -32,19 +442,28 @@ int main(int argc, char* argv[]) {
         return argc < 2 ? 1 : 0;
     }
     
-    if (argc < 6) {
-        std::cerr << "Error: Missing required arguments\n" << std::endl;
-        printUsage(argv[0]);
-        return 1;
-    }
-    
     std::string inputFile;
+    std::vector<std::string> batchInputs;
+    std::string manifestFile;
+    bool batchMode = false;
+    unsigned threadCount = 0;
     std::string outputFile;
     std::string shaderType;
     bool enableOpt = true;
+    bool enableSpirvOpt = false;
     bool showStats = false;
     bool verbose = false;
     bool showGLSL = false;
+    bool showReflection = false;
+    bool compareBackends = false;
+    std::string cacheDir;
+    std::string permutationsFile;
+    std::string packFile;
+    std::string daemonSocket;
+    std::string serverSocket;
+    std::string traceFile;
+    size_t memoryCacheMb = 64;
+    SpirvBackend backend = CodeGenerator::defaultBackend();
     
     // Parse command line arguments
     for (int i = 1; i < argc; i++) {
@@ -54,14 +473,134 @@ int main(int argc, char* argv[]) {
             shaderType = argv[++i];
         } else if (strcmp(argv[i], "--no-opt") == 0) {
             enableOpt = false;
+        } else if (strcmp(argv[i], "--spirv-opt") == 0) {
+            enableSpirvOpt = true;
         } else if (strcmp(argv[i], "--stats") == 0) {
             showStats = true;
         } else if (strcmp(argv[i], "--verbose") == 0) {
             verbose = true;
         } else if (strcmp(argv[i], "--glsl") == 0) {
             showGLSL = true;
-        } else if (inputFile.empty() && argv[i][0] != '-') {
-            inputFile = argv[i];
+        } else if (strcmp(argv[i], "--reflect") == 0) {
+            showReflection = true;
+        } else if (strcmp(argv[i], "--cache-dir") == 0 && i + 1 < argc) {
+            cacheDir = argv[++i];
+        } else if (strcmp(argv[i], "--batch") == 0) {
+            batchMode = true;
+        } else if (strcmp(argv[i], "--manifest") == 0 && i + 1 < argc) {
+            manifestFile = argv[++i];
+        } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            threadCount = static_cast<unsigned>(std::max(0, atoi(argv[++i])));
+        } else if (strcmp(argv[i], "--pack") == 0 && i + 1 < argc) {
+            packFile = argv[++i];
+        } else if (strcmp(argv[i], "--permutations") == 0 && i + 1 < argc) {
+            permutationsFile = argv[++i];
+        } else if (strcmp(argv[i], "--daemon") == 0 && i + 1 < argc) {
+            daemonSocket = argv[++i];
+        } else if (strcmp(argv[i], "--server") == 0 && i + 1 < argc) {
+            serverSocket = argv[++i];
+        } else if (strcmp(argv[i], "--memory-cache-mb") == 0 && i + 1 < argc) {
+            memoryCacheMb = static_cast<size_t>(std::max(0, atoi(argv[++i])));
+        } else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            traceFile = argv[++i];
+        } else if (strcmp(argv[i], "--compare-backends") == 0) {
+            compareBackends = true;
+        } else if (strcmp(argv[i], "--backend") == 0 && i + 1 < argc) {
+            std::string backendArg = argv[++i];
+            if (!CodeGenerator::parseBackendName(backendArg, backend)) {
+                std::cerr << "Error: Unknown backend '" << backendArg << "'" << std::endl;
+                std::cerr << "Must be 'glslang', 'validator' or 'native'\n" << std::endl;
+                return 1;
+            }
+        } else if (argv[i][0] != '-') {
+            batchInputs.push_back(argv[i]);
+            if (inputFile.empty()) {
+                inputFile = argv[i];
+            }
+        }
+    }
+    
+    if (!CodeGenerator::isBackendAvailable(backend)) {
+        std::cerr << "Error: Backend '" << CodeGenerator::backendName(backend) 
+                  << "' is not available in this build" << std::endl;
+        std::cerr << "Rebuild with glslang installed or use --backend validator\n" << std::endl;
+        return 1;
+    }
+    
+    // Spans are only recorded when a trace file was asked for
+    CompileTrace trace;
+    CompileTrace* tracePtr = traceFile.empty() ? nullptr : &trace;
+    
+    // Daemon mode: compile whatever clients send until interrupted
+    if (!daemonSocket.empty()) {
+        try {
+            CompileServer::Options options;
+            options.socketPath = daemonSocket;
+            options.threadCount = threadCount;
+            options.cacheDirectory = cacheDir;
+            options.memoryCacheBytes = memoryCacheMb * 1024 * 1024;
+            return runDaemon(options);
+        } catch (const std::exception& e) {
+            std::cerr << "\n=== Error ===" << std::endl;
+            std::cerr << e.what() << std::endl;
+            std::cerr << "=============\n" << std::endl;
+            return 1;
+        }
+    }
+    
+    // Batch mode: many shaders on a thread pool (or on a running daemon)
+    if (batchMode || !manifestFile.empty() || !serverSocket.empty() || !packFile.empty()) {
+        if (!shaderType.empty() && !ShaderCompiler::isValidShaderType(shaderType)) {
+            std::cerr << "Error: Invalid shader type '" << shaderType << "'" << std::endl;
+            std::cerr << "Must be 'vertex' or 'fragment'\n" << std::endl;
+            return 1;
+        }
+        
+        try {
+            std::vector<BatchJob> jobs;
+            if (!manifestFile.empty()) {
+                jobs = BatchCompiler::parseManifest(manifestFile);
+            }
+            if (!batchMode && manifestFile.empty() && batchInputs.size() == 1 && !outputFile.empty() &&
+                !shaderType.empty()) {
+                // A single compile sent to the daemon: -o is the output file, not a directory
+                jobs.push_back({inputFile, outputFile, shaderType});
+            } else {
+                for (const auto& input : batchInputs) {
+                    // -t forces the type of every listed file, otherwise it comes from the name
+                    BatchJob job = BatchCompiler::jobForFile(input, outputFile, shaderType);
+                    jobs.push_back(std::move(job));
+                }
+            }
+            
+            if (jobs.empty()) {
+                std::cerr << "Error: No input files specified\n" << std::endl;
+                printUsage(argv[0]);
+                return 1;
+            }
+            
+            if (!serverSocket.empty()) {
+                return runClient(serverSocket, jobs, enableOpt, backend, enableSpirvOpt, packFile, showStats);
+            }
+            
+            BatchCompiler::Options options;
+            options.optimizationEnabled = enableOpt;
+            options.backend = backend;
+            options.spirvOptimizationEnabled = enableSpirvOpt;
+            options.cacheDirectory = cacheDir;
+            options.threadCount = threadCount;
+            options.keepSpirv = !packFile.empty();
+            options.trace = tracePtr;
+            
+            int status = runBatch(jobs, options, packFile, showStats);
+            writeTrace(traceFile, trace);
+            return status;
+            
+        } catch (const std::exception& e) {
+            std::cerr << "\n=== Error ===" << std::endl;
+            std::cerr << e.what() << std::endl;
+            std::cerr << "=============\n" << std::endl;
+            return 1;
         }
     }
     
@@ -90,18 +629,43 @@ int main(int argc, char* argv[]) {
         return 1;
     }
     
+    // Outside the try, so a failed compile can still show its GLSL
+    ShaderCompiler compiler;
+    
     try {
         std::cout << "=== Vulkan Shader Compiler ===" << std::endl;
         std::cout << "Input:  " << inputFile << std::endl;
         std::cout << "Output: " << outputFile << std::endl;
         std::cout << "Type:   " << shaderType << std::endl;
         std::cout << "Optimization: " << (enableOpt ? "enabled" : "disabled") << std::endl;
+        std::cout << "Backend: " << CodeGenerator::backendName(backend) << std::endl;
+        if (enableSpirvOpt) {
+            std::cout << "SPIR-V optimization: enabled" << std::endl;
+        }
+        if (!cacheDir.empty()) {
+            std::cout << "Cache:  " << cacheDir << std::endl;
+        }
         std::cout << "==============================\n" << std::endl;
         
-        // Create compiler instance
-        ShaderCompiler compiler;
+        // Configure compiler instance
         compiler.setOptimizationEnabled(enableOpt);
         compiler.setVerbose(verbose);
+        compiler.setBackend(backend);
+        compiler.setSpirvOptimizationEnabled(enableSpirvOpt);
+        compiler.setCacheDirectory(cacheDir);
+        compiler.setTrace(tracePtr);
+        
+        // A shader family: one module per permutation from a single parse
+        if (!permutationsFile.empty()) {
+            auto permutations = ShaderCompiler::parsePermutationFile(permutationsFile);
+            if (permutations.empty()) {
+                std::cerr << "Error: No permutations in " << permutationsFile << std::endl;
+                return 1;
+            }
+            int status = runPermutations(compiler, inputFile, outputFile, shaderType, permutations, showStats);
+            writeTrace(traceFile, trace);
+            return status;
+        }
         
         // Compile shader
         std::cout << "Compiling..." << std::endl;
@@ -129,6 +693,11 @@ int main(int argc, char* argv[]) {
             std::cout << "======================" << std::endl;
         }
         
+        // What the renderer binds the module by, read back from the SPIR-V itself
+        if (showReflection) {
+            printReflection(ShaderReflection::fromSpirv(spirv.data(), spirv.size()));
+        }
+        
         // Show statistics if requested
         if (showStats) {
             auto stats = compiler.getStats();
@@ -138,10 +707,21 @@ int main(int argc, char* argv[]) {
             // Timing
             std::cout << "\nTiming:" << std::endl;
             std::cout << "  Total:        " << stats.totalTimeMs << " ms" << std::endl;
-            std::cout << "  Lexing:       " << stats.lexingTimeMs << " ms" << std::endl;
-            std::cout << "  Parsing:      " << stats.parsingTimeMs << " ms" << std::endl;
+            std::cout << "  Lex + Parse:  " << stats.parsingTimeMs << " ms" << std::endl;
             std::cout << "  Optimization: " << stats.optimizationTimeMs << " ms" << std::endl;
             std::cout << "  Code Gen:     " << stats.codegenTimeMs << " ms" << std::endl;
+            std::cout << "    GLSL emit:  " << stats.glslGenerationTimeMs << " ms" << std::endl;
+            std::cout << "    SPIR-V:     " << stats.spirvGenerationTimeMs << " ms" << std::endl;
+            if (enableSpirvOpt) {
+                std::cout << "  SPIR-V Opt:   " << stats.spirvOptimizationTimeMs << " ms" << std::endl;
+            }
+            
+            // Cache stats
+            if (!cacheDir.empty()) {
+                std::cout << "\nCache:" << std::endl;
+                std::cout << "  Hits: " << stats.cacheHits << std::endl;
+                std::cout << "  Misses: " << stats.cacheMisses << std::endl;
+            }
             
             // Lexer stats
             std::cout << "\nLexer:" << std::endl;
@@ -150,6 +730,7 @@ int main(int argc, char* argv[]) {
             // Parser stats
             std::cout << "\nParser:" << std::endl;
             std::cout << "  AST Nodes: " << stats.astNodeCount << std::endl;
+            std::cout << "  AST Arena: " << stats.astArenaBytes << " bytes" << std::endl;
             std::cout << "  Statements: " << stats.originalStatementCount << std::endl;
             
             // Optimization stats
@@ -159,6 +740,7 @@ int main(int argc, char* argv[]) {
                 std::cout << "  Constants folded: " << stats.constantsFolded << std::endl;
                 std::cout << "  Algebraic simplifications: " << stats.algebraicSimplifications << std::endl;
                 std::cout << "  Dead code eliminated: " << stats.deadCodeEliminated << std::endl;
+                std::cout << "  Common subexpressions eliminated: " << stats.commonSubexpressionsEliminated << std::endl;
                 std::cout << "  Statements: " << stats.originalStatementCount 
                           << " -> " << stats.optimizedStatementCount;
                 
@@ -178,17 +760,81 @@ int main(int argc, char* argv[]) {
             std::cout << "  SPIR-V size: " << stats.spirvSizeBytes << " bytes" << std::endl;
             std::cout << "  SPIR-V instructions: " << stats.spirvInstructionCount << " words" << std::endl;
             
+            if (enableSpirvOpt) {
+                std::cout << "\nSPIR-V Optimizer:" << std::endl;
+                std::cout << "  Size: " << stats.originalSpirvSizeBytes << " -> " << stats.spirvSizeBytes << " bytes";
+                if (stats.originalSpirvSizeBytes > 0 && stats.spirvSizeBytes < stats.originalSpirvSizeBytes) {
+                    float percent = 100.0f * (stats.originalSpirvSizeBytes - stats.spirvSizeBytes) /
+                                    stats.originalSpirvSizeBytes;
+                    std::cout << " (" << percent << "% reduction)";
+                }
+                std::cout << std::endl;
+                std::cout << "  Instructions: " << stats.originalSpirvInstructionCount << " -> "
+                          << stats.spirvInstructionCount << " words" << std::endl;
+            }
+            
             std::cout << "==============================" << std::endl;
         }
         
+        // A/B the backends on the same input
+        if (compareBackends) {
+            std::cout << "\n=== Backend Comparison ===" << std::endl;
+            
+            for (SpirvBackend candidate : {SpirvBackend::EXTERNAL_VALIDATOR, 
+                                           SpirvBackend::GLSLANG_LIBRARY,
+                                           SpirvBackend::NATIVE}) {
+                std::cout << "  " << CodeGenerator::backendName(candidate) << ": ";
+                
+                if (!CodeGenerator::isBackendAvailable(candidate)) {
+                    std::cout << "not available" << std::endl;
+                    continue;
+                }
+                
+                try {
+                    ShaderCompiler candidateCompiler;
+                    candidateCompiler.setOptimizationEnabled(enableOpt);
+                    candidateCompiler.setBackend(candidate);
+                    candidateCompiler.setSpirvOptimizationEnabled(enableSpirvOpt);
+                    auto candidateSpirv = candidateCompiler.compileFromFile(inputFile, shaderType);
+                    auto candidateStats = candidateCompiler.getStats();
+                    
+                    std::cout << candidateStats.codegenTimeMs << " ms codegen ("
+                              << candidateStats.glslGenerationTimeMs << " ms GLSL, "
+                              << candidateStats.spirvGenerationTimeMs << " ms SPIR-V), "
+                              << candidateSpirv.size() * sizeof(uint32_t) << " bytes" << std::endl;
+                } catch (const std::exception& e) {
+                    std::string message = e.what();
+                    std::cout << "failed: " << message.substr(0, message.find('\n')) << std::endl;
+                }
+            }
+            
+            std::cout << "==========================" << std::endl;
+        }
+        
+        writeTrace(traceFile, trace);
         std::cout << "\nSuccess! You can now use this SPIR-V with Vulkan." << std::endl;
         
         return 0;
         
     } catch (const ShaderCompilationError& e) {
         std::cerr << "\n=== Compilation Failed ===" << std::endl;
-        std::cerr << e.what() << std::endl;
+        if (e.hasLocation()) {
+            // file:line:column, as editors expect
+            std::cerr << inputFile << ":" << e.getLine() << ":" << e.getColumn() << ": "
+                      << ShaderCompilationError::stageName(e.getStage()) << " error: " << e.getMessage() << std::endl;
+        } else {
+            std::cerr << e.what() << std::endl;
+        }
         std::cerr << "==========================\n" << std::endl;
+        
+        // The message never includes the GLSL; it is shown on request
+        if (showGLSL && e.getStage() == ShaderCompilationError::Stage::CODE_GENERATION &&
+            !compiler.getGeneratedGLSL().empty()) {
+            std::cerr << "=== Generated GLSL ===" << std::endl;
+            std::cerr << compiler.getGeneratedGLSL() << std::endl;
+            std::cerr << "======================\n" << std::endl;
+        }
+        writeTrace(traceFile, trace);
         return 1;
         
     } catch (const std::exception& e) {